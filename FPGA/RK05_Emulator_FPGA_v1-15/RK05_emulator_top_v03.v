@@ -11,6 +11,7 @@
 `include "drive_select.v"
 `include "sdram_controller.v"
 `include "sector_and_index.v"
+`include "sector_crc_check.v"
 `include "seek_to_cylinder.v"
 `include "spi_interface.v"
 `include "timing_gen.v"
@@ -95,7 +96,7 @@ module RK05_emulator_top (
 wire [7:0] MAJOR_VERSION;
 assign MAJOR_VERSION = 1;
 wire [7:0] MINOR_VERSION;
-assign MINOR_VERSION = 15;
+assign MINOR_VERSION = 21;
 
 wire reset;
 
@@ -108,6 +109,10 @@ wire [7:0] bitclockdivider_clockphase;
 wire [7:0] bitclockdivider_dataphase;
 wire [7:0] bitpulse_width;
 wire [15:0] microseconds_per_sector;
+wire [7:0] sector_timebase_divider;
+wire [7:0] seek_settle;
+wire [7:0] seek_per_track;
+wire [23:0] nco_tuning_word;
 wire cpu_dc_low;
 
 wire clkenbl_sector;
@@ -142,6 +147,17 @@ wire dram_readack;
 wire dram_writeack;
 
 wire [7:0] spi_serpar_reg;
+wire [7:0] spi_write_address;
+wire spi_write_strobe;
+wire [7:0] crc_status;
+wire [15:0] crc_error_count;
+wire [7:0] bist_status;
+wire [14:0] bist_last_row;
+wire [15:0] bist_error_count;
+wire [23:0] bist_first_address;
+wire [23:0] bist_last_address;
+wire [15:0] bist_expected;
+wire [15:0] bist_actual;
 wire [15:0] dram_readdata;
 wire [15:0] dram_writedata_spi;
 wire [15:0] dram_writedata_buswrite;
@@ -155,6 +171,7 @@ wire clkenbl_read_data;
 wire clock_pulse;
 wire data_pulse;
 wire clkenbl_1usec;
+wire clkenbl_sector_usec;
 
 wire [7:0] bdw_test;
 wire interface_test_mode;
@@ -575,6 +592,8 @@ sdram_controller i_sdram_controller (
     .dram_writedata_buswrite (dram_writedata_buswrite),
     .Write_Protect (Write_Protect),
     .spi_serpar_reg (spi_serpar_reg),
+    .spi_write_address (spi_write_address),
+    .spi_write_strobe (spi_write_strobe),
     .Sector_Address (Sector_Address),
     .Cylinder_Address (Cylinder_Address),
     .Head_Select (Head_Select),
@@ -598,7 +617,15 @@ sdram_controller i_sdram_controller (
     .SDRAM_CLK (SDRAM_CLK),
     .SDRAM_CKE (SDRAM_CKE),
     .SDRAM_DQML (SDRAM_DQML),
-    .SDRAM_DQMH (SDRAM_DQMH)
+    .SDRAM_DQMH (SDRAM_DQMH),
+
+    .bist_status (bist_status),
+    .bist_last_row (bist_last_row),
+    .bist_error_count (bist_error_count),
+    .bist_first_address (bist_first_address),
+    .bist_last_address (bist_last_address),
+    .bist_expected (bist_expected),
+    .bist_actual (bist_actual)
 );
 
 
@@ -608,7 +635,7 @@ sector_and_index i_sector_and_index (
     // Inputs
     .clock (clock),
     .reset (reset),
-    .clkenbl_1usec (clkenbl_1usec),
+    .clkenbl_1usec (clkenbl_sector_usec),
     .number_of_sectors (number_of_sectors),
     .microseconds_per_sector (microseconds_per_sector),
 
@@ -631,6 +658,9 @@ seek_to_cylinder i_seek_to_cylinder (
     .BUS_RESTORE_L (BUS_RESTORE_L),
     .BUS_HEAD_SELECT_L (BUS_HEAD_SELECT_L),
     .clkenbl_index (clkenbl_index),
+    .clkenbl_1usec (clkenbl_1usec),
+    .seek_settle (seek_settle),
+    .seek_per_track (seek_per_track),
 
     // Outputs
     .Cylinder_Address (Cylinder_Address),
@@ -676,11 +706,22 @@ spi_interface i_spi_interface (
     .read_selected_ready (read_selected_ready),
     .write_selected_ready (write_selected_ready),
     .clkenbl_1usec (clkenbl_1usec),
+    .crc_status (crc_status),
+    .crc_error_count (crc_error_count),
+    .bist_status (bist_status),
+    .bist_last_row (bist_last_row),
+    .bist_error_count (bist_error_count),
+    .bist_first_address (bist_first_address),
+    .bist_last_address (bist_last_address),
+    .bist_expected (bist_expected),
+    .bist_actual (bist_actual),
 
     // Outputs
     .spi_miso (CPU_SPI_MISO),
     .load_address_spi (load_address_spi),
     .spi_serpar_reg (spi_serpar_reg),
+    .spi_write_address (spi_write_address),
+    .spi_write_strobe (spi_write_strobe),
     .dram_read_enbl_spi (dram_read_enbl_spi),
     .dram_write_enbl_spi (dram_write_enbl_spi),
     .dram_writedata_spi (dram_writedata_spi),
@@ -698,11 +739,30 @@ spi_interface i_spi_interface (
     .bitclockdivider_dataphase (bitclockdivider_dataphase),
     .bitpulse_width (bitpulse_width),
     .microseconds_per_sector (microseconds_per_sector),
+    .sector_timebase_divider (sector_timebase_divider),
+    .seek_settle (seek_settle),
+    .seek_per_track (seek_per_track),
+    .nco_tuning_word (nco_tuning_word),
     .interface_test_mode (interface_test_mode),
     .command_interrupt (CMD_INTERRUPT),
     .Servo_Pulse_FPGA (Servo_Pulse_FPGA)
 );
 
+// ======== Module ======== sector_crc_check =====
+sector_crc_check i_sector_crc_check (
+    // Inputs
+    .clock (clock),
+    .reset (reset),
+    .spi_serpar_reg (spi_serpar_reg),
+    .spi_write_address (spi_write_address),
+    .spi_write_strobe (spi_write_strobe),
+    .data_length (data_length),
+
+    // Outputs
+    .crc_status (crc_status),
+    .crc_error_count (crc_error_count)
+);
+
 // improved 4/1/2023
 // ======== Module ======== timing_gen =====
 timing_gen i_timing_gen (
@@ -712,13 +772,16 @@ timing_gen i_timing_gen (
     .bitclockdivider_clockphase (bitclockdivider_clockphase),
     .bitclockdivider_dataphase (bitclockdivider_dataphase),
     .bitpulse_width (bitpulse_width),
+    .sector_timebase_divider (sector_timebase_divider),
+    .nco_tuning_word (nco_tuning_word),
 
     // Outputs
     .clkenbl_read_bit (clkenbl_read_bit),
     .clkenbl_read_data (clkenbl_read_data),
     .clock_pulse (clock_pulse),
     .data_pulse (data_pulse),
-    .clkenbl_1usec (clkenbl_1usec)
+    .clkenbl_1usec (clkenbl_1usec),
+    .clkenbl_sector_usec (clkenbl_sector_usec)
 );
 
 endmodule // RK05_emulator_top
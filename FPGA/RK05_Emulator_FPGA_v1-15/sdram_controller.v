@@ -8,7 +8,18 @@
 //   read from bus, 
 //   read from SPI, 
 //   write from bus, 
-//   write from SPI.
+//   write from SPI,
+//   memory self test (BIST).
+//
+// The self test is started by writing register 0x19 with bit 0 set, bits 2:1 select the pattern and bit 3 inverts it.
+//   Rows 0 through the last row, registers 0x1a and 0x1b, are tested. A row is bank << 13 | row, so 8191 covers the
+//   emulator address space (bank 0) and 32767 covers all four banks. The write pass writes every row, then the read
+//   pass reads every row back and compares it with the regenerated pattern. Each row is opened once and its 512
+//   columns are written or read one per clock, then the banks are precharged and two auto refresh cycles are done,
+//   which keeps up with the refresh rate. The full chip takes about 0.9 seconds.
+//   Patterns: 0 - PRBS31 (x^31 + x^28 + 1), 16 bits per clock, 1 - walking ones, 2 - address in address,
+//   3 - checkerboard. The error count saturates at 0xffff, the first and last failing addresses are kept along
+//   with the expected and actual data of the first failure. Bus and SPI SDRAM requests wait while the test runs.
 //
 //==========================================================================================================
 
@@ -26,6 +37,8 @@ module sdram_controller(
     input wire [15:0] dram_writedata_buswrite,   // 16-bit write data to DRAM controller from SPI
     input wire Write_Protect,            // CPU register that indicates the drive write protect status.
     input wire [7:0] spi_serpar_reg,           // 8-bit SPI serpar register used for writing to the sdram address register
+    input wire [7:0] spi_write_address,        // register address of the byte in spi_serpar_reg
+    input wire spi_write_strobe,               // one clock wide enable when a byte from the SPI interface is complete
     input wire [3:0] Sector_Address,           // specifies which sector is present "under the heads"
     input wire [7:0] Cylinder_Address,         // valid cylinder address
     input wire Head_Select,              // head selection (upper or lower)
@@ -48,7 +61,15 @@ module sdram_controller(
     output wire SDRAM_CLK,	     // SDRAM Clock
     output reg SDRAM_CKE,	     // SDRAM Clock Enable
     output reg SDRAM_DQML,	     // SDRAM DQ Mask for Lower Byte
-    output reg SDRAM_DQMH	     // SDRAM DQ Mask for Upper (High) Byte
+    output reg SDRAM_DQMH,	     // SDRAM DQ Mask for Upper (High) Byte
+
+    output wire [7:0] bist_status,      // self test done, running, error and the selected pattern
+    output reg [14:0] bist_last_row,    // last row tested, bank << 13 | row
+    output reg [15:0] bist_error_count, // number of words that did not compare, saturates at 0xffff
+    output reg [23:0] bist_first_address, // address of the first failing word
+    output reg [23:0] bist_last_address,  // address of the most recent failing word
+    output reg [15:0] bist_expected,    // expected data of the first failing word
+    output reg [15:0] bist_actual       // data read from the first failing word
 );
 
 //============================ Internal Connections ==================================
@@ -63,6 +84,8 @@ module sdram_controller(
 // L   H   L  L  bank  H col  Write with auto precharge (Write and close row)
 // L   L   L  H   x    x  x   Auto Refresh
 // L   L   H  L   x    H  x   Precharge All, precharge the current row of all banks
+// L   H   L  H  bank  L col  Read, row stays open (self test)
+// L   H   L  L  bank  L col  Write, row stays open (self test)
 //
 // During Reset, 200 us pause, DQML, DQMH and CKE held high during initial pause period
 // After the 200 us pause, set the mode register, then issue eight Auto Refresh cycles
@@ -86,6 +109,16 @@ module sdram_controller(
 `define ST14 5'd14 // 14 - Init Precharge Wait
 `define ST15 5'd15 // 15 - Init Load Mode Register
 `define ST16 5'd16 // 16 - Init NOP before Precharge All
+`define ST17 5'd17 // 17 - BIST Activate
+`define ST18 5'd18 // 18 - BIST pre-Burst NOP
+`define ST19 5'd19 // 19 - BIST Write or Read Burst, one column per clock
+`define ST20 5'd20 // 20 - BIST Burst Wait, write recovery and read data
+`define ST21 5'd21 // 21 - BIST Precharge All
+`define ST22 5'd22 // 22 - BIST Precharge Wait
+`define ST23 5'd23 // 23 - BIST Auto Refresh
+`define ST24 5'd24 // 24 - BIST After Auto Refresh Wait
+
+`define BIST_PRBS_SEED 31'h2a3b4c5d // any non-zero PRBS31 state
 
 
 reg [23:0] memory_address; // memory address register
@@ -97,8 +130,53 @@ reg writerequest_spi;
 reg writerequest_buswrite;
 reg capture_readdata;
 
+reg bist_request;          // start written, the test begins at the next command dispatch
+reg bist_running;
+reg bist_done;
+reg bist_read_pass;        // 0 while writing the pattern, 1 while reading it back
+reg [1:0] bist_pattern;
+reg bist_invert;
+reg [14:0] bist_row;       // bank and row being tested
+reg [8:0] bist_column;
+reg [1:0] bist_wait;       // NOP counter
+reg bist_second_refresh;
+reg [30:0] bist_write_prbs; // pattern generator for the burst
+reg [30:0] bist_check_prbs; // pattern generator for the compare, in step with the read data
+reg [23:0] bist_check_address;
+reg [2:0] bist_read_valid; // read data of the burst arrives three clocks after the read command
+
+wire bist_control_write;
+wire [23:0] bist_address;
+wire [15:0] bist_write_data;
+wire [15:0] bist_check_data;
+wire bist_mismatch;
+
 //============================ Start of Code =========================================
 
+// 16 bits of the PRBS31 sequence x^31 + x^28 + 1, oldest bit in bit 15. The next state is {prbs[14:0], word}.
+function [15:0] bist_prbs_word;
+  input [30:0] prbs;
+  bist_prbs_word = prbs[30:15] ^ prbs[27:12];
+endfunction
+
+function [15:0] bist_pattern_data;
+  input [1:0] pattern;
+  input invert;
+  input [23:0] address;
+  input [30:0] prbs;
+  bist_pattern_data = {16{invert}} ^ ((pattern == 2'd0) ? bist_prbs_word(prbs) :
+                                     ((pattern == 2'd1) ? (16'h0001 << address[3:0]) :
+                                     ((pattern == 2'd2) ? (address[15:0] ^ {address[23:16], address[23:16]}) :
+                                                          (16'haaaa ^ {16{address[0]}}))));
+endfunction
+
+assign bist_control_write = (spi_write_address == 8'h19) & spi_write_strobe;
+assign bist_address = {bist_row, bist_column};
+assign bist_write_data = bist_pattern_data(bist_pattern, bist_invert, bist_address, bist_write_prbs);
+assign bist_check_data = bist_pattern_data(bist_pattern, bist_invert, bist_check_address, bist_check_prbs);
+assign bist_mismatch = bist_read_valid[2] & (SDRAM_DQ_in != bist_check_data);
+assign bist_status = {bist_done, bist_running, (bist_error_count != 16'd0), 2'b00, bist_invert, bist_pattern};
+
 // dram_readdata[15:0] always has the data ready that was read at the memory_address.
 // The read function is triggered after the odd byte is read.
 // The following code is triggered when spi_cs_n is low and counts clocks
@@ -121,6 +199,26 @@ begin : HSCLOCKFUNCTIONS // block name
     writerequest_spi <= 1'd0;
     writerequest_buswrite <= 1'd0;
     capture_readdata <= 1'd0;
+    bist_request <= 1'b0;
+    bist_running <= 1'b0;
+    bist_done <= 1'b0;
+    bist_read_pass <= 1'b0;
+    bist_pattern <= 2'd0;
+    bist_invert <= 1'b0;
+    bist_last_row <= 15'd8191; // emulator address space
+    bist_row <= 15'd0;
+    bist_column <= 9'd0;
+    bist_wait <= 2'd0;
+    bist_second_refresh <= 1'b0;
+    bist_write_prbs <= `BIST_PRBS_SEED;
+    bist_check_prbs <= `BIST_PRBS_SEED;
+    bist_check_address <= 24'd0;
+    bist_read_valid <= 3'd0;
+    bist_error_count <= 16'd0;
+    bist_first_address <= 24'd0;
+    bist_last_address <= 24'd0;
+    bist_expected <= 16'd0;
+    bist_actual <= 16'd0;
 
     SDRAM_CS_n <= 1'b1;
     SDRAM_RAS_n <= 1'b1;
@@ -166,9 +264,47 @@ begin : HSCLOCKFUNCTIONS // block name
     dram_readack <= (memstate == `ST4);
     dram_writeack <= (memstate == `ST9);
 
+    // self test control, register 0x19, and last row, registers 0x1a and 0x1b, are ignored while the test runs
+    if(bist_control_write & ~bist_running & ~bist_request) begin
+      bist_pattern <= spi_serpar_reg[2:1];
+      bist_invert <= spi_serpar_reg[3];
+      bist_request <= spi_serpar_reg[0];
+      bist_done <= bist_done & ~spi_serpar_reg[0];
+    end
+    bist_last_row[14:8] <= ((spi_write_address == 8'h1a) && spi_write_strobe && ~bist_running) ? spi_serpar_reg[6:0] : bist_last_row[14:8];
+    bist_last_row[7:0] <= ((spi_write_address == 8'h1b) && spi_write_strobe && ~bist_running) ? spi_serpar_reg[7:0] : bist_last_row[7:0];
+
+    // the test starts from the command dispatch state so a bus or SPI access in progress completes first
+    if((memstate == `ST0) & bist_request) begin
+      bist_request <= 1'b0;
+      bist_running <= 1'b1;
+      bist_read_pass <= 1'b0;
+      bist_row <= 15'd0;
+      bist_write_prbs <= `BIST_PRBS_SEED;
+      bist_check_prbs <= `BIST_PRBS_SEED;
+      bist_check_address <= 24'd0;
+      bist_error_count <= 16'd0;
+    end
+
+    // compare the read data with the check generator, which advances only when a word arrives
+    bist_read_valid <= {bist_read_valid[1:0], (memstate == `ST19) & bist_read_pass};
+    if(bist_read_valid[2]) begin
+      bist_check_address <= bist_check_address + 1;
+      bist_check_prbs <= {bist_check_prbs[14:0], bist_prbs_word(bist_check_prbs)};
+    end
+    if(bist_mismatch) begin
+      bist_error_count <= (bist_error_count == 16'hffff) ? bist_error_count : bist_error_count + 1;
+      bist_last_address <= bist_check_address;
+      if(bist_error_count == 16'd0) begin
+        bist_first_address <= bist_check_address;
+        bist_expected <= bist_check_data;
+        bist_actual <= SDRAM_DQ_in;
+      end
+    end
+
     case(memstate)  // SDRAM Controller state machine
     `ST0: begin     // 0  - command dispatch NOP
-      memstate <= readrequest ? `ST1 : ((writerequest_spi | writerequest_buswrite) ? `ST6 : `ST11);
+      memstate <= bist_request ? `ST17 : (readrequest ? `ST1 : ((writerequest_spi | writerequest_buswrite) ? `ST6 : `ST11));
       SDRAM_CS_n <= 1'b1;
       SDRAM_RAS_n <= 1'b1;
       SDRAM_CAS_n <= 1'b1;
@@ -413,6 +549,144 @@ begin : HSCLOCKFUNCTIONS // block name
       SDRAM_DQML <= 1'b1;
       SDRAM_DQMH <= 1'b1;
      end
+    `ST17: begin     // 17 - BIST Activate
+      memstate <= `ST18;
+      SDRAM_CS_n <= 1'b0;
+      SDRAM_RAS_n <= 1'b0;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= bist_row[14];
+      SDRAM_BS0 <= bist_row[13];
+      SDRAM_Address <= bist_row[12:0];
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST18: begin     // 18 - BIST pre-Burst NOP
+      memstate <= `ST19;
+      bist_column <= 9'd0;
+      SDRAM_CS_n <= 1'b1;
+      SDRAM_RAS_n <= 1'b1;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'd0;
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST19: begin     // 19 - BIST Write or Read Burst, one column per clock without auto precharge
+      memstate <= (bist_column == 9'd511) ? `ST20 : `ST19;
+      bist_column <= bist_column + 1;
+      bist_write_prbs <= {bist_write_prbs[14:0], bist_prbs_word(bist_write_prbs)};
+      bist_wait <= 2'd0;
+      SDRAM_CS_n <= 1'b0;
+      SDRAM_RAS_n <= 1'b1;
+      SDRAM_CAS_n <= 1'b0;
+      SDRAM_WE_n <= bist_read_pass;
+      SDRAM_BS1 <= bist_row[14];
+      SDRAM_BS0 <= bist_row[13];
+      SDRAM_Address <= {4'b0000, bist_column}; // A10 <= 0, the row stays open
+      SDRAM_DQ_output <= bist_write_data;
+      SDRAM_DQ_enable <= ~bist_read_pass;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST20: begin     // 20 - BIST Burst Wait, write recovery before the precharge and the last read data
+      memstate <= (bist_wait == 2'd2) ? `ST21 : `ST20;
+      bist_wait <= bist_wait + 1;
+      SDRAM_CS_n <= 1'b1;
+      SDRAM_RAS_n <= 1'b1;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'd0;
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST21: begin     // 21 - BIST Precharge All
+      memstate <= `ST22;
+      SDRAM_CS_n <= 1'b0;
+      SDRAM_RAS_n <= 1'b0;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b0;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'b0010000000000; // Precharge All requires A10 to be high
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST22: begin     // 22 - BIST Precharge Wait
+      memstate <= `ST23;
+      bist_second_refresh <= 1'b0;
+      SDRAM_CS_n <= 1'b1;
+      SDRAM_RAS_n <= 1'b1;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'd0;
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST23: begin     // 23 - BIST Auto Refresh, two per row keep up with the refresh rate
+      memstate <= `ST24;
+      bist_wait <= 2'd0;
+      SDRAM_CS_n <= 1'b0;
+      SDRAM_RAS_n <= 1'b0;
+      SDRAM_CAS_n <= 1'b0;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'd0;
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
+    `ST24: begin     // 24 - BIST After Auto Refresh Wait, then the second refresh, the next row, the read pass or done
+      bist_wait <= bist_wait + 1;
+      if(bist_wait == 2'd1) begin
+        bist_second_refresh <= 1'b1;
+        if(~bist_second_refresh)
+          memstate <= `ST23;
+        else if(bist_row != bist_last_row) begin
+          memstate <= `ST17;
+          bist_row <= bist_row + 1;
+        end
+        else if(~bist_read_pass) begin
+          memstate <= `ST17;
+          bist_row <= 15'd0;
+          bist_read_pass <= 1'b1;
+        end
+        else begin
+          memstate <= `ST0;
+          bist_running <= 1'b0;
+          bist_done <= 1'b1;
+        end
+      end
+      SDRAM_CS_n <= 1'b1;
+      SDRAM_RAS_n <= 1'b1;
+      SDRAM_CAS_n <= 1'b1;
+      SDRAM_WE_n <= 1'b1;
+      SDRAM_BS1 <= 1'b0;
+      SDRAM_BS0 <= 1'b0;
+      SDRAM_Address <= 13'd0;
+      SDRAM_DQ_output <= 16'd0;
+      SDRAM_DQ_enable <= 1'b0;
+      SDRAM_DQML <= 1'b0;
+      SDRAM_DQMH <= 1'b0;
+     end
     endcase
   end
 end // End of Block HSCLOCKFUNCTIONS
@@ -4,6 +4,7 @@
 // File Name: sector_and_index.v
 // Functions: 
 //   Divide the 1 microsecond clock to generate a sector pulse enable signal.
+//   In turbo mode the sector time base is faster than 1 microsecond, all sector and index timing scales with it.
 //   After number_of_sectors sector pulses, generate an index pulse offset by 600 usec.
 //   The Sector interval is defined by the parameter microseconds_per_sector.
 //
@@ -12,7 +13,7 @@
 module sector_and_index(
     input wire clock,                          // master clock 40 MHz
     input wire reset,                          // active high synchronous reset input
-    input wire clkenbl_1usec,                  // 1 usec clock enable input from the timing generator
+    input wire clkenbl_1usec,                  // sector time base clock enable from the timing generator, 1 usec except in turbo mode
     input wire [4:0] number_of_sectors,
     input wire [15:0] microseconds_per_sector, // number of microseconds per sector to generate sector timing
 
@@ -0,0 +1,114 @@
+//==========================================================================================================
+// RK05 Emulator
+// Sector CRC Check
+// File Name: sector_crc_check.v
+// Functions:
+//   Check each sector as the CPU streams the disk image into the SDRAM through SPI register 0x06.
+//   Loading the SDRAM address through register 0x05 starts a new sector. The cylinder address is taken
+//     from the loaded SDRAM address, cylinder << 14 | head << 13 | sector << 9.
+//   The first two bytes of the sector are the header word, LSB first, which must equal cylinder << 5.
+//   The CRC is CRC-16 with polynomial x^16 + x^15 + x^2 + 1, bit reversed (0xa001), initial value 0,
+//     calculated over the data words and the CRC word. The result is zero for a good sector.
+//   The CRC is calculated one bit per clock, so a byte takes 8 clocks, much less than the time between SPI bytes.
+//   After the last byte of the sector, data_length / 8 bytes, the status shows sector done and the error bits.
+//   Sectors with an error increment the error count. Writing 0x04 with bit 1 set clears the error count.
+//
+//==========================================================================================================
+
+module sector_crc_check(
+    input wire clock,
+    input wire reset,
+    input wire [7:0] spi_serpar_reg,     // byte from the SPI interface
+    input wire [7:0] spi_write_address,  // register address of the byte in spi_serpar_reg
+    input wire spi_write_strobe,         // one clock wide enable when a byte from the SPI interface is complete
+    input wire [15:0] data_length,       // number of bits in the sector, header + data + CRC
+
+    output wire [7:0] crc_status,        // sector done, header error and CRC error for the most recent sector
+    output reg [15:0] crc_error_count    // number of sectors with an error since the count was cleared
+);
+
+//============================ Internal Connections ==================================
+
+reg [23:0] loaded_address;  // SDRAM address loaded by the CPU, 8 bits at a time
+reg [15:0] crc;
+reg [7:0] crc_shift;        // byte being shifted through the CRC
+reg [3:0] crc_bitcount;     // number of bits of crc_shift still to be processed
+reg [9:0] sector_bytecount; // number of bytes received in the present sector
+reg [7:0] header_low;       // first byte of the header word
+reg header_error;
+reg crc_error;
+reg sector_done;
+reg sector_complete;        // last byte of the sector is being shifted through the CRC
+
+wire address_byte;
+wire data_byte;
+wire crc_feedback;
+wire [15:0] expected_header;
+
+//============================ Start of Code =========================================
+
+assign address_byte = (spi_write_address == 8'h05) & spi_write_strobe;
+assign data_byte = (spi_write_address == 8'h06) & spi_write_strobe;
+assign crc_feedback = crc[0] ^ crc_shift[0];
+assign expected_header = {3'b000, loaded_address[21:14], 5'b00000};
+assign crc_status = {sector_done, 5'b00000, header_error, crc_error};
+
+always @ (posedge clock)
+begin : SECTORCRCCHECK // block name
+  if(reset == 1'b1) begin
+    loaded_address <= 24'd0;
+    crc <= 16'd0;
+    crc_shift <= 8'd0;
+    crc_bitcount <= 4'd0;
+    sector_bytecount <= 10'd0;
+    header_low <= 8'd0;
+    header_error <= 1'b0;
+    crc_error <= 1'b0;
+    sector_done <= 1'b0;
+    sector_complete <= 1'b0;
+    crc_error_count <= 16'd0;
+  end
+  else begin
+    loaded_address <= address_byte ? {loaded_address[15:0], spi_serpar_reg} : loaded_address;
+
+    // header bytes are compared, the remaining bytes are shifted through the CRC one bit per clock
+    if(address_byte) begin
+      crc <= 16'd0;
+      crc_bitcount <= 4'd0;
+      sector_bytecount <= 10'd0;
+      header_error <= 1'b0;
+      crc_error <= 1'b0;
+      sector_done <= 1'b0;
+      sector_complete <= 1'b0;
+    end
+    else if(data_byte) begin
+      sector_bytecount <= sector_bytecount + 1;
+      if(sector_bytecount == 10'd0)
+        header_low <= spi_serpar_reg;
+      else if(sector_bytecount == 10'd1)
+        header_error <= ({spi_serpar_reg, header_low} != expected_header);
+      else if(sector_bytecount < data_length[12:3]) begin
+        crc_shift <= spi_serpar_reg;
+        crc_bitcount <= 4'd8;
+        sector_complete <= (sector_bytecount == (data_length[12:3] - 1));
+      end
+    end
+    else if(crc_bitcount != 4'd0) begin
+      crc <= crc_feedback ? ({1'b0, crc[15:1]} ^ 16'ha001) : {1'b0, crc[15:1]};
+      crc_shift <= {1'b0, crc_shift[7:1]};
+      crc_bitcount <= crc_bitcount - 1;
+    end
+    else if(sector_complete) begin
+      sector_complete <= 1'b0;
+      sector_done <= 1'b1;
+      crc_error <= (crc != 16'd0);
+      crc_error_count <= ((header_error | (crc != 16'd0)) & (crc_error_count != 16'hffff)) ? crc_error_count + 1 : crc_error_count;
+    end
+
+    // writing 0x04 with bit 1 set clears the error count
+    if((spi_write_address == 8'h04) & spi_write_strobe & spi_serpar_reg[1])
+      crc_error_count <= 16'd0;
+  end
+end // End of Block SECTORCRCCHECK
+
+endmodule // End of Module sector_crc_check
@@ -7,6 +7,9 @@
 //   Seek to the cylinder address if the address is valid (less than 203),
 //   by saving the cylinder address in Cylinder_Address.
 //   Respond with bus address accepted, bus address invalid, bus RWS ready.
+//   Seek time model: with seek_settle and seek_per_track both zero the seek is instant, the original behavior.
+//     Otherwise BUS_RWS_RDY_H is low for seek_per_track * 4 usec for each cylinder moved,
+//     followed by seek_settle * 128 usec. A seek to the present cylinder takes no time.
 //
 //==========================================================================================================
 
@@ -19,6 +22,9 @@ module seek_to_cylinder(
     input wire BUS_RESTORE_L,     // restore, moves heads to cylinder zero
     input wire BUS_HEAD_SELECT_L, // head selection, upper or lower
     input wire clkenbl_index,     // index enable pulse
+    input wire clkenbl_1usec,     // 1 usec clock enable input from the timing generator
+    input wire [7:0] seek_settle,    // head settle time at the end of a seek, 128 usec units
+    input wire [7:0] seek_per_track, // seek time for each cylinder moved, 4 usec units
 
     output reg [7:0] Cylinder_Address, // internal register to store the valid cylinder address
     output reg Head_Select,            // internal register to store the head selection (upper or lower)
@@ -38,10 +44,19 @@ reg [2:0] meta_head_select; // sampling and metastability reduction of Head Sele
 reg [7:0] addr_resp;        // counter to provide the proper pulse width of Address Accepted or Address Invalid
 reg [2:0] on_cyl_counter;   // counter to produce a visible flicker of the On Cylinder indicator
 wire BUS_RESTORE;           // active high bus restore signal so the equations below are more clear
+reg seeking;                // the heads are moving or settling, RWS ready is inactive
+reg [7:0] seek_tracks;      // number of cylinders still to be moved
+reg [14:0] seek_timer;      // usec remaining in the present track or in the settle time
+wire start_seek;            // valid strobe that begins a seek
+wire [7:0] new_cylinder;    // cylinder address at the end of the seek
+wire [7:0] seek_distance;   // number of cylinders between the present and the new cylinder address
 
 //============================ Start of Code =========================================
 
 assign BUS_RESTORE = ~BUS_RESTORE_L;    // make the active high internal signal Bus Restore
+assign start_seek = meta_bus_strobe[2] && ~meta_bus_strobe[3] && Selected_Ready && (BUS_RESTORE || (~BUS_CYL_ADD_L < 8'd203));
+assign new_cylinder = BUS_RESTORE ? 8'd0 : ~BUS_CYL_ADD_L;
+assign seek_distance = (new_cylinder > Cylinder_Address) ? (new_cylinder - Cylinder_Address) : (Cylinder_Address - new_cylinder);
 // BUS_RESTORE_L is stable prior to BUS_STROBE_L being active so we don't worry about metastability on BUS_RESTORE_L
 always @ (posedge clock)
 begin
@@ -58,9 +73,34 @@ begin
         addr_resp <= 8'd0;
         BUS_RWS_RDY_H <= 1'b1;
         on_cyl_counter <= 0;
+        seeking <= 1'b0;
+        seek_tracks <= 8'd0;
+        seek_timer <= 15'd0;
     end
     else begin
-        BUS_RWS_RDY_H <= 1'b1;
+        BUS_RWS_RDY_H <= ~seeking;
+
+        // seek timer, count down the time for each cylinder and then the settle time
+        // with no time per cylinder the seek goes straight to the settle time
+        if(start_seek) begin
+            seeking <= (seek_distance != 8'd0) && ((seek_settle != 8'd0) || (seek_per_track != 8'd0));
+            seek_tracks <= (seek_per_track != 8'd0) ? seek_distance : 8'd0;
+            seek_timer <= (seek_per_track != 8'd0) ? {5'd0, seek_per_track, 2'b00} : {seek_settle, 7'd0};
+        end
+        else if(seeking && clkenbl_1usec) begin
+            if(seek_timer > 15'd1)
+                seek_timer <= seek_timer - 1;
+            else if(seek_tracks > 8'd1) begin
+                seek_tracks <= seek_tracks - 1;
+                seek_timer <= {5'd0, seek_per_track, 2'b00};
+            end
+            else if(seek_tracks == 8'd1) begin
+                seek_tracks <= 8'd0;
+                seek_timer <= {seek_settle, 7'd0};
+            end
+            else
+                seeking <= 1'b0;
+        end
         
         meta_bus_strobe[3:0] <= {meta_bus_strobe[2:0], ~BUS_STROBE_L};
         meta_head_select[2:0] <= {meta_head_select[1:0], ~BUS_HEAD_SELECT_L};
@@ -79,4 +119,4 @@ begin
     end
 end
 
-endmodule // End of Module sector_and_index
+endmodule // End of Module seek_to_cylinder
@@ -6,6 +6,12 @@
 //   read and write FPGA hardware control registers.
 //   read and write SDRAM data.
 //   write SDRAM address register for processor SDRAM accesses.
+//   burst register access: when spi_cs_n is held low after the first data byte, each following byte
+//     writes or reads the next consecutive register address. The SDRAM address and write data ports
+//     (0x05 and 0x06) do not increment, so a burst to 0x05 loads the full 24-bit SDRAM address
+//     and a burst to 0x06 streams data into the SDRAM. The SDRAM read port 0x88 does increment and
+//     must still be read one byte per transaction; it has no side effects when it is reached by
+//     auto-increment, so a burst read from 0x80 passes through it to the registers above.
 //
 //==========================================================================================================
 
@@ -39,10 +45,21 @@ module spi_interface(
     input wire read_selected_ready,
     input wire write_selected_ready,
     input wire clkenbl_1usec,           // 1 usec clock enable input from the timing generator
+    input wire [7:0] crc_status,        // sector CRC check status of the most recent sector loaded by the CPU
+    input wire [15:0] crc_error_count,  // number of sectors loaded by the CPU with a header or CRC error
+    input wire [7:0] bist_status,       // SDRAM self test done, running, error and pattern
+    input wire [14:0] bist_last_row,    // last SDRAM row of the self test
+    input wire [15:0] bist_error_count, // number of words that failed the SDRAM self test
+    input wire [23:0] bist_first_address, // address of the first failing word
+    input wire [23:0] bist_last_address,  // address of the most recent failing word
+    input wire [15:0] bist_expected,    // expected data of the first failing word
+    input wire [15:0] bist_actual,      // data read from the first failing word
 
     output reg spi_miso,                // SPI controller data input, peripheral data output
     output reg load_address_spi,        // enable from SPI to command the sdram controller to load address 8 bits at a time
     output reg [7:0] spi_serpar_reg,    // 8-bit serpar register used for writing to the sdram address register
+    output reg [7:0] spi_write_address, // register address of the byte in spi_serpar_reg
+    output wire spi_write_strobe,       // one clock wide enable in the clock domain each time a data byte is complete
     output reg dram_read_enbl_spi,      // read enable request to DRAM controller
     output reg dram_write_enbl_spi,     // write enable request to DRAM controller
     output reg [15:0] dram_writedata_spi, // 16-bit write data to DRAM controller
@@ -60,6 +77,10 @@ module spi_interface(
     output reg [7:0] bitclockdivider_dataphase,
     output reg [7:0] bitpulse_width,
     output reg [15:0] microseconds_per_sector,
+    output reg [7:0] sector_timebase_divider, // system clocks per sector time base tick, 40 for real drive timing
+    output reg [7:0] seek_settle,       // seek settle time, 128 usec units, zero with seek_per_track zero is instant seek
+    output reg [7:0] seek_per_track,    // seek time per cylinder, 4 usec units
+    output reg [23:0] nco_tuning_word,  // bit clock phase accumulator increment, zero selects the integer bit clock dividers
     output reg interface_test_mode,
     output reg command_interrupt,
     output reg Servo_Pulse_FPGA
@@ -75,7 +96,14 @@ reg [2:0] metawprot;
 reg dramwrite_lowhigh;
 reg dramread_lowhigh;
 reg [4:0] spicount; // define as 5 bits instead of 4 to prevent the first bit from wrapping around at the end of transmitting the 16-bit data (8 addr + 8 data)
+                    // during a burst the count wraps from 15 back to 8 for each additional data byte
 reg [7:0] serialaddress;
+reg spi_first_byte;      // the data byte being shifted is the first one after the address byte
+reg spi_write_first;     // the byte in spi_serpar_reg was the first data byte of the transaction
+reg spi_byte_toggle;     // toggles in the spi_clk domain each time a data byte is complete
+reg [3:0] metabyte;      // synchronizes spi_byte_toggle into the clock domain
+wire [2:0] spi_bit_index; // bit of muxed_read_data that is shifted out next
+wire spi_port_address;   // SDRAM address and write data ports do not auto-increment during a burst
 wire [7:0] muxed_read_data;
 wire pre_spi_miso;
 reg frdlyd;
@@ -100,9 +128,9 @@ SB_DFFS SPI_DFFS_inst (
 assign muxed_read_data = (serialaddress == 8'h80) ? 8'h00 : 
                         ((serialaddress == 8'h81) ? Cylinder_Address[7:0] :
                         ((serialaddress == 8'h82) ? {Sector_Address[3:0], operation_id[1:0], Selected_Ready, Head_Select} :
-                        ((serialaddress == 8'h83) ? 8'h00 :
-                        ((serialaddress == 8'h84) ? 8'h00 :
-                        ((serialaddress == 8'h85) ? 8'h00 :
+                        ((serialaddress == 8'h83) ? crc_status[7:0] :
+                        ((serialaddress == 8'h84) ? crc_error_count[15:8] :
+                        ((serialaddress == 8'h85) ? crc_error_count[7:0] :
                         ((serialaddress == 8'h89) ? {1'b0, 7'h0} : // bit 7 == 0 identifies the FPGA as an emulator, bits 6:0 are presently unused
                         ((serialaddress == 8'h90) ? major_version[7:0] :
                         ((serialaddress == 8'h91) ? minor_version[7:0] :
@@ -121,26 +149,56 @@ assign muxed_read_data = (serialaddress == 8'h80) ? 8'h00 :
                         ((serialaddress == 8'haf) ? bitpulse_width[7:0] :
                         ((serialaddress == 8'hb0) ? microseconds_per_sector[15:8] :
                         ((serialaddress == 8'hb1) ? microseconds_per_sector[7:0] :
-                        ((serialaddress == 8'h88) ? (dramread_lowhigh ? dram_readdata[15:8] : dram_readdata[7:0]) : 8'b0))))))))))))))))))))))));
+                        ((serialaddress == 8'hb3) ? sector_timebase_divider[7:0] :
+                        ((serialaddress == 8'hb4) ? seek_settle[7:0] :
+                        ((serialaddress == 8'hb5) ? seek_per_track[7:0] :
+                        ((serialaddress == 8'hb6) ? nco_tuning_word[23:16] :
+                        ((serialaddress == 8'hb7) ? nco_tuning_word[15:8] :
+                        ((serialaddress == 8'hb8) ? nco_tuning_word[7:0] :
+                        ((serialaddress == 8'hb9) ? bist_status[7:0] :
+                        ((serialaddress == 8'hba) ? {1'b0, bist_last_row[14:8]} :
+                        ((serialaddress == 8'hbb) ? bist_last_row[7:0] :
+                        ((serialaddress == 8'hbc) ? bist_error_count[15:8] :
+                        ((serialaddress == 8'hbd) ? bist_error_count[7:0] :
+                        ((serialaddress == 8'hbe) ? bist_first_address[23:16] :
+                        ((serialaddress == 8'hbf) ? bist_first_address[15:8] :
+                        ((serialaddress == 8'hc0) ? bist_first_address[7:0] :
+                        ((serialaddress == 8'hc1) ? bist_expected[15:8] :
+                        ((serialaddress == 8'hc2) ? bist_expected[7:0] :
+                        ((serialaddress == 8'hc3) ? bist_actual[15:8] :
+                        ((serialaddress == 8'hc4) ? bist_actual[7:0] :
+                        ((serialaddress == 8'hc5) ? bist_last_address[23:16] :
+                        ((serialaddress == 8'hc6) ? bist_last_address[15:8] :
+                        ((serialaddress == 8'hc7) ? bist_last_address[7:0] :
+                        ((serialaddress == 8'h88) ? (dramread_lowhigh ? dram_readdata[15:8] : dram_readdata[7:0]) : 8'b0)))))))))))))))))))))))))))))))))))))))))))));
                         // dram_readdata[15:0] always has the data ready that was read at the dram_address.
                         // The DRAM word read function is triggered after the odd byte is read.
                         // The next word is requested after reading the high byte from register 0x88.
 
-assign pre_spi_miso = ((spicount == 5'd7) & muxed_read_data[7]) | 
-                      ((spicount == 5'd8) & muxed_read_data[6]) |
-                      ((spicount == 5'd9) & muxed_read_data[5]) |
-                      ((spicount == 5'd10) & muxed_read_data[4]) |
-                      ((spicount == 5'd11) & muxed_read_data[3]) |
-                      ((spicount == 5'd12) & muxed_read_data[2]) |
-                      ((spicount == 5'd13) & muxed_read_data[1]) |
-                      ((spicount == 5'd14) & muxed_read_data[0]);
+// spicount 7 sends bit 7 of the first data byte, 8 to 14 send bits 6 to 0,
+// and during a burst spicount 15 sends bit 7 of the following byte
+assign spi_bit_index = 3'd6 - spicount[2:0];
+assign pre_spi_miso = (spicount >= 5'd7) & muxed_read_data[spi_bit_index];
+
+assign spi_port_address = (serialaddress == 8'h05) | (serialaddress == 8'h06);
 
 always @ (posedge spi_clk)
 begin : SPICLKPOSFUNCTIONS // block name
   // Reset the SPI bit counter using the DFF that is set when spi_cs_n is inactive
   // The SPI bit counter is used by a mux to serialize the SPI read data.
-  spicount <= spi_start ? 5'd0 : spicount + 1;
-  serialaddress <= (spicount == 6) ? {spiserialreg[6:0], spi_mosi} : serialaddress;
+  spicount <= spi_start ? 5'd0 : ((spicount == 5'd15) ? 5'd8 : spicount + 1);
+  // load the address from the first byte, then advance it after each data byte of a burst
+  serialaddress <= (spicount == 5'd6) ? {spiserialreg[6:0], spi_mosi} :
+                  (((spicount == 5'd14) && ~spi_port_address) ? serialaddress + 1 : serialaddress);
+  spi_first_byte <= (spicount == 5'd6) ? 1'b1 : ((spicount == 5'd14) ? 1'b0 : spi_first_byte);
+
+  // at the end of each data byte capture the byte and its address for the clock domain
+  if(spicount == 5'd14) begin
+    spi_serpar_reg <= {spiserialreg[6:0], spi_mosi};
+    spi_write_address <= serialaddress;
+    spi_write_first <= spi_first_byte;
+    spi_byte_toggle <= ~spi_byte_toggle;
+  end
 
   if(spi_cs_n == 1'b0) begin
     spiserialreg[7:0] <= {spiserialreg[6:0], spi_mosi};
@@ -163,10 +221,8 @@ begin : SPICLKNEGFUNCTIONS // block name
   spi_miso <= pre_spi_miso;
 end
 
-always @ (posedge spi_cs_n)
-begin : SPICSPOSFUNCTIONS // block name
-    spi_serpar_reg <=  spiserialreg;
-end
+// the byte toggle is synchronized and edge detected to make a single clock wide write strobe
+assign spi_write_strobe = metabyte[2] ^ metabyte[3];
 
 always @ (posedge clock)
 begin : HSCLOCKFUNCTIONS // block name
@@ -182,6 +238,7 @@ begin : HSCLOCKFUNCTIONS // block name
     dramwrite_lowhigh <= 1'b0;
     dramread_lowhigh <= 1'b0;
     metaspi <= 4'b0000;
+    metabyte <= {4{spi_byte_toggle}};
     metawprot <= 3'b000;
     cpu_dc_low <= 1'b0;
     toggle_wp <= 1'b0;
@@ -198,6 +255,10 @@ begin : HSCLOCKFUNCTIONS // block name
     operation_id <= 2'b00;
     command_interrupt <= 1'b0;
     servo_pw <= 8'd47; // 0.75 msec is 47, 16 usec intervals
+    sector_timebase_divider <= 8'd40; // 1 usec sector time base, real drive timing
+    seek_settle <= 8'd0; // instant seek
+    seek_per_track <= 8'd0;
+    nco_tuning_word <= 24'd0; // integer bit clock dividers
     counter_servo_20ms_period <= 11'h0;
     counter_16usec <= 4'h0;
   end
@@ -212,82 +273,97 @@ begin : HSCLOCKFUNCTIONS // block name
 
     frdlyd <= File_Ready;
     metaspi[3:0] <= {metaspi[2:0], ~spi_cs_n};
+    metabyte[3:0] <= {metabyte[2:0], spi_byte_toggle};
     metawprot[2:0] <= {metawprot[1:0], (~BUS_WT_PROTECT_L & Selected_Ready)};
 
     //clear Write_Protect when there's a change in File_Ready
     //Write_Protect <= metawprot[2] | // if metawp then set wp 
-                     //(~(File_Ready ^ frdlyd) & ~metawprot[2] &  (serialaddress == 8'h04) & ~metaspi[2] & metaspi[3] &  spi_serpar_reg[0] & ~Write_Protect) |
+                     //(~(File_Ready ^ frdlyd) & ~metawprot[2] &  (serialaddress == 8'h04) & ~metaspi[2] & metaspi[3] & spi_serpar_reg[0] & ~Write_Protect) |
                      //(~(File_Ready ^ frdlyd) & ~metawprot[2] & ((serialaddress == 8'h04) | metaspi[2] |  ~metaspi[3] | ~spi_serpar_reg[0]) & Write_Protect);                
     // Q <= (Q | Set) & ~Reset
     // Set when metawprot[2] or (toggle_wp & ~Q)
     // Reset when (toggle_wp & Q) or (File_Ready ^ frdlyd)
-    toggle_wp <= (serialaddress == 8'h04) & ~metaspi[2] & metaspi[3] &  spi_serpar_reg[0]; //toggle_wp is separated only so the code is more readable
+    toggle_wp <= (spi_write_address == 8'h04) & spi_write_strobe & spi_serpar_reg[0]; //toggle_wp is separated only so the code is more readable
     Write_Protect <= (Write_Protect | (metawprot[2] | (toggle_wp & ~Write_Protect))) & ~((toggle_wp & Write_Protect) | (File_Ready ^ frdlyd));
  
     // register address 0x00
-    Drive_Address[2:0] <= ((serialaddress == 8'h00) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[2:0] : Drive_Address[2:0];
-    File_Ready <=         ((serialaddress == 8'h00) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[4] : File_Ready;
-    Fault_Latch <=        ((serialaddress == 8'h00) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[5] : Fault_Latch;
-    cpu_dc_low <=         ((serialaddress == 8'h00) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7] : cpu_dc_low;
+    Drive_Address[2:0] <= ((spi_write_address == 8'h00) && spi_write_strobe) ? spi_serpar_reg[2:0] : Drive_Address[2:0];
+    File_Ready <=         ((spi_write_address == 8'h00) && spi_write_strobe) ? spi_serpar_reg[4] : File_Ready;
+    Fault_Latch <=        ((spi_write_address == 8'h00) && spi_write_strobe) ? spi_serpar_reg[5] : Fault_Latch;
+    cpu_dc_low <=         ((spi_write_address == 8'h00) && spi_write_strobe) ? spi_serpar_reg[7] : cpu_dc_low;
 
     // register address 0x05
-    load_address_spi   <= (serialaddress == 8'h05) & ~metaspi[2] & metaspi[3]; // command to load 8 bits of address from SPI
+    load_address_spi   <= (spi_write_address == 8'h05) & spi_write_strobe; // command to load 8 bits of address from SPI
 
     // register address 0x06
-    dram_writedata_spi[7:0] <=  ((serialaddress == 8'h06) && ~metaspi[2] && metaspi[3]) ? dram_writedata_spi[15:8] : dram_writedata_spi[7:0];
-    dram_writedata_spi[15:8] <= ((serialaddress == 8'h06) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg : dram_writedata_spi[15:8];
-    dram_write_enbl_spi <=       (serialaddress == 8'h06) & ~metaspi[2] & metaspi[3] & dramwrite_lowhigh;
+    dram_writedata_spi[7:0] <=  ((spi_write_address == 8'h06) && spi_write_strobe) ? dram_writedata_spi[15:8] : dram_writedata_spi[7:0];
+    dram_writedata_spi[15:8] <= ((spi_write_address == 8'h06) && spi_write_strobe) ? spi_serpar_reg : dram_writedata_spi[15:8];
+    dram_write_enbl_spi <=       (spi_write_address == 8'h06) & spi_write_strobe & dramwrite_lowhigh;
 
     // register address 0x07
-    preamble1_length <= ((serialaddress == 8'h07) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : preamble1_length;
+    preamble1_length <= ((spi_write_address == 8'h07) && spi_write_strobe) ? spi_serpar_reg[7:0] : preamble1_length;
 
     // register address 0x08
-    preamble2_length <= ((serialaddress == 8'h08) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : preamble2_length;
+    preamble2_length <= ((spi_write_address == 8'h08) && spi_write_strobe) ? spi_serpar_reg[7:0] : preamble2_length;
 
     // register address 0x09
-    data_length[15:8] <= ((serialaddress == 8'h09) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : data_length[15:8];
+    data_length[15:8] <= ((spi_write_address == 8'h09) && spi_write_strobe) ? spi_serpar_reg[7:0] : data_length[15:8];
 
     // register address 0x0a
-    data_length[7:0] <= ((serialaddress == 8'h0a) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : data_length[7:0];
+    data_length[7:0] <= ((spi_write_address == 8'h0a) && spi_write_strobe) ? spi_serpar_reg[7:0] : data_length[7:0];
 
     // register address 0x0b
-    postamble_length <= ((serialaddress == 8'h0b) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : postamble_length;
+    postamble_length <= ((spi_write_address == 8'h0b) && spi_write_strobe) ? spi_serpar_reg[7:0] : postamble_length;
 
     // register address 0x0c
-    number_of_sectors <= ((serialaddress == 8'h0c) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[4:0] : number_of_sectors;
+    number_of_sectors <= ((spi_write_address == 8'h0c) && spi_write_strobe) ? spi_serpar_reg[4:0] : number_of_sectors;
 
     // register address 0x0d
-    bitclockdivider_clockphase <= ((serialaddress == 8'h0d) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : bitclockdivider_clockphase;
+    bitclockdivider_clockphase <= ((spi_write_address == 8'h0d) && spi_write_strobe) ? spi_serpar_reg[7:0] : bitclockdivider_clockphase;
 
     // register address 0x0e
-    bitclockdivider_dataphase <= ((serialaddress == 8'h0e) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : bitclockdivider_dataphase;
+    bitclockdivider_dataphase <= ((spi_write_address == 8'h0e) && spi_write_strobe) ? spi_serpar_reg[7:0] : bitclockdivider_dataphase;
 
     // register address 0x0f
-    bitpulse_width <= ((serialaddress == 8'h0f) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : bitpulse_width;
+    bitpulse_width <= ((spi_write_address == 8'h0f) && spi_write_strobe) ? spi_serpar_reg[7:0] : bitpulse_width;
 
     // register address 0x10
-    microseconds_per_sector[15:8] <= ((serialaddress == 8'h10) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : microseconds_per_sector[15:8];
+    microseconds_per_sector[15:8] <= ((spi_write_address == 8'h10) && spi_write_strobe) ? spi_serpar_reg[7:0] : microseconds_per_sector[15:8];
 
     // register address 0x11
-    microseconds_per_sector[7:0] <= ((serialaddress == 8'h11) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : microseconds_per_sector[7:0];
+    microseconds_per_sector[7:0] <= ((spi_write_address == 8'h11) && spi_write_strobe) ? spi_serpar_reg[7:0] : microseconds_per_sector[7:0];
 
     // register address 0x12
-    servo_pw[7:0] <= ((serialaddress == 8'h12) && ~metaspi[2] && metaspi[3]) ? spi_serpar_reg[7:0] : servo_pw[7:0];
+    servo_pw[7:0] <= ((spi_write_address == 8'h12) && spi_write_strobe) ? spi_serpar_reg[7:0] : servo_pw[7:0];
+
+    // register address 0x13
+    sector_timebase_divider[7:0] <= ((spi_write_address == 8'h13) && spi_write_strobe) ? spi_serpar_reg[7:0] : sector_timebase_divider[7:0];
+
+    // register address 0x14
+    seek_settle[7:0] <= ((spi_write_address == 8'h14) && spi_write_strobe) ? spi_serpar_reg[7:0] : seek_settle[7:0];
+
+    // register address 0x15
+    seek_per_track[7:0] <= ((spi_write_address == 8'h15) && spi_write_strobe) ? spi_serpar_reg[7:0] : seek_per_track[7:0];
+
+    // register addresses 0x16, 0x17 and 0x18
+    nco_tuning_word[23:16] <= ((spi_write_address == 8'h16) && spi_write_strobe) ? spi_serpar_reg[7:0] : nco_tuning_word[23:16];
+    nco_tuning_word[15:8] <= ((spi_write_address == 8'h17) && spi_write_strobe) ? spi_serpar_reg[7:0] : nco_tuning_word[15:8];
+    nco_tuning_word[7:0] <= ((spi_write_address == 8'h18) && spi_write_strobe) ? spi_serpar_reg[7:0] : nco_tuning_word[7:0];
 
     // register address 0x20
-    interface_test_mode <= ((serialaddress == 8'h20) && ~metaspi[2] && metaspi[3]) ? (spi_serpar_reg[7:0] == 8'h55) : interface_test_mode;
+    interface_test_mode <= ((spi_write_address == 8'h20) && spi_write_strobe) ? (spi_serpar_reg[7:0] == 8'h55) : interface_test_mode;
 
-    // register address 0x88
-    dram_read_enbl_spi <= (serialaddress == 8'h88) & ~metaspi[2] & metaspi[3] & dramread_lowhigh;
+    // register address 0x88, only a single-byte read advances the read data, a burst passing through 0x88 has no side effects
+    dram_read_enbl_spi <= (spi_write_address == 8'h88) & spi_write_strobe & spi_write_first & dramread_lowhigh;
 
     // dram_readdata[15:0] always has the data ready that was read at the dram_address.
     // The read function is triggered after the odd byte is read.
     // The next word is requested after reading the high byte when the SPI address is 8'h88.
     // toggle respective lowhigh bits on a write or read, clear both bits on address load, otherwise lowhigh bits remain the same
-    dramwrite_lowhigh <= ((serialaddress == 8'h06) && ~metaspi[2] && metaspi[3]) ? ~dramwrite_lowhigh : 
-                        (((serialaddress == 8'h05) && ~metaspi[2] && metaspi[3]) ? 1'b0 : dramwrite_lowhigh);
-    dramread_lowhigh  <= ((serialaddress == 8'h88) && ~metaspi[2] && metaspi[3]) ? ~dramread_lowhigh :
-                        (((serialaddress == 8'h05) && ~metaspi[2] && metaspi[3]) ? 1'b0 : dramread_lowhigh);
+    dramwrite_lowhigh <= ((spi_write_address == 8'h06) && spi_write_strobe) ? ~dramwrite_lowhigh : 
+                        (((spi_write_address == 8'h05) && spi_write_strobe) ? 1'b0 : dramwrite_lowhigh);
+    dramread_lowhigh  <= ((spi_write_address == 8'h88) && spi_write_strobe && spi_write_first) ? ~dramread_lowhigh :
+                        (((spi_write_address == 8'h05) && spi_write_strobe) ? 1'b0 : dramread_lowhigh);
   end
 end // End of Block HSCLOCKFUNCTIONS
 
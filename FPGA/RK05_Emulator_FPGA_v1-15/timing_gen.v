@@ -4,7 +4,12 @@
 // File Name: timing_gen.v
 // Functions: 
 //   divide the global clock to generate a 1x rate 1.44 MHz read bit clock enable and twice-rate bit clock enable.
-//   1 microsecond clock timing generator - divide the global clock to generate a 1 microsecond timing enable signal used for sector and index logic and seek logic. 
+//   When nco_tuning_word is not zero the half-bit timing comes from a 24-bit phase accumulator instead of the
+//     integer dividers. The half-bit rate is nco_tuning_word * 40 MHz / 2^24, so any bit rate can be generated.
+//     Each half bit is a whole number of clocks, the average rate is exact and the jitter is one clock.
+//   1 microsecond clock timing generator - divide the global clock to generate a 1 microsecond timing enable signal used for seek logic and the servo. 
+//   sector time base generator - divide the global clock by sector_timebase_divider to generate the time base for the sector and index logic.
+//     The divider is 40 for real drive timing, 1 usec. A smaller divider speeds up the disk rotation for turbo mode.
 //
 //==========================================================================================================
 
@@ -14,12 +19,15 @@ module timing_gen(
     input wire [7:0] bitclockdivider_clockphase,
     input wire [7:0] bitclockdivider_dataphase,
     input wire [7:0] bitpulse_width,
+    input wire [7:0] sector_timebase_divider, // 40 for 1 usec sector timing, smaller for turbo mode
+    input wire [23:0] nco_tuning_word, // phase accumulator increment for the half-bit rate, zero selects the integer dividers
 
     output reg clkenbl_read_bit,  // enable for disk read clock
     output reg clkenbl_read_data, // enable for disk read data
     output reg clock_pulse,       // clock pulse with proper 160 us width from drive
     output reg data_pulse,        // data pulse with proper 160 us width from drive
-    output reg clkenbl_1usec     // enable for 1 usec clock pulse
+    output reg clkenbl_1usec,    // enable for 1 usec clock pulse
+    output reg clkenbl_sector_usec // enable for the sector time base, 1 usec except in turbo mode
 );
 
 //============================ Internal Connections ==================================
@@ -29,6 +37,13 @@ reg data_phase;
 //reg [2:0] pulse_width_counter;
 reg [6:0] usec_counter;
 `define USEC_LOAD_VALUE 7'd40  // reload value for the usec_counter
+reg [7:0] sector_usec_counter;
+reg [23:0] nco_phase;       // phase accumulator
+reg nco_carry;              // phase accumulator overflow, the end of a half bit
+reg [7:0] nco_pulse_count;  // counts the clock and data pulse width after each half bit boundary
+wire nco_mode;
+
+assign nco_mode = (nco_tuning_word != 24'd0);
 
 //============================ Start of Code =========================================
 
@@ -40,6 +55,11 @@ begin : COUNTERS // block name
     data_phase <= 1'b1;
     usec_counter <= `USEC_LOAD_VALUE;
     clkenbl_1usec <= 1'b0;
+    sector_usec_counter <= 8'd40;
+    clkenbl_sector_usec <= 1'b0;
+    nco_phase <= 24'd0;
+    nco_carry <= 1'b0;
+    nco_pulse_count <= 8'd0;
     clkenbl_read_bit <= 1'b0;
     clkenbl_read_data <= 1'b0;
     clock_pulse <= 1'b0;
@@ -49,23 +69,42 @@ begin : COUNTERS // block name
   else begin
     //clkenbl_read_bit  <= (half_bit==4'd14) && ~data_phase;
     //clkenbl_read_data <= (half_bit==4'd14) &&  data_phase;
-    clkenbl_read_bit  <= (half_bit==8'd2) && ~data_phase;
-    clkenbl_read_data <= (half_bit==8'd2) &&  data_phase;
+    // phase accumulator, the carry marks the end of each half bit
+    {nco_carry, nco_phase} <= {1'b0, nco_phase} + {1'b0, nco_tuning_word};
+    // the pulse starts two clocks after the end of the half bit so the read enable is ahead of it, as with the dividers
+    nco_pulse_count <= nco_carry ? bitpulse_width + 1 : ((nco_pulse_count == 8'd0) ? 8'd0 : nco_pulse_count - 1);
+
+    if(nco_mode) begin
+      clkenbl_read_bit  <= nco_carry && ~data_phase;
+      clkenbl_read_data <= nco_carry &&  data_phase;
+      data_phase <= nco_carry ? ~data_phase : data_phase;
+      clock_pulse <= (nco_pulse_count != 8'd0) && (nco_pulse_count <= bitpulse_width) && ~data_phase;
+      data_pulse  <= (nco_pulse_count != 8'd0) && (nco_pulse_count <= bitpulse_width) &&  data_phase;
+    end
+    else begin
+      clkenbl_read_bit  <= (half_bit==8'd2) && ~data_phase;
+      clkenbl_read_data <= (half_bit==8'd2) &&  data_phase;
 
-    //half_bit <= (half_bit==4'd15) ? 4'd2 : half_bit + 1; // for divide by 14, if counter == 15 then load 2
-    //data_phase <= (half_bit==4'd15) ? ~data_phase : data_phase; // toggle data_phase when counter == 15
-    half_bit <= (half_bit==8'd1) ? (data_phase ? bitclockdivider_clockphase : bitclockdivider_dataphase) : half_bit - 1; // decrement, but if at the end, load opposite phase count
-    data_phase <= (half_bit==8'd1) ? ~data_phase : data_phase; // toggle data_phase when counter == 1 at the end of the phase
+      //half_bit <= (half_bit==4'd15) ? 4'd2 : half_bit + 1; // for divide by 14, if counter == 15 then load 2
+      //data_phase <= (half_bit==4'd15) ? ~data_phase : data_phase; // toggle data_phase when counter == 15
+      half_bit <= (half_bit==8'd1) ? (data_phase ? bitclockdivider_clockphase : bitclockdivider_dataphase) : half_bit - 1; // decrement, but if at the end, load opposite phase count
+      data_phase <= (half_bit==8'd1) ? ~data_phase : data_phase; // toggle data_phase when counter == 1 at the end of the phase
 
-    //clock_pulse <= (half_bit > 4'd0) && (half_bit < 4'd8) && ~data_phase;
-    //data_pulse  <= (half_bit > 4'd0) && (half_bit < 4'd8) &&  data_phase;
-    clock_pulse <= (half_bit > (bitclockdivider_clockphase - bitpulse_width)) && ~data_phase;
-    data_pulse  <= (half_bit > (bitclockdivider_dataphase  - bitpulse_width)) && data_phase;
+      //clock_pulse <= (half_bit > 4'd0) && (half_bit < 4'd8) && ~data_phase;
+      //data_pulse  <= (half_bit > 4'd0) && (half_bit < 4'd8) &&  data_phase;
+      clock_pulse <= (half_bit > (bitclockdivider_clockphase - bitpulse_width)) && ~data_phase;
+      data_pulse  <= (half_bit > (bitclockdivider_dataphase  - bitpulse_width)) && data_phase;
+    end
 
     //usec_counter <= (usec_counter == 6'd63) ? 6'd24 : usec_counter + 1; // for divide by 40, if counter == 63 then load 24
     //clkenbl_1usec <= (usec_counter == 6'd63);
     usec_counter <= (usec_counter == 7'd1) ? `USEC_LOAD_VALUE : usec_counter - 1; // for divide by 40, if counter == 1 then load 40
     clkenbl_1usec <= (usec_counter == 7'd1);
+
+    // sector time base, a divider less than 2 is treated as 2
+    sector_usec_counter <= (sector_usec_counter <= 8'd1) ? ((sector_timebase_divider < 8'd2) ? 8'd2 : sector_timebase_divider) :
+        sector_usec_counter - 1;
+    clkenbl_sector_usec <= (sector_usec_counter <= 8'd1);
   end
 end // End of Block COUNTERS
 
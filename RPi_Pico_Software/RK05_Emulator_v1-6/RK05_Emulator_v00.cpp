@@ -124,6 +124,9 @@ void initialize_states(){
     edisk.numberOfSectorsPerTrack = 16;
     edisk.numberOfHeads = 2;
     edisk.microsecondsPerSector = 2500;
+    edisk.turbo_percent = 100;
+    edisk.seek_model = SEEK_INSTANT;
+    edisk.seek_scale_percent = 100;
 }
 
 #define UART_ID uart0
@@ -224,8 +227,9 @@ int main() {
             //if((ticker % 10) == 0) // for debugging the display_state functions
                 //print_display_state();
             read_rocker_switches(&edisk);
-            // if the WTPROT button is pressed then toggle the WP status in the FPGA, also toggles the indicator
-            if(edisk.wp_switch && !edisk.p_wp_switch){
+            // if the WTPROT button is pressed then toggle the WP status in the FPGA, also toggles the indicator.
+            // While unloaded the RUN/LOAD state machine does it, since holding WTPROT there opens the image selection.
+            if(edisk.wp_switch && !edisk.p_wp_switch && (edisk.run_load_state != RLST0) && (edisk.run_load_state != RLST20)){
                 toggle_wp();
                 printf("toggle WTPROT\r\n");
             }
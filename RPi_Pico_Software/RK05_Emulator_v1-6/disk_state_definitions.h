@@ -4,6 +4,9 @@
 // 
 // *********************************************************************************
 // 
+#define SEEK_INSTANT 0
+#define SEEK_RK05 1
+
 struct Disk_State
 {
     char imageName[11];
@@ -20,6 +23,9 @@ struct Disk_State
     int numberOfSectorsPerTrack;
     int numberOfHeads;
     int microsecondsPerSector;
+    int turbo_percent;      // disk speed in percent of the real drive, 100 is real drive timing
+    int seek_model;         // SEEK_INSTANT or SEEK_RK05
+    int seek_scale_percent; // scale factor for the RK05 seek times
 
     int Drive_Address;
     bool mode_RK05f;
@@ -11,6 +11,7 @@
 #include "ssd1306a.h"
 
 #include "disk_state_definitions.h"
+#include "image_catalog_definitions.h"
 #include "display_timers.h"
 #include "display_big_images.h"
 #include "emulator_hardware.h"
@@ -125,6 +126,34 @@ void display_splash_screen()
     edisplay.display_message_timer = STATUS_DISPLAY_TIME;
 }
 
+// one image of the catalog, its place in the catalog and file name on the top line, the image name
+// in large characters, then the controller and geometry and the header date and file size
+void display_catalog_entry(int index, int count, const struct Image_Catalog_Entry* entry)
+{
+    char line[(DISPLAY_WIDTH / 6) + 1];
+    int x_coord;
+
+    ssd1306_clear(&disp);
+    ssd1306_invert(&disp, 0);
+    edisplay.display_inverted = false;
+    snprintf(line, sizeof(line), "%d/%d %s", index + 1, count, entry->fileName);
+    ssd1306_draw_string(&disp, 0, 0, 1, line);
+    if(entry->headerValid){
+        x_coord = DISPLAY_WIDTH / 2 - (strlen(entry->imageName) * ssd1306_get_font_width(2)) / 2;
+        ssd1306_draw_string(&disp, x_coord, 14, 2, entry->imageName);
+        snprintf(line, sizeof(line), "%s %d/%d/%d", entry->controller,
+            entry->numberOfCylinders, entry->numberOfHeads, entry->numberOfSectorsPerTrack);
+        ssd1306_draw_string(&disp, 0, 38, 1, line);
+        snprintf(line, sizeof(line), "%.10s %lluKB", entry->imageDate, (unsigned long long) (entry->fileSize / 1024));
+        ssd1306_draw_string(&disp, 0, 50, 1, line);
+    }
+    else
+        ssd1306_draw_string(&disp, 0, 38, 1, (char*) "no RK05 header");
+    ssd1306_show(&disp);
+
+    edisplay.display_message_timer = CATALOG_DISPLAY_TIME;
+}
+
 void display_invert()
 {
     // invert the image presently in the display
@@ -11,6 +11,7 @@ void display_status(char* row1, char* row2);
 void display_splash_screen();
 void display_shutdown();
 void display_drive_address(int drv_addr, bool fixed, char *image_name);
+void display_catalog_entry(int index, int count, const struct Image_Catalog_Entry* entry);
 void manage_display_timers(Disk_State* ddisk);
 void display_restart_invert_timer();
 void display_disable_message_timer();
@@ -7,4 +7,5 @@
 #define STATUS_DISPLAY_TIME 30
 #define ERROR_DISPLAY_TIME 100
 #define DISPLAY_INVERT_TIME 600
+#define CATALOG_DISPLAY_TIME 100
 
@@ -13,83 +13,16 @@
 //#include "display_functions.h"
 //#include "display_timers.h"
 #include "emulator_hardware.h"
+#include "image_catalog_definitions.h"
 #include "microsd_file_ops.h"
 #include "display_functions.h"
+#include "prbs_generator.h"
 
 #include "emulator_global.h"
 
 #define SEEK_TIMEOUT 1000
 #define READWRITE_TIMEOUT 1000
-
-// shift_prbs function shifts a 16-order PRBS register by one state
-void shift_prbs(int* prbs){
-    int counter; // a counter is a fast and easy way to calculate the parity of the taps
-    counter = 0;
-    // x^16 + x^14 + x^13 + x^11 + 1
-    //if((*prbs & 0x1) != 0) counter++;
-    //if((*prbs & 0x4) != 0) counter++;
-    //if((*prbs & 0x8) != 0) counter++;
-    //if((*prbs & 0x20) != 0) counter++;
-    //*prbs = *prbs >> 1;
-    // inverted feedback, if parity of the taps is even then shift a 1 into the MSB
-    //if((counter & 1) == 0) *prbs = *prbs | 0x8000;
-
-    // x^24 + x^23 + x^22 + x^4 + 1
-    if((*prbs & 0x1) != 0) counter++;
-    if((*prbs & 0x2) != 0) counter++;
-    if((*prbs & 0x4) != 0) counter++;
-    if((*prbs & 0x080000) != 0) counter++;
-    *prbs = *prbs >> 1;
-    // inverted feedback, if parity of the taps is even then shift a 1 into the MSB
-    if((counter & 1) == 0) *prbs = *prbs | 0x800000;
-}
-
-// shift_prbs16 function shifts a 16-order PRBS register by one state
-void shift_prbs16(int* prbs){
-    int counter; // a counter is a fast and easy way to calculate the parity of the taps
-    counter = 0;
-    // x^16 + x^14 + x^13 + x^11 + 1
-    if((*prbs & 0x1) != 0) counter++;
-    if((*prbs & 0x4) != 0) counter++;
-    if((*prbs & 0x8) != 0) counter++;
-    if((*prbs & 0x20) != 0) counter++;
-    *prbs = *prbs >> 1;
-    // inverted feedback, if parity of the taps is even then shift a 1 into the MSB
-    if((counter & 1) == 0) *prbs = *prbs | 0x8000;
-}
-
-// shift_prbs24 function shifts a 24-order PRBS register by one state
-void shift_prbs24(int* prbs){
-    int counter; // a counter is a fast and easy way to calculate the parity of the taps
-    counter = 0;
-    // x^24 + x^23 + x^22 + x^4 + 1
-    if((*prbs & 0x1) != 0) counter++;
-    if((*prbs & 0x10) != 0) counter++;
-    if((*prbs & 0x040000) != 0) counter++;
-    if((*prbs & 0x080000) != 0) counter++;
-    *prbs = *prbs >> 1;
-    // inverted feedback, if parity of the taps is even then shift a 1 into the MSB
-    if((counter & 1) == 0) *prbs = *prbs | 0x800000;
-}
-
-// shift_prbs31 function shifts a 31-order PRBS register by one state
-void shift_prbs31(int* prbs){
-    int counter; // a counter is a fast and easy way to calculate the parity of the taps
-    counter = 0;
-    //Pederson book: 7 21042104211E
-    // x^31 + x^27 + x^23 + x^19 + x^15 + x^11 + x^7 + x^3 + 1
-    if((*prbs & 0x1) != 0) counter++;
-    if((*prbs & 0x8) != 0) counter++;
-    if((*prbs & 0x80) != 0) counter++;
-    if((*prbs & 0x800) != 0) counter++;
-    if((*prbs & 0x8000) != 0) counter++;
-    if((*prbs & 0x80000) != 0) counter++;
-    if((*prbs & 0x800000) != 0) counter++;
-    if((*prbs & 0x8000000) != 0) counter++;
-    *prbs = *prbs >> 1;
-    // inverted feedback, if parity of the taps is even then shift a 1 into the MSB
-    if((counter & 1) == 0) *prbs = *prbs | 0x40000000;
-}
+#define BIST_TIMEOUT_MS 2000
 
 void char_to_uppercase(char* cpointer){
     if((*cpointer >= 'a') && (*cpointer <= 'z')) // convert to uppercase
@@ -385,9 +318,70 @@ void door_test(){
     }
 }
 
-void card_directory(){
-    printf("  Card Directory test.\r\n");
-    printf("  card_directory() not yet implemented\r\n");
+static void print_catalog_entry(const Image_Catalog_Entry* entry){
+    char geometry[24];
+
+    if(!entry->headerValid)
+        printf("  %-24s no RK05 v1.0 header\r\n", entry->fileName);
+    else{
+        snprintf(geometry, sizeof(geometry), "%d/%d/%d", entry->numberOfCylinders, entry->numberOfHeads, entry->numberOfSectorsPerTrack);
+        printf("  %-24s %-10s %-10s %-11s %-19s %6llu\r\n", entry->fileName, entry->imageName, entry->controller,
+            geometry, entry->imageDate, (unsigned long long) (entry->fileSize / 1024));
+    }
+}
+
+// list the images on the card from the catalog, then browse them on the display with the rocker switches
+void card_directory(bool rescan_all){
+    uint64_t start;
+    int count, index;
+    bool rl_switch, wp_switch;
+
+    printf("  Card Directory.\r\n");
+    if(!is_card_present()){
+        printf("### ERROR, no microSD card inserted\r\n");
+        image_catalog_invalidate();
+        return;
+    }
+    start = time_us_64();
+    if(image_catalog_refresh(rescan_all) != FILE_OPS_OKAY){
+        printf("### ERROR, could not read the image catalog\r\n");
+        return;
+    }
+    count = image_catalog_count();
+    printf("  %d image%s, catalog ready in %llu us\r\n", count, (count == 1) ? "" : "s", (unsigned long long) (time_us_64() - start));
+    if(count == 0)
+        return;
+    printf("  %-24s %-10s %-10s %-11s %-19s %6s\r\n", "file", "name", "controller", "cyl/hd/sec", "date", "KB");
+    for(index = 0; index < count; index++)
+        print_catalog_entry(image_catalog_entry(index));
+
+    printf("  WT PROT shows the next image on the display, RUN/LOAD the previous one. Hit any key to stop.\r\n");
+    index = 0;
+    display_catalog_entry(index, count, image_catalog_entry(index));
+    rl_switch = read_load_switch();
+    wp_switch = read_wp_switch();
+    while(true){
+        // a test for keyboard key hit to abort the loop
+        if(char_from_callback != 0){
+            printf("  Ending the Card Directory\r\n");
+            char_from_callback = 0; //reset the value
+            display_shutdown();
+            return;
+        }
+        if(read_wp_switch() && !wp_switch){
+            index = (index + 1) % count;
+            display_catalog_entry(index, count, image_catalog_entry(index));
+            print_catalog_entry(image_catalog_entry(index));
+        }
+        if(read_load_switch() != rl_switch){
+            index = (index + count - 1) % count;
+            display_catalog_entry(index, count, image_catalog_entry(index));
+            print_catalog_entry(image_catalog_entry(index));
+        }
+        rl_switch = read_load_switch();
+        wp_switch = read_wp_switch();
+        sleep_ms(100);
+    }
 }
 
 void vsense_test(){
@@ -395,57 +389,107 @@ void vsense_test(){
     printf("  vsense_test() not yet implemented\r\n");
 }
 
+// dump the FPGA status and readback registers, all captured in the same SPI transaction
+void register_dump(){
+    uint8_t regs[REGISTER_BLOCK_SIZE];
+    read_register_block(regs);
+    printf("  FPGA registers 0x%02x - 0x%02x%s\r\n", REGISTER_BLOCK_FIRST, REGISTER_BLOCK_FIRST + REGISTER_BLOCK_SIZE - 1,
+        is_fpga_burst_capable() ? "" : ", single register reads, 0x88 not read");
+    for(int i = 0; i < REGISTER_BLOCK_SIZE; i++){
+        if((i & 0xf) == 0)
+            printf("  %02x:", REGISTER_BLOCK_FIRST + i);
+        printf(" %02x", regs[i]);
+        if(((i & 0xf) == 0xf) || (i == (REGISTER_BLOCK_SIZE - 1)))
+            printf("\r\n");
+    }
+}
+
+// the word at SDRAM word address n, the 24-bit address given to load_ram_address(), gets bits 16 * n onward
+// of the PRBS31 sequence, so a test of part of the SDRAM checks the same data there as a test of all of it
+static void ramtest_start(Prbs_Generator* prbs, int start_address){
+    prbs_start(prbs, prbs31_polynomial(), PRBS31_FPGA_SEED);
+    prbs_jump(prbs, (uint64_t) start_address * 16); // 16-bit SDRAM words
+}
+
 void ramtest(int start_address, int num_bytes){
-    int prbs_reg;
-    int bytecount, i;
+    Prbs_Generator prbs;
+    int bytecount;
     int byte_errors;
+    int ideal;
 
     byte_errors = 0;
-    prbs_reg = 0x12345678; // initialize PRBS register starting seed value
-    // fixed seed
     printf("  Ramtest.\r\n");
     printf("  Filling the entire test range with a pseudorandom pattern.\r\n");
+    ramtest_start(&prbs, start_address);
     load_ram_address(start_address);
-    for(bytecount = 0; bytecount < num_bytes; bytecount++){
-        shift_prbs31(&prbs_reg); // shift 1 time
-        storebyte(prbs_reg & 0xff);
-    }
+    for(bytecount = 0; bytecount < num_bytes; bytecount++)
+        storebyte(prbs_next_byte(&prbs));
 
     printf("  Reading back and checking the test range.\r\n");
-    prbs_reg = 0x12345678; // re-initialize PRBS register starting seed value
+    ramtest_start(&prbs, start_address);
     load_ram_address(start_address);
     for(bytecount = 0; bytecount < num_bytes; bytecount++){
-        shift_prbs31(&prbs_reg); // shift 1 time
+        ideal = prbs_next_byte(&prbs);
         int tempval = readbyte();
-        if(tempval != (prbs_reg & 0xff)){
-            printf("Error, address = %x, ideal = %x, readback = %x\r\n", start_address + bytecount, prbs_reg & 0xff, tempval);
+        if(tempval != ideal){
+            printf("Error, address = %x, ideal = %x, readback = %x\r\n", start_address + bytecount, ideal, tempval);
             byte_errors++;
         }
     }
 
-    prbs_reg = 0x12345678; // initialize PRBS register starting seed value
-    // fixed seed
     printf("  Filling the entire test range with an inverted pseudorandom pattern.\r\n");
+    ramtest_start(&prbs, start_address);
     load_ram_address(start_address);
-    for(bytecount = 0; bytecount < num_bytes; bytecount++){
-        shift_prbs31(&prbs_reg); // shift 1 time
-        storebyte(~prbs_reg & 0xff);
-    }
+    for(bytecount = 0; bytecount < num_bytes; bytecount++)
+        storebyte(~prbs_next_byte(&prbs) & 0xff);
 
     printf("  Reading back the inverted data and checking the test range.\r\n");
-    prbs_reg = 0x12345678; // re-initialize PRBS register starting seed value
+    ramtest_start(&prbs, start_address);
     load_ram_address(start_address);
     for(bytecount = 0; bytecount < num_bytes; bytecount++){
-        shift_prbs31(&prbs_reg); // shift 1 time
+        ideal = ~prbs_next_byte(&prbs) & 0xff;
         int tempval = readbyte();
-        if(tempval != (~prbs_reg & 0xff)){
-            printf("Error, address = %x, ideal = %x, readback = %x\r\n", start_address + bytecount, ~prbs_reg & 0xff, tempval);
+        if(tempval != ideal){
+            printf("Error, address = %x, ideal = %x, readback = %x\r\n", start_address + bytecount, ideal, tempval);
             byte_errors++;
         }
     }
     printf(" Test complete. Byte error count = %d\r\n", byte_errors);
 }
 
+// FPGA SDRAM self test, each pattern is written to rows 0 through rows - 1 and read back at full SDRAM speed
+void sdram_bist(int rows){
+    static const int patterns[] = {BIST_PRBS, BIST_PRBS | BIST_INVERT, BIST_WALKING_ONES, BIST_ADDRESS};
+    static const char* pattern_names[] = {"PRBS", "inverted PRBS", "walking ones", "address in address"};
+    Sdram_Bist_Result result;
+    uint64_t test_start, start;
+    int total_errors;
+    bool done;
+
+    total_errors = 0;
+    printf("  SDRAM self test, %d rows, %d Mbytes.\r\n", rows, rows / 1024);
+    test_start = time_us_64();
+    for(int i = 0; i < (int) (sizeof(patterns) / sizeof(patterns[0])); i++){
+        start = time_us_64();
+        start_sdram_bist(rows, patterns[i]);
+        done = false;
+        while(!done && ((time_us_64() - start) < (BIST_TIMEOUT_MS * 1000))){
+            sleep_ms(1);
+            done = read_sdram_bist(&result);
+        }
+        if(!done){
+            printf("### ERROR, SDRAM self test did not finish in %d ms\r\n", BIST_TIMEOUT_MS);
+            return;
+        }
+        printf("  %-20s %5d errors, %4d ms\r\n", pattern_names[i], result.error_count, (int) ((time_us_64() - start) / 1000));
+        if(result.error_count != 0)
+            printf("    first error, address = %06x, ideal = %04x, readback = %04x, last error address = %06x\r\n",
+                result.first_address, result.expected, result.actual, result.last_address);
+        total_errors += result.error_count;
+    }
+    printf(" Test complete. Word error count = %d, %d ms\r\n", total_errors, (int) ((time_us_64() - test_start) / 1000));
+}
+
 void command_parse_and_dispatch (Disk_State* dstate)
 {
     int p1_numeric, p2_numeric, p3_numeric;
@@ -499,10 +543,12 @@ void command_parse_and_dispatch (Disk_State* dstate)
         }
     }
     else if((strcmp((char *) "DIRECTORY", extract_argv[0])==0) || (strcmp((char *) "DIR", extract_argv[0])==0) || (strcmp((char *) "D", extract_argv[0])==0)){
-        if(extract_argc != 1)
-            printf("### ERROR, %d fields entered, should be 1 field\r\n", extract_argc);
+        if(extract_argc > 2)
+            printf("### ERROR, %d fields entered, should be 1 or 2 fields\r\n", extract_argc);
+        else if((extract_argc == 2) && (strcmp((char *) "REFRESH", extract_argv[1]) != 0))
+            printf("### ERROR, field2 \"%s\" not recognized, should be REFRESH\r\n", extract_argv[1]);
         else{
-            card_directory();
+            card_directory(extract_argc == 2);
         }
     }
     else if((strcmp((char *) "VSENSE", extract_argv[0])==0) || (strcmp((char *) "DCLOW", extract_argv[0])==0) || (strcmp((char *) "V", extract_argv[0])==0)){
@@ -512,6 +558,13 @@ void command_parse_and_dispatch (Disk_State* dstate)
             vsense_test();
         }
     }
+    else if((strcmp((char *) "REGISTERS", extract_argv[0])==0) || (strcmp((char *) "REGS", extract_argv[0])==0)){
+        if(extract_argc != 1)
+            printf("### ERROR, %d fields entered, should be 1 field\r\n", extract_argc);
+        else{
+            register_dump();
+        }
+    }
     //else if((strcmp((char *) "REGISTER", extract_argv[0])==0) || (strcmp((char *) "REG", extract_argv[0])==0)){
         //if(extract_argc != 3)
             //printf("### ERROR, %d fields entered, should be 3 fields\r\n", extract_argc);
@@ -531,18 +584,46 @@ void command_parse_and_dispatch (Disk_State* dstate)
         else {
             printf("  SCANINPUTS, SCANI, I\r\n  SCANOUTPUTS, SCANO, O\r\n");
             printf("  ADDRESS, ADDR, A\r\n  ROCKER, ROCK, R\r\n  LEDTEST, LED, L\r\n");
-            printf("  DOORTEST, DOOR, M\r\n  DIRECTORY, DIR, D\r\n  VSENSE, DCLOW, V\r\n");
+            printf("  DOORTEST, DOOR, M\r\n  DIRECTORY, DIR, D [REFRESH]\r\n  VSENSE, DCLOW, V\r\n");
+            printf("  REGISTERS, REGS\r\n");
+            printf("  RAMTEST, MEMTEST [FULL]\r\n");
             printf("  RAMTEST, MEMTEST <hex start address> <hex number of bytes>\r\n");
+            printf("  LOADBENCH, LB\r\n");
+            printf("  CARDBENCH, CB\r\n");
         }
     }
     else if((strcmp((char *) "RAMTEST", extract_argv[0])==0) || (strcmp((char *) "MEMTEST", extract_argv[0])==0)){
-        if(extract_argc != 3)
-            printf("### ERROR, %d fields entered, should be 3 fields\r\n", extract_argc);
-        else{
+        if(extract_argc == 3){
             sscanf(extract_argv[1], "%x", &p2_numeric);
             sscanf(extract_argv[2], "%x", &p3_numeric);
             ramtest(p2_numeric, p3_numeric);
         }
+        else if((extract_argc == 2) && (strcmp((char *) "FULL", extract_argv[1]) != 0))
+            printf("### ERROR, field2 \"%s\" not recognized, should be FULL\r\n", extract_argv[1]);
+        else if(extract_argc > 3)
+            printf("### ERROR, %d fields entered, should be 1, 2 or 3 fields\r\n", extract_argc);
+        else if(!is_fpga_bist_capable())
+            printf("### ERROR, the FPGA has no SDRAM self test, use RAMTEST <hex start address> <hex number of bytes>\r\n");
+        else
+            sdram_bist(extract_argc == 2 ? BIST_ALL_ROWS : BIST_EMULATOR_ROWS);
+    }
+    else if((strcmp((char *) "LOADBENCH", extract_argv[0])==0) || (strcmp((char *) "LB", extract_argv[0])==0)){
+        if(extract_argc != 1)
+            printf("### ERROR, %d fields entered, should be 1 field\r\n", extract_argc);
+        else{
+            printf("  Image load benchmark, the SDRAM is overwritten and the image file is rewritten.\r\n");
+            if(file_load_benchmark(dstate) != FILE_OPS_OKAY)
+                printf("### ERROR, load benchmark did not complete\r\n");
+        }
+    }
+    else if((strcmp((char *) "CARDBENCH", extract_argv[0])==0) || (strcmp((char *) "CB", extract_argv[0])==0)){
+        if(extract_argc != 1)
+            printf("### ERROR, %d fields entered, should be 1 field\r\n", extract_argc);
+        else{
+            printf("  microSD card benchmark, a 1 MB scratch file is written and deleted.\r\n");
+            if(card_benchmark() != FILE_OPS_OKAY)
+                printf("### ERROR, card benchmark did not complete or the card failed\r\n");
+        }
     }
     else
         printf("### ERROR, invalid command, field1 \"%s\" not recognized\r\n", extract_argv[0]);
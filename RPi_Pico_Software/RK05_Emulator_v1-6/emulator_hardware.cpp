@@ -15,6 +15,7 @@
 #include "disk_state_definitions.h"
 #include "display_functions.h"
 #include "emulator_state_definitions.h"
+#include "emulator_hardware.h"
 
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
@@ -66,6 +67,18 @@
 //FPGA VERSIONS
 #define FPGA_MIN_VERSION 0
 #define FPGA_MAX_VERSION 255
+#define FPGA_BURST_MAJOR_VERSION 1  // first FPGA version that supports burst register access is 1.16
+#define FPGA_BURST_MINOR_VERSION 16
+#define FPGA_CRC_MAJOR_VERSION 1    // first FPGA version with the sector CRC check is 1.17
+#define FPGA_CRC_MINOR_VERSION 17
+#define FPGA_TURBO_MAJOR_VERSION 1  // first FPGA version with the sector time base register is 1.18
+#define FPGA_TURBO_MINOR_VERSION 18
+#define FPGA_SEEK_MAJOR_VERSION 1   // first FPGA version with the seek time model is 1.19
+#define FPGA_SEEK_MINOR_VERSION 19
+#define FPGA_NCO_MAJOR_VERSION 1    // first FPGA version with the phase accumulator bit clock is 1.20
+#define FPGA_NCO_MINOR_VERSION 20
+#define FPGA_BIST_MAJOR_VERSION 1   // first FPGA version with the SDRAM self test is 1.21
+#define FPGA_BIST_MINOR_VERSION 21
 
 //FPGA CPU REGISTERS, WRITE
 #define SPI_CONTROL_0 0
@@ -84,12 +97,24 @@
 #define SPI_USECPERSECTH_10 0x10
 #define SPI_USECPERSECTL_11 0x11
 #define SPI_SERVO_PW_12 0x12
+#define SPI_SECTOR_TIMEBASE_13 0x13
+#define SPI_SEEK_SETTLE_14 0x14
+#define SPI_SEEK_PER_TRACK_15 0x15
+#define SPI_NCO_TUNINGH_16 0x16
+#define SPI_NCO_TUNINGM_17 0x17
+#define SPI_NCO_TUNINGL_18 0x18
+#define SPI_BIST_CONTROL_19 0x19
+#define SPI_BIST_LAST_ROWH_1A 0x1a
+#define SPI_BIST_LAST_ROWL_1B 0x1b
 #define SPI_INTERFACE_TEST_MODE_20 0x20
 
 //FPGA CPU REGISTERS, READ
 #define SPI_STATUS_80 0x80
 #define SPI_CYLADDR_81 0x81
 #define SPI_DRVSTATUS_82 0x82
+#define SPI_CRC_STATUS_83 0x83
+#define SPI_CRC_ERRCOUNTH_84 0x84
+#define SPI_CRC_ERRCOUNTL_85 0x85
 #define SPI_DRAMREAD_88 0x88
 #define SPI_FUNCT_ID_89 0x89
 #define SPI_FPGACODE_VER_90 0x90
@@ -109,12 +134,46 @@
 #define SPI_READBACK_00_AF 0xaf
 #define SPI_READBACK_00_B0 0xb0
 #define SPI_READBACK_00_B1 0xb1
+#define SPI_READBACK_00_B3 0xb3
+#define SPI_READBACK_00_B4 0xb4
+#define SPI_READBACK_00_B5 0xb5
+#define SPI_READBACK_00_B6 0xb6
+#define SPI_BIST_STATUS_B9 0xb9
+#define SPI_BIST_ERRCOUNTH_BC 0xbc
+#define SPI_BIST_LAST_ADDRL_C7 0xc7
 
 #define DRIVE_ADDRESS_BITS 0x7
 #define FILE_READY_BIT 0x10
 #define FAULT_LATCH_BIT 0x20
 #define DC_LOW_BIT 0x80
 #define TOGGLE_WP_BIT 0x1
+#define CLEAR_CRC_COUNT_BIT 0x2
+#define CRC_SECTOR_DONE_BIT 0x80
+#define CRC_STATUS_POLL_LIMIT 10
+#define BIST_START_BIT 0x1
+#define BIST_DONE_BIT 0x80
+#define BIST_RESULT_SIZE (SPI_BIST_LAST_ADDRL_C7 - SPI_BIST_ERRCOUNTH_BC + 1)
+
+// turbo mode limits, the sector and index pulses get shorter as the speed goes up so 4x is the limit
+#define TURBO_MIN_PERCENT 100
+#define TURBO_MAX_PERCENT 400
+#define SECTOR_TIMEBASE_REAL 40 // 40 MHz clocks in 1 usec
+#define MIN_BITCLKDIV 3
+
+// RK05 seek model, linear fit of the 10 msec track-to-track and 85 msec 202 cylinder seek times
+#define RK05_SEEK_SETTLE_USEC 9630
+#define RK05_SEEK_PER_TRACK_USEC 373
+#define SEEK_SETTLE_UNIT_USEC 128
+#define SEEK_PER_TRACK_UNIT_USEC 4
+#define SEEK_SCALE_MAX_PERCENT 1000
+
+// phase accumulator bit clock, the half-bit rate is tuning word * FPGA_CLOCK_HZ / 2^24
+#define FPGA_CLOCK_HZ 40000000
+#define NCO_ACCUMULATOR_BITS 24
+#define NCO_MAX_TUNING_WORD (1 << (NCO_ACCUMULATOR_BITS - 1)) // at least two clocks per half bit
+#define MIN_BITRATE 100000
+#define MAX_BITRATE 5000000
+#define BITPULSE_WIDTH 6 // 150 nsec clock and data pulses
 
 #define dc_lower_threshold 2850 // 3850 // equivalent of ~4.70 V
 #define dc_upper_threshold 2940 // 3972 // equivalent of ~4.85 V
@@ -128,6 +187,8 @@
 #define DOOR_IS_OPENING 0
 
 #define BUF_LEN 2
+#define SPI_BURST_MAX 64    // largest number of data bytes in one burst transaction
+#define SPI_SHADOW_SIZE 0x20 // write registers 0x00 through 0x1f are shadowed
 //#define PICO_DEFAULT_SPI_CSN_PIN 17
 
 //static int debugdrivedoorstatus;
@@ -138,6 +199,13 @@ static uint servo_chan;
 
 static uint8_t dutyfactortable_fpga[21] = {47, 49, 51, 53, 55, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79, 81, 83, 85, 88};
 
+// copy of the last value written to each FPGA write register so that read-modify-write
+// of the control register doesn't need an SPI readback transaction
+static uint8_t spi_shadow[SPI_SHADOW_SIZE];
+static bool fpga_burst_capable = false; // set by initialize_fpga() when the FPGA supports burst register access
+static int fpga_version = 0;
+static int fpga_minorversion = 0;
+
 #ifdef PICO_DEFAULT_SPI_CSN_PIN
 static inline void cs_select()
 {
@@ -177,6 +245,110 @@ void write_spi_register(uint8_t reg, uint8_t data)
     cs_select();
     spi_write_read_blocking (spi_default, out_buf, in_buf, 2);
     cs_deselect();
+    if(reg < SPI_SHADOW_SIZE)
+        spi_shadow[reg] = data;
+}
+
+// write count consecutive registers starting at first_reg in a single SPI transaction.
+// The range must not include the SDRAM ports 0x05 and 0x06 because the FPGA doesn't auto-increment past them.
+// Older FPGA versions without burst support get one transaction per register.
+void write_spi_registers(uint8_t first_reg, const uint8_t* data, int count)
+{
+    uint8_t out_buf [SPI_BURST_MAX + 1];
+    int i;
+    if((count <= 0) || (count > SPI_BURST_MAX)){
+        printf("###ERROR, SPI burst write of %d bytes\r\n", count);
+        return;
+    }
+    if(!fpga_burst_capable){
+        for(i = 0; i < count; i++)
+            write_spi_register(first_reg + i, data[i]);
+        return;
+    }
+    out_buf[0] = first_reg;
+    memcpy(&out_buf[1], data, count);
+    cs_select();
+    spi_write_blocking (spi_default, out_buf, count + 1);
+    cs_deselect();
+    for(i = 0; i < count; i++){
+        if((first_reg + i) < SPI_SHADOW_SIZE)
+            spi_shadow[first_reg + i] = data[i];
+    }
+}
+
+// read count consecutive registers starting at first_reg in a single SPI transaction.
+// With an older FPGA the registers are read one per transaction, and the SDRAM read port 0x88
+// is skipped and returned as zero because reading it advances the SDRAM read pointer.
+void read_spi_registers(uint8_t first_reg, uint8_t* data, int count)
+{
+    uint8_t out_buf [SPI_BURST_MAX + 1], in_buf [SPI_BURST_MAX + 1];
+    int i;
+    if((count <= 0) || (count > SPI_BURST_MAX)){
+        printf("###ERROR, SPI burst read of %d bytes\r\n", count);
+        return;
+    }
+    if(!fpga_burst_capable){
+        for(i = 0; i < count; i++)
+            data[i] = ((first_reg + i) == SPI_DRAMREAD_88) ? 0 : read_write_spi_register(first_reg + i, 0);
+        return;
+    }
+    memset(out_buf, 0, count + 1);
+    out_buf[0] = first_reg;
+    cs_select();
+    spi_write_read_blocking (spi_default, out_buf, in_buf, count + 1);
+    cs_deselect();
+    memcpy(data, &in_buf[1], count);
+}
+
+// write count bytes to the same register, used for the SDRAM address port that doesn't auto-increment
+void write_spi_port(uint8_t reg, const uint8_t* data, int count)
+{
+    uint8_t out_buf [SPI_BURST_MAX + 1];
+    int i;
+    if(!fpga_burst_capable || (count > SPI_BURST_MAX)){
+        for(i = 0; i < count; i++)
+            write_spi_register(reg, data[i]);
+        return;
+    }
+    out_buf[0] = reg;
+    memcpy(&out_buf[1], data, count);
+    cs_select();
+    spi_write_blocking (spi_default, out_buf, count + 1);
+    cs_deselect();
+}
+
+// update the shadow copy of the write registers from the FPGA readback registers
+void sync_spi_shadow()
+{
+    uint8_t readback[SPI_READBACK_00_B1 - SPI_READBACK_00_A0 + 1];
+    read_spi_registers(SPI_READBACK_00_A0, readback, sizeof(readback));
+    spi_shadow[SPI_CONTROL_0] = readback[0];
+    for(int reg = SPI_PREAMBLE1_7; reg <= SPI_USECPERSECTL_11; reg++)
+        spi_shadow[reg] = readback[reg];
+    if(fpga_version_at_least(FPGA_TURBO_MAJOR_VERSION, FPGA_TURBO_MINOR_VERSION))
+        spi_shadow[SPI_SECTOR_TIMEBASE_13] = read_write_spi_register(SPI_READBACK_00_B3, 0);
+    if(fpga_version_at_least(FPGA_SEEK_MAJOR_VERSION, FPGA_SEEK_MINOR_VERSION)){
+        spi_shadow[SPI_SEEK_SETTLE_14] = read_write_spi_register(SPI_READBACK_00_B4, 0);
+        spi_shadow[SPI_SEEK_PER_TRACK_15] = read_write_spi_register(SPI_READBACK_00_B5, 0);
+    }
+    if(fpga_version_at_least(FPGA_NCO_MAJOR_VERSION, FPGA_NCO_MINOR_VERSION))
+        read_spi_registers(SPI_READBACK_00_B6, &spi_shadow[SPI_NCO_TUNINGH_16], 3);
+}
+
+bool is_fpga_burst_capable()
+{
+    return(fpga_burst_capable);
+}
+
+// true if the FPGA version read by initialize_fpga() is the same as or later than major.minor
+bool fpga_version_at_least(int major, int minor)
+{
+    return((fpga_version > major) || ((fpga_version == major) && (fpga_minorversion >= minor)));
+}
+
+bool is_fpga_crc_capable()
+{
+    return(fpga_version_at_least(FPGA_CRC_MAJOR_VERSION, FPGA_CRC_MINOR_VERSION));
 }
 
 void toggle_wp()
@@ -184,10 +356,66 @@ void toggle_wp()
     write_spi_register(SPI_COMMAND_4, TOGGLE_WP_BIT);
 }
 
+void clear_crc_error_count()
+{
+    write_spi_register(SPI_COMMAND_4, CLEAR_CRC_COUNT_BIT);
+}
+
+// returns the FPGA CRC check status of the sector most recently written to the SDRAM, bit 1 is a header error
+// and bit 0 is a CRC error. The FPGA takes a few clocks to finish the CRC so the sector done bit is polled.
+int read_sector_crc_status()
+{
+    int status = 0;
+    for(int i = 0; i < CRC_STATUS_POLL_LIMIT; i++){
+        status = read_write_spi_register(SPI_CRC_STATUS_83, 0);
+        if((status & CRC_SECTOR_DONE_BIT) != 0)
+            return(status & (SECTOR_HEADER_ERROR | SECTOR_CRC_ERROR));
+    }
+    return(SECTOR_CHECK_TIMEOUT);
+}
+
+int read_crc_error_count()
+{
+    uint8_t regs[2];
+    read_spi_registers(SPI_CRC_ERRCOUNTH_84, regs, 2);
+    return((regs[0] << 8) | regs[1]);
+}
+
+bool is_fpga_bist_capable()
+{
+    return(fpga_version_at_least(FPGA_BIST_MAJOR_VERSION, FPGA_BIST_MINOR_VERSION));
+}
+
+// start the FPGA SDRAM self test of rows 0 through rows - 1, a row is bank << 13 | row.
+// pattern is one of the BIST_ patterns, BIST_INVERT complements it. The SDRAM contents are overwritten.
+void start_sdram_bist(int rows, int pattern)
+{
+    uint8_t last_row[2];
+    last_row[0] = ((rows - 1) >> 8) & 0x7f;
+    last_row[1] = (rows - 1) & 0xff;
+    write_spi_registers(SPI_BIST_LAST_ROWH_1A, last_row, 2);
+    write_spi_register(SPI_BIST_CONTROL_19, ((pattern & 0x7) << 1) | BIST_START_BIT);
+}
+
+// read the SDRAM self test status and, once it is done, the results. Returns true when the test is done.
+bool read_sdram_bist(Sdram_Bist_Result* result)
+{
+    uint8_t regs[BIST_RESULT_SIZE];
+    if((read_write_spi_register(SPI_BIST_STATUS_B9, 0) & BIST_DONE_BIT) == 0)
+        return(false);
+    read_spi_registers(SPI_BIST_ERRCOUNTH_BC, regs, BIST_RESULT_SIZE);
+    result->error_count = (regs[0] << 8) | regs[1];
+    result->first_address = (regs[2] << 16) | (regs[3] << 8) | regs[4];
+    result->expected = (regs[5] << 8) | regs[6];
+    result->actual = (regs[7] << 8) | regs[8];
+    result->last_address = (regs[9] << 16) | (regs[10] << 8) | regs[11];
+    return(true);
+}
+
 void set_file_ready()
 {
     printf("set_file_ready\r\n");
-    int tempctrlreg = read_write_spi_register(SPI_READBACK_00_A0, 0);
+    int tempctrlreg = spi_shadow[SPI_CONTROL_0];
     tempctrlreg = tempctrlreg | FILE_READY_BIT;
     write_spi_register(SPI_CONTROL_0, tempctrlreg & 0xff);
 }
@@ -196,7 +424,7 @@ void clear_file_ready()
 {
     //int tempctrlreg;
     printf("clear_file_ready\r\n");
-    int tempctrlreg = read_write_spi_register(SPI_READBACK_00_A0, 0);
+    int tempctrlreg = spi_shadow[SPI_CONTROL_0];
     //tempctrlreg = 0;
     tempctrlreg = tempctrlreg & ~FILE_READY_BIT;
     write_spi_register(SPI_CONTROL_0, tempctrlreg & 0xff);
@@ -204,14 +432,14 @@ void clear_file_ready()
 
 void set_fault_latch()
 {
-    int tempctrlreg = read_write_spi_register(SPI_READBACK_00_A0, 0);
+    int tempctrlreg = spi_shadow[SPI_CONTROL_0];
     tempctrlreg = tempctrlreg | FAULT_LATCH_BIT;
     write_spi_register(SPI_CONTROL_0, tempctrlreg & 0xff);
 }
 
 void clear_fault_latch()
 {
-    int tempctrlreg = read_write_spi_register(SPI_READBACK_00_A0, 0);
+    int tempctrlreg = spi_shadow[SPI_CONTROL_0];
     tempctrlreg = tempctrlreg & ~FAULT_LATCH_BIT;
     write_spi_register(SPI_CONTROL_0, tempctrlreg & 0xff);
 }
@@ -281,22 +509,29 @@ void assert_outputs(int step_count){
 }
 
 int read_test_inputs(){
-    int retval = read_write_spi_register(SPI_TEST_MODE_GRP1_94, 0);
-    retval |= (read_write_spi_register(SPI_TEST_MODE_GRP2_95, 0) & 0xff) << 8;
-    retval |= (read_write_spi_register(SPI_TEST_MODE_GRP3_96, 0) & 0xff) << 16;
+    uint8_t regs[3];
+    read_spi_registers(SPI_TEST_MODE_GRP1_94, regs, 3);
+    int retval = regs[0] | (regs[1] << 8) | (regs[2] << 16);
     return(retval);
 }
 
 int read_int_inputs(){
-    int retval = read_write_spi_register(SPI_CYLADDR_81, 0);
-    retval |= (read_write_spi_register(SPI_DRVSTATUS_82, 0) & 0xff) << 8;
+    uint8_t regs[2];
+    read_spi_registers(SPI_CYLADDR_81, regs, 2);
+    int retval = regs[0] | (regs[1] << 8);
     retval |= (read_write_spi_register(SPI_TEST_MODE_GRP2_95, 0) & 0xff) << 16;
     return(retval);
 }
 
+// read the FPGA status and readback registers 0x80 through 0xb1 in one burst
+void read_register_block(uint8_t* regs)
+{
+    read_spi_registers(REGISTER_BLOCK_FIRST, regs, REGISTER_BLOCK_SIZE);
+}
+
 void load_drive_address(int d_addr)
 {
-    int tempctrlreg = read_write_spi_register(SPI_READBACK_00_A0, 0);
+    int tempctrlreg = spi_shadow[SPI_CONTROL_0];
     tempctrlreg = (tempctrlreg & ~DRIVE_ADDRESS_BITS) | d_addr;
     write_spi_register(SPI_CONTROL_0, tempctrlreg & 0xff);
 }
@@ -322,9 +557,11 @@ bool is_it_a_tester()
 
 void load_ram_address(int ramaddress)
 {
-    write_spi_register(SPI_DRAM_ADDR_5, (ramaddress >> 16) & 0xff);
-    write_spi_register(SPI_DRAM_ADDR_5, (ramaddress >> 8)  & 0xff);
-    write_spi_register(SPI_DRAM_ADDR_5,  ramaddress        & 0xff);
+    uint8_t addrbytes[3];
+    addrbytes[0] = (ramaddress >> 16) & 0xff;
+    addrbytes[1] = (ramaddress >> 8)  & 0xff;
+    addrbytes[2] =  ramaddress        & 0xff;
+    write_spi_port(SPI_DRAM_ADDR_5, addrbytes, 3);
 }
 
 void storebyte(int bytevalue)
@@ -339,36 +576,141 @@ int readbyte()
 
 }
 
+// turbo mode divides the bit clock and the sector time base by turbo_percent / 100 so the whole disk
+// rotation is faster. The bit clock dividers are rounded down and the sector time base is rounded up so
+// the sector is never shorter than the bits in it. Any setting that can't be used falls back to real drive timing.
+static void apply_turbo(Disk_State* ddisk, bool rate_available, uint8_t* clockphase, uint8_t* dataphase, uint8_t* pulsewidth)
+{
+    int turbo = ddisk->turbo_percent;
+    if(turbo != 100){
+        if((turbo < TURBO_MIN_PERCENT) || (turbo > TURBO_MAX_PERCENT)){
+            printf("###ERROR, turbo=%d is outside %d to %d, using real drive timing\r\n", turbo, TURBO_MIN_PERCENT, TURBO_MAX_PERCENT);
+            turbo = 100;
+        }
+        else if(!fpga_version_at_least(FPGA_TURBO_MAJOR_VERSION, FPGA_TURBO_MINOR_VERSION) || !rate_available){
+            printf("  turbo mode not available, using real drive timing\r\n");
+            turbo = 100;
+        }
+    }
+    ddisk->turbo_percent = turbo;
+    if(!fpga_version_at_least(FPGA_TURBO_MAJOR_VERSION, FPGA_TURBO_MINOR_VERSION))
+        return;
+    if(turbo != 100){
+        *clockphase = (*clockphase * 100) / turbo;
+        *dataphase = (*dataphase * 100) / turbo;
+        if(*clockphase < MIN_BITCLKDIV) *clockphase = MIN_BITCLKDIV;
+        if(*dataphase < MIN_BITCLKDIV) *dataphase = MIN_BITCLKDIV;
+        *pulsewidth = (*pulsewidth * 100) / turbo;
+        if(*pulsewidth < 1) *pulsewidth = 1;
+        printf("  turbo mode %d%%, bit clock dividers %d/%d, pulse width %d\r\n", turbo, *clockphase, *dataphase, *pulsewidth);
+    }
+    write_spi_register(SPI_SECTOR_TIMEBASE_13, (SECTOR_TIMEBASE_REAL * 100 + turbo - 1) / turbo);
+}
+
+// set the phase accumulator tuning word for the bitRate, scaled by the turbo factor, and return
+// the half-bit time in FPGA clocks. A tuning word of zero selects the integer bit clock dividers.
+static int write_nco_tuning_word(Disk_State* ddisk, bool enable)
+{
+    uint8_t tuning[3] = {0, 0, 0};
+    int halfbitclocks = 0;
+    if(enable){
+        uint64_t halfbitrate = (uint64_t) ddisk->bitRate * 2 * ddisk->turbo_percent / 100;
+        uint32_t word = (uint32_t) (((halfbitrate << NCO_ACCUMULATOR_BITS) + FPGA_CLOCK_HZ / 2) / FPGA_CLOCK_HZ);
+        if(word > NCO_MAX_TUNING_WORD)
+            word = NCO_MAX_TUNING_WORD;
+        tuning[0] = (word >> 16) & 0xff;
+        tuning[1] = (word >> 8) & 0xff;
+        tuning[2] = word & 0xff;
+        halfbitclocks = FPGA_CLOCK_HZ / halfbitrate;
+        printf("  bit clock tuning word 0x%06x, %d bps\r\n", word,
+            (int) (((uint64_t) word * FPGA_CLOCK_HZ) >> (NCO_ACCUMULATOR_BITS + 1)));
+    }
+    write_spi_registers(SPI_NCO_TUNINGH_16, tuning, 3);
+    return(halfbitclocks);
+}
+
+// set the FPGA seek time registers from the seek model and scale factor
+static void apply_seek_model(Disk_State* ddisk)
+{
+    uint8_t seekregs[2] = {0, 0};
+    if(!fpga_version_at_least(FPGA_SEEK_MAJOR_VERSION, FPGA_SEEK_MINOR_VERSION)){
+        if(ddisk->seek_model != SEEK_INSTANT)
+            printf("  seek model not available, using instant seek\r\n");
+        ddisk->seek_model = SEEK_INSTANT;
+        return;
+    }
+    if(ddisk->seek_model == SEEK_RK05){
+        int scale = ddisk->seek_scale_percent;
+        if((scale < 1) || (scale > SEEK_SCALE_MAX_PERCENT)){
+            printf("###ERROR, seek_scale=%d is outside 1 to %d, using 100\r\n", scale, SEEK_SCALE_MAX_PERCENT);
+            scale = ddisk->seek_scale_percent = 100;
+        }
+        int settle = (RK05_SEEK_SETTLE_USEC * scale / 100 + SEEK_SETTLE_UNIT_USEC / 2) / SEEK_SETTLE_UNIT_USEC;
+        int pertrack = (RK05_SEEK_PER_TRACK_USEC * scale / 100 + SEEK_PER_TRACK_UNIT_USEC / 2) / SEEK_PER_TRACK_UNIT_USEC;
+        seekregs[0] = (settle > 255) ? 255 : settle;
+        seekregs[1] = (pertrack > 255) ? 255 : ((pertrack < 1) ? 1 : pertrack);
+        printf("  RK05 seek model, scale %d%%, settle %d usec, %d usec per cylinder\r\n", scale,
+            seekregs[0] * SEEK_SETTLE_UNIT_USEC, seekregs[1] * SEEK_PER_TRACK_UNIT_USEC);
+    }
+    write_spi_registers(SPI_SEEK_SETTLE_14, seekregs, 2);
+}
+
 // update the FPGA registers from the disk drive parameters read from the JSON header in the RK05 image file
 //
 void update_fpga_disk_state(Disk_State* ddisk){
+    // registers 0x07 through 0x11 are written in one burst, starting from the shadow copy
+    // so that the bit clock registers keep their present values if the bitRate is unknown
+    uint8_t regs[SPI_USECPERSECTL_11 - SPI_PREAMBLE1_7 + 1];
+    memcpy(regs, &spi_shadow[SPI_PREAMBLE1_7], sizeof(regs));
+    bool nco = fpga_version_at_least(FPGA_NCO_MAJOR_VERSION, FPGA_NCO_MINOR_VERSION) &&
+        (ddisk->bitRate >= MIN_BITRATE) && (ddisk->bitRate <= MAX_BITRATE);
+    bool known_rate = true;
     if(ddisk->bitRate == 1440000){
-        write_spi_register(SPI_BITCLKDIV_CP_D, 14);
-        write_spi_register(SPI_BITCLKDIV_DP_E, 14);
-        write_spi_register(SPI_BITPLSWIDTH_F, 6);
+        regs[SPI_BITCLKDIV_CP_D - SPI_PREAMBLE1_7] = 14;
+        regs[SPI_BITCLKDIV_DP_E - SPI_PREAMBLE1_7] = 14;
+        regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7] = 6;
     }
     else if(ddisk->bitRate == 1545000){
-        write_spi_register(SPI_BITCLKDIV_CP_D, 13);
-        write_spi_register(SPI_BITCLKDIV_DP_E, 13);
-        write_spi_register(SPI_BITPLSWIDTH_F, 6);
+        regs[SPI_BITCLKDIV_CP_D - SPI_PREAMBLE1_7] = 13;
+        regs[SPI_BITCLKDIV_DP_E - SPI_PREAMBLE1_7] = 13;
+        regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7] = 6;
     }
     else if(ddisk->bitRate == 1600000){
-        write_spi_register(SPI_BITCLKDIV_CP_D, 12);
-        write_spi_register(SPI_BITCLKDIV_DP_E, 13);
-        write_spi_register(SPI_BITPLSWIDTH_F, 6);
+        regs[SPI_BITCLKDIV_CP_D - SPI_PREAMBLE1_7] = 12;
+        regs[SPI_BITCLKDIV_DP_E - SPI_PREAMBLE1_7] = 13;
+        regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7] = 6;
     }
-    else
+    else if(nco){
+        // the phase accumulator generates the bit rate, the dividers are only approximate
+        known_rate = false;
+        regs[SPI_BITCLKDIV_CP_D - SPI_PREAMBLE1_7] = FPGA_CLOCK_HZ / 2 / ddisk->bitRate;
+        regs[SPI_BITCLKDIV_DP_E - SPI_PREAMBLE1_7] = FPGA_CLOCK_HZ / 2 / ddisk->bitRate;
+        regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7] = BITPULSE_WIDTH;
+    }
+    else{
+        known_rate = false;
         printf("###ERROR, unknown disk bitRate %d\r\n", ddisk->bitRate);
-    write_spi_register(SPI_PREAMBLE1_7, ddisk->preamble1Length);
-    write_spi_register(SPI_PREAMBLE2_8, ddisk->preamble2Length);
-    write_spi_register(SPI_DATA_LENH_9, ddisk->dataLength >> 8);
-    write_spi_register(SPI_DATA_LENL_A, ddisk->dataLength & 0xff);
-    write_spi_register(SPI_POSTAMBLE_B, ddisk->postambleLength);
-    //write_spi_register(<NO_REGISTER_FOR_THIS_YET>, ddisk->numberOfCylinders); // FPGA is coded with a constant == 203
-    write_spi_register(SPI_SECTPERTRK_C, ddisk->numberOfSectorsPerTrack);
-    //write_spi_register(<NO_REGISTER_FOR_THIS_YET>, ddisk->numberOfHeads); // FPGA is coded with a constant of 2 heads
-    write_spi_register(SPI_USECPERSECTH_10, ddisk->microsecondsPerSector >> 8);
-    write_spi_register(SPI_USECPERSECTL_11, ddisk->microsecondsPerSector & 0xff);
+    }
+    apply_turbo(ddisk, known_rate || nco, &regs[SPI_BITCLKDIV_CP_D - SPI_PREAMBLE1_7], &regs[SPI_BITCLKDIV_DP_E - SPI_PREAMBLE1_7], &regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7]);
+    regs[SPI_PREAMBLE1_7 - SPI_PREAMBLE1_7] = ddisk->preamble1Length;
+    regs[SPI_PREAMBLE2_8 - SPI_PREAMBLE1_7] = ddisk->preamble2Length;
+    regs[SPI_DATA_LENH_9 - SPI_PREAMBLE1_7] = ddisk->dataLength >> 8;
+    regs[SPI_DATA_LENL_A - SPI_PREAMBLE1_7] = ddisk->dataLength & 0xff;
+    regs[SPI_POSTAMBLE_B - SPI_PREAMBLE1_7] = ddisk->postambleLength;
+    // numberOfCylinders, FPGA is coded with a constant == 203
+    regs[SPI_SECTPERTRK_C - SPI_PREAMBLE1_7] = ddisk->numberOfSectorsPerTrack;
+    // numberOfHeads, FPGA is coded with a constant of 2 heads
+    regs[SPI_USECPERSECTH_10 - SPI_PREAMBLE1_7] = ddisk->microsecondsPerSector >> 8;
+    regs[SPI_USECPERSECTL_11 - SPI_PREAMBLE1_7] = ddisk->microsecondsPerSector & 0xff;
+    if(fpga_version_at_least(FPGA_NCO_MAJOR_VERSION, FPGA_NCO_MINOR_VERSION)){
+        // keep the pulse width shorter than the half bit
+        int halfbitclocks = write_nco_tuning_word(ddisk, nco);
+        uint8_t* pulsewidth = &regs[SPI_BITPLSWIDTH_F - SPI_PREAMBLE1_7];
+        if(nco && (*pulsewidth >= halfbitclocks))
+            *pulsewidth = (halfbitclocks > 1) ? halfbitclocks - 1 : 1;
+    }
+    write_spi_registers(SPI_PREAMBLE1_7, regs, sizeof(regs));
+    apply_seek_model(ddisk);
 }
 
 // *************** CPU GPIO Signals ***************
@@ -673,6 +1015,15 @@ void initialize_fpga(struct Disk_State* ddisk)
 {
     //fpga_ctrl_reg_image = 0;
     //update_drive_address(ddisk);
+
+    // read the FPGA version first because it determines whether burst register access can be used
+    // and later confirm whether it's compatible with the software version
+    ddisk->FPGA_version = fpga_version = read_fpga_version();
+    ddisk->FPGA_minorversion = fpga_minorversion = read_fpga_minorversion();
+    fpga_burst_capable = fpga_version_at_least(FPGA_BURST_MAJOR_VERSION, FPGA_BURST_MINOR_VERSION);
+    sync_spi_shadow();
+    spi_shadow[SPI_SERVO_PW_12] = dutyfactortable_fpga[0]; // no readback register for the servo pulse width, FPGA reset value
+
     clear_file_ready();
     ddisk->File_Ready = false;
     clear_fault_latch();
@@ -681,10 +1032,6 @@ void initialize_fpga(struct Disk_State* ddisk)
     ddisk->dc_low = false;
 
     //check_dc_low(ddisk);
-
-    // read the FPGA version and later confirm whether it's compatible with the software version
-    ddisk->FPGA_version = read_fpga_version();
-    ddisk->FPGA_minorversion = read_fpga_minorversion();
 }
 
 //void boot_open_the_door()
@@ -11,6 +11,32 @@
 #define DRIVE_ADDRESS_BITS_I2C 0x7
 #define DRIVE_FIXED_MODE_BIT_I2C 0x8
 
+// sector CRC check status returned by read_sector_crc_status()
+#define SECTOR_CRC_ERROR 0x1
+#define SECTOR_HEADER_ERROR 0x2
+#define SECTOR_CHECK_TIMEOUT 0x4
+
+// SDRAM self test patterns for start_sdram_bist(), BIST_INVERT complements the pattern
+#define BIST_PRBS 0
+#define BIST_WALKING_ONES 1
+#define BIST_ADDRESS 2
+#define BIST_CHECKERBOARD 3
+#define BIST_INVERT 4
+#define BIST_EMULATOR_ROWS 8192 // bank 0 holds the disk image, cylinder << 14 | head << 13 | sector << 9
+#define BIST_ALL_ROWS 32768     // all four banks
+
+struct Sdram_Bist_Result
+{
+    int error_count;    // saturates at 0xffff
+    int first_address;  // SDRAM word address of the first failing word
+    int expected;       // expected and actual data of the first failing word
+    int actual;
+    int last_address;   // SDRAM word address of the most recent failing word
+};
+
+#define REGISTER_BLOCK_FIRST 0x80
+#define REGISTER_BLOCK_SIZE 0x39 // FPGA status and readback registers 0x80 through 0xb8
+
 void initialize_uart();
 void initialize_gpio();
 void initialize_fpga(Disk_State* ddisk);
@@ -47,6 +73,20 @@ void microSD_LED_on();
 void microSD_LED_off();
 
 uint8_t read_write_spi_register(uint8_t reg, uint8_t data);
+void write_spi_registers(uint8_t first_reg, const uint8_t* data, int count);
+void read_spi_registers(uint8_t first_reg, uint8_t* data, int count);
+void write_spi_port(uint8_t reg, const uint8_t* data, int count);
+void sync_spi_shadow();
+bool is_fpga_burst_capable();
+bool fpga_version_at_least(int major, int minor);
+bool is_fpga_crc_capable();
+bool is_fpga_bist_capable();
+void start_sdram_bist(int rows, int pattern);
+bool read_sdram_bist(Sdram_Bist_Result* result);
+void clear_crc_error_count();
+int read_sector_crc_status();
+int read_crc_error_count();
+void read_register_block(uint8_t* regs);
 void toggle_wp();
 void set_file_ready();
 void clear_file_ready();
@@ -10,6 +10,7 @@
 
 #include "emulator_state_definitions.h"
 #include "disk_state_definitions.h"
+#include "image_catalog_definitions.h"
 #include "display_functions.h"
 //#include "display_timers.h"
 #include "emulator_hardware.h"
@@ -19,8 +20,32 @@
 #define LOADINGERROROFF 7
 #define UNLOADINGERRORON 4
 #define UNLOADINGERROROFF 4
+#define IMAGESELECTHOLD 20      // main loop passes WT PROT is held in the unloaded state to open the image selection
+#define IMAGESELECTTIMEOUT 90   // main loop passes without a switch change before the image selection is closed unchanged
 
 static int errorlightcount;
+static int wpholdcount;
+static int selectindex;
+static int selectidlecount;
+
+// open the image selection with the catalog of the card, the saved selection is shown first
+static bool start_image_selection(){
+    printf("Image selection\r\n");
+    if(!is_card_present()){
+        printf("*** ERROR, microSD card is not inserted\r\n");
+        display_error((char *) "no microSD", (char *) "inserted");
+        return(false);
+    }
+    if((image_catalog_refresh(false) != FILE_OPS_OKAY) || (image_catalog_count() == 0)){
+        printf("*** ERROR, no disk image file available\r\n");
+        display_error((char *) "no disk", (char *) "image found");
+        return(false);
+    }
+    selectindex = image_catalog_selected();
+    selectidlecount = 0;
+    display_catalog_entry(selectindex, image_catalog_count(), image_catalog_entry(selectindex));
+    return(true);
+}
 
 void process_run_load_state(Disk_State* dstate){
 int intermediate_result;
@@ -43,6 +68,40 @@ int intermediate_result;
                     dstate->run_load_state = RLST1; // If the RUN/LOAD switch is toggled to RUN then advance to RLST1
                 }
             }
+            else if(dstate->wp_switch){
+                // holding WT PROT opens the image selection, a shorter press toggles WT PROT when it is released
+                if((++wpholdcount == IMAGESELECTHOLD) && start_image_selection())
+                    dstate->run_load_state = RLST20;
+            }
+            else{
+                if(dstate->p_wp_switch && (wpholdcount < IMAGESELECTHOLD)){
+                    toggle_wp();
+                    printf("toggle WTPROT\r\n");
+                }
+                wpholdcount = 0;
+            }
+            break;
+        case RLST20:
+            // Unloaded, front panel image selection. Each press of WT PROT shows the next image of the catalog.
+            // Only toggling RUN/LOAD to RUN confirms the image shown, which is saved as the selection and loaded.
+            // If the switches have not been touched for IMAGESELECTTIMEOUT passes the operator only browsed,
+            // and the previous selection is left as it is.
+            if(dstate->rl_switch){
+                if(image_catalog_select(selectindex) != FILE_OPS_OKAY)
+                    display_error((char *) "cannot save", (char *) "selection");
+                printf("Switch toggled from LOAD to RUN\r\n");
+                dstate->run_load_state = RLST1;
+            }
+            else if(++selectidlecount >= IMAGESELECTTIMEOUT){
+                printf("Image selection timed out, the selection is unchanged\r\n");
+                display_status((char *) "selection", (char *) "unchanged");
+                dstate->run_load_state = RLST0;
+            }
+            else if(dstate->wp_switch && !dstate->p_wp_switch){
+                selectindex = (selectindex + 1) % image_catalog_count();
+                selectidlecount = 0;
+                display_catalog_entry(selectindex, image_catalog_count(), image_catalog_entry(selectindex));
+            }
             break;
         case RLST1:
             // The RUN/LOAD switch has been toggled to the “RUN” position. Check to see that the microSD has been inserted. 
@@ -157,7 +216,13 @@ int intermediate_result;
             // Read the disk image file and write it to the DRAM. If a read error occurs then go to load error state with code 7.
             printf("  Drive_Address = %d, RLST%x, %d, %d\r\n", dstate->Drive_Address, dstate->run_load_state, dstate->rl_switch, dstate->wp_switch);
             intermediate_result = read_disk_image_data(dstate);
-            if(intermediate_result != 0){
+            if(intermediate_result == FILE_OPS_CRC_ERROR){
+                file_close_disk_image();
+                printf("*** ERROR, disk image data has sector header or CRC errors\r\n");
+                display_error((char *) "image data", (char *) "CRC error");
+                dstate->run_load_state = RLST18;
+            }
+            else if(intermediate_result != 0){
                 file_close_disk_image();
                 printf("*** ERROR, problem reading disk image data\n");
                 display_error((char *) "cannot read", (char *) "image data");
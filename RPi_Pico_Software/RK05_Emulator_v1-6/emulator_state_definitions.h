@@ -34,3 +34,4 @@
 #define RLST1d 0x1d // Unloading error state, indicator on. Flash the Fault light indefinitely.
 #define RLST1e 0x1e // Unloading error state, indicator off. Flash the Fault light indefinitely.
 #define RLST1f 0x1f // wait for door to close after Unloading error state or unloaded RLST0 state.
+#define RLST20 0x20 // Unloaded, front panel image selection. WT PROT steps through the images on the display and RUN loads the one shown.
@@ -0,0 +1,487 @@
+// *********************************************************************************
+// controller_bfm.cpp
+//   bus-functional model of an RK8-E or RK11-D disk controller on the drive bus of
+//   the Verilated FPGA design, used to measure the emulator the way a host uses it
+//
+//   A pattern is a list of disk accesses, one per line:
+//     R <block> [<count>]   read count sectors starting at block
+//     W <block> [<count>]   write count sectors starting at block
+//     S <cylinder>          seek
+//   A block is a sector of the pack, (cylinder * heads + head) * sectors + sector,
+//   which is the OS/8 block number on an RK8-E and the sector number of a SIMH
+//   trace. Lines starting with '#' are comments. The pattern "os8" is built in.
+//
+//   A read is decoded from the BUS_RD_CLK_L and BUS_RD_DATA_L pulses, its header
+//   word and CRC are checked and it is compared with the SDRAM. A write sends the
+//   composite BUS_WT_DATA_CLK_L waveform of the controller, with a clock pulse at
+//   the start of each bit cell and a data pulse in the middle of a one, and the
+//   SDRAM is checked afterwards. The latency of an access is the time from its
+//   request to the sync bit, the seek and the rotational delay.
+// *********************************************************************************
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sim.h"
+
+#define PS_PER_NS 1000ULL
+#define PS_PER_US 1000000ULL
+#define ADDRESS_SETUP_US 1          // cylinder address to strobe
+#define STROBE_US 2                 // width of BUS_STROBE_L
+#define ADDRESS_RESPONSE_US 20      // time for the address accepted or invalid pulse to start
+#define SEEK_TIMEOUT_US 1000000
+#define FILE_READY_TIMEOUT_US 10000
+#define TIMEOUT_REVOLUTIONS 3       // the wanted sector must come around in this many revolutions
+#define WRITE_PULSE_NS 150          // width of the clock and data pulses on BUS_WT_DATA_CLK_L
+#define GATE_OFF_US 5               // time after a read or write before the next access
+#define MAX_SECTOR_BYTES 1024
+#define CRC_POLYNOMIAL 0xa001
+#define LINE_LENGTH 200
+
+// OS/8 on an RK8-E: the boot, the keyboard monitor and a DIR, then a PIP copy of a
+// file from the first file system of the pack to the second one and the directory updates
+static const char os8_pattern[] =
+    "# boot block, keyboard monitor and USR\n"
+    "R 0\n"
+    "R 7 6\n"
+    "R 13 3\n"
+    "# DIR, the directory segments and the program\n"
+    "R 1 6\n"
+    "R 26 4\n"
+    "# PIP, read a 40 block file and write it to the second file system\n"
+    "R 1 1\n"
+    "R 200 40\n"
+    "R 3249 1\n"
+    "W 3448 40\n"
+    "W 3249 1\n"
+    "R 1 1\n";
+
+struct Bfm_Counts
+{
+    int reads;
+    int writes;
+    int seeks;
+    int header_errors;
+    int crc_errors;
+    int compare_errors;
+    int timeouts;
+    uint64_t words;
+    uint64_t latency_ps_total;
+    uint64_t latency_ps_max;
+};
+
+static const struct Bfm_Disk* disk;
+static struct Sim_Bus_Inputs bus;
+static struct Bfm_Counts counts;
+static int present_cylinder;
+static uint32_t random_state = 1;
+
+static void set_bus()
+{
+    fpga_bus_set(&bus);
+}
+
+static void run_us(uint64_t us)
+{
+    fpga_bus_run_until_ps(fpga_bus_time_ps() + us * PS_PER_US);
+}
+
+static uint64_t revolution_ps()
+{
+    return((uint64_t) disk->sectors * disk->sector_us * PS_PER_US);
+}
+
+static uint16_t crc16(const uint8_t* buf, int length)
+{
+    uint16_t crc = 0;
+    for(int i = 0; i < length; i++){
+        crc ^= buf[i];
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC_POLYNOMIAL : crc >> 1;
+    }
+    return(crc);
+}
+
+static uint8_t random_byte()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return(random_state & 0xff);
+}
+
+// first SDRAM word of a sector
+static uint32_t sdram_address(int cylinder, int head, int sector)
+{
+    return((cylinder << 14) | (head << 13) | (sector << 9));
+}
+
+static bool same_as_sdram(const uint8_t* buf, uint32_t address)
+{
+    const uint16_t* wp = fpga_model_sdram() + address;
+    for(int i = 0; i < disk->sector_bytes; i++){
+        if(buf[i] != ((wp[i >> 1] >> ((i & 1) * 8)) & 0xff))
+            return(false);
+    }
+    return(true);
+}
+
+static void record_latency(uint64_t latency)
+{
+    counts.latency_ps_total += latency;
+    if(latency > counts.latency_ps_max)
+        counts.latency_ps_max = latency;
+}
+
+// strobe a cylinder address, or a restore with a negative cylinder, and wait for the heads to settle
+static bool seek(int cylinder)
+{
+    struct Sim_Bus_Outputs out;
+    uint64_t deadline;
+    bool accepted = false;
+
+    if(cylinder == present_cylinder)
+        return(true);
+    bus.restore_l = (cylinder < 0) ? 0 : 1;
+    bus.cyl_add_l = (cylinder < 0) ? 0xff : ~cylinder & 0xff;
+    set_bus();
+    run_us(ADDRESS_SETUP_US);
+    bus.strobe_l = 0;
+    set_bus();
+    run_us(STROBE_US);
+    bus.strobe_l = 1;
+    set_bus();
+
+    deadline = fpga_bus_time_ps() + ADDRESS_RESPONSE_US * PS_PER_US;
+    while(fpga_bus_time_ps() < deadline){
+        fpga_bus_clock();
+        fpga_bus_get(&out);
+        if(!out.address_invalid_l)
+            break;
+        if(!out.address_accepted_l){
+            accepted = true;
+            break;
+        }
+    }
+    bus.restore_l = 1;
+    bus.cyl_add_l = 0xff;
+    set_bus();
+    if(!accepted){
+        printf("*** bus model: cylinder %d not accepted\n", cylinder);
+        counts.timeouts++;
+        return(false);
+    }
+
+    deadline = fpga_bus_time_ps() + SEEK_TIMEOUT_US * PS_PER_US;
+    do{
+        fpga_bus_clock();
+        fpga_bus_get(&out);
+    } while(out.rws_rdy_l && fpga_bus_time_ps() < deadline);
+    if(out.rws_rdy_l){
+        printf("*** bus model: seek to cylinder %d did not complete\n", cylinder);
+        counts.timeouts++;
+        return(false);
+    }
+    present_cylinder = (cylinder < 0) ? 0 : cylinder;
+    counts.seeks++;
+    return(true);
+}
+
+// wait for the end of the sector pulse of a sector
+static bool wait_for_sector(int sector)
+{
+    struct Sim_Bus_Outputs out;
+    uint64_t deadline = fpga_bus_time_ps() + TIMEOUT_REVOLUTIONS * revolution_ps();
+    bool pulse = false;
+
+    while(fpga_bus_time_ps() < deadline){
+        fpga_bus_clock();
+        fpga_bus_get(&out);
+        if(!out.sec_pls_l)
+            pulse = true;
+        else if(pulse){
+            pulse = false;
+            if((~out.sec_cntr_l & 0xf) == sector)
+                return(true);
+        }
+    }
+    printf("*** bus model: no sector pulse for sector %d\n", sector);
+    counts.timeouts++;
+    return(false);
+}
+
+// seek, select the head and wait for the sector, the start of an access
+static bool find_sector(int block, int* cylinder, int* head, int* sector)
+{
+    *sector = block % disk->sectors;
+    *head = (block / disk->sectors) % disk->heads;
+    *cylinder = block / (disk->sectors * disk->heads);
+    if(!seek(*cylinder))
+        return(false);
+    bus.head_select_l = *head ? 0 : 1;
+    set_bus();
+    return(wait_for_sector(*sector));
+}
+
+static bool read_sector(int block)
+{
+    static uint8_t buf[MAX_SECTOR_BYTES];
+    struct Sim_Bus_Outputs out;
+    uint64_t start = fpga_bus_time_ps();
+    uint64_t deadline;
+    uint64_t sync_ps = 0;
+    int cylinder, head, sector;
+    int bits = 0;
+    bool synced = false;
+    bool have_cell = false;
+    bool cell_data = false;
+    bool clk_l = true;
+    bool data_l = true;
+
+    if(!find_sector(block, &cylinder, &head, &sector))
+        return(false);
+    memset(buf, 0, disk->sector_bytes);
+    bus.rd_gate_l = 0;
+    set_bus();
+
+    // a clock pulse starts each bit cell and ends the one before it, a data pulse in the cell is a one
+    deadline = fpga_bus_time_ps() + 2 * (uint64_t) disk->sector_us * PS_PER_US;
+    while(bits < disk->sector_bytes * 8 && fpga_bus_time_ps() < deadline){
+        fpga_bus_clock();
+        fpga_bus_get(&out);
+        if(clk_l && !out.rd_clk_l){
+            if(have_cell){
+                if(synced){
+                    buf[bits >> 3] |= (cell_data ? 1 : 0) << (bits & 7);
+                    bits++;
+                }
+                else if(cell_data){
+                    synced = true;
+                    sync_ps = fpga_bus_time_ps();
+                }
+            }
+            have_cell = true;
+            cell_data = false;
+        }
+        if(data_l && !out.rd_data_l)
+            cell_data = true;
+        clk_l = out.rd_clk_l;
+        data_l = out.rd_data_l;
+    }
+    bus.rd_gate_l = 1;
+    set_bus();
+    run_us(GATE_OFF_US);
+
+    if(bits < disk->sector_bytes * 8){
+        printf("*** bus model: read of block %d stopped after %d bits\n", block, bits);
+        counts.timeouts++;
+        return(false);
+    }
+    counts.reads++;
+    counts.words += disk->data_words;
+    record_latency(sync_ps - start);
+    if((buf[0] | (buf[1] << 8)) != (cylinder << 5))
+        counts.header_errors++;
+    if(crc16(buf + 2, disk->sector_bytes - 2) != 0)
+        counts.crc_errors++;
+    if(!same_as_sdram(buf, sdram_address(cylinder, head, sector)))
+        counts.compare_errors++;
+    return(true);
+}
+
+// one bit cell on BUS_WT_DATA_CLK_L
+static void write_cell(uint64_t cell_start, uint64_t cell_ps, bool one)
+{
+    bus.wt_data_clk_l = 0;
+    set_bus();
+    fpga_bus_run_until_ps(cell_start + WRITE_PULSE_NS * PS_PER_NS);
+    bus.wt_data_clk_l = 1;
+    set_bus();
+    if(one){
+        fpga_bus_run_until_ps(cell_start + cell_ps / 2);
+        bus.wt_data_clk_l = 0;
+        set_bus();
+        fpga_bus_run_until_ps(cell_start + cell_ps / 2 + WRITE_PULSE_NS * PS_PER_NS);
+        bus.wt_data_clk_l = 1;
+        set_bus();
+    }
+    fpga_bus_run_until_ps(cell_start + cell_ps);
+}
+
+static bool write_sector(int block)
+{
+    static uint8_t buf[MAX_SECTOR_BYTES];
+    uint64_t start = fpga_bus_time_ps();
+    uint64_t cell_ps = 1000000000000ULL / disk->bit_rate;
+    uint64_t t;
+    uint16_t crc;
+    int cylinder, head, sector;
+    int databits = disk->sector_bytes * 8;
+
+    if(!find_sector(block, &cylinder, &head, &sector))
+        return(false);
+    buf[0] = (cylinder << 5) & 0xff;
+    buf[1] = (cylinder << 5) >> 8;
+    for(int i = 2; i < disk->sector_bytes - 2; i++)
+        buf[i] = random_byte();
+    crc = crc16(buf + 2, disk->sector_bytes - 4);
+    buf[disk->sector_bytes - 2] = crc & 0xff;
+    buf[disk->sector_bytes - 1] = crc >> 8;
+
+    bus.wt_gate_l = 0;
+    set_bus();
+    t = fpga_bus_time_ps();
+    for(int i = 0; i < disk->preamble_bits; i++, t += cell_ps)
+        write_cell(t, cell_ps, false);
+    record_latency(t - start);
+    write_cell(t, cell_ps, true);
+    t += cell_ps;
+    for(int i = 0; i < databits; i++, t += cell_ps)
+        write_cell(t, cell_ps, (buf[i >> 3] >> (i & 7)) & 1);
+    for(int i = 0; i < disk->postamble_bits; i++, t += cell_ps)
+        write_cell(t, cell_ps, false);
+    bus.wt_gate_l = 1;
+    set_bus();
+    run_us(GATE_OFF_US);
+
+    counts.writes++;
+    counts.words += disk->data_words;
+    if(!same_as_sdram(buf, sdram_address(cylinder, head, sector)))
+        counts.compare_errors++;
+    return(true);
+}
+
+// one line of a pattern
+static bool run_line(const char* line, int lineno)
+{
+    char op;
+    int value;
+    int count = 1;
+    int blocks = disk->cylinders * disk->heads * disk->sectors;
+    int fields = sscanf(line, " %c %d %d", &op, &value, &count);
+
+    if(fields <= 0 || op == '#')
+        return(true);
+    if(fields < 2 || count < 1){
+        printf("*** bus model: line %d, can't read \"%s\"\n", lineno, line);
+        return(false);
+    }
+    switch(op){
+        case 'S':
+            if(value < 0 || value >= disk->cylinders){
+                printf("*** bus model: line %d, no cylinder %d\n", lineno, value);
+                return(false);
+            }
+            return(seek(value));
+        case 'R':
+        case 'W':
+            if(value < 0 || value + count > blocks){
+                printf("*** bus model: line %d, blocks %d to %d are not on the pack\n", lineno, value, value + count - 1);
+                return(false);
+            }
+            for(int i = 0; i < count; i++){
+                if(!(op == 'R' ? read_sector(value + i) : write_sector(value + i)))
+                    return(false);
+            }
+            return(true);
+        default:
+            printf("*** bus model: line %d, unknown access %c\n", lineno, op);
+            return(false);
+    }
+}
+
+// select drive 0 and wait for it to be ready, then restore the heads to cylinder 0
+static bool select_drive()
+{
+    struct Sim_Bus_Outputs out;
+    uint64_t deadline = fpga_bus_time_ps() + FILE_READY_TIMEOUT_US * PS_PER_US;
+
+    memset(&bus, 0xff, sizeof(bus));
+    bus.sel_dr_l = 0xf;
+    bus.rk11d_l = disk->rk11d ? 0 : 1;
+    if(!disk->rk11d)
+        bus.sel_dr_l = 0xe; // RK8-E, one select line per drive
+    set_bus();
+    do{
+        fpga_bus_clock();
+        fpga_bus_get(&out);
+    } while(out.file_ready_l && fpga_bus_time_ps() < deadline);
+    if(out.file_ready_l){
+        printf("*** bus model: drive 0 is not ready\n");
+        return(false);
+    }
+    present_cylinder = -1;
+    return(seek(-1));
+}
+
+static void deselect_drive()
+{
+    memset(&bus, 0xff, sizeof(bus));
+    bus.sel_dr_l = 0xf;
+    set_bus();
+}
+
+// run a pattern, the built-in "os8" one or a pattern file, and print the throughput
+bool bfm_run_pattern(const char* pattern, const struct Bfm_Disk* bfm_disk, FILE* report)
+{
+    char line[LINE_LENGTH];
+    const char* p = os8_pattern;
+    FILE* fp = NULL;
+    uint64_t start;
+    double seconds;
+    int lineno = 0;
+    int accesses;
+    bool ok;
+
+    if(bfm_disk->sector_bytes > MAX_SECTOR_BYTES || bfm_disk->sectors > 16){
+        printf("*** bus model: the disk geometry is not supported\n");
+        return(false);
+    }
+    if(strcmp(pattern, "os8") != 0){
+        fp = fopen(pattern, "r");
+        if(fp == NULL){
+            perror(pattern);
+            return(false);
+        }
+    }
+    disk = bfm_disk;
+    memset(&counts, 0, sizeof(counts));
+
+    ok = select_drive();
+    counts.seeks = 0;
+    start = fpga_bus_time_ps();
+    while(ok){
+        if(fp != NULL){
+            if(fgets(line, sizeof(line), fp) == NULL)
+                break;
+        }
+        else{
+            size_t n = strcspn(p, "\n");
+            if(*p == '\0')
+                break;
+            if(n >= sizeof(line))
+                n = sizeof(line) - 1;
+            memcpy(line, p, n);
+            line[n] = '\0';
+            p += (p[n] == '\n') ? n + 1 : n;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        ok = run_line(line, ++lineno);
+    }
+    seconds = (fpga_bus_time_ps() - start) / 1e12;
+    deselect_drive();
+    if(fp != NULL)
+        fclose(fp);
+
+    accesses = counts.reads + counts.writes;
+    fprintf(report, "bus pattern %s: %d reads, %d writes, %d seeks in %.3f ms simulated\n", pattern,
+        counts.reads, counts.writes, counts.seeks, seconds * 1e3);
+    fprintf(report, "  data      %10llu words, %.0f words/s\n", (unsigned long long) counts.words,
+        seconds > 0 ? counts.words / seconds : 0.0);
+    fprintf(report, "  latency   %10.1f us average, %.1f us maximum\n",
+        accesses ? counts.latency_ps_total / 1e6 / accesses : 0.0, counts.latency_ps_max / 1e6);
+    fprintf(report, "  errors    %10d header, %d CRC, %d compare, %d timeouts\n", counts.header_errors,
+        counts.crc_errors, counts.compare_errors, counts.timeouts);
+    return(ok && counts.header_errors == 0 && counts.crc_errors == 0 && counts.compare_errors == 0);
+}
@@ -0,0 +1,365 @@
+// *********************************************************************************
+// fpga_model.cpp
+//   behavioural model of the emulator FPGA as seen from the CPU SPI link
+//   register map of spi_interface.v, the SPI port and self test of sdram_controller.v
+//   and the sector check of sector_crc_check.v, FPGA version 1.21
+//
+//   A transaction is the register address byte followed by one or more data bytes.
+//   The address advances after each data byte of a burst, except for the SDRAM
+//   address and write data ports 0x05 and 0x06. Registers below 0x80 are written,
+//   registers from 0x80 up are read.
+// *********************************************************************************
+// 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sim.h"
+#include "prbs_generator.h"
+
+#define FPGA_WRITE_REGISTERS 0x20
+#define FILE_READY_BIT 0x10
+#define TOGGLE_WP_BIT 0x1
+#define CLEAR_CRC_COUNT_BIT 0x2
+#define INTERFACE_TEST_MODE_KEY 0x55
+#define CRC_POLYNOMIAL 0xa001
+#define BIST_START_BIT 0x1
+#define BIST_ROW_CLOCKS 525     // activate, 512 columns, precharge and two refreshes
+#define FPGA_CLOCK_MHZ 40
+
+// write register reset values, RK8-E timing
+static const uint8_t reset_values[FPGA_WRITE_REGISTERS] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 120,  // 0x00 control, 0x07 preamble 1
+    82, 0x0c, 0x20, 36, 16, 14, 14, 6,              // 0x08 preamble 2, data length, postamble, sectors, bit clock
+    0x09, 0xc4, 47, 40, 0, 0, 0, 0,                 // 0x10 usec per sector, servo, time base, seek, NCO
+    0, 0x00, 0x1f, 0xff, 0, 0, 0, 0                 // 0x18 NCO, 0x19 self test, 0x1a last row 8191
+};
+
+static uint8_t wreg[FPGA_WRITE_REGISTERS];
+static bool write_protect;
+static bool interface_test_mode;
+
+// SPI transaction state
+static bool selected;
+static bool address_byte;   // the next byte is the register address
+static bool first_data;     // the next byte is the first data byte of the transaction
+static uint8_t serialaddress;
+
+// SDRAM port
+static uint16_t* sdram;
+static uint32_t memory_address;
+static uint32_t spi_mem_addr;   // last two address bytes loaded through register 0x05
+static uint16_t dram_readdata;
+static uint8_t dram_write_low;
+static bool dramwrite_lowhigh;
+static bool dramread_lowhigh;
+
+// sector check
+static uint32_t loaded_address;
+static uint16_t crc;
+static int sector_bytecount;
+static uint8_t header_low;
+static bool header_error;
+static bool crc_error;
+static bool sector_done;
+static uint16_t crc_error_count;
+
+// SDRAM self test, the result is known at the start and is reported when the test time has passed
+static bool bist_done;
+static uint64_t bist_remaining_us;
+static uint16_t bist_error_count;
+static uint32_t bist_first_address;
+static uint32_t bist_last_address;
+static uint16_t bist_expected;
+static uint16_t bist_actual;
+
+static int data_length()
+{
+    return((wreg[0x09] << 8) | wreg[0x0a]);
+}
+
+static void dram_read()
+{
+    dram_readdata = sdram[memory_address & (SIM_SDRAM_WORDS - 1)];
+}
+
+void fpga_model_reset()
+{
+    if(sdram == NULL){
+        sdram = (uint16_t*) calloc(SIM_SDRAM_WORDS, sizeof(uint16_t));
+        if(sdram == NULL){
+            printf("*** ERROR, no memory for the SDRAM model\r\n");
+            exit(1);
+        }
+    }
+    memcpy(wreg, reset_values, sizeof(wreg));
+    write_protect = false;
+    interface_test_mode = false;
+    selected = false;
+    memory_address = spi_mem_addr = 0;
+    dram_readdata = 0;
+    dramwrite_lowhigh = dramread_lowhigh = false;
+    loaded_address = 0;
+    crc = 0;
+    sector_bytecount = 0;
+    header_error = crc_error = sector_done = false;
+    crc_error_count = 0;
+    bist_done = false;
+    bist_remaining_us = 0;
+    bist_error_count = 0;
+    bist_first_address = bist_last_address = 0;
+    bist_expected = bist_actual = 0;
+}
+
+void fpga_model_select(bool select)
+{
+    selected = select;
+    address_byte = true;
+}
+
+// the register model has no clock, only the SDRAM self test time runs out while the CPU sleeps
+void fpga_model_idle(uint64_t us)
+{
+    bist_remaining_us = (us < bist_remaining_us) ? bist_remaining_us - us : 0;
+}
+
+const uint16_t* fpga_model_sdram()
+{
+    return(sdram);
+}
+
+// sector_crc_check.v, the header word is compared and the rest of the sector goes through the CRC
+static void check_sector_byte(uint8_t data)
+{
+    int bytecount = (data_length() >> 3) & 0x3ff;
+    int expected_header = ((loaded_address >> 14) & 0xff) << 5;
+
+    if(sector_bytecount == 0)
+        header_low = data;
+    else if(sector_bytecount == 1)
+        header_error = (((data << 8) | header_low) != expected_header);
+    else if(sector_bytecount < bytecount){
+        crc ^= data;
+        for(int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC_POLYNOMIAL : crc >> 1;
+        if(sector_bytecount == bytecount - 1){
+            sector_done = true;
+            crc_error = (crc != 0);
+            if((header_error || crc_error) && crc_error_count != 0xffff)
+                crc_error_count++;
+        }
+    }
+    sector_bytecount = (sector_bytecount + 1) & 0x3ff;
+}
+
+// sdram_controller.v self test pattern, the PRBS31 generator advances 16 bits per word
+static uint16_t bist_pattern_data(int pattern, bool invert, uint32_t address, Prbs_Generator* prbs)
+{
+    uint16_t word = prbs_next_word16(prbs);
+    uint16_t data;
+
+    switch(pattern){
+        case 0:
+            data = word;
+            break;
+        case 1:
+            data = 1 << (address & 0xf);
+            break;
+        case 2:
+            data = (address & 0xffff) ^ (((address >> 16) & 0xff) * 0x0101);
+            break;
+        default:
+            data = (address & 1) ? 0x5555 : 0xaaaa;
+            break;
+    }
+    return(invert ? ~data : data);
+}
+
+// write pass then read pass over rows 0 through the last row, 512 words per row
+static void run_bist(uint8_t control)
+{
+    int pattern = (control >> 1) & 0x3;
+    bool invert = (control & 0x8) != 0;
+    uint32_t words = ((((wreg[0x1a] & 0x7f) << 8) | wreg[0x1b]) + 1) << 9;
+    Prbs_Generator prbs;
+    uint32_t address;
+    uint16_t expected;
+
+    prbs_start(&prbs, prbs31_polynomial(), PRBS31_FPGA_SEED);
+    for(address = 0; address < words; address++)
+        sdram[address] = bist_pattern_data(pattern, invert, address, &prbs);
+    bist_error_count = 0;
+    prbs_start(&prbs, prbs31_polynomial(), PRBS31_FPGA_SEED);
+    for(address = 0; address < words; address++){
+        expected = bist_pattern_data(pattern, invert, address, &prbs);
+        if(sdram[address] != expected){
+            if(bist_error_count == 0){
+                bist_first_address = address;
+                bist_expected = expected;
+                bist_actual = sdram[address];
+            }
+            bist_last_address = address;
+            if(bist_error_count != 0xffff)
+                bist_error_count++;
+        }
+    }
+    bist_done = true;
+    bist_remaining_us = 2 * (uint64_t) (words >> 9) * BIST_ROW_CLOCKS / FPGA_CLOCK_MHZ;
+}
+
+static void write_register(uint8_t reg, uint8_t data, bool first)
+{
+    switch(reg){
+        case 0x00:
+            // write protect is cleared when File_Ready changes
+            if(((wreg[0] ^ data) & FILE_READY_BIT) != 0)
+                write_protect = false;
+            wreg[0] = data;
+            break;
+        case 0x04:
+            if((data & TOGGLE_WP_BIT) != 0)
+                write_protect = !write_protect;
+            if((data & CLEAR_CRC_COUNT_BIT) != 0)
+                crc_error_count = 0;
+            break;
+        case 0x05:
+            // the address is shifted in 8 bits at a time, the third byte completes it and starts a read
+            memory_address = (spi_mem_addr << 8) | data;
+            spi_mem_addr = ((spi_mem_addr << 8) | data) & 0xffff;
+            loaded_address = ((loaded_address << 8) | data) & 0xffffff;
+            dramwrite_lowhigh = dramread_lowhigh = false;
+            dram_read();
+            crc = 0;
+            sector_bytecount = 0;
+            header_error = crc_error = sector_done = false;
+            break;
+        case 0x06:
+            // the low byte is held until the high byte completes the word
+            if(dramwrite_lowhigh){
+                if(!write_protect){
+                    sdram[memory_address & (SIM_SDRAM_WORDS - 1)] = (data << 8) | dram_write_low;
+                    memory_address++;
+                }
+            }
+            else
+                dram_write_low = data;
+            dramwrite_lowhigh = !dramwrite_lowhigh;
+            check_sector_byte(data);
+            break;
+        case 0x19:
+            // a write while the test runs is ignored
+            if(bist_remaining_us == 0){
+                wreg[0x19] = data;
+                if((data & BIST_START_BIT) != 0)
+                    run_bist(data);
+            }
+            break;
+        case 0x1a:
+        case 0x1b:
+            if(bist_remaining_us == 0)
+                wreg[reg] = data;
+            break;
+        case 0x20:
+            interface_test_mode = (data == INTERFACE_TEST_MODE_KEY);
+            break;
+        case 0x88:
+            // reading the high byte fetches the next word, once per transaction
+            if(first){
+                if(dramread_lowhigh){
+                    memory_address++;
+                    dram_read();
+                }
+                dramread_lowhigh = !dramread_lowhigh;
+            }
+            break;
+        default:
+            if(reg < FPGA_WRITE_REGISTERS)
+                wreg[reg] = data;
+            break;
+    }
+}
+
+static uint8_t read_register(uint8_t reg)
+{
+    if(reg >= 0xa7 && reg <= 0xb1)
+        return(reg == 0xac ? wreg[0x0c] & 0x1f : wreg[reg - 0xa0]);
+    if(reg >= 0xb3 && reg <= 0xb8)
+        return(wreg[reg - 0xa0]);
+    switch(reg){
+        case 0xb9:
+            return((bist_done && bist_remaining_us == 0 ? 0x80 : 0) | (bist_remaining_us != 0 ? 0x40 : 0) |
+                (bist_error_count != 0 ? 0x20 : 0) | ((wreg[0x19] >> 1) & 0x7));
+        case 0xba:
+            return(wreg[0x1a] & 0x7f);
+        case 0xbb:
+            return(wreg[0x1b]);
+        case 0xbc:
+            return(bist_error_count >> 8);
+        case 0xbd:
+            return(bist_error_count & 0xff);
+        case 0xbe:
+            return(bist_first_address >> 16);
+        case 0xbf:
+            return((bist_first_address >> 8) & 0xff);
+        case 0xc0:
+            return(bist_first_address & 0xff);
+        case 0xc1:
+            return(bist_expected >> 8);
+        case 0xc2:
+            return(bist_expected & 0xff);
+        case 0xc3:
+            return(bist_actual >> 8);
+        case 0xc4:
+            return(bist_actual & 0xff);
+        case 0xc5:
+            return(bist_last_address >> 16);
+        case 0xc6:
+            return((bist_last_address >> 8) & 0xff);
+        case 0xc7:
+            return(bist_last_address & 0xff);
+        case 0x83:
+            return((sector_done ? 0x80 : 0) | (header_error ? 0x2 : 0) | (crc_error ? 0x1 : 0));
+        case 0x84:
+            return(crc_error_count >> 8);
+        case 0x85:
+            return(crc_error_count & 0xff);
+        case 0x88:
+            return(dramread_lowhigh ? dram_readdata >> 8 : dram_readdata & 0xff);
+        case 0x89:
+            return(0x00); // bit 7 == 0 identifies the FPGA as an emulator
+        case 0x90:
+            return(SIM_FPGA_VERSION);
+        case 0x91:
+            return(SIM_FPGA_MINORVERSION);
+        case 0x94:
+            return(0xff); // idle bus, all of the active low inputs are high
+        case 0x95:
+            return(0xff);
+        case 0x96:
+            return(0x0f);
+        case 0xa0:
+            return(wreg[0] & 0xb7);
+        default:
+            return(0x00); // drive status, cylinder address and unused registers
+    }
+}
+
+// one byte in each direction, the read data is the register addressed at the start of the byte
+uint8_t fpga_model_transfer(uint8_t mosi)
+{
+    uint8_t miso;
+    if(!selected)
+        return(0xff);
+    if(address_byte){
+        serialaddress = mosi;
+        address_byte = false;
+        first_data = true;
+        return(0x00);
+    }
+    miso = read_register(serialaddress);
+    write_register(serialaddress, mosi, first_data);
+    first_data = false;
+    if((serialaddress != 0x05) && (serialaddress != 0x06))
+        serialaddress++;
+    return(miso);
+}
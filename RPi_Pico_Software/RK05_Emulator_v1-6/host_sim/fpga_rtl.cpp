@@ -0,0 +1,304 @@
+// *********************************************************************************
+// fpga_rtl.cpp
+//   the FPGA design itself as the FPGA model, Verilated from RK05_emulator_top_v03.v
+//   through the rtl/rk05_sim_top.v wrapper
+//
+//   The SPI bytes from the firmware are shifted into the design bit by bit, SPI
+//   mode 0 at the baud rate the firmware set, with the 40 MHz FPGA clock running
+//   underneath. The SDRAM on the board is modelled here at its command interface.
+//   Simulated time only moves while the CPU talks to the FPGA or sleeps, so the
+//   number of FPGA clocks per SPI byte is that of a CPU that never stalls.
+// *********************************************************************************
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "verilated.h"
+#include "Vrk05_sim_top.h"
+
+#include "host_sim.h"
+
+#define CLOCK_HALF_PERIOD_PS 12500      // 40 MHz FPGA clock
+#define RESET_CLOCKS 16                 // pin_reset_n low, then high, for this many clocks each
+#define CS_IDLE_PS 100000               // minimum time CPU_SPI_CS_n stays high between transactions
+#define MAX_IDLE_US 1000                // a longer CPU sleep only runs the FPGA this long
+#define DEFAULT_SPI_BAUDRATE 25000000
+
+// SDRAM commands, {RAS_n, CAS_n, WE_n} with CS_n low
+#define SDRAM_LOAD_MODE 0
+#define SDRAM_AUTO_REFRESH 1
+#define SDRAM_PRECHARGE 2
+#define SDRAM_ACTIVE 3
+#define SDRAM_WRITE 4
+#define SDRAM_READ 5
+
+static Vrk05_sim_top* top;
+static uint64_t now_ps;             // simulated time
+static uint64_t next_edge_ps;       // next edge of the FPGA clock
+static uint64_t cs_high_ps;         // when CPU_SPI_CS_n went high
+
+#define READ_PIPELINE 8             // more than the largest CAS latency
+
+// SDRAM model, single word reads and writes with auto precharge, or back to back reads and
+// writes to an open row from the self test
+static uint16_t* sdram;
+static uint16_t open_row[4];
+static bool row_open[4];
+static int cas_latency;
+static uint32_t sdram_clocks;
+static bool read_pending[READ_PIPELINE];    // read data due on the bus, indexed by SDRAM clock
+static uint32_t read_address[READ_PIPELINE];
+static uint16_t dq_bus;             // the data bus holds the last value driven onto it
+static uint64_t sdram_errors;
+
+static void sdram_error(const char* what, uint32_t address)
+{
+    if(sdram_errors++ < 10)
+        printf("*** SDRAM model: %s, address 0x%06x\r\n", what, address);
+}
+
+// rising edge of SDRAM_CLK, the command the controller set up half a clock earlier is taken
+static void sdram_clock()
+{
+    int bank = (top->SDRAM_BS1 << 1) | top->SDRAM_BS0;
+    uint32_t address;
+
+    int slot;
+
+    // the data of a read goes on the bus cas_latency clocks after the read command and stays until the next read data
+    slot = ++sdram_clocks % READ_PIPELINE;
+    if(read_pending[slot]){
+        dq_bus = sdram[read_address[slot]];
+        read_pending[slot] = false;
+    }
+
+    if(!top->SDRAM_CKE || top->SDRAM_CS_n)
+        return;
+
+    address = ((uint32_t) bank << 22) | ((uint32_t) open_row[bank] << 9) | (top->SDRAM_Address & 0x1ff);
+    switch((top->SDRAM_RAS_n << 2) | (top->SDRAM_CAS_n << 1) | top->SDRAM_WE_n){
+        case SDRAM_LOAD_MODE:
+            cas_latency = (top->SDRAM_Address >> 4) & 0x7;
+            break;
+        case SDRAM_ACTIVE:
+            if(row_open[bank])
+                sdram_error("activate of a bank with an open row", address);
+            open_row[bank] = top->SDRAM_Address & 0x1fff;
+            row_open[bank] = true;
+            break;
+        case SDRAM_READ:
+        case SDRAM_WRITE:
+            if(!row_open[bank])
+                sdram_error("read or write of a bank without an open row", address);
+            if(top->SDRAM_WE_n){
+                slot = (sdram_clocks + (cas_latency > 0 ? cas_latency : 1)) % READ_PIPELINE;
+                read_pending[slot] = true;
+                read_address[slot] = address;
+            }
+            else{
+                if(!top->SDRAM_DQ_fpga_enable)
+                    sdram_error("write without data on the bus", address);
+                if(!top->SDRAM_DQML)
+                    sdram[address] = (sdram[address] & 0xff00) | (top->SDRAM_DQ_pins & 0x00ff);
+                if(!top->SDRAM_DQMH)
+                    sdram[address] = (sdram[address] & 0x00ff) | (top->SDRAM_DQ_pins & 0xff00);
+            }
+            // A10 selects auto precharge
+            if((top->SDRAM_Address & 0x400) != 0)
+                row_open[bank] = false;
+            break;
+        case SDRAM_PRECHARGE:
+            if((top->SDRAM_Address & 0x400) != 0)
+                memset(row_open, 0, sizeof(row_open));
+            else
+                row_open[bank] = false;
+            break;
+        case SDRAM_AUTO_REFRESH:
+            for(int i = 0; i < 4; i++)
+                if(row_open[i])
+                    sdram_error("refresh with an open row", 0);
+            break;
+        default:
+            break;
+    }
+}
+
+// the SDRAM drives the data bus whenever the FPGA does not
+static void eval()
+{
+    top->eval();
+    top->SDRAM_DQ_model = dq_bus;
+    top->SDRAM_DQ_drive = !top->SDRAM_DQ_fpga_enable;
+    top->eval();
+}
+
+// run the FPGA clock up to the time t
+static void run_until(uint64_t t)
+{
+    while(next_edge_ps <= t){
+        now_ps = next_edge_ps;
+        next_edge_ps += CLOCK_HALF_PERIOD_PS;
+        top->clock = !top->clock;
+        if(top->clock)
+            sim_counters.fpga_clocks++;
+        else
+            sdram_clock();  // SDRAM_CLK is the inverted FPGA clock
+        eval();
+    }
+    now_ps = t;
+}
+
+static void run_clocks(int clocks)
+{
+    run_until(now_ps + (uint64_t) clocks * 2 * CLOCK_HALF_PERIOD_PS);
+}
+
+static uint64_t spi_half_period_ps()
+{
+    unsigned int baudrate = sim_spi_baudrate();
+    if(baudrate == 0)
+        baudrate = DEFAULT_SPI_BAUDRATE;
+    return(500000000000ULL / baudrate);
+}
+
+void fpga_model_reset()
+{
+    if(sdram == NULL){
+        sdram = (uint16_t*) calloc(SIM_SDRAM_WORDS, sizeof(uint16_t));
+        if(sdram == NULL){
+            printf("*** ERROR, no memory for the SDRAM model\r\n");
+            exit(1);
+        }
+    }
+    if(top == NULL)
+        top = new Vrk05_sim_top;
+
+    // the drive bus is idle, all of its inputs are active low
+    top->BUS_RK11D_L = 1;
+    top->BUS_SEL_DR_L = 0xf;
+    top->BUS_CYL_ADD_L = 0xff;
+    top->BUS_STROBE_L = 1;
+    top->BUS_HEAD_SELECT_L = 1;
+    top->BUS_WT_PROTECT_L = 1;
+    top->BUS_WT_DATA_CLK_L = 1;
+    top->BUS_WT_GATE_L = 1;
+    top->BUS_RESTORE_L = 1;
+    top->BUS_RD_GATE_L = 1;
+    top->CPU_SPI_CS_n = 1;
+    top->CPU_SPI_CLK = 0;
+    top->CPU_SPI_MOSI = 0;
+    top->clock = 0;
+
+    memset(row_open, 0, sizeof(row_open));
+    cas_latency = 2;
+    sdram_clocks = 0;
+    memset(read_pending, 0, sizeof(read_pending));
+    dq_bus = 0;
+    sdram_errors = 0;
+    next_edge_ps = now_ps + CLOCK_HALF_PERIOD_PS;
+    cs_high_ps = now_ps;
+
+    top->pin_reset_n = 0;
+    eval();
+    run_clocks(RESET_CLOCKS);
+    top->pin_reset_n = 1;
+    run_clocks(RESET_CLOCKS);
+}
+
+void fpga_model_select(bool selected)
+{
+    uint64_t half = spi_half_period_ps();
+    if(selected){
+        if(now_ps < cs_high_ps + CS_IDLE_PS)
+            run_until(cs_high_ps + CS_IDLE_PS);
+        top->CPU_SPI_CS_n = 0;
+        eval();
+        run_until(now_ps + half);
+    }
+    else{
+        run_until(now_ps + half);
+        top->CPU_SPI_CS_n = 1;
+        eval();
+        cs_high_ps = now_ps;
+    }
+}
+
+// SPI mode 0, MSB first: MOSI is set up while the clock is low, both sides sample on
+// the rising edge and the FPGA shifts out the next MISO bit on the falling edge
+uint8_t fpga_model_transfer(uint8_t mosi)
+{
+    uint64_t half = spi_half_period_ps();
+    uint8_t miso = 0;
+
+    for(int bit = 7; bit >= 0; bit--){
+        top->CPU_SPI_MOSI = (mosi >> bit) & 1;
+        eval();
+        run_until(now_ps + half);
+        top->CPU_SPI_CLK = 1;
+        eval();
+        miso = (miso << 1) | (top->CPU_SPI_MISO & 1);
+        run_until(now_ps + half);
+        top->CPU_SPI_CLK = 0;
+        eval();
+    }
+    return(miso);
+}
+
+// the FPGA keeps running while the CPU sleeps, up to MAX_IDLE_US
+void fpga_model_idle(uint64_t us)
+{
+    if(top != NULL)
+        run_until(now_ps + (us < MAX_IDLE_US ? us : MAX_IDLE_US) * 1000000ULL);
+}
+
+const uint16_t* fpga_model_sdram()
+{
+    return(sdram);
+}
+
+// drive bus, the controller side is driven by the bus-functional model in controller_bfm.cpp
+void fpga_bus_set(const struct Sim_Bus_Inputs* in)
+{
+    top->BUS_RK11D_L = in->rk11d_l;
+    top->BUS_SEL_DR_L = in->sel_dr_l;
+    top->BUS_CYL_ADD_L = in->cyl_add_l;
+    top->BUS_STROBE_L = in->strobe_l;
+    top->BUS_HEAD_SELECT_L = in->head_select_l;
+    top->BUS_WT_PROTECT_L = in->wt_protect_l;
+    top->BUS_WT_DATA_CLK_L = in->wt_data_clk_l;
+    top->BUS_WT_GATE_L = in->wt_gate_l;
+    top->BUS_RESTORE_L = in->restore_l;
+    top->BUS_RD_GATE_L = in->rd_gate_l;
+    eval();
+}
+
+void fpga_bus_get(struct Sim_Bus_Outputs* out)
+{
+    out->file_ready_l = top->BUS_FILE_READY_L;
+    out->rws_rdy_l = top->BUS_RWS_RDY_L;
+    out->address_accepted_l = top->BUS_ADDRESS_ACCEPTED_L;
+    out->address_invalid_l = top->BUS_ADDRESS_INVALID_L;
+    out->wt_prot_status_l = top->BUS_WT_PROT_STATUS_L;
+    out->rd_data_l = top->BUS_RD_DATA_L;
+    out->rd_clk_l = top->BUS_RD_CLK_L;
+    out->sec_cntr_l = top->BUS_SEC_CNTR_L;
+    out->sec_pls_l = top->BUS_SEC_PLS_L;
+    out->indx_pls_l = top->BUS_INDX_PLS_L;
+}
+
+uint64_t fpga_bus_time_ps()
+{
+    return(now_ps);
+}
+
+// run the FPGA with the bus inputs held, to the time t or for one 40 MHz clock
+void fpga_bus_run_until_ps(uint64_t t)
+{
+    run_until(t);
+}
+
+void fpga_bus_clock()
+{
+    run_clocks(1);
+}
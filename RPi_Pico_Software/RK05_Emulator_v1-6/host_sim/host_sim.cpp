@@ -0,0 +1,569 @@
+// *********************************************************************************
+// host_sim.cpp
+//   Top Level main() function of the host simulator of the RK05 emulator firmware
+//
+//   The firmware sources are built for Linux against stubs of the Pico SDK, a
+//   model of the FPGA registers and SDRAM, and a microSD card that is a disk
+//   image file. The RUN/LOAD switch is toggled to load the disk image into the
+//   SDRAM model and, with -u, back to unload it onto the card. The SPI bytes,
+//   microSD blocks and I2C transfers of each load and unload are counted so that
+//   changes to the load path can be measured without a board.
+//
+//   rk05_host_sim_rtl, built when Verilator is installed, runs the same firmware
+//   against the Verilated FPGA design and also reports the FPGA clocks it took.
+//   It can also act as the disk controller on the drive bus, so the sustained
+//   words/s and access latency of the turbo and seek settings can be compared.
+//
+//   The simulated time moves on by the time each SPI, I2C and microSD transfer
+//   takes on the wire, so time_us_64() and the LOADBENCH command give the time a
+//   board would spend on the links. With -o the counts of each load and unload are
+//   written as CSV lines, and with -r they are checked against a baseline CSV file
+//   so that a change to microsd_file_ops.cpp or the SPI layer that does more work
+//   is caught. "cmake --build build --target load_bench" runs the sample images
+//   in _rk05_files against load_bench_baseline.csv.
+//
+//   rk05_host_sim [options] [<image_file.rk05>]
+//     -c <file>     card image file, default rk05_card.img
+//     -s <MB>       size of a new card image, default 64
+//     -u            unload the image after loading it
+//     -n <count>    number of load (and unload) cycles, default 1
+//     -x <command>  run an Interface Test Mode command, such as "RAMTEST 0 1000"
+//     -e <settings> emulator settings for rk05emulator.cfg on a new card, such as "turbo=200 seek=rk05"
+//     -b <pattern>  after each load run a disk controller access pattern on the drive bus,
+//                   os8 or a pattern file, see controller_bfm.cpp (rk05_host_sim_rtl only)
+//     -o <file>     append CSV lines of the load and unload counts to a file
+//     -r <file>     compare the counts with a baseline CSV file, exit with 2 if any count
+//                   is more than 2% higher
+//     -q            only print the counts
+//   A new card image is formatted and the disk image file is copied to it. Without
+//   a disk image file the card image must already exist.
+// *********************************************************************************
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "ff.h"
+
+#include "disk_state_definitions.h"
+#include "display_functions.h"
+#include "emulator_state_definitions.h"
+#include "emulator_state.h"
+#include "emulator_hardware.h"
+#include "emulator_command.h"
+
+#include "host_sim.h"
+
+#define DEFAULT_CARD_FILE "rk05_card.img"
+#define DEFAULT_CARD_MB 64
+#define IMAGE_HEADER_SIZE 381
+#define MAX_SECTOR_SIZE 1024
+#define COPY_BUFFER_SIZE 32768
+#define MAX_TICKS 1000 // main loop passes before a load or unload is abandoned, 100 seconds of simulated time
+#define MAX_COMMANDS 20
+#define CONFIG_FILE_NAME "rk05emulator.cfg"
+#define CSV_HEADER "image,phase,spi_bytes,spi_transactions,sd_commands,sd_read_blocks,sd_write_blocks,i2c_bytes,wire_us,host_us"
+#define CSV_COUNTS 7        // the columns after the phase that are compared with the baseline, host_us is not
+#define MAX_BASELINE_ROWS 100
+#define BASELINE_TOLERANCE_PERCENT 2
+
+// GLOBAL VARIABLES, the emulator_command.cpp globals of RK05_Emulator_v00.cpp
+#define INPUT_LINE_LENGTH 200
+char inputdata[INPUT_LINE_LENGTH];
+char *extract_argv[INPUT_LINE_LENGTH];
+int extract_argc;
+int char_from_callback;
+int debug_mode;
+
+static struct Disk_State edisk;
+static FILE* report;
+
+// load and unload counts, -o and -r
+struct Bench_Row
+{
+    char image[64];
+    char phase[16];
+    uint64_t counts[CSV_COUNTS];
+};
+
+static FILE* csv;
+static const char* csv_image = "";
+static struct Bench_Row baseline[MAX_BASELINE_ROWS];
+static int baselinecount;
+static int regressions;
+static uint64_t phase_start_us;
+
+static void print_usage()
+{
+    printf("Usage: rk05_host_sim [options] [<image_file.rk05>]\n");
+    printf("  -c <file>     card image file, default %s\n", DEFAULT_CARD_FILE);
+    printf("  -s <MB>       size of a new card image, default %d\n", DEFAULT_CARD_MB);
+    printf("  -u            unload the image after loading it\n");
+    printf("  -n <count>    number of load (and unload) cycles, default 1\n");
+    printf("  -x <command>  run an Interface Test Mode command, such as \"RAMTEST 0 1000\"\n");
+    printf("  -e <settings> emulator settings for %s on a new card, such as \"turbo=200 seek=rk05\"\n",
+        CONFIG_FILE_NAME);
+    printf("  -b <pattern>  after each load run a disk controller access pattern on the drive bus,\n");
+    printf("                os8 or a pattern file (rk05_host_sim_rtl only)\n");
+    printf("  -o <file>     append CSV lines of the load and unload counts to a file\n");
+    printf("  -r <file>     compare the counts with a baseline CSV file, exit with 2 if any count\n");
+    printf("                is more than %d%% higher\n", BASELINE_TOLERANCE_PERCENT);
+    printf("  -q            only print the counts\n");
+    printf("A disk image file is copied to a newly formatted card image, without one the\n");
+    printf("card image must already exist.\n");
+    exit(1);
+}
+
+// same as initialize_states() in RK05_Emulator_v00.cpp, PDP-8 RK8-E values
+static void initialize_states()
+{
+    memset(&edisk, 0, sizeof(edisk));
+    edisk.run_load_state = RLST0;
+    edisk.door_is_open = true;
+    strcpy(edisk.controller, "RK8-E");
+    edisk.bitRate = 1440000;
+    edisk.preamble1Length = 120;
+    edisk.preamble2Length = 82;
+    edisk.dataLength = 3104;
+    edisk.postambleLength = 36;
+    edisk.numberOfCylinders = 203;
+    edisk.numberOfSectorsPerTrack = 16;
+    edisk.numberOfHeads = 2;
+    edisk.microsecondsPerSector = 2500;
+    edisk.turbo_percent = 100;
+    edisk.seek_model = SEEK_INSTANT;
+    edisk.seek_scale_percent = 100;
+}
+
+// the start of initialize_system() in RK05_Emulator_v00.cpp, without the console set up
+static void initialize_system()
+{
+    fpga_model_reset();
+    initialize_gpio();
+    setup_display();
+    assert_fpga_reset();
+    sleep_ms(10);
+    deassert_fpga_reset();
+    initialize_spi();
+    initialize_states();
+    initialize_fpga(&edisk);
+    read_rocker_switches(&edisk);
+    clear_dc_low();
+    load_drive_address(read_drive_address_switches() & DRIVE_ADDRESS_BITS_I2C);
+}
+
+// format the card image and copy the disk image file to its root directory
+static bool make_card(const char* cardfile, uint64_t cardbytes, const char* imagefile, const char* settings)
+{
+    static BYTE work[FF_MAX_SS * 4];
+    static uint8_t buf[COPY_BUFFER_SIZE];
+    MKFS_PARM opt = {FM_ANY, 0, 0, 0, 0};
+    FATFS fs;
+    FIL fil;
+    FRESULT fr;
+    UINT nw;
+    size_t nr;
+    const char* name;
+    FILE* fp;
+
+    fp = fopen(imagefile, "rb");
+    if(fp == NULL){
+        perror(imagefile);
+        return(false);
+    }
+    if(!sd_image_open(cardfile, cardbytes)){
+        perror(cardfile);
+        fclose(fp);
+        return(false);
+    }
+    if((fr = f_mkfs("0:", &opt, work, sizeof(work))) != FR_OK || (fr = f_mount(&fs, "0:", 1)) != FR_OK){
+        printf("*** ERROR, could not format card image %s (%d)\n", cardfile, fr);
+        fclose(fp);
+        return(false);
+    }
+    name = strrchr(imagefile, '/');
+    name = (name == NULL) ? imagefile : name + 1;
+    if((fr = f_open(&fil, name, FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK){
+        printf("*** ERROR, could not create %s on the card image (%d)\n", name, fr);
+        fclose(fp);
+        return(false);
+    }
+    while((nr = fread(buf, 1, sizeof(buf), fp)) > 0){
+        if((fr = f_write(&fil, buf, (UINT) nr, &nw)) != FR_OK || nw != nr){
+            printf("*** ERROR, could not write %s to the card image (%d)\n", name, fr);
+            fclose(fp);
+            return(false);
+        }
+    }
+    fclose(fp);
+    f_close(&fil);
+    if(settings != NULL){
+        if((fr = f_open(&fil, CONFIG_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK || f_printf(&fil, "%s\n", settings) < 0){
+            printf("*** ERROR, could not write %s to the card image (%d)\n", CONFIG_FILE_NAME, fr);
+            return(false);
+        }
+        f_close(&fil);
+    }
+    f_unmount("0:");
+    return(true);
+}
+
+// compare the disk image file on the card with the SDRAM model
+static bool compare_card_with_sdram()
+{
+    static uint8_t sector[MAX_SECTOR_SIZE];
+    const uint16_t* sdram = fpga_model_sdram();
+    int bytecount = edisk.dataLength / 8;
+    int mismatches = 0;
+    FATFS fs;
+    DIR dir;
+    FILINFO fno;
+    FIL fil;
+    UINT nr;
+    bool ok = true;
+
+    if(f_mount(&fs, "0:", 1) != FR_OK || f_findfirst(&dir, &fno, "", "?*.RK05") != FR_OK || fno.fname[0] == '\0'
+        || f_open(&fil, fno.fname, FA_READ) != FR_OK){
+        printf("*** ERROR, could not open the disk image file on the card\n");
+        f_unmount("0:");
+        return(false);
+    }
+    f_closedir(&dir);
+    f_lseek(&fil, IMAGE_HEADER_SIZE);
+    for(int cylinder = 0; cylinder < edisk.numberOfCylinders && ok; cylinder++){
+        for(int head = 0; head < edisk.numberOfHeads && ok; head++){
+            for(int sectorcount = 0; sectorcount < edisk.numberOfSectorsPerTrack; sectorcount++){
+                const uint16_t* wp = sdram + ((cylinder << 14) | (head << 13) | (sectorcount << 9));
+                if(f_read(&fil, sector, bytecount, &nr) != FR_OK || nr != (UINT) bytecount){
+                    printf("*** ERROR, disk image file on the card is short\n");
+                    ok = false;
+                    break;
+                }
+                for(int i = 0; i < bytecount; i++){
+                    if(sector[i] != ((wp[i >> 1] >> ((i & 1) * 8)) & 0xff)){
+                        mismatches++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    f_close(&fil);
+    f_unmount("0:");
+    if(mismatches != 0)
+        printf("*** ERROR, %d sectors of the card and the SDRAM differ\n", mismatches);
+    return(ok && mismatches == 0);
+}
+
+static double host_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+#ifdef HOST_SIM_RTL
+// run an access pattern on the drive bus with the geometry of the loaded image
+static bool run_bus_pattern(const char* pattern)
+{
+    struct Bfm_Disk disk;
+    double start = host_seconds();
+    bool ok;
+
+    disk.rk11d = (strcmp(edisk.controller, "RK11-D") == 0);
+    disk.bit_rate = edisk.bitRate;
+    disk.sector_bytes = edisk.dataLength / 8;
+    disk.data_words = 256;
+    disk.preamble_bits = edisk.preamble1Length;
+    disk.postamble_bits = edisk.postambleLength;
+    disk.cylinders = edisk.numberOfCylinders;
+    disk.heads = edisk.numberOfHeads;
+    disk.sectors = edisk.numberOfSectorsPerTrack;
+    disk.sector_us = edisk.microsecondsPerSector;
+    ok = bfm_run_pattern(pattern, &disk, report);
+    fprintf(report, "  host      %10.3f s\n", host_seconds() - start);
+    return(ok);
+}
+#endif
+
+// run the main loop of RK05_Emulator_v00.cpp until the RUN/LOAD state machine reaches one of two states
+static int run_until(int done_state, int error_state)
+{
+    int ticks;
+    for(ticks = 0; ticks < MAX_TICKS; ticks++){
+        if(edisk.run_load_state == done_state || edisk.run_load_state == error_state)
+            break;
+        read_rocker_switches(&edisk);
+        check_dc_low(&edisk);
+        process_run_load_state(&edisk);
+        manage_display_timers(&edisk);
+        sleep_ms(100);
+    }
+    return(ticks);
+}
+
+static void print_counts(double seconds)
+{
+    struct Sim_Counters* c = &sim_counters;
+    double mhz = sim_spi_baudrate() / 1e6;
+    fprintf(report, "  FPGA SPI  %10llu bytes in %llu transactions, %.3f s on the wire at %.1f MHz\n",
+        (unsigned long long) c->spi_bytes, (unsigned long long) c->spi_transactions,
+        mhz > 0 ? c->spi_bytes * 8 / (mhz * 1e6) : 0.0, mhz);
+    fprintf(report, "  microSD   %10llu blocks read, %llu blocks written, %llu commands\n",
+        (unsigned long long) c->sd_read_blocks, (unsigned long long) c->sd_write_blocks,
+        (unsigned long long) c->sd_commands);
+    fprintf(report, "  I2C       %10llu bytes in %llu transactions\n",
+        (unsigned long long) c->i2c_bytes, (unsigned long long) c->i2c_transactions);
+    fprintf(report, "  GPIO      %10llu writes\n", (unsigned long long) c->gpio_writes);
+    fprintf(report, "  sleep     %10.3f s simulated, host %.3f s\n", c->sleep_us / 1e6, seconds);
+    fprintf(report, "  wire      %10.3f s simulated on the SPI, I2C and microSD links\n",
+        (time_us_64() - phase_start_us - c->sleep_us) / 1e6);
+    if(c->fpga_clocks != 0)
+        fprintf(report, "  FPGA RTL  %10llu clocks, %.2f clocks per SPI byte, %.0f clocks per host second\n",
+            (unsigned long long) c->fpga_clocks, c->spi_bytes ? (double) c->fpga_clocks / c->spi_bytes : 0.0,
+            seconds > 0 ? c->fpga_clocks / seconds : 0.0);
+}
+
+static bool read_baseline(const char* filename)
+{
+    char line[256];
+    struct Bench_Row* row;
+    FILE* fp = fopen(filename, "r");
+    if(fp == NULL){
+        perror(filename);
+        return(false);
+    }
+    while(fgets(line, sizeof(line), fp) != NULL && baselinecount < MAX_BASELINE_ROWS){
+        row = &baseline[baselinecount];
+        if(sscanf(line, "%63[^,],%15[^,],%llu,%llu,%llu,%llu,%llu,%llu,%llu", row->image, row->phase,
+            (unsigned long long*) &row->counts[0], (unsigned long long*) &row->counts[1], (unsigned long long*) &row->counts[2],
+            (unsigned long long*) &row->counts[3], (unsigned long long*) &row->counts[4], (unsigned long long*) &row->counts[5],
+            (unsigned long long*) &row->counts[6]) == 2 + CSV_COUNTS)
+            baselinecount++;
+    }
+    fclose(fp);
+    return(true);
+}
+
+// compare a load or unload with the first baseline row of the same image and phase
+static void check_baseline(const struct Bench_Row* row)
+{
+    static const char* names[CSV_COUNTS] = {"spi_bytes", "spi_transactions", "sd_commands", "sd_read_blocks",
+        "sd_write_blocks", "i2c_bytes", "wire_us"};
+    for(int i = 0; i < baselinecount; i++){
+        if(strcmp(baseline[i].image, row->image) != 0 || strcmp(baseline[i].phase, row->phase) != 0)
+            continue;
+        for(int c = 0; c < CSV_COUNTS; c++){
+            uint64_t limit = baseline[i].counts[c] + baseline[i].counts[c] * BASELINE_TOLERANCE_PERCENT / 100;
+            if(row->counts[c] > limit){
+                fprintf(report, "*** REGRESSION, %s %s %s %llu, baseline %llu\n", row->image, row->phase, names[c],
+                    (unsigned long long) row->counts[c], (unsigned long long) baseline[i].counts[c]);
+                regressions++;
+            }
+        }
+        return;
+    }
+    fprintf(report, "  no baseline for %s %s\n", row->image, row->phase);
+}
+
+static void start_phase()
+{
+    memset(&sim_counters, 0, sizeof(sim_counters));
+    phase_start_us = time_us_64();
+}
+
+// the wire time is the simulated time less the sleeps of the main loop
+static void record_phase(const char* phase, double seconds)
+{
+    struct Sim_Counters* c = &sim_counters;
+    struct Bench_Row row;
+
+    snprintf(row.image, sizeof(row.image), "%s", csv_image);
+    snprintf(row.phase, sizeof(row.phase), "%s", phase);
+    row.counts[0] = c->spi_bytes;
+    row.counts[1] = c->spi_transactions;
+    row.counts[2] = c->sd_commands;
+    row.counts[3] = c->sd_read_blocks;
+    row.counts[4] = c->sd_write_blocks;
+    row.counts[5] = c->i2c_bytes;
+    row.counts[6] = time_us_64() - phase_start_us - c->sleep_us;
+    if(csv != NULL){
+        fprintf(csv, "%s,%s", row.image, row.phase);
+        for(int i = 0; i < CSV_COUNTS; i++)
+            fprintf(csv, ",%llu", (unsigned long long) row.counts[i]);
+        fprintf(csv, ",%.0f\n", seconds * 1e6);
+    }
+    if(baselinecount != 0)
+        check_baseline(&row);
+}
+
+int main(int argc, char **argv)
+{
+    const char* cardfile = DEFAULT_CARD_FILE;
+    const char* imagefile = NULL;
+    const char* settings = NULL;
+    const char* pattern = NULL;
+    const char* csvfile = NULL;
+    const char* baselinefile = NULL;
+    const char* commands[MAX_COMMANDS];
+    int commandcount = 0;
+    int cardmb = DEFAULT_CARD_MB;
+    int cycles = 1;
+    bool unload = false;
+    bool quiet = false;
+    bool ok = true;
+    double start;
+    int ticks;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            cardfile = argv[++i];
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            cardmb = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            cycles = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-x") == 0 && i + 1 < argc && commandcount < MAX_COMMANDS)
+            commands[commandcount++] = argv[++i];
+        else if(strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+            settings = argv[++i];
+        else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            pattern = argv[++i];
+        else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            csvfile = argv[++i];
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            baselinefile = argv[++i];
+        else if(strcmp(argv[i], "-u") == 0)
+            unload = true;
+        else if(strcmp(argv[i], "-q") == 0)
+            quiet = true;
+        else if(argv[i][0] != '-' && imagefile == NULL)
+            imagefile = argv[i];
+        else
+            print_usage();
+    }
+    if(cardmb <= 0 || cycles <= 0)
+        print_usage();
+#ifndef HOST_SIM_RTL
+    if(pattern != NULL){
+        printf("The register model has no drive bus, -b needs rk05_host_sim_rtl\n");
+        return(1);
+    }
+#endif
+
+    if(baselinefile != NULL && !read_baseline(baselinefile))
+        return(1);
+    if(csvfile != NULL){
+        bool newfile = (access(csvfile, F_OK) != 0);
+        csv = fopen(csvfile, "a");
+        if(csv == NULL){
+            perror(csvfile);
+            return(1);
+        }
+        if(newfile)
+            fprintf(csv, "%s\n", CSV_HEADER);
+    }
+    if(imagefile != NULL){
+        csv_image = strrchr(imagefile, '/');
+        csv_image = (csv_image == NULL) ? imagefile : csv_image + 1;
+    }
+
+    // with -q the firmware console output is discarded and only the counts are printed
+    report = stdout;
+    if(quiet){
+        report = fdopen(dup(fileno(stdout)), "w");
+        if(report == NULL || freopen("/dev/null", "w", stdout) == NULL){
+            perror("stdout");
+            return(1);
+        }
+    }
+
+    // card present, RUN/LOAD switch in the LOAD position, WT PROT released, not in Interface Test Mode
+    sim_set_gpio_input(SIM_GPIO_CARD_DETECT, false);
+    sim_set_gpio_input(SIM_GPIO_TESTMODE, true);
+    sim_set_gpio_input(SIM_GPIO_RUN_LOAD, true);
+    sim_set_gpio_input(SIM_GPIO_WT_PROT, true);
+
+    if(imagefile != NULL)
+        ok = make_card(cardfile, (uint64_t) cardmb << 20, imagefile, settings);
+    else if(!sd_image_open(cardfile, 0)){
+        perror(cardfile);
+        ok = false;
+    }
+    if(!ok)
+        return(1);
+
+    initialize_system();
+
+    for(int i = 0; i < commandcount; i++){
+        strncpy(inputdata, commands[i], INPUT_LINE_LENGTH - 1);
+        inputdata[INPUT_LINE_LENGTH - 1] = '\0';
+        fprintf(report, "command %s\n", commands[i]);
+        fflush(report);
+        start_phase();
+        start = host_seconds();
+        extract_command_fields(inputdata);
+        // DIR browses the catalog on the display until a key is hit, a key hit up front ends it after the listing
+        if((extract_argc >= 1) && ((strcmp(extract_argv[0], "DIRECTORY") == 0) || (strcmp(extract_argv[0], "DIR") == 0) ||
+            (strcmp(extract_argv[0], "D") == 0)))
+            char_from_callback = ' ';
+        command_parse_and_dispatch(&edisk);
+        char_from_callback = 0;
+        print_counts(host_seconds() - start);
+    }
+    if(commandcount != 0 && imagefile == NULL)
+        return(0);
+
+    for(int cycle = 0; cycle < cycles && ok; cycle++){
+        // toggle the RUN/LOAD switch to RUN and wait for the image to be loaded
+        start_phase();
+        start = host_seconds();
+        sim_set_gpio_input(SIM_GPIO_RUN_LOAD, false);
+        ticks = run_until(RLST10, RLST19);
+        fprintf(report, "load: RLST%x after %d main loop passes\n", edisk.run_load_state, ticks);
+        print_counts(host_seconds() - start);
+        record_phase("load", host_seconds() - start);
+        if(edisk.run_load_state != RLST10 || !compare_card_with_sdram()){
+            fprintf(report, "load failed\n");
+            ok = false;
+            break;
+        }
+
+#ifdef HOST_SIM_RTL
+        if(pattern != NULL && !run_bus_pattern(pattern)){
+            fprintf(report, "bus pattern failed\n");
+            ok = false;
+            break;
+        }
+#endif
+
+        if(!unload)
+            break;
+
+        // toggle the RUN/LOAD switch to LOAD and wait for the image to be written back
+        start_phase();
+        start = host_seconds();
+        sim_set_gpio_input(SIM_GPIO_RUN_LOAD, true);
+        ticks = run_until(RLST0, RLST19);
+        fprintf(report, "unload: RLST%x after %d main loop passes\n", edisk.run_load_state, ticks);
+        print_counts(host_seconds() - start);
+        record_phase("unload", host_seconds() - start);
+        if(edisk.run_load_state != RLST0 || !compare_card_with_sdram()){
+            fprintf(report, "unload failed\n");
+            ok = false;
+        }
+    }
+
+    sd_image_close();
+    if(csv != NULL)
+        fclose(csv);
+    if(!ok)
+        return(1);
+    if(regressions != 0){
+        fprintf(report, "%d counts are more than %d%% above the baseline\n", regressions, BASELINE_TOLERANCE_PERCENT);
+        return(2);
+    }
+    return(0);
+}
@@ -0,0 +1,106 @@
+// *********************************************************************************
+// host_sim.h
+//   definitions shared by the parts of the host simulator: the Pico SDK stubs,
+//   the FPGA register model and the file-backed microSD card
+// *********************************************************************************
+// 
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// FPGA version reported by the model, the spi_interface.v register map of this version is modelled
+#define SIM_FPGA_VERSION 1
+#define SIM_FPGA_MINORVERSION 21
+
+#define SIM_SDRAM_WORDS (1 << 24) // 24-bit word address, sectors are at cylinder << 14 | head << 13 | sector << 9
+
+// GPIO inputs, the front panel switches are grounded when active
+#define SIM_GPIO_CARD_DETECT 11
+#define SIM_GPIO_TESTMODE 6
+#define SIM_GPIO_RUN_LOAD 20
+#define SIM_GPIO_WT_PROT 21
+
+// counts of the work done through the simulated hardware
+struct Sim_Counters
+{
+    uint64_t spi_transactions;      // FPGA SPI chip select cycles
+    uint64_t spi_bytes;             // bytes on the FPGA SPI link, address bytes included
+    uint64_t sd_commands;           // microSD read and write commands, one per disk_read() or disk_write()
+    uint64_t sd_read_blocks;        // 512 byte blocks read from the microSD card
+    uint64_t sd_write_blocks;       // 512 byte blocks written to the microSD card
+    uint64_t i2c_transactions;      // front panel display and switch transfers
+    uint64_t i2c_bytes;
+    uint64_t gpio_writes;
+    uint64_t sleep_us;              // simulated time spent in sleep_ms() and sleep_us()
+    uint64_t fpga_clocks;           // 40 MHz FPGA clock cycles, counted by the RTL model only
+};
+
+extern struct Sim_Counters sim_counters;
+
+// Pico SDK stubs, pico_stubs.cpp
+void sim_set_gpio_input(unsigned int gpio, bool value);
+unsigned int sim_spi_baudrate();
+void sim_advance_ps(uint64_t ps);
+
+// FPGA model, the register model in fpga_model.cpp or the Verilated FPGA design in fpga_rtl.cpp
+void fpga_model_reset();
+void fpga_model_select(bool selected);
+uint8_t fpga_model_transfer(uint8_t mosi);
+void fpga_model_idle(uint64_t us);
+const uint16_t* fpga_model_sdram();
+
+// drive bus of the Verilated FPGA design, fpga_rtl.cpp only, levels as on the bus connector
+struct Sim_Bus_Inputs
+{
+    uint8_t rk11d_l;
+    uint8_t sel_dr_l;       // 4 bits
+    uint8_t cyl_add_l;
+    uint8_t strobe_l;
+    uint8_t head_select_l;
+    uint8_t wt_protect_l;
+    uint8_t wt_data_clk_l;
+    uint8_t wt_gate_l;
+    uint8_t restore_l;
+    uint8_t rd_gate_l;
+};
+
+struct Sim_Bus_Outputs
+{
+    uint8_t file_ready_l;
+    uint8_t rws_rdy_l;
+    uint8_t address_accepted_l;
+    uint8_t address_invalid_l;
+    uint8_t wt_prot_status_l;
+    uint8_t rd_data_l;
+    uint8_t rd_clk_l;
+    uint8_t sec_cntr_l;     // 4 bits
+    uint8_t sec_pls_l;
+    uint8_t indx_pls_l;
+};
+
+void fpga_bus_set(const struct Sim_Bus_Inputs* in);
+void fpga_bus_get(struct Sim_Bus_Outputs* out);
+uint64_t fpga_bus_time_ps();
+void fpga_bus_run_until_ps(uint64_t t);
+void fpga_bus_clock();
+
+// disk controller bus-functional model, controller_bfm.cpp
+struct Bfm_Disk
+{
+    bool rk11d;             // RK11-D drive select and 16-bit words, otherwise RK8-E
+    int bit_rate;           // controller write data rate, bits per second
+    int sector_bytes;       // header word, data and CRC, dataLength / 8
+    int data_words;         // data words in a sector, 256
+    int preamble_bits;      // write preamble before the sync bit
+    int postamble_bits;
+    int cylinders;
+    int heads;
+    int sectors;
+    int sector_us;          // microseconds per sector at real drive speed
+};
+
+bool bfm_run_pattern(const char* pattern, const struct Bfm_Disk* disk, FILE* report);
+
+// file-backed microSD card, sd_card_image.cpp
+bool sd_image_open(const char* filename, uint64_t create_bytes);
+void sd_image_close();
@@ -0,0 +1,17 @@
+// *********************************************************************************
+// hardware/adc.h
+//   host simulator stand-in for the Pico SDK ADC header
+//   the ADC reads a healthy +5V supply unless the simulator sets it lower
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_HARDWARE_ADC_H
+#define _HOST_SIM_HARDWARE_ADC_H
+
+#include "pico/stdlib.h"
+
+void adc_init();
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read();
+
+#endif
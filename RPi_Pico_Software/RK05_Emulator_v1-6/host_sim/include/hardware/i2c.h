@@ -0,0 +1,23 @@
+// *********************************************************************************
+// hardware/i2c.h
+//   host simulator stand-in for the Pico SDK I2C header
+//   the front panel display and drive address switches are on i2c1, transfers
+//   are counted and the switches read as drive 0
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_HARDWARE_I2C_H
+#define _HOST_SIM_HARDWARE_I2C_H
+
+#include "pico/stdlib.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t host_sim_i2c0, host_sim_i2c1;
+#define i2c0 (&host_sim_i2c0)
+#define i2c1 (&host_sim_i2c1)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+#endif
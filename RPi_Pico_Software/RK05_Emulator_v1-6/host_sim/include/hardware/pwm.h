@@ -0,0 +1,12 @@
+// *********************************************************************************
+// hardware/pwm.h
+//   host simulator stand-in for the Pico SDK PWM header
+//   the door servo pulse comes from the FPGA, so no PWM functions are used
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_HARDWARE_PWM_H
+#define _HOST_SIM_HARDWARE_PWM_H
+
+#include "pico/stdlib.h"
+
+#endif
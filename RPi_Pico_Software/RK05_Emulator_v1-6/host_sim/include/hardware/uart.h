@@ -0,0 +1,21 @@
+// *********************************************************************************
+// hardware/uart.h
+//   host simulator stand-in for the Pico SDK UART header
+//   the console is the host stdin and stdout
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_HARDWARE_UART_H
+#define _HOST_SIM_HARDWARE_UART_H
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t host_sim_uart0, host_sim_uart1;
+#define uart0 (&host_sim_uart0)
+#define uart1 (&host_sim_uart1)
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+
+#endif
@@ -0,0 +1,23 @@
+// *********************************************************************************
+// hw_config.h
+//   host simulator stand-in for the FatFs_SPI hardware configuration header
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_HW_CONFIG_H
+#define _HOST_SIM_HW_CONFIG_H
+
+#include "ff.h"
+#include "sd_card.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+size_t sd_get_num();
+sd_card_t *sd_get_by_num(size_t num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+// *********************************************************************************
+// pico/binary_info.h
+//   host simulator stand-in for the Pico SDK binary info header
+//   binary info only matters to picotool, so the declarations are dropped
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_PICO_BINARY_INFO_H
+#define _HOST_SIM_PICO_BINARY_INFO_H
+
+#define bi_decl(_decl)
+#define bi_decl_if_func_used(_decl)
+#define bi_1pin_with_name(p0, name)
+#define bi_2pins_with_func(p0, p1, func)
+#define bi_program_description(description)
+
+#endif
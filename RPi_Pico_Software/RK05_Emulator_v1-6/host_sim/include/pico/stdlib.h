@@ -0,0 +1,44 @@
+// *********************************************************************************
+// pico/stdlib.h
+//   host simulator stand-in for the Pico SDK standard library header
+//   only the parts of the SDK the emulator firmware uses are declared
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_PICO_STDLIB_H
+#define _HOST_SIM_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+// default SPI0 pins of the Pico board, the FPGA SPI link
+#define PICO_DEFAULT_SPI 0
+#define PICO_DEFAULT_SPI_SCK_PIN 18
+#define PICO_DEFAULT_SPI_TX_PIN 19
+#define PICO_DEFAULT_SPI_RX_PIN 16
+#define PICO_DEFAULT_SPI_CSN_PIN 17
+#define PICO_DEFAULT_LED_PIN 25
+
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+// time, sleeping advances the simulated time instead of waiting
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+uint64_t time_us_64();
+
+// console
+bool stdio_init_all();
+int getchar_timeout_us(uint32_t timeout_us);
+void stdio_set_chars_available_callback(void (*fn)(void*), void *param);
+
+#endif
@@ -0,0 +1,36 @@
+// *********************************************************************************
+// sd_card.h
+//   host simulator stand-in for the FatFs_SPI SD card header
+//   the card is a file-backed disk image, see sd_card_image.cpp
+// *********************************************************************************
+// 
+#ifndef _HOST_SIM_SD_CARD_H
+#define _HOST_SIM_SD_CARD_H
+
+#include <stdint.h>
+#include "ff.h"
+#include "diskio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sd_card_t sd_card_t;
+
+struct sd_card_t {
+    const char *pcName;
+    int m_Status;       // Card status, STA_NOINIT until the card is initialized
+    uint64_t sectors;   // card size in 512 byte blocks
+    FATFS fatfs;
+    bool mounted;
+};
+
+bool sd_init_driver();
+bool sd_card_detect(sd_card_t *sd_card_p);
+uint64_t sd_sectors(sd_card_t *sd_card_p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,262 @@
+// *********************************************************************************
+// pico_stubs.cpp
+//   host simulator implementation of the Pico SDK functions used by the firmware
+//   GPIO, time, console, UART, ADC, I2C and the SPI link to the FPGA model
+// *********************************************************************************
+// 
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/adc.h"
+#include "hardware/uart.h"
+#include "hardware/i2c.h"
+
+#include "host_sim.h"
+
+#define ADC_HEALTHY_5V 3000 // above dc_upper_threshold in emulator_hardware.cpp
+
+struct spi_inst { uint baudrate; };
+struct uart_inst { uint baudrate; };
+struct i2c_inst { uint baudrate; };
+
+spi_inst_t host_sim_spi0, host_sim_spi1;
+uart_inst_t host_sim_uart0, host_sim_uart1;
+i2c_inst_t host_sim_i2c0, host_sim_i2c1;
+
+struct Sim_Counters sim_counters;
+
+static bool gpio_value[NUM_BANK0_GPIOS];
+static bool gpio_output[NUM_BANK0_GPIOS];
+static bool gpio_input[NUM_BANK0_GPIOS];
+static uint64_t sim_time_ps;       // simulated time, sleeps plus the time on the SPI, I2C and microSD links
+static bool fpga_selected;
+
+// *************** simulator controls ***************
+//
+// set the level of a GPIO input pin, pins that are never set read high as if pulled up
+void sim_set_gpio_input(uint gpio, bool value)
+{
+    if(gpio < NUM_BANK0_GPIOS)
+        gpio_input[gpio] = value;
+}
+
+uint sim_spi_baudrate()
+{
+    return(spi_default->baudrate);
+}
+
+// move the simulated time on by the time a transfer takes on the wire
+void sim_advance_ps(uint64_t ps)
+{
+    sim_time_ps += ps;
+}
+
+static void advance_bits(uint64_t bits, uint baudrate)
+{
+    if(baudrate != 0)
+        sim_time_ps += bits * 1000000000000ULL / baudrate;
+}
+
+// *************** GPIO ***************
+//
+void gpio_init(uint gpio)
+{
+    if(gpio >= NUM_BANK0_GPIOS)
+        return;
+    gpio_output[gpio] = false;
+    gpio_value[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    if(gpio < NUM_BANK0_GPIOS)
+        gpio_output[gpio] = out;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if(gpio >= NUM_BANK0_GPIOS)
+        return;
+    sim_counters.gpio_writes++;
+    // the FPGA SPI chip select frames a transaction, active low
+    if(gpio == PICO_DEFAULT_SPI_CSN_PIN && value == fpga_selected){
+        fpga_selected = !value;
+        fpga_model_select(fpga_selected);
+        if(!fpga_selected)
+            sim_counters.spi_transactions++;
+    }
+    gpio_value[gpio] = value;
+}
+
+bool gpio_get(uint gpio)
+{
+    if(gpio >= NUM_BANK0_GPIOS)
+        return(false);
+    return(gpio_output[gpio] ? gpio_value[gpio] : gpio_input[gpio]);
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+void gpio_pull_up(uint gpio)
+{
+}
+
+void gpio_pull_down(uint gpio)
+{
+}
+
+// the FPGA command interrupt is not modelled, so the callback is never called
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+}
+
+// *************** time ***************
+//
+void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t) ms * 1000);
+}
+
+void sleep_us(uint64_t us)
+{
+    sim_time_ps += us * 1000000;
+    sim_counters.sleep_us += us;
+    fpga_model_idle(us);
+}
+
+uint64_t time_us_64()
+{
+    return(sim_time_ps / 1000000);
+}
+
+// *************** console and UART ***************
+//
+bool stdio_init_all()
+{
+    return(true);
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    int c = getchar();
+    return((c == EOF) ? PICO_ERROR_TIMEOUT : c);
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void*), void *param)
+{
+}
+
+uint uart_init(uart_inst_t *uart, uint baudrate)
+{
+    uart->baudrate = baudrate;
+    return(baudrate);
+}
+
+// *************** ADC ***************
+//
+void adc_init()
+{
+}
+
+void adc_gpio_init(uint gpio)
+{
+}
+
+void adc_select_input(uint input)
+{
+}
+
+uint16_t adc_read()
+{
+    return(ADC_HEALTHY_5V);
+}
+
+// *************** I2C ***************
+//
+uint i2c_init(i2c_inst_t *i2c, uint baudrate)
+{
+    i2c->baudrate = baudrate;
+    return(baudrate);
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    sim_counters.i2c_transactions++;
+    sim_counters.i2c_bytes += len + 1;
+    advance_bits((len + 1) * 9, i2c->baudrate);
+    return((int) len);
+}
+
+// every device reads as zero, the PCA9557 switch port then selects drive 0
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    sim_counters.i2c_transactions++;
+    sim_counters.i2c_bytes += len + 1;
+    advance_bits((len + 1) * 9, i2c->baudrate);
+    memset(dst, 0, len);
+    return((int) len);
+}
+
+// *************** SPI ***************
+//
+// only spi0 with the chip select asserted reaches the FPGA model, anything else reads 0xff
+uint spi_init(spi_inst_t *spi, uint baudrate)
+{
+    spi->baudrate = baudrate;
+    return(baudrate);
+}
+
+void spi_deinit(spi_inst_t *spi)
+{
+}
+
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate)
+{
+    spi->baudrate = baudrate;
+    return(baudrate);
+}
+
+uint spi_get_baudrate(const spi_inst_t *spi)
+{
+    return(spi->baudrate);
+}
+
+void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order)
+{
+}
+
+static uint8_t spi_transfer(spi_inst_t *spi, uint8_t mosi)
+{
+    if(spi != spi0)
+        return(0xff);
+    sim_counters.spi_bytes++;
+    advance_bits(8, spi->baudrate);
+    if(!fpga_selected)
+        return(0xff);
+    return(fpga_model_transfer(mosi));
+}
+
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+        dst[i] = spi_transfer(spi, src[i]);
+    return((int) len);
+}
+
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+        spi_transfer(spi, src[i]);
+    return((int) len);
+}
+
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len)
+{
+    for(size_t i = 0; i < len; i++)
+        dst[i] = spi_transfer(spi, repeated_tx_data);
+    return((int) len);
+}
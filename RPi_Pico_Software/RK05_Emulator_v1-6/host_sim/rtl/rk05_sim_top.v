@@ -0,0 +1,198 @@
+//==========================================================================================================
+// RK05 Emulator
+// Verilator top level for the host simulator
+// File Name: rk05_sim_top.v
+// Functions:
+//   instantiates RK05_emulator_top with the SDRAM data bus split into plain ports for the C++ SDRAM model,
+//   simulation models of the Lattice SB_IO and SB_DFFS primitives that Verilator can compile.
+//
+// The SB_IO.v and SB_DFFS.v files next to the FPGA sources are not used: SB_IO.v never returns the pin
+// to D_IN_0 and SB_DFFS.v is a gate level model with #1 delays.
+//==========================================================================================================
+
+//================================= TOP LEVEL INPUT-OUTPUT DEFINITIONS =====================================
+module rk05_sim_top (
+
+// BUS Connector Inputs
+    input wire BUS_RK11D_L,
+    input wire [3:0] BUS_SEL_DR_L,
+    input wire [7:0] BUS_CYL_ADD_L,
+    input wire BUS_STROBE_L,
+    input wire BUS_HEAD_SELECT_L,
+    input wire BUS_WT_PROTECT_L,
+    input wire BUS_WT_DATA_CLK_L,
+    input wire BUS_WT_GATE_L,
+    input wire BUS_RESTORE_L,
+    input wire BUS_RD_GATE_L,
+
+// BUS Connector Outputs
+    output wire BUS_FILE_READY_L,
+    output wire BUS_RWS_RDY_L,
+    output wire BUS_ADDRESS_ACCEPTED_L,
+    output wire BUS_ADDRESS_INVALID_L,
+    output wire BUS_SEEK_INCOMPLETE_L,
+    output wire BUS_WT_PROT_STATUS_L,
+    output wire BUS_WT_CHK_L,
+    output wire BUS_RD_DATA_L,
+    output wire BUS_RD_CLK_L,
+    output wire [3:0] BUS_SEC_CNTR_L,
+    output wire BUS_SEC_PLS_L,
+    output wire BUS_INDX_PLS_L,
+    output wire BUS_DC_LO_L,
+    output wire BUS_RK05_HIGH_DENSITY_L,
+
+// SDRAM, the data bus is driven by the SDRAM model when SDRAM_DQ_drive is high
+    output wire [12:0] SDRAM_Address,
+    output wire SDRAM_BS0,
+    output wire SDRAM_BS1,
+    output wire SDRAM_WE_n,
+    output wire SDRAM_CAS_n,
+    output wire SDRAM_RAS_n,
+    output wire SDRAM_CS_n,
+    output wire SDRAM_CLK,
+    output wire SDRAM_CKE,
+    output wire SDRAM_DQML,
+    output wire SDRAM_DQMH,
+    input wire [15:0] SDRAM_DQ_model,  // read data from the SDRAM model
+    input wire SDRAM_DQ_drive,         // SDRAM model output enable
+    output wire [15:0] SDRAM_DQ_pins,  // value on the data bus
+    output wire SDRAM_DQ_fpga_enable,  // the FPGA drives the data bus
+
+// CPU SPI Port
+    output wire CPU_SPI_MISO,
+    input wire CPU_SPI_MOSI,
+    input wire CPU_SPI_CLK,
+    input wire CPU_SPI_CS_n,
+
+// Front Panel
+    output wire FPANEL_WT_PROT_indicator,
+    output wire FPANEL_WT_indicator,
+    output wire FPANEL_RD_indicator,
+    output wire FPANEL_ON_CYL_indicator,
+
+// Clock and Reset
+    input wire clock,
+    input wire pin_reset_n,
+
+// Tester Outputs
+    output wire TESTER_OUTPUT_1_L,
+    output wire TESTER_OUTPUT_2_L,
+    output wire TESTER_OUTPUT_3_L,
+    output wire Servo_Pulse_FPGA_pin,
+    output wire SPARE_PIO1_24,
+    output wire SELECTED_RDY_LED_N,
+    output wire CMD_INTERRUPT
+);
+
+//============================ Internal Connections ==================================
+wire [15:0] SDRAM_DQ;
+
+//============================ Start of Code =========================================
+assign SDRAM_DQ = SDRAM_DQ_drive ? SDRAM_DQ_model : 16'bz;
+assign SDRAM_DQ_pins = SDRAM_DQ;
+assign SDRAM_DQ_fpga_enable = emulator.SDRAM_DQ_enable;
+
+RK05_emulator_top emulator (
+    .BUS_RK11D_L (BUS_RK11D_L),
+    .BUS_SEL_DR_L (BUS_SEL_DR_L),
+    .BUS_CYL_ADD_L (BUS_CYL_ADD_L),
+    .BUS_STROBE_L (BUS_STROBE_L),
+    .BUS_HEAD_SELECT_L (BUS_HEAD_SELECT_L),
+    .BUS_WT_PROTECT_L (BUS_WT_PROTECT_L),
+    .BUS_WT_DATA_CLK_L (BUS_WT_DATA_CLK_L),
+    .BUS_WT_GATE_L (BUS_WT_GATE_L),
+    .BUS_RESTORE_L (BUS_RESTORE_L),
+    .BUS_RD_GATE_L (BUS_RD_GATE_L),
+    .BUS_FILE_READY_L (BUS_FILE_READY_L),
+    .BUS_RWS_RDY_L (BUS_RWS_RDY_L),
+    .BUS_ADDRESS_ACCEPTED_L (BUS_ADDRESS_ACCEPTED_L),
+    .BUS_ADDRESS_INVALID_L (BUS_ADDRESS_INVALID_L),
+    .BUS_SEEK_INCOMPLETE_L (BUS_SEEK_INCOMPLETE_L),
+    .BUS_WT_PROT_STATUS_L (BUS_WT_PROT_STATUS_L),
+    .BUS_WT_CHK_L (BUS_WT_CHK_L),
+    .BUS_RD_DATA_L (BUS_RD_DATA_L),
+    .BUS_RD_CLK_L (BUS_RD_CLK_L),
+    .BUS_SEC_CNTR_L (BUS_SEC_CNTR_L),
+    .BUS_SEC_PLS_L (BUS_SEC_PLS_L),
+    .BUS_INDX_PLS_L (BUS_INDX_PLS_L),
+    .BUS_DC_LO_L (BUS_DC_LO_L),
+    .BUS_RK05_HIGH_DENSITY_L (BUS_RK05_HIGH_DENSITY_L),
+    .SDRAM_Address (SDRAM_Address),
+    .SDRAM_BS0 (SDRAM_BS0),
+    .SDRAM_BS1 (SDRAM_BS1),
+    .SDRAM_WE_n (SDRAM_WE_n),
+    .SDRAM_CAS_n (SDRAM_CAS_n),
+    .SDRAM_RAS_n (SDRAM_RAS_n),
+    .SDRAM_CS_n (SDRAM_CS_n),
+    .SDRAM_CLK (SDRAM_CLK),
+    .SDRAM_CKE (SDRAM_CKE),
+    .SDRAM_DQML (SDRAM_DQML),
+    .SDRAM_DQMH (SDRAM_DQMH),
+    .SDRAM_DQ (SDRAM_DQ),
+    .CPU_SPI_MISO (CPU_SPI_MISO),
+    .CPU_SPI_MOSI (CPU_SPI_MOSI),
+    .CPU_SPI_CLK (CPU_SPI_CLK),
+    .CPU_SPI_CS_n (CPU_SPI_CS_n),
+    .FPANEL_WT_PROT_indicator (FPANEL_WT_PROT_indicator),
+    .FPANEL_WT_indicator (FPANEL_WT_indicator),
+    .FPANEL_RD_indicator (FPANEL_RD_indicator),
+    .FPANEL_ON_CYL_indicator (FPANEL_ON_CYL_indicator),
+    .clock (clock),
+    .pin_reset_n (pin_reset_n),
+    .TESTER_OUTPUT_1_L (TESTER_OUTPUT_1_L),
+    .TESTER_OUTPUT_2_L (TESTER_OUTPUT_2_L),
+    .TESTER_OUTPUT_3_L (TESTER_OUTPUT_3_L),
+    .Servo_Pulse_FPGA_pin (Servo_Pulse_FPGA_pin),
+    .SPARE_PIO1_24 (SPARE_PIO1_24),
+    .SELECTED_RDY_LED_N (SELECTED_RDY_LED_N),
+    .CMD_INTERRUPT (CMD_INTERRUPT)
+);
+
+endmodule // End of Module rk05_sim_top
+
+//------------------------------------------------
+// Simulation model of the Lattice SB_IO, only the combinational
+// output enable and input path used for the SDRAM DQ pins.
+//------------------------------------------------
+module SB_IO(
+    inout wire PACKAGE_PIN,
+    input wire OUTPUT_ENABLE,
+    input wire D_OUT_0,
+    output wire D_IN_0,
+    input wire LATCH_INPUT_VALUE,
+    input wire CLOCK_ENABLE,
+    input wire INPUT_CLK,
+    input wire OUTPUT_CLK,
+    input wire D_OUT_1,
+    output wire D_IN_1
+);
+
+parameter PIN_TYPE = 6'b101001,
+PULLUP = 1'b0,
+NEG_TRIGGER = 1'b0;
+
+assign PACKAGE_PIN = OUTPUT_ENABLE ? D_OUT_0 : 1'bz;
+assign D_IN_0 = PACKAGE_PIN;
+assign D_IN_1 = 1'b0;
+
+endmodule // End of Module SB_IO
+
+//------------------------------------------------
+// Simulation model of the Lattice SB_DFFS, D flip flop with asynchronous set.
+//------------------------------------------------
+module SB_DFFS(
+    output reg Q,
+    input wire C,
+    input wire D,
+    input wire S
+);
+
+always @ (posedge C or posedge S)
+begin
+  if(S)
+    Q <= 1'b1;
+  else
+    Q <= D;
+end
+
+endmodule // End of Module SB_DFFS
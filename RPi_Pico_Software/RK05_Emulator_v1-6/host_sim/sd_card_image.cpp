@@ -0,0 +1,225 @@
+// *********************************************************************************
+// sd_card_image.cpp
+//   host simulator microSD card, a file-backed disk image of 512 byte blocks
+//   FatFs disk I/O functions in place of the FatFs_SPI glue and SD driver
+// *********************************************************************************
+// 
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "ff.h"
+#include "diskio.h"
+#include "sd_card.h"
+#include "hw_config.h"
+
+#include "host_sim.h"
+
+#define SD_BLOCK_SIZE 512
+#define SD_BAUDRATE 12500000        // hw_config.c
+#define SD_COMMAND_BYTES 16         // command, response and the wait for the card, per disk_read() or disk_write()
+#define SD_BLOCK_BYTES 516          // start token, data and CRC of a block, with a byte of busy wait
+
+static FILE* card_file = NULL;
+
+static sd_card_t sd_cards[] = {
+    {
+        .pcName = "0:",
+        .m_Status = STA_NOINIT,
+    }};
+
+// open the card image, a new image of create_bytes is made if create_bytes is not zero
+bool sd_image_open(const char* filename, uint64_t create_bytes)
+{
+    sd_image_close();
+    if(create_bytes != 0){
+        card_file = fopen(filename, "w+b");
+        if(card_file == NULL)
+            return(false);
+        if((fseeko(card_file, (off_t) create_bytes - 1, SEEK_SET) != 0) || (fputc(0, card_file) == EOF)){
+            sd_image_close();
+            return(false);
+        }
+    }
+    else{
+        card_file = fopen(filename, "r+b");
+        if(card_file == NULL)
+            return(false);
+    }
+    fseeko(card_file, 0, SEEK_END);
+    sd_cards[0].sectors = (uint64_t) ftello(card_file) / SD_BLOCK_SIZE;
+    sd_cards[0].m_Status = STA_NOINIT;
+    return(true);
+}
+
+void sd_image_close()
+{
+    if(card_file != NULL)
+        fclose(card_file);
+    card_file = NULL;
+    sd_cards[0].m_Status = STA_NOINIT;
+}
+
+// *************** FatFs_SPI driver functions ***************
+//
+size_t sd_get_num()
+{
+    return(count_of(sd_cards));
+}
+
+sd_card_t *sd_get_by_num(size_t num)
+{
+    if(num < sd_get_num())
+        return(&sd_cards[num]);
+    return(NULL);
+}
+
+bool sd_init_driver()
+{
+    return(true);
+}
+
+// the card is present when the card detect input is low and a card image is open
+bool sd_card_detect(sd_card_t *sd_card_p)
+{
+    if((card_file == NULL) || gpio_get(SIM_GPIO_CARD_DETECT)){
+        sd_card_p->m_Status |= STA_NODISK;
+        return(false);
+    }
+    sd_card_p->m_Status &= ~STA_NODISK;
+    return(true);
+}
+
+uint64_t sd_sectors(sd_card_t *sd_card_p)
+{
+    return(sd_card_p->sectors);
+}
+
+// CSD version 2.0 of an SDHC card of the image size, 25 MHz maximum transfer rate
+static void make_csd(uint8_t* csd, uint64_t sectors)
+{
+    uint32_t c_size = (uint32_t) (sectors / 1024) - 1;
+
+    memset(csd, 0, 16);
+    csd[0] = 0x40;      // CSD_STRUCTURE 1
+    csd[1] = 0x0e;      // TAAC
+    csd[3] = 0x32;      // TRAN_SPEED
+    csd[4] = 0x5b;      // CCC
+    csd[5] = 0x59;      // CCC, READ_BL_LEN 9
+    csd[7] = (c_size >> 16) & 0x3f;
+    csd[8] = (c_size >> 8) & 0xff;
+    csd[9] = c_size & 0xff;
+    csd[10] = 0x7f;     // ERASE_BLK_EN, SECTOR_SIZE
+    csd[11] = 0x80;
+    csd[12] = 0x0a;     // R2W_FACTOR, WRITE_BL_LEN 9
+    csd[13] = 0x40;
+    csd[15] = 0x01;
+}
+
+// CID of a made up card, manufactured in January 2024
+static void make_cid(uint8_t* cid)
+{
+    static const uint8_t sim_cid[16] = {
+        0x00, 'H', 'S', 'R', 'K', '0', '5', 'S', 0x10, 0x00, 0x00, 0x05, 0x05, 0x01, 0x81, 0x01};
+    memcpy(cid, sim_cid, 16);
+}
+
+// *************** FatFs disk I/O ***************
+//
+// the simulated time moves on by the time the SD driver would spend on the SPI link to the card
+static void advance_sd_time(UINT count)
+{
+    sim_advance_ps(((uint64_t) SD_COMMAND_BYTES + (uint64_t) count * SD_BLOCK_BYTES) * 8 * 1000000000000ULL / SD_BAUDRATE);
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if(!p_sd)
+        return(STA_NOINIT);
+    sd_card_detect(p_sd);
+    return(p_sd->m_Status);
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+    sd_card_t *p_sd = sd_get_by_num(pdrv);
+    if(!p_sd)
+        return(STA_NOINIT);
+    if(sd_card_detect(p_sd))
+        p_sd->m_Status &= ~STA_NOINIT;
+    return(p_sd->m_Status);
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, LBA_t sector, UINT count)
+{
+    if((pdrv >= sd_get_num()) || (card_file == NULL))
+        return(RES_PARERR);
+    if((sd_cards[pdrv].m_Status & STA_NOINIT) != 0)
+        return(RES_NOTRDY);
+    if(sector + count > sd_cards[pdrv].sectors)
+        return(RES_PARERR);
+    sim_counters.sd_commands++;
+    sim_counters.sd_read_blocks += count;
+    advance_sd_time(count);
+    if((fseeko(card_file, (off_t) sector * SD_BLOCK_SIZE, SEEK_SET) != 0) ||
+        (fread(buff, SD_BLOCK_SIZE, count, card_file) != count))
+        return(RES_ERROR);
+    return(RES_OK);
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    if((pdrv >= sd_get_num()) || (card_file == NULL))
+        return(RES_PARERR);
+    if((sd_cards[pdrv].m_Status & STA_NOINIT) != 0)
+        return(RES_NOTRDY);
+    if(sector + count > sd_cards[pdrv].sectors)
+        return(RES_PARERR);
+    sim_counters.sd_commands++;
+    sim_counters.sd_write_blocks += count;
+    advance_sd_time(count);
+    if((fseeko(card_file, (off_t) sector * SD_BLOCK_SIZE, SEEK_SET) != 0) ||
+        (fwrite(buff, SD_BLOCK_SIZE, count, card_file) != count))
+        return(RES_ERROR);
+    return(RES_OK);
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+    if((pdrv >= sd_get_num()) || (card_file == NULL))
+        return(RES_PARERR);
+    switch(cmd){
+        case CTRL_SYNC:
+            fflush(card_file);
+            return(RES_OK);
+        case GET_SECTOR_COUNT:
+            *(LBA_t*) buff = sd_cards[pdrv].sectors;
+            return(RES_OK);
+        case GET_BLOCK_SIZE:
+            *(DWORD*) buff = 1;
+            return(RES_OK);
+        case MMC_GET_CSD:
+            if((sd_cards[pdrv].m_Status & STA_NOINIT) != 0)
+                return(RES_NOTRDY);
+            make_csd((uint8_t*) buff, sd_cards[pdrv].sectors);
+            return(RES_OK);
+        case MMC_GET_CID:
+            if((sd_cards[pdrv].m_Status & STA_NOINIT) != 0)
+                return(RES_NOTRDY);
+            make_cid((uint8_t*) buff);
+            return(RES_OK);
+        default:
+            return(RES_PARERR);
+    }
+}
+
+// FAT time stamp from the host clock
+DWORD get_fattime(void)
+{
+    time_t now = time(NULL);
+    struct tm* t = localtime(&now);
+    return(((DWORD)(t->tm_year - 80) << 25) | ((DWORD)(t->tm_mon + 1) << 21) | ((DWORD) t->tm_mday << 16) |
+        ((DWORD) t->tm_hour << 11) | ((DWORD) t->tm_min << 5) | ((DWORD) t->tm_sec >> 1));
+}
@@ -0,0 +1,31 @@
+// *********************************************************************************
+// image_catalog_definitions.h
+//  definitions of the catalog of the disk images on the microSD card
+//
+//  rk05catalog.idx on the card holds the entries exactly as they are in RAM, so its
+//  format is tied to this build. A catalog with another entry size is read again
+//  from the image headers, but a change that keeps the size, such as reordering
+//  the fields, needs a new CATALOG_FILE_MAGIC in microsd_file_ops.cpp.
+//
+// *********************************************************************************
+//
+#define CATALOG_MAX_IMAGES 64
+#define CATALOG_FILE_NAME_LENGTH 48     // longer image file names are left out of the catalog
+#define CATALOG_CONTROLLER_LENGTH 24
+
+struct Image_Catalog_Entry
+{
+    char fileName[CATALOG_FILE_NAME_LENGTH];
+    char imageName[11];
+    char imageDate[20];
+    char controller[CATALOG_CONTROLLER_LENGTH];
+    int numberOfCylinders;
+    int numberOfHeads;
+    int numberOfSectorsPerTrack;
+    int dataLength;
+    uint64_t fileSize;
+    uint16_t fileDate;      // FAT time stamp of the file, the header is read again when it changes
+    uint16_t fileTime;
+    bool headerValid;       // false if the file has no RK05 v1.0 header
+    bool seen;              // found in the last pass over the directory
+};
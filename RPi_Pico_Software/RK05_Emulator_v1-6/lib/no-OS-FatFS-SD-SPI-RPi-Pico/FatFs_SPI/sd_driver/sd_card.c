@@ -758,6 +758,23 @@ uint64_t sd_sectors(sd_card_t *pSD) {
     return sectors;
 }
 
+// Reads the 16 byte CID register (cid true) or CSD register (cid false)
+int sd_read_register(sd_card_t *pSD, bool cid, uint8_t *reg) {
+    int status = SD_BLOCK_DEVICE_ERROR_NONE;
+    sd_acquire(pSD);
+    // CMD9 or CMD10, Response R2 (R1 byte + 16-byte block read)
+    if (sd_cmd(pSD, cid ? CMD10_SEND_CID : CMD9_SEND_CSD, 0x0, false, 0) !=
+        0x0) {
+        DBG_PRINTF("Didn't get a response from the disk\r\n");
+        status = SD_BLOCK_DEVICE_ERROR_NO_RESPONSE;
+    } else if (sd_read_bytes(pSD, reg, 16) != 0) {
+        DBG_PRINTF("Couldn't read %s response from disk\r\n", cid ? "cid" : "csd");
+        status = SD_BLOCK_DEVICE_ERROR_CRC;
+    }
+    sd_release(pSD);
+    return status;
+}
+
 // SPI function to wait till chip is ready and sends start token
 static bool sd_wait_token(sd_card_t *pSD, uint8_t token) {
     TRACE_PRINTF("%s(0x%02hhx)\r\n", __FUNCTION__, token);
@@ -85,6 +85,7 @@ struct sd_card_t {
 
 bool sd_card_detect(sd_card_t *pSD);
 uint64_t sd_sectors(sd_card_t *pSD);
+int sd_read_register(sd_card_t *pSD, bool cid, uint8_t *reg);
 
 bool sd_init_driver();
 bool sd_card_detect(sd_card_t *sd_card_p);
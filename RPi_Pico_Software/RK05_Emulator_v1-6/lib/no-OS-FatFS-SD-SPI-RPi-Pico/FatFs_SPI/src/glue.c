@@ -162,6 +162,12 @@ DRESULT disk_ioctl(BYTE pdrv, /* Physical drive nmuber (0..) */
         }
         case CTRL_SYNC:
             return RES_OK;
+        case MMC_GET_CSD:  // Reads the 16 byte CSD register into buff
+        case MMC_GET_CID:  // Reads the 16 byte CID register into buff
+            if (p_sd->m_Status & STA_NOINIT) return RES_NOTRDY;
+            if (sd_read_register(p_sd, cmd == MMC_GET_CID, (uint8_t *)buff) != 0)
+                return RES_ERROR;
+            return RES_OK;
         default:
             return RES_PARERR;
     }
@@ -6,6 +6,8 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 //#include "hardware/spi.h"
 #include "ff.h" /* Obtains integer types */
@@ -18,11 +20,31 @@
 #include "display_functions.h"
 #include "emulator_state_definitions.h"
 #include "emulator_hardware.h"
+#include "image_catalog_definitions.h"
+#include "prbs_generator.h"
 
 
 #define MAX_SECTOR_SIZE 1024
 #define FILE_OPS_OKAY   0
 #define FILE_OPS_ERROR  1
+#define FILE_OPS_CRC_ERROR 2
+#define MAX_SECTOR_ERRORS_REPORTED 10
+#define CONFIG_FILE_NAME "rk05emulator.cfg"
+#define CONFIG_LINE_LENGTH 80
+#define CATALOG_FILE_NAME "rk05catalog.idx"
+#define CATALOG_FILE_MAGIC "RK05CAT1"
+#define SELECTION_FILE_NAME "rk05selected.txt"
+#define BENCHMARK_SD_BLOCKS 2048
+#define BENCHMARK_SPI_REGISTER_OPS 10000
+#define BENCHMARK_DRAM_BYTES 65536
+#define CARDBENCH_FILE_NAME "cardbench.tmp"
+#define CARDBENCH_BLOCKS 2048               // 1 MB scratch file
+#define CARDBENCH_BURST_BLOCKS 8            // blocks per raw sequential transfer
+#define CARDBENCH_RANDOM_BLOCKS 256
+#define CARDBENCH_LINKMAP_SIZE 64           // fast seek table of the scratch file, 31 fragments
+#define CARDBENCH_SLOW_READ 500000          // bytes per second, sequential FatFs reads slower than this are slow
+#define CARDBENCH_SLOW_WRITE 250000         // bytes per second, sequential FatFs writes slower than this are slow
+#define CARDBENCH_SLOW_LATENCY_US 250000    // a single block taking longer than this is slow
 
 static FATFS fs;
 static FIL fil;
@@ -32,6 +54,11 @@ static int ret;
 static char diskimagefilename[FF_LFN_BUF + 1] = "";
 static uint8_t sectordata[MAX_SECTOR_SIZE];  // largest possible sector data is 580 for RK11-E
 
+static Image_Catalog_Entry catalog[CATALOG_MAX_IMAGES];
+static int catalog_size;
+static bool catalog_valid;  // the catalog in RAM matches the card and can be listed without reading the card
+static char catalog_selection[CATALOG_FILE_NAME_LENGTH];    // the image selected on the front panel
+
 static void force_unmount()
 {
     f_unmount("0:");
@@ -53,6 +80,95 @@ int file_init_and_mount()
     return(FILE_OPS_OKAY);
 }
 
+// find "<name>=<value>" in a line of text and copy the value, returns false if the setting isn't present.
+// The name must be at the start of the text or follow a space, tab, '[' or ','. The value ends at a space, ']' or ','.
+static bool get_setting(const char* text, const char* name, char* value, int size)
+{
+    int namelength = strlen(name);
+    for (const char* p = strstr(text, name); p != NULL; p = strstr(p + 1, name)){
+        bool at_start = (p == text) || (strchr(" \t[,", p[-1]) != NULL);
+        if (!at_start || (p[namelength] != '='))
+            continue;
+        p += namelength + 1;
+        int i;
+        for (i = 0; (i < size - 1) && (p[i] != '\0') && (strchr(" \t],\r\n", p[i]) == NULL); i++)
+            value[i] = p[i];
+        value[i] = '\0';
+        return(true);
+    }
+    return(false);
+}
+
+// apply the emulator settings found in a line of text
+//   turbo=<percent>       disk speed in percent of the real drive for controllers that tolerate a faster drive
+//   seek=instant|rk05     instant seek, or the RK05 seek time model for timing sensitive diagnostics
+//   seek_scale=<percent>  scale factor for the RK05 seek times
+static void apply_settings(struct Disk_State* dstate, const char* text)
+{
+    char value[20];
+    if (get_setting(text, "turbo", value, sizeof(value)))
+        dstate->turbo_percent = atoi(value);
+    if (get_setting(text, "seek", value, sizeof(value))){
+        if (strcmp(value, "instant") == 0)
+            dstate->seek_model = SEEK_INSTANT;
+        else if (strcmp(value, "rk05") == 0)
+            dstate->seek_model = SEEK_RK05;
+        else
+            printf("###ERROR, unknown seek=%s setting\r\n", value);
+    }
+    if (get_setting(text, "seek_scale", value, sizeof(value)))
+        dstate->seek_scale_percent = atoi(value);
+}
+
+// read the optional emulator configuration file from the root of the microSD card.
+// Each line has one or more "<setting>=<value>" fields, lines starting with '#' are comments.
+// A line starting with "<controller>:" only applies to images for that controller, for example
+//   RK8-E: seek=rk05
+// A missing file leaves all settings at the real drive values.
+static void read_config_file(struct Disk_State* dstate)
+{
+    FIL cfgfil;
+    char line[CONFIG_LINE_LENGTH];
+    char* settings;
+    char* colon;
+
+    dstate->turbo_percent = 100;
+    dstate->seek_model = SEEK_INSTANT;
+    dstate->seek_scale_percent = 100;
+    if (f_open(&cfgfil, CONFIG_FILE_NAME, FA_READ) != FR_OK)
+        return;
+    printf("Reading config file '%s'\r\n", CONFIG_FILE_NAME);
+    while (f_gets(line, sizeof(line), &cfgfil) != NULL){
+        if (line[0] == '#')
+            continue;
+        settings = line;
+        colon = strchr(line, ':');
+        if ((colon != NULL) && (colon < strchr(line, '='))){
+            *colon = '\0';
+            if (strcmp(line, dstate->controller) != 0)
+                continue;
+            settings = colon + 1;
+        }
+        apply_settings(dstate, settings);
+    }
+    f_close(&cfgfil);
+}
+
+// the file name of the image selected on the front panel, saved on the card by image_catalog_select()
+static bool read_selection_file(char* name, int size)
+{
+    FIL selfil;
+    bool found;
+
+    if (f_open(&selfil, SELECTION_FILE_NAME, FA_READ) != FR_OK)
+        return(false);
+    found = (f_gets(name, size, &selfil) != NULL);
+    f_close(&selfil);
+    if (found)
+        name[strcspn(name, "\r\n")] = '\0';
+    return(found && (name[0] != '\0'));
+}
+
 int file_open_read_disk_image()
 {
     DIR dir;
@@ -65,7 +181,16 @@ int file_open_read_disk_image()
         return(fr);
     }
 
-    // Find first disk image file name
+    // The image selected on the front panel, no directory scan is needed to find it
+    if (read_selection_file(diskimagefilename, sizeof(diskimagefilename))){
+        if ((fr = f_open(&fil, diskimagefilename, FA_READ)) == FR_OK){
+            printf("Selected disk image file '%s'\r\n", diskimagefilename);
+            return(FILE_OPS_OKAY);
+        }
+        printf("###ERROR, selected disk image file '%s' not found (%d), loading the first image found\r\n", diskimagefilename, fr);
+    }
+
+    // Otherwise find first disk image file name
     fr = f_findfirst(&dir, &fno, "", "?*.RK05");
     f_closedir(&dir);
 
@@ -93,6 +218,7 @@ int file_open_write_disk_image()
 {
     FRESULT fr;
     printf("file_open_write_disk_image\r\n");
+    catalog_valid = false;
     if ((fr = f_mount(&fs, "0:", 1)) != FR_OK){
         printf("*** ERROR, could not mount filesystem before open for write (%d)\r\n", fr);
         display_error((char *) "cannot mount", (char *) "filesystem");
@@ -127,6 +253,7 @@ int file_close_disk_image()
     // Force SD card reinitialization in case it has been swapped or removed and the volume is remounted.
     sd_card_t *pSD = sd_get_by_num(0);
     pSD->m_Status |= STA_NOINIT;
+    catalog_valid = false;
 
     return(FILE_OPS_OKAY);
 }
@@ -217,13 +344,12 @@ bool serialize_string(char *cp, int size)
 static char magicNumber[10] = "\x89RK05\r\n\x1A"; 
 static char versionNumber[4] = "1.0";
 
-int read_image_file_header(struct Disk_State* dstate)
+// the fields of the header of the open image file, without the settings and FPGA registers that a load applies
+static int read_header_fields(struct Disk_State* dstate)
 {
     bool rc;
     static char tmp[10];
 
-    printf("Reading header from file '%s'\r\n", diskimagefilename);
-
     if (!deserialize_string(tmp, sizeof(magicNumber)) || strncmp(tmp, magicNumber, sizeof(magicNumber)) != 0) {
         // invalid magic
         return 2;
@@ -248,8 +374,17 @@ int read_image_file_header(struct Disk_State* dstate)
     rc = rc && deserialize_int(&dstate->numberOfSectorsPerTrack); 
     rc = rc && deserialize_int(&dstate->numberOfHeads);           
     rc = rc && deserialize_int(&dstate->microsecondsPerSector);
+    return(rc ? 0 : 1);
+}
 
-    if (rc) {
+int read_image_file_header(struct Disk_State* dstate)
+{
+    int result;
+
+    printf("Reading header from file '%s'\r\n", diskimagefilename);
+
+    result = read_header_fields(dstate);
+    if (result == 0) {
         printf("controller = %s\r\n", dstate->controller);
         printf("bitRate = %d\r\n", dstate->bitRate);
         printf("preamble1Length = %d\r\n", dstate->preamble1Length);
@@ -261,12 +396,15 @@ int read_image_file_header(struct Disk_State* dstate)
         printf("numberOfHeads = %d\r\n", dstate->numberOfHeads);
         printf("microsecondsPerSector = %d\r\n", dstate->microsecondsPerSector);
 
+        // settings in the image description, for example "turbo=200", override the config file
+        read_config_file(dstate);
+        apply_settings(dstate, dstate->imageDescription);
+
         // write the data read from the JSON  header into the FPGA registers
         update_fpga_disk_state(dstate);
-        return 0;
     }
 
-    return 1;
+    return result;
 }
 
 int write_image_file_header(struct Disk_State* dstate)
@@ -305,11 +443,18 @@ int read_disk_image_data(struct Disk_State* dstate)
     int headcount;
     int cylindercount;
     int ramaddress;
+    int sectorstatus;
+    int sectorerrors = 0;
+    bool crc_check = is_fpga_crc_capable();
     char display_line_2[30];
 
     printf("Reading disk data from file '%s'\r\n", diskimagefilename);
     printf("  %s\r\n", dstate->controller);
     printf(" cylinders=%d, heads=%d, sectors=%d, datalength=%d bytes\r\n", dstate->numberOfCylinders, dstate->numberOfHeads, dstate->numberOfSectorsPerTrack, dstate->dataLength / 8);
+    if(crc_check)
+        clear_crc_error_count();
+    else
+        printf("  FPGA version has no sector CRC check, image data is not verified\r\n");
     for (cylindercount = 0; cylindercount < dstate->numberOfCylinders; cylindercount++){
         if ((cylindercount % 20) == 0)
             printf("  cylindercount = %d\r\n", cylindercount);
@@ -334,10 +479,27 @@ int read_disk_image_data(struct Disk_State* dstate)
                     storebyte(*bp++);
                 }
                 gpio_put(22, 0); // for debugging to time the loop
+
+                // the FPGA checks the header word and CRC as the sector is written to the SDRAM
+                if(crc_check){
+                    sectorstatus = read_sector_crc_status();
+                    if(sectorstatus != 0){
+                        if(++sectorerrors <= MAX_SECTOR_ERRORS_REPORTED)
+                            printf("###ERROR, cylinder %d, head %d, sector %d:%s%s%s\r\n", cylindercount, headcount, sectorcount,
+                                (sectorstatus & SECTOR_HEADER_ERROR) ? " header word" : "",
+                                (sectorstatus & SECTOR_CRC_ERROR) ? " CRC" : "",
+                                (sectorstatus & SECTOR_CHECK_TIMEOUT) ? " no CRC check status" : "");
+                    }
+                }
             }
         }
     }
 
+    if(crc_check){
+        printf("  FPGA sector check, %d sectors with errors, FPGA error count %d\r\n", sectorerrors, read_crc_error_count());
+        if(sectorerrors != 0)
+            return(FILE_OPS_CRC_ERROR);
+    }
     return(FILE_OPS_OKAY);
 }
 
@@ -385,3 +547,649 @@ int write_disk_image_data(struct Disk_State* dstate)
     return(FILE_OPS_OKAY);
 }
 
+
+// *********************************************************************************
+// image catalog
+//   the .rk05 images on the card with the header fields that the directory listing
+//   and the front panel show, sorted by file name. The catalog in RAM is used as it
+//   is until an image file is opened for write or closed, since the card can be
+//   swapped while the door is open. Otherwise one pass over the directory entries
+//   checks it, only images that are new or whose size or time stamp changed have
+//   their header read, and the catalog is saved in CATALOG_FILE_NAME so that after
+//   a power up the headers are not read again either.
+// *********************************************************************************
+//
+static void read_catalog_file()
+{
+    FIL catfil;
+    UINT nr;
+    char magic[8];
+    int header[2];
+
+    catalog_size = 0;
+    if (f_open(&catfil, CATALOG_FILE_NAME, FA_READ) != FR_OK)
+        return;
+    // the magic, the number of entries and the entry size, then the entries as they are in RAM
+    if ((f_read(&catfil, magic, sizeof(magic), &nr) == FR_OK) && (nr == sizeof(magic)) &&
+        (strncmp(magic, CATALOG_FILE_MAGIC, sizeof(magic)) == 0) &&
+        (f_read(&catfil, header, sizeof(header), &nr) == FR_OK) && (nr == sizeof(header)) &&
+        (header[0] >= 0) && (header[0] <= CATALOG_MAX_IMAGES) && (header[1] == sizeof(Image_Catalog_Entry)) &&
+        (f_read(&catfil, catalog, header[0] * sizeof(Image_Catalog_Entry), &nr) == FR_OK) &&
+        (nr == header[0] * sizeof(Image_Catalog_Entry)))
+        catalog_size = header[0];
+    f_close(&catfil);
+}
+
+static void write_catalog_file()
+{
+    FIL catfil;
+    UINT nw;
+    FRESULT fr;
+    int header[2] = {catalog_size, sizeof(Image_Catalog_Entry)};
+
+    if ((fr = f_open(&catfil, CATALOG_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK){
+        printf("###ERROR, could not create the catalog file %s (%d)\r\n", CATALOG_FILE_NAME, fr);
+        return;
+    }
+    fr = f_write(&catfil, CATALOG_FILE_MAGIC, 8, &nw);
+    if (fr == FR_OK)
+        fr = f_write(&catfil, header, sizeof(header), &nw);
+    // entries are zeroed when they are added and only moved with memcpy() and qsort(), so the
+    // padding bytes between the fields are written as zeroes too
+    if (fr == FR_OK)
+        fr = f_write(&catfil, catalog, catalog_size * sizeof(Image_Catalog_Entry), &nw);
+    if (fr != FR_OK)
+        printf("###ERROR, could not write the catalog file %s (%d)\r\n", CATALOG_FILE_NAME, fr);
+    f_close(&catfil);
+}
+
+// header fields of an image file into its catalog entry
+static void read_catalog_entry_header(Image_Catalog_Entry* entry)
+{
+    static Disk_State header;
+
+    entry->headerValid = false;
+    if (f_open(&fil, entry->fileName, FA_READ) != FR_OK)
+        return;
+    memset(&header, 0, sizeof(header));
+    if (read_header_fields(&header) == 0){
+        strncpy(entry->imageName, header.imageName, sizeof(entry->imageName) - 1);
+        strncpy(entry->imageDate, header.imageDate, sizeof(entry->imageDate) - 1);
+        strncpy(entry->controller, header.controller, sizeof(entry->controller) - 1);
+        entry->imageName[sizeof(entry->imageName) - 1] = '\0';
+        entry->imageDate[sizeof(entry->imageDate) - 1] = '\0';
+        entry->controller[sizeof(entry->controller) - 1] = '\0';
+        entry->numberOfCylinders = header.numberOfCylinders;
+        entry->numberOfHeads = header.numberOfHeads;
+        entry->numberOfSectorsPerTrack = header.numberOfSectorsPerTrack;
+        entry->dataLength = header.dataLength;
+        entry->headerValid = true;
+    }
+    f_close(&fil);
+}
+
+static int compare_file_names(const void* a, const void* b)
+{
+    const char* pa = ((const Image_Catalog_Entry*) a)->fileName;
+    const char* pb = ((const Image_Catalog_Entry*) b)->fileName;
+
+    while ((*pa != '\0') && (toupper(*pa) == toupper(*pb))){
+        pa++;
+        pb++;
+    }
+    return(toupper(*pa) - toupper(*pb));
+}
+
+// bring the catalog up to date with the card, rescan_all reads every header again
+int image_catalog_refresh(bool rescan_all)
+{
+    DIR dir;
+    FILINFO fno;
+    FRESULT fr;
+    Image_Catalog_Entry* entry;
+    bool changed, added;
+    int i;
+
+    if (catalog_valid && !rescan_all)
+        return(FILE_OPS_OKAY);
+    if (file_init_and_mount() != FILE_OPS_OKAY)
+        return(FILE_OPS_ERROR);
+    if ((fr = f_mount(&fs, "0:", 1)) != FR_OK){
+        printf("*** ERROR, could not mount filesystem to read the catalog (%d)\r\n", fr);
+        return(fr);
+    }
+
+    if (!read_selection_file(catalog_selection, sizeof(catalog_selection)))
+        catalog_selection[0] = '\0';
+    changed = rescan_all;
+    if (rescan_all)
+        catalog_size = 0;
+    else if (catalog_size == 0){
+        read_catalog_file();
+        changed = (catalog_size == 0);
+    }
+    for (i = 0; i < catalog_size; i++)
+        catalog[i].seen = false;
+
+    for (fr = f_findfirst(&dir, &fno, "", "?*.RK05"); (fr == FR_OK) && (fno.fname[0] != '\0'); fr = f_findnext(&dir, &fno)){
+        if (strlen(fno.fname) >= CATALOG_FILE_NAME_LENGTH){
+            printf("###ERROR, image file name %s is too long for the catalog\r\n", fno.fname);
+            continue;
+        }
+        for (i = 0; (i < catalog_size) && (strcmp(catalog[i].fileName, fno.fname) != 0); i++)
+            ;
+        added = (i == catalog_size);
+        if (added){
+            if (catalog_size == CATALOG_MAX_IMAGES){
+                printf("###ERROR, more than %d images, %s is not in the catalog\r\n", CATALOG_MAX_IMAGES, fno.fname);
+                continue;
+            }
+            memset(&catalog[i], 0, sizeof(Image_Catalog_Entry));
+            strcpy(catalog[i].fileName, fno.fname);
+            catalog_size++;
+        }
+        entry = &catalog[i];
+        entry->seen = true;
+        if (added || (entry->fileSize != fno.fsize) || (entry->fileDate != fno.fdate) || (entry->fileTime != fno.ftime)){
+            entry->fileSize = fno.fsize;
+            entry->fileDate = fno.fdate;
+            entry->fileTime = fno.ftime;
+            read_catalog_entry_header(entry);
+            changed = true;
+        }
+    }
+    f_closedir(&dir);
+
+    // drop the images that are gone
+    for (i = 0; i < catalog_size; ){
+        if (catalog[i].seen)
+            i++;
+        else{
+            catalog_size--;
+            memcpy(&catalog[i], &catalog[catalog_size], sizeof(Image_Catalog_Entry));
+            changed = true;
+        }
+    }
+    if (changed){
+        qsort(catalog, catalog_size, sizeof(Image_Catalog_Entry), compare_file_names);
+        write_catalog_file();
+    }
+    force_unmount();
+    catalog_valid = true;
+    return(FILE_OPS_OKAY);
+}
+
+// the index of the image selected on the front panel, 0 if none is selected or it is not on the card
+int image_catalog_selected()
+{
+    for (int i = 0; i < catalog_size; i++){
+        if (strcmp(catalog[i].fileName, catalog_selection) == 0)
+            return(i);
+    }
+    return(0);
+}
+
+// save the selection on the card, the next load opens this image without a directory scan
+int image_catalog_select(int index)
+{
+    FIL selfil;
+    FRESULT fr;
+
+    if ((index < 0) || (index >= catalog_size))
+        return(FILE_OPS_ERROR);
+    if (strcmp(catalog[index].fileName, catalog_selection) == 0)
+        return(FILE_OPS_OKAY);
+    if (file_init_and_mount() != FILE_OPS_OKAY)
+        return(FILE_OPS_ERROR);
+    if ((fr = f_mount(&fs, "0:", 1)) != FR_OK){
+        printf("*** ERROR, could not mount filesystem to save the image selection (%d)\r\n", fr);
+        return(fr);
+    }
+    if ((fr = f_open(&selfil, SELECTION_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS)) == FR_OK){
+        if (f_printf(&selfil, "%s\n", catalog[index].fileName) < 0)
+            fr = FR_DISK_ERR;
+        if (f_close(&selfil) != FR_OK)
+            fr = FR_DISK_ERR;
+    }
+    force_unmount();
+    if (fr != FR_OK){
+        printf("*** ERROR, could not save the image selection in %s (%d)\r\n", SELECTION_FILE_NAME, fr);
+        return(fr);
+    }
+    strcpy(catalog_selection, catalog[index].fileName);
+    printf("Selected disk image file '%s'\r\n", catalog_selection);
+    return(FILE_OPS_OKAY);
+}
+
+void image_catalog_invalidate()
+{
+    catalog_valid = false;
+}
+
+int image_catalog_count()
+{
+    return(catalog_size);
+}
+
+const Image_Catalog_Entry* image_catalog_entry(int index)
+{
+    return(((index >= 0) && (index < catalog_size)) ? &catalog[index] : NULL);
+}
+
+// *********************************************************************************
+// load benchmark, the LOADBENCH Interface Test Mode command
+//   times the image load and unload end to end and each layer under it: FatFs
+//   reads of the image file, microSD block reads, FPGA SPI register operations and
+//   SDRAM bytes through the SPI data ports. The results are printed as CSV lines
+//   layer,bytes,us,bytes_per_s so they can be compared with a stored baseline.
+//   The SDRAM contents are overwritten and the image file is written back as loaded.
+// *********************************************************************************
+//
+static void print_benchmark_line(const char* layer, uint64_t bytes, uint64_t us)
+{
+    printf("%s,%llu,%llu,%llu\r\n", layer, (unsigned long long) bytes, (unsigned long long) us,
+        (unsigned long long) (us != 0 ? bytes * 1000000 / us : 0));
+}
+
+static uint64_t image_data_bytes(Disk_State* dstate)
+{
+    return((uint64_t) dstate->numberOfCylinders * dstate->numberOfHeads * dstate->numberOfSectorsPerTrack * (dstate->dataLength / 8));
+}
+
+int file_load_benchmark(Disk_State* dstate)
+{
+    FRESULT fr;
+    UINT nr;
+    DRESULT dr;
+    uint64_t start, bytes;
+    int bytecount;
+    int i;
+    int result;
+
+    // FatFs reads of the image file in sector sized pieces, as read_disk_image_data() does them
+    if(file_open_read_disk_image() != FILE_OPS_OKAY)
+        return(FILE_OPS_ERROR);
+    if(read_image_file_header(dstate) != 0){
+        printf("###ERROR, could not read the image file header\r\n");
+        file_close_disk_image();
+        return(FILE_OPS_ERROR);
+    }
+    bytecount = dstate->dataLength / 8;
+    printf("LOADBENCH,%s,%s\r\n", diskimagefilename, dstate->controller);
+    printf("layer,bytes,us,bytes_per_s\r\n");
+    bytes = 0;
+    start = time_us_64();
+    do{
+        fr = f_read(&fil, sectordata, bytecount, &nr);
+        bytes += nr;
+    } while(fr == FR_OK && nr == bytecount);
+    print_benchmark_line("fatfs_read", bytes, time_us_64() - start);
+
+    // single block reads from the start of the card, below FatFs
+    bytes = 0;
+    start = time_us_64();
+    for(i = 0; i < BENCHMARK_SD_BLOCKS; i++){
+        if((dr = disk_read(0, sectordata, i, 1)) != RES_OK){
+            printf("###ERROR, microSD block %d read error %d\r\n", i, dr);
+            break;
+        }
+        bytes += 512;
+    }
+    print_benchmark_line("sd_block_read", bytes, time_us_64() - start);
+    file_close_disk_image();
+
+    // FPGA register reads, each is one SPI transaction of an address byte and a data byte
+    start = time_us_64();
+    for(i = 0; i < BENCHMARK_SPI_REGISTER_OPS; i++)
+        read_reg00();
+    print_benchmark_line("spi_register_read", (uint64_t) BENCHMARK_SPI_REGISTER_OPS * 2, time_us_64() - start);
+
+    // SDRAM data bytes through the SPI data ports
+    start = time_us_64();
+    load_ram_address(0);
+    for(i = 0; i < BENCHMARK_DRAM_BYTES; i++)
+        storebyte(i & 0xff);
+    print_benchmark_line("dram_write", BENCHMARK_DRAM_BYTES, time_us_64() - start);
+    start = time_us_64();
+    load_ram_address(0);
+    for(i = 0; i < BENCHMARK_DRAM_BYTES; i++)
+        readbyte();
+    print_benchmark_line("dram_read", BENCHMARK_DRAM_BYTES, time_us_64() - start);
+
+    // the whole load, as RLST4 through RLST8 do it
+    start = time_us_64();
+    if(file_open_read_disk_image() != FILE_OPS_OKAY)
+        return(FILE_OPS_ERROR);
+    if(read_image_file_header(dstate) != 0){
+        file_close_disk_image();
+        return(FILE_OPS_ERROR);
+    }
+    result = read_disk_image_data(dstate);
+    file_close_disk_image();
+    print_benchmark_line("load", image_data_bytes(dstate), time_us_64() - start);
+    if(result != FILE_OPS_OKAY){
+        printf("###ERROR, image load failed, the unload is not timed\r\n");
+        return(result);
+    }
+
+    // the whole unload, as RLST11 through RLST14 do it, the file gets back the data just loaded
+    start = time_us_64();
+    if(file_open_write_disk_image() != FILE_OPS_OKAY)
+        return(FILE_OPS_ERROR);
+    if(write_image_file_header(dstate) != 0){
+        file_close_disk_image();
+        return(FILE_OPS_ERROR);
+    }
+    result = write_disk_image_data(dstate);
+    file_close_disk_image();
+    print_benchmark_line("unload", image_data_bytes(dstate), time_us_64() - start);
+    return(result);
+}
+
+
+// *********************************************************************************
+// card benchmark, the CARDBENCH Interface Test Mode command
+//   reads the CID and CSD registers of the microSD card, then times sequential
+//   reads and writes of a scratch file through FatFs, the same blocks below FatFs
+//   with disk_read() and disk_write() in 8 block transfers, and single block reads
+//   at random places on the card and writes at random places in the scratch file.
+//   Every block written is read back and checked. Throughput is printed as CSV
+//   lines layer,bytes,us,bytes_per_s as LOADBENCH does, then the latency of the
+//   single block transfers as a histogram, and the card is reported OK, SLOW or
+//   FAILED. The scratch file is deleted at the end.
+// *********************************************************************************
+//
+#define CARDBENCH_BUCKETS 10
+
+static const uint32_t cardbench_bucket_us[CARDBENCH_BUCKETS - 1] = {
+    250, 500, 1000, 2000, 5000, 10000, 25000, 50000, 100000};
+
+struct Cardbench_Latency
+{
+    uint32_t count[CARDBENCH_BUCKETS];
+    uint32_t max_us;
+};
+
+static uint8_t cardbench_data[CARDBENCH_BURST_BLOCKS * 512];
+static DWORD cardbench_linkmap[CARDBENCH_LINKMAP_SIZE];
+static int cardbench_errors;
+
+static void cardbench_record(Cardbench_Latency* latency, uint32_t us)
+{
+    int i;
+    for(i = 0; i < CARDBENCH_BUCKETS - 1; i++){
+        if(us < cardbench_bucket_us[i])
+            break;
+    }
+    latency->count[i]++;
+    if(us > latency->max_us)
+        latency->max_us = us;
+}
+
+// each pass writes the scratch file with the PRBS31 sequence from its own seed,
+// block n of the file holds bits 4096 * n onward
+static void cardbench_start(Prbs_Generator* prbs, int pass, uint32_t block)
+{
+    prbs_start(prbs, prbs31_polynomial(), PRBS31_FPGA_SEED + pass);
+    prbs_jump(prbs, (uint64_t) block * 512 * 8);
+}
+
+static void cardbench_fill(Prbs_Generator* prbs, int bytes)
+{
+    for(int i = 0; i < bytes; i++)
+        cardbench_data[i] = prbs_next_byte(prbs);
+}
+
+static void cardbench_check(Prbs_Generator* prbs, int bytes, const char* layer, uint32_t block)
+{
+    int mismatches = 0;
+    for(int i = 0; i < bytes; i++){
+        if(cardbench_data[i] != prbs_next_byte(prbs))
+            mismatches++;
+    }
+    if(mismatches != 0){
+        if(cardbench_errors < MAX_SECTOR_ERRORS_REPORTED)
+            printf("###ERROR, %s data mismatch, %d bytes wrong from scratch file block %lu\r\n",
+                layer, mismatches, (unsigned long) block);
+        cardbench_errors++;
+    }
+}
+
+static void cardbench_io_error(const char* layer, uint64_t block, int result)
+{
+    if(cardbench_errors < MAX_SECTOR_ERRORS_REPORTED)
+        printf("###ERROR, %s error %d at block %llu\r\n", layer, result, (unsigned long long) block);
+    cardbench_errors++;
+}
+
+// card block of a scratch file block, and how many blocks from there are contiguous up to
+// the end of the cluster, from the fast seek table of the file
+static LBA_t cardbench_lba(uint32_t block, int* contiguous)
+{
+    DWORD cluster_offset = block / fs.csize;
+    DWORD* fragment = &cardbench_linkmap[1];
+
+    while((fragment[0] != 0) && (cluster_offset >= fragment[0])){
+        cluster_offset -= fragment[0];
+        fragment += 2;
+    }
+    *contiguous = fs.csize - (block % fs.csize);
+    return(fs.database + (LBA_t) (fragment[1] + cluster_offset - 2) * fs.csize + (block % fs.csize));
+}
+
+static void print_card_registers()
+{
+    static const int tran_speed_value[16] = {0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80};
+    uint8_t csd[16], cid[16];
+    LBA_t sectors;
+    uint32_t khz;
+    int i;
+
+    if(disk_ioctl(0, GET_SECTOR_COUNT, &sectors) == RES_OK)
+        printf("  capacity: %llu blocks, %llu MB\r\n", (unsigned long long) sectors, (unsigned long long) (sectors / 2048));
+    if(disk_ioctl(0, MMC_GET_CSD, csd) != RES_OK){
+        printf("###ERROR, could not read the CSD register\r\n");
+        cardbench_errors++;
+    }
+    else{
+        // TRAN_SPEED is a rate unit of 100 kbit/s times a power of ten and a multiplier in tenths
+        khz = 100;
+        for(i = 0; i < (csd[3] & 0x7); i++)
+            khz *= 10;
+        khz = khz * tran_speed_value[(csd[3] >> 3) & 0xf] / 10;
+        printf("  CSD: %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\r\n",
+            csd[0], csd[1], csd[2], csd[3], csd[4], csd[5], csd[6], csd[7],
+            csd[8], csd[9], csd[10], csd[11], csd[12], csd[13], csd[14], csd[15]);
+        printf("  type: %s, CSD version %d, maximum clock %lu.%lu MHz\r\n",
+            ((csd[0] >> 6) == 0) ? "SDSC" : "SDHC/SDXC", (csd[0] >> 6) + 1,
+            (unsigned long) (khz / 1000), (unsigned long) ((khz % 1000) / 100));
+    }
+    if(disk_ioctl(0, MMC_GET_CID, cid) != RES_OK){
+        printf("###ERROR, could not read the CID register\r\n");
+        cardbench_errors++;
+    }
+    else{
+        printf("  CID: manufacturer 0x%02x, OEM %c%c, product %c%c%c%c%c, revision %d.%d\r\n",
+            cid[0], cid[1], cid[2], cid[3], cid[4], cid[5], cid[6], cid[7], cid[8] >> 4, cid[8] & 0xf);
+        printf("  CID: serial number 0x%02x%02x%02x%02x, manufactured %d-%02d\r\n",
+            cid[9], cid[10], cid[11], cid[12], 2000 + (((cid[13] & 0xf) << 4) | (cid[14] >> 4)), cid[14] & 0xf);
+    }
+}
+
+int card_benchmark()
+{
+    static Cardbench_Latency read_latency, write_latency;
+    Prbs_Generator prbs, random_blocks;
+    FRESULT fr;
+    DRESULT dr;
+    UINT nbytes;
+    LBA_t sectors, lba;
+    uint64_t start, elapsed, read_bytes_per_s, write_bytes_per_s;
+    uint32_t block, us;
+    int contiguous;
+    int i;
+
+    memset(&read_latency, 0, sizeof(read_latency));
+    memset(&write_latency, 0, sizeof(write_latency));
+    cardbench_errors = 0;
+    if((fr = f_mount(&fs, "0:", 1)) != FR_OK){
+        printf("*** ERROR, could not mount filesystem (%d)\r\n", fr);
+        return(fr);
+    }
+    if(disk_ioctl(0, GET_SECTOR_COUNT, &sectors) != RES_OK){
+        printf("*** ERROR, could not read the card size\r\n");
+        force_unmount();
+        return(FILE_OPS_ERROR);
+    }
+    printf("CARDBENCH\r\n");
+    print_card_registers();
+    printf("layer,bytes,us,bytes_per_s\r\n");
+
+    // sequential FatFs writes of the scratch file, the time includes the sync of the FAT and directory
+    if((fr = f_open(&fil, CARDBENCH_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS)) != FR_OK){
+        printf("*** ERROR, could not create the scratch file %s (%d)\r\n", CARDBENCH_FILE_NAME, fr);
+        force_unmount();
+        return(fr);
+    }
+    cardbench_start(&prbs, 0, 0);
+    elapsed = 0;
+    for(block = 0; block < CARDBENCH_BLOCKS; block += CARDBENCH_BURST_BLOCKS){
+        cardbench_fill(&prbs, sizeof(cardbench_data));
+        start = time_us_64();
+        fr = f_write(&fil, cardbench_data, sizeof(cardbench_data), &nbytes);
+        elapsed += time_us_64() - start;
+        if((fr != FR_OK) || (nbytes != sizeof(cardbench_data))){
+            cardbench_io_error("fatfs_seq_write", block, fr);
+            break;
+        }
+    }
+    start = time_us_64();
+    fr = f_close(&fil);
+    elapsed += time_us_64() - start;
+    if(fr != FR_OK)
+        cardbench_io_error("fatfs_seq_write close", 0, fr);
+    print_benchmark_line("fatfs_seq_write", (uint64_t) CARDBENCH_BLOCKS * 512, elapsed);
+    write_bytes_per_s = (elapsed != 0) ? (uint64_t) CARDBENCH_BLOCKS * 512 * 1000000 / elapsed : 0;
+
+    // sequential FatFs reads, then the fast seek table of the file for the raw tests
+    if((fr = f_open(&fil, CARDBENCH_FILE_NAME, FA_READ)) != FR_OK){
+        printf("*** ERROR, could not open the scratch file %s (%d)\r\n", CARDBENCH_FILE_NAME, fr);
+        force_unmount();
+        return(fr);
+    }
+    cardbench_start(&prbs, 0, 0);
+    elapsed = 0;
+    for(block = 0; block < CARDBENCH_BLOCKS; block += CARDBENCH_BURST_BLOCKS){
+        start = time_us_64();
+        fr = f_read(&fil, cardbench_data, sizeof(cardbench_data), &nbytes);
+        elapsed += time_us_64() - start;
+        if((fr != FR_OK) || (nbytes != sizeof(cardbench_data))){
+            cardbench_io_error("fatfs_seq_read", block, fr);
+            break;
+        }
+        cardbench_check(&prbs, sizeof(cardbench_data), "fatfs_seq_read", block);
+    }
+    print_benchmark_line("fatfs_seq_read", (uint64_t) CARDBENCH_BLOCKS * 512, elapsed);
+    read_bytes_per_s = (elapsed != 0) ? (uint64_t) CARDBENCH_BLOCKS * 512 * 1000000 / elapsed : 0;
+    fil.cltbl = cardbench_linkmap;
+    cardbench_linkmap[0] = CARDBENCH_LINKMAP_SIZE;
+    fr = f_lseek(&fil, CREATE_LINKMAP);
+    f_close(&fil);
+    if(fr != FR_OK){
+        printf("*** ERROR, the scratch file is in too many fragments for the raw tests (%d)\r\n", fr);
+        f_unlink(CARDBENCH_FILE_NAME);
+        force_unmount();
+        return(fr);
+    }
+
+    // raw sequential writes and reads of the blocks of the scratch file, no transfer crosses a cluster
+    cardbench_start(&prbs, 1, 0);
+    elapsed = 0;
+    for(block = 0; block < CARDBENCH_BLOCKS; block += i){
+        lba = cardbench_lba(block, &contiguous);
+        i = (contiguous < CARDBENCH_BURST_BLOCKS) ? contiguous : CARDBENCH_BURST_BLOCKS;
+        cardbench_fill(&prbs, i * 512);
+        start = time_us_64();
+        dr = disk_write(0, cardbench_data, lba, i);
+        elapsed += time_us_64() - start;
+        if(dr != RES_OK)
+            cardbench_io_error("raw_seq_write", lba, dr);
+    }
+    print_benchmark_line("raw_seq_write", (uint64_t) CARDBENCH_BLOCKS * 512, elapsed);
+    cardbench_start(&prbs, 1, 0);
+    elapsed = 0;
+    for(block = 0; block < CARDBENCH_BLOCKS; block += i){
+        lba = cardbench_lba(block, &contiguous);
+        i = (contiguous < CARDBENCH_BURST_BLOCKS) ? contiguous : CARDBENCH_BURST_BLOCKS;
+        start = time_us_64();
+        dr = disk_read(0, cardbench_data, lba, i);
+        elapsed += time_us_64() - start;
+        if(dr != RES_OK)
+            cardbench_io_error("raw_seq_read", lba, dr);
+        cardbench_check(&prbs, i * 512, "raw_seq_read", block);
+    }
+    print_benchmark_line("raw_seq_read", (uint64_t) CARDBENCH_BLOCKS * 512, elapsed);
+
+    // raw single block reads anywhere on the card, and writes to random blocks of the scratch file
+    cardbench_start(&random_blocks, 2, 0);
+    elapsed = 0;
+    for(i = 0; i < CARDBENCH_RANDOM_BLOCKS; i++){
+        prbs_advance32(&random_blocks);
+        lba = random_blocks.state % sectors;
+        start = time_us_64();
+        dr = disk_read(0, cardbench_data, lba, 1);
+        us = (uint32_t) (time_us_64() - start);
+        elapsed += us;
+        cardbench_record(&read_latency, us);
+        if(dr != RES_OK)
+            cardbench_io_error("raw_rand_read", lba, dr);
+    }
+    print_benchmark_line("raw_rand_read", (uint64_t) CARDBENCH_RANDOM_BLOCKS * 512, elapsed);
+    elapsed = 0;
+    for(i = 0; i < CARDBENCH_RANDOM_BLOCKS; i++){
+        prbs_advance32(&random_blocks);
+        block = random_blocks.state % CARDBENCH_BLOCKS;
+        lba = cardbench_lba(block, &contiguous);
+        cardbench_start(&prbs, 3, block);
+        cardbench_fill(&prbs, 512);
+        start = time_us_64();
+        dr = disk_write(0, cardbench_data, lba, 1);
+        us = (uint32_t) (time_us_64() - start);
+        elapsed += us;
+        cardbench_record(&write_latency, us);
+        if(dr != RES_OK)
+            cardbench_io_error("raw_rand_write", lba, dr);
+        cardbench_start(&prbs, 3, block);
+        if((dr = disk_read(0, cardbench_data, lba, 1)) != RES_OK)
+            cardbench_io_error("raw_rand_write read back", lba, dr);
+        cardbench_check(&prbs, 512, "raw_rand_write", block);
+    }
+    print_benchmark_line("raw_rand_write", (uint64_t) CARDBENCH_RANDOM_BLOCKS * 512, elapsed);
+
+    if((fr = f_unlink(CARDBENCH_FILE_NAME)) != FR_OK)
+        printf("*** ERROR, could not delete the scratch file %s (%d)\r\n", CARDBENCH_FILE_NAME, fr);
+    force_unmount();
+
+    // single block latency histogram
+    printf("latency_us,reads,writes\r\n");
+    for(i = 0; i < CARDBENCH_BUCKETS; i++){
+        if(i < CARDBENCH_BUCKETS - 1)
+            printf("<%lu", (unsigned long) cardbench_bucket_us[i]);
+        else
+            printf(">=%lu", (unsigned long) cardbench_bucket_us[i - 1]);
+        printf(",%lu,%lu\r\n", (unsigned long) read_latency.count[i], (unsigned long) write_latency.count[i]);
+    }
+    printf("max,%lu,%lu\r\n", (unsigned long) read_latency.max_us, (unsigned long) write_latency.max_us);
+
+    if(cardbench_errors != 0){
+        printf("  card FAILED, %d errors\r\n", cardbench_errors);
+        return(FILE_OPS_ERROR);
+    }
+    if((read_bytes_per_s < CARDBENCH_SLOW_READ) || (write_bytes_per_s < CARDBENCH_SLOW_WRITE) ||
+        (read_latency.max_us > CARDBENCH_SLOW_LATENCY_US) || (write_latency.max_us > CARDBENCH_SLOW_LATENCY_US))
+        printf("  card SLOW, reads under %d or writes under %d bytes per second, or a block over %d us\r\n",
+            CARDBENCH_SLOW_READ, CARDBENCH_SLOW_WRITE, CARDBENCH_SLOW_LATENCY_US);
+    else
+        printf("  card OK\r\n");
+    return(FILE_OPS_OKAY);
+}
@@ -13,5 +13,14 @@ int write_image_file_header(Disk_State* dstate);
 int read_disk_image_data(Disk_State* dstate);
 int write_disk_image_data(Disk_State* datate);
 int file_init_and_mount();
+int file_load_benchmark(Disk_State* dstate);
+int card_benchmark();
+int image_catalog_refresh(bool rescan_all);
+void image_catalog_invalidate();
+int image_catalog_selected();
+int image_catalog_select(int index);
+int image_catalog_count();
+const Image_Catalog_Entry* image_catalog_entry(int index);
 
 #define FILE_OPS_OKAY 0
+#define FILE_OPS_CRC_ERROR 2
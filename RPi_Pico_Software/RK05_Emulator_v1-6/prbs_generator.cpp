@@ -0,0 +1,182 @@
+// *********************************************************************************
+// prbs_generator.cpp
+//   table-driven PRBS generators for memory and link test patterns
+//
+//   A step of n bits is an affine map of the register, M * state ^ c, with M the
+//   n-th power of the one bit shift. M is applied a byte of the state at a time from
+//   a table of 256 entries per byte, and c is folded into the table of the low byte.
+//   A jump multiplies the one bit map by itself, log2(bits) times.
+// *********************************************************************************
+//
+#include <stdio.h>
+#include <string.h>
+
+#include "prbs_generator.h"
+
+#define SHORT_JUMP_BITS 4096    // up to this far ahead the 32 bit steps are quicker than the jump maps
+
+// the step tables take 16 KB, so every PRBS31 user shares this one copy
+static Prbs_Polynomial prbs31;
+
+// affine map of the register, column i is the image of bit i without the constant
+struct Prbs_Map
+{
+    uint32_t column[32];
+    uint32_t constant;
+};
+
+static uint32_t order_mask(int order)
+{
+    return(order >= 32 ? 0xffffffff : (1UL << order) - 1);
+}
+
+static uint32_t parity(uint32_t x)
+{
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return(x & 1);
+}
+
+static uint32_t shift_one(const Prbs_Polynomial* poly, uint32_t state)
+{
+    uint32_t bit = parity(state & poly->taps) ^ (poly->inverted ? 1 : 0);
+    return(((state << 1) | bit) & order_mask(poly->order));
+}
+
+static uint32_t apply_map(const Prbs_Map* map, uint32_t state)
+{
+    uint32_t result = map->constant;
+    for(int i = 0; state != 0; i++, state >>= 1){
+        if((state & 1) != 0)
+            result ^= map->column[i];
+    }
+    return(result);
+}
+
+// result = second(first(state)), result may be either of the two
+static void compose_maps(Prbs_Map* result, const Prbs_Map* second, const Prbs_Map* first)
+{
+    Prbs_Map product;
+    for(int i = 0; i < 32; i++)
+        product.column[i] = apply_map(second, first->column[i]) ^ second->constant;
+    product.constant = apply_map(second, first->constant);
+    memcpy(result, &product, sizeof(product));
+}
+
+static void shift_map(Prbs_Map* map, const Prbs_Polynomial* poly)
+{
+    uint32_t zero = shift_one(poly, 0);
+    for(int i = 0; i < 32; i++)
+        map->column[i] = (i < poly->order) ? shift_one(poly, 1UL << i) ^ zero : 0;
+    map->constant = zero;
+}
+
+static void identity_map(Prbs_Map* map)
+{
+    for(int i = 0; i < 32; i++)
+        map->column[i] = 1UL << i;
+    map->constant = 0;
+}
+
+static void fill_step_table(uint32_t table[4][256], const Prbs_Map* map)
+{
+    for(int byte = 0; byte < 4; byte++){
+        for(int value = 0; value < 256; value++){
+            // the constant is left in the table of the low byte only
+            table[byte][value] = apply_map(map, (uint32_t) value << (8 * byte)) ^ (byte == 0 ? 0 : map->constant);
+        }
+    }
+}
+
+static uint32_t table_step(const uint32_t table[4][256], uint32_t state)
+{
+    return(table[0][state & 0xff] ^ table[1][(state >> 8) & 0xff] ^
+           table[2][(state >> 16) & 0xff] ^ table[3][state >> 24]);
+}
+
+// *************** Polynomials and Generators ***************
+//
+// build the step tables of a polynomial, taps has a bit set for each register bit in the feedback,
+// x^31 + x^28 + 1 is order 31 and taps bits 30 and 27
+void prbs_init_polynomial(Prbs_Polynomial* poly, int order, uint32_t taps, bool inverted)
+{
+    Prbs_Map one, step;
+
+    poly->order = order;
+    poly->taps = taps & order_mask(order);
+    poly->inverted = inverted;
+    shift_map(&one, poly);
+    identity_map(&step);
+    for(int i = 0; i < 8; i++)
+        compose_maps(&step, &one, &step);
+    fill_step_table(poly->step8, &step);
+    for(int i = 0; i < 2; i++)
+        compose_maps(&step, &step, &step);
+    fill_step_table(poly->step32, &step);
+}
+
+// the PRBS31 polynomial of the FPGA SDRAM self test, built on first use
+const Prbs_Polynomial* prbs31_polynomial()
+{
+    if(prbs31.order == 0)
+        prbs_init_polynomial(&prbs31, PRBS31_ORDER, PRBS31_TAPS, false);
+    return(&prbs31);
+}
+
+void prbs_start(Prbs_Generator* gen, const Prbs_Polynomial* poly, uint32_t seed)
+{
+    gen->poly = poly;
+    gen->state = seed & order_mask(poly->order);
+}
+
+// one bit, returns the bit shifted in
+uint32_t prbs_shift(Prbs_Generator* gen)
+{
+    gen->state = shift_one(gen->poly, gen->state);
+    return(gen->state & 1);
+}
+
+// the next 8 bits of the sequence, the first one in bit 7
+uint8_t prbs_next_byte(Prbs_Generator* gen)
+{
+    gen->state = table_step(gen->poly->step8, gen->state);
+    return(gen->state & 0xff);
+}
+
+// the next 16 bits of the sequence, the first one in bit 15, the data word of the FPGA self test
+uint16_t prbs_next_word16(Prbs_Generator* gen)
+{
+    uint16_t word = prbs_next_byte(gen) << 8;
+    return(word | prbs_next_byte(gen));
+}
+
+void prbs_advance32(Prbs_Generator* gen)
+{
+    gen->state = table_step(gen->poly->step32, gen->state);
+}
+
+// move the generator on by a number of bits, by 32 bit steps when that is close and
+// otherwise by squaring the one bit map, so the cost grows with log2(bits)
+void prbs_jump(Prbs_Generator* gen, uint64_t bits)
+{
+    Prbs_Map power, total;
+
+    if(bits <= SHORT_JUMP_BITS){
+        for(; bits >= 32; bits -= 32)
+            prbs_advance32(gen);
+        for(; bits > 0; bits--)
+            prbs_shift(gen);
+        return;
+    }
+    shift_map(&power, gen->poly);
+    identity_map(&total);
+    for(; bits != 0; bits >>= 1){
+        if((bits & 1) != 0)
+            compose_maps(&total, &power, &total);
+        compose_maps(&power, &power, &power);
+    }
+    gen->state = apply_map(&total, gen->state);
+}
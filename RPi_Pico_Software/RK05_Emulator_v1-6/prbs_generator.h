@@ -0,0 +1,46 @@
+// *********************************************************************************
+// prbs_generator.h
+//   table-driven PRBS generators for memory and link test patterns
+//
+//   The register shifts left and each new bit, the parity of the tapped bits, enters
+//   at bit 0, so after n steps of up to the register order the low n bits are the n
+//   newest bits with the oldest one highest. This is the SDRAM self test generator of
+//   sdram_controller.v. Inverted generators shift in the complement of the parity.
+//
+//   The generator advances 8 or 32 bits per step with four table lookups, and can
+//   jump to any position of the sequence in O(log n), so a test can start at any
+//   address without running the sequence up to it.
+// *********************************************************************************
+//
+#include <stdint.h>
+#include <stdbool.h>
+
+// x^31 + x^28 + 1, the pattern of the FPGA SDRAM self test
+#define PRBS31_ORDER 31
+#define PRBS31_TAPS ((1UL << 30) | (1UL << 27))
+#define PRBS31_FPGA_SEED 0x2a3b4c5d
+
+// the polynomial and its step tables, shared by all of the generators that use it
+struct Prbs_Polynomial
+{
+    int order;              // register length in bits, 8 to 32
+    uint32_t taps;          // register bits that make up the parity of the next bit
+    bool inverted;          // the complement of the parity is shifted in
+    uint32_t step8[4][256]; // next state after 8 bits, the XOR of one entry per state byte
+    uint32_t step32[4][256];
+};
+
+struct Prbs_Generator
+{
+    const Prbs_Polynomial* poly;
+    uint32_t state;
+};
+
+void prbs_init_polynomial(Prbs_Polynomial* poly, int order, uint32_t taps, bool inverted);
+const Prbs_Polynomial* prbs31_polynomial();
+void prbs_start(Prbs_Generator* gen, const Prbs_Polynomial* poly, uint32_t seed);
+uint32_t prbs_shift(Prbs_Generator* gen);
+uint8_t prbs_next_byte(Prbs_Generator* gen);
+uint16_t prbs_next_word16(Prbs_Generator* gen);
+void prbs_advance32(Prbs_Generator* gen);
+void prbs_jump(Prbs_Generator* gen, uint64_t bits);
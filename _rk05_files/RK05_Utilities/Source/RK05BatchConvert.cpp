@@ -0,0 +1,1035 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05BatchConvert.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Convert many SIMH RK05 disk images to RK05 Emulator disk images
+**      in parallel.
+**
+**      The inputs are files, directories (every .simh, .dsk and .rk file
+**      in them) and wildcard patterns. Each output is written to a
+**      temporary file, read back and has every sector header word and
+**      CRC checked before it is renamed to its final name, so a failed
+**      conversion never leaves a partial image behind. Nothing is asked
+**      interactively, existing outputs are handled by the overwrite
+**      policy given on the command line.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <errno.h>
+
+#include "RK05Image.h"
+#include "RK05Simh.h"
+#include "RK05Geometry.h"
+#include "RK05Thread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <glob.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#if defined(_WIN32)
+#define PathSeparator       '\\'
+#else
+#define PathSeparator       '/'
+#endif
+
+#define OneMegabyte         (1024.0 * 1024.0)
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef enum overwritePolicy
+    {
+    PolicyNone = 0,
+    PolicySkip,
+    PolicyOverwrite,
+    PolicyFail,
+    } OverwritePolicy;
+
+typedef enum fileResult
+    {
+    ResultPending = 0,
+    ResultConverted,
+    ResultSkipped,
+    ResultFailed,
+    } FileResult;
+
+typedef struct batchFile
+    {
+    char *input;
+    char *path;                 // input made absolute, to find repeats
+    char *output;
+    FileResult result;
+    size_t inputBytes;
+    size_t outputBytes;
+    double seconds;
+    char message[128];
+    } BatchFile;
+
+typedef struct verifyContext
+    {
+    int sectorSize;
+    int errors;
+    } VerifyContext;
+
+typedef struct batch
+    {
+    BatchFile *files;
+    int count;
+    int allocated;
+    OverwritePolicy policy;
+    Rk05Header header;          // name is set per file
+    const Rk05Geometry *geometry; // from -c, NULL to choose by input size
+    bool quiet;
+    Rk05Lock *printLock;
+    } Batch;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void printUsage(void);
+static void addInput(Batch *bp, const char *input, const char *outputDir);
+static void addDirectory(Batch *bp, const char *dir, const char *outputDir);
+static void addPattern(Batch *bp, const char *pattern, const char *outputDir);
+static void addFile(Batch *bp, const char *input, const char *outputDir);
+static bool isDirectory(const char *path);
+static bool isSimhName(const char *name);
+static const char *baseName(const char *path);
+static char *fullPath(const char *path);
+static int comparePaths(const char *a, const char *b);
+static void markDuplicates(Batch *bp);
+static int compareOutputs(const void *a, const void *b);
+static void convertFile(void *context, int job, int worker);
+static bool convert(Batch *bp, BatchFile *fp, const char *tempName);
+static bool verify(BatchFile *fp, const char *tempName);
+static bool verifySector(void *context, int cylinder, int head, int sector, const u8 *buf);
+static void printResult(Batch *bp, const BatchFile *fp);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Program entry point.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        array of argument strings
+**
+**  Returns:        0 if all files were converted or skipped, non-zero
+**                  otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    Rk05PoolStats stats;
+    Batch batch;
+    const char *outputDir;
+    int threads = rk05CpuCount();
+    int converted = 0;
+    int skipped = 0;
+    int failed = 0;
+    double inputBytes = 0;
+    double outputBytes = 0;
+    int i;
+
+    memset(&batch, 0, sizeof(batch));
+    rk05InitHeader(&batch.header);
+
+    // Process command line arguments.
+    argv += 1;
+    argc -= 1;
+
+    while (argc > 0) {
+        if (**argv != '-') {
+            break;
+        }
+
+        if (strcmp(*argv, "-o") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'overwrite policy' parameter\n");
+                printUsage();
+            }
+
+            if (strcmp(*argv, "skip") == 0) {
+                batch.policy = PolicySkip;
+            } else if (strcmp(*argv, "overwrite") == 0) {
+                batch.policy = PolicyOverwrite;
+            } else if (strcmp(*argv, "fail") == 0) {
+                batch.policy = PolicyFail;
+            } else {
+                printf("Unknown overwrite policy %s\n", *argv);
+                printUsage();
+            }
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-j") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'threads' parameter\n");
+                printUsage();
+            }
+
+            threads = atoi(*argv);
+            if (threads < 1 || threads > Rk05MaxThreads) {
+                printf("Threads must be 1 to %d\n", Rk05MaxThreads);
+                printUsage();
+            }
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-d") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'image description' parameter\n");
+                printUsage();
+            }
+
+            safecpy(batch.header.imageDescription, *argv, sizeof(batch.header.imageDescription));
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-c") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'controller' parameter\n");
+                printUsage();
+            }
+
+            batch.geometry = rk05GeometryByName(*argv);
+            if (batch.geometry == NULL) {
+                printf("Unknown controller %s\n", *argv);
+                printUsage();
+            }
+            rk05GeometryHeader(batch.geometry, &batch.header);
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-q") == 0) {
+            batch.quiet = true;
+
+            argv += 1;
+            argc -= 1;
+        } else {
+            printf("Unknown option %s\n", *argv);
+            printUsage();
+            }
+        }
+
+    if (batch.policy == PolicyNone) {
+        printf("The overwrite policy must be given with -o\n");
+        printUsage();
+    }
+
+    if (argc < 2) {
+        printUsage();
+    }
+
+    outputDir = argv[0];
+    if (!isDirectory(outputDir)) {
+        printf("Output directory %s does not exist\n", outputDir);
+        exit(1);
+    }
+
+    // Collect the input files.
+    for (i = 1; i < argc; i++) {
+        addInput(&batch, argv[i], outputDir);
+    }
+
+    if (batch.count == 0) {
+        printf("No SIMH images found\n");
+        exit(1);
+    }
+
+    markDuplicates(&batch);
+
+    // All images get the same date, localtime is not safe in the workers.
+    time_t timer;
+    struct tm* tm_info;
+
+    timer = time(NULL);
+    tm_info = localtime(&timer);
+
+    strftime(batch.header.imageDate, sizeof(batch.header.imageDate), "%Y-%m-%d %H:%M:%S", tm_info);
+
+    // Convert.
+    batch.printLock = rk05LockCreate();
+    if (batch.printLock == NULL || !rk05RunPool(batch.count, threads, convertFile, &batch, &stats)) {
+        printf("Can't start worker threads\n");
+        exit(1);
+    }
+
+    // Report.
+    for (i = 0; i < batch.count; i++) {
+        switch (batch.files[i].result) {
+        case ResultConverted:
+            converted++;
+            inputBytes += (double)batch.files[i].inputBytes;
+            outputBytes += (double)batch.files[i].outputBytes;
+            break;
+
+        case ResultSkipped:
+            skipped++;
+            break;
+
+        default:
+            failed++;
+            break;
+        }
+    }
+
+    printf("\n");
+    printf("Files:       %d converted, %d skipped, %d failed\n", converted, skipped, failed);
+    printf("SIMH data:   %.1f MB read\n", inputBytes / OneMegabyte);
+    printf("RK05 data:   %.1f MB written and verified\n", outputBytes / OneMegabyte);
+    printf("Time:        %.2f s on %d threads, %d steals\n", stats.seconds, stats.threads, stats.steals);
+    if (stats.seconds > 0) {
+        printf("Throughput:  %.1f MB/s, %.1f images/s\n",
+               (inputBytes + outputBytes) / OneMegabyte / stats.seconds, converted / stats.seconds);
+    }
+
+    if (failed != 0) {
+        printf("\nFailed:\n");
+        for (i = 0; i < batch.count; i++) {
+            if (batch.files[i].result == ResultFailed) {
+                printf("    %s: %s\n", batch.files[i].input, batch.files[i].message);
+            }
+        }
+    }
+
+    // Cleanup and exit
+    for (i = 0; i < batch.count; i++) {
+        free(batch.files[i].input);
+        free(batch.files[i].path);
+        free(batch.files[i].output);
+    }
+    free(batch.files);
+    rk05LockFree(batch.printLock);
+
+    return failed == 0 ? 0 : 1;
+}
+
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print short description of command and its parameters.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printUsage(void)
+    {
+    printf("Usage:\n");
+    printf("    RK05BatchConvert -o <policy> [options] <output_dir> <simh_input>...\n");
+    printf("Inputs:\n");
+    printf("    SIMH image files, directories (*.simh, *.dsk and *.rk files) and\n");
+    printf("    wildcard patterns. Outputs are named after the inputs with .rk05.\n");
+    printf("    Different inputs which would write the same output name all fail.\n");
+    printf("Options:\n");
+    printf("    -o <policy>            - Existing outputs: skip, overwrite or fail.\n");
+    printf("    -j <threads>           - Worker threads (default one per processor).\n");
+    printf("    -d <image_description> - Image Description (max 199 characters).\n");
+    printf("    -c <controller>        - Controller: RK8-E or RK11-D. Without -c full size\n");
+    printf("                             RK11-D images are recognised by their size and\n");
+    printf("                             all others converted as RK8-E.\n");
+    printf("    -q                     - Only report failures and the summary.\n");
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a command line input to the batch.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  input       file, directory or wildcard pattern
+**                  outputDir   output directory
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void addInput(Batch *bp, const char *input, const char *outputDir)
+{
+    if (strpbrk(input, "*?") != NULL) {
+        addPattern(bp, input, outputDir);
+    } else if (isDirectory(input)) {
+        addDirectory(bp, input, outputDir);
+    } else if (file_exists(input)) {
+        addFile(bp, input, outputDir);
+    } else {
+        printf("Can't find %s\n", input);
+        exit(1);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add the SIMH images in a directory to the batch.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  dir         directory
+**                  outputDir   output directory
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void addDirectory(Batch *bp, const char *dir, const char *outputDir)
+{
+    char path[1024];
+
+#if defined(_WIN32)
+    WIN32_FIND_DATAA find;
+    HANDLE handle;
+
+    snprintf(path, sizeof(path), "%s\\*", dir);
+    handle = FindFirstFileA(path, &find);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        if ((find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && isSimhName(find.cFileName)) {
+            snprintf(path, sizeof(path), "%s\\%s", dir, find.cFileName);
+            addFile(bp, path, outputDir);
+        }
+    } while (FindNextFileA(handle, &find));
+
+    FindClose(handle);
+#else
+    struct dirent *entry;
+    DIR *dp;
+
+    dp = opendir(dir);
+    if (dp == NULL) {
+        printf("Can't open %s", dir);
+        perror(" ");
+        exit(1);
+    }
+
+    while ((entry = readdir(dp)) != NULL) {
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (isSimhName(entry->d_name) && !isDirectory(path)) {
+            addFile(bp, path, outputDir);
+        }
+    }
+
+    closedir(dp);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add the files matching a wildcard pattern to the batch,
+**                  for shells which do not expand them.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  pattern     wildcard pattern
+**                  outputDir   output directory
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void addPattern(Batch *bp, const char *pattern, const char *outputDir)
+{
+#if defined(_WIN32)
+    WIN32_FIND_DATAA find;
+    HANDLE handle;
+    char path[1024];
+    const char *name = baseName(pattern);
+    int dirLength = (int)(name - pattern);
+
+    handle = FindFirstFileA(pattern, &find);
+    if (handle == INVALID_HANDLE_VALUE) {
+        printf("No files match %s\n", pattern);
+        return;
+    }
+
+    do {
+        if ((find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+            snprintf(path, sizeof(path), "%.*s%s", dirLength, pattern, find.cFileName);
+            addFile(bp, path, outputDir);
+        }
+    } while (FindNextFileA(handle, &find));
+
+    FindClose(handle);
+#else
+    glob_t matches;
+    size_t i;
+
+    if (glob(pattern, 0, NULL, &matches) != 0) {
+        printf("No files match %s\n", pattern);
+        return;
+    }
+
+    for (i = 0; i < matches.gl_pathc; i++) {
+        if (!isDirectory(matches.gl_pathv[i])) {
+            addFile(bp, matches.gl_pathv[i], outputDir);
+        }
+    }
+
+    globfree(&matches);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add one SIMH image to the batch.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  input       SIMH image file
+**                  outputDir   output directory
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void addFile(Batch *bp, const char *input, const char *outputDir)
+{
+    BatchFile *fp;
+    const char *name = baseName(input);
+    const char *dot = strrchr(name, '.');
+    int nameLength = dot != NULL && dot != name ? (int)(dot - name) : (int)strlen(name);
+    size_t size;
+
+    if (bp->count == bp->allocated) {
+        bp->allocated = bp->allocated == 0 ? 64 : bp->allocated * 2;
+        bp->files = (BatchFile *)realloc(bp->files, bp->allocated * sizeof(BatchFile));
+        if (bp->files == NULL) {
+            printf("Out of memory\n");
+            exit(1);
+        }
+    }
+
+    fp = &bp->files[bp->count++];
+    memset(fp, 0, sizeof(*fp));
+
+    fp->input = (char *)malloc(strlen(input) + 1);
+    size = strlen(outputDir) + nameLength + 7;
+    fp->output = (char *)malloc(size);
+    if (fp->input == NULL || fp->output == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    fp->path = fullPath(input);
+    if (fp->path == NULL) {
+        printf("Can't find the full path of %s", input);
+        perror(" ");
+        exit(1);
+    }
+
+    strcpy(fp->input, input);
+    snprintf(fp->output, size, "%s%c%.*s.rk05", outputDir, PathSeparator, nameLength, name);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check if a path is a directory.
+**
+**  Parameters:     Name        Description.
+**                  path        path to check
+**
+**  Returns:        true if it is a directory
+**
+**------------------------------------------------------------------------*/
+static bool isDirectory(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+
+    return (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check if a file name has a SIMH disk image extension.
+**
+**  Parameters:     Name        Description.
+**                  name        file name
+**
+**  Returns:        true if it is a SIMH image name
+**
+**------------------------------------------------------------------------*/
+static bool isSimhName(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+
+    if (dot == NULL) {
+        return false;
+    }
+
+    return _stricmp(dot, ".simh") == 0 || _stricmp(dot, ".dsk") == 0 || _stricmp(dot, ".rk") == 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the file name part of a path.
+**
+**  Parameters:     Name        Description.
+**                  path        path
+**
+**  Returns:        pointer to the file name in path
+**
+**------------------------------------------------------------------------*/
+static const char *baseName(const char *path)
+{
+    const char *name = path;
+    const char *cp;
+
+    for (cp = path; *cp != '\0'; cp++) {
+        if (*cp == '/' || *cp == '\\' || *cp == ':') {
+            name = cp + 1;
+        }
+    }
+
+    return name;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Make a path absolute, so the same file named in two
+**                  ways (./img.simh and img.simh) compares equal.
+**
+**  Parameters:     Name        Description.
+**                  path        path of an existing file
+**
+**  Returns:        allocated absolute path or NULL on error
+**
+**------------------------------------------------------------------------*/
+static char *fullPath(const char *path)
+{
+#if defined(_WIN32)
+    return _fullpath(NULL, path, 0);
+#else
+    return realpath(path, NULL);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare two paths the way the file system does.
+**
+**  Parameters:     Name        Description.
+**                  a           first path
+**                  b           second path
+**
+**  Returns:        <0, 0 or >0
+**
+**------------------------------------------------------------------------*/
+static int comparePaths(const char *a, const char *b)
+{
+#if defined(_WIN32)
+    return _stricmp(a, b);
+#else
+    return strcmp(a, b);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Skip inputs listed more than once and fail every input
+**                  of a group of different files which would write the
+**                  same output name, before the workers start, so no
+**                  output depends on which input converts first.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void markDuplicates(Batch *bp)
+{
+    BatchFile **sorted;
+    BatchFile *other;
+    bool collision;
+    int first;
+    int end;
+    int i;
+    int j;
+
+    sorted = (BatchFile **)malloc(bp->count * sizeof(BatchFile *));
+    if (sorted == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    for (i = 0; i < bp->count; i++) {
+        sorted[i] = &bp->files[i];
+    }
+
+    qsort(sorted, bp->count, sizeof(BatchFile *), compareOutputs);
+
+    for (first = 0; first < bp->count; first = end) {
+        // Find the group of inputs with this output name and check if it holds different files.
+        collision = false;
+        for (end = first + 1; end < bp->count && comparePaths(sorted[end]->output, sorted[first]->output) == 0; end++) {
+            if (comparePaths(sorted[end]->path, sorted[first]->path) != 0) {
+                collision = true;
+            }
+        }
+
+        for (i = first; i < end; i++) {
+            if (collision) {
+                // Name one of the other files in the message.
+                other = NULL;
+                for (j = first; other == NULL; j++) {
+                    if (comparePaths(sorted[j]->path, sorted[i]->path) != 0) {
+                        other = sorted[j];
+                    }
+                }
+
+                sorted[i]->result = ResultFailed;
+                snprintf(sorted[i]->message, sizeof(sorted[i]->message), "output name also used by %s", other->input);
+            } else if (i != first) {
+                sorted[i]->result = ResultSkipped;
+                safecpy(sorted[i]->message, "listed more than once", sizeof(sorted[i]->message));
+            }
+        }
+    }
+
+    free(sorted);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        qsort comparison by output name, then input order.
+**
+**  Parameters:     Name        Description.
+**                  a           pointer to first BatchFile pointer
+**                  b           pointer to second BatchFile pointer
+**
+**  Returns:        <0, 0 or >0
+**
+**------------------------------------------------------------------------*/
+static int compareOutputs(const void *a, const void *b)
+{
+    const BatchFile *fa = *(const BatchFile * const *)a;
+    const BatchFile *fb = *(const BatchFile * const *)b;
+    int result = comparePaths(fa->output, fb->output);
+
+    if (result != 0) {
+        return result;
+    }
+
+    return fa < fb ? -1 : (fa > fb ? 1 : 0);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pool job, convert one image.
+**
+**  Parameters:     Name        Description.
+**                  context     pointer to batch
+**                  job         index of the file to convert
+**                  worker      worker number
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void convertFile(void *context, int job, int worker)
+{
+    Batch *bp = (Batch *)context;
+    BatchFile *fp = &bp->files[job];
+    char *tempName;
+    double start = rk05Seconds();
+
+    (void)worker;
+
+    if (fp->result != ResultPending) {
+        printResult(bp, fp);
+        return;
+    }
+
+    if (file_exists(fp->output)) {
+        if (bp->policy == PolicySkip) {
+            fp->result = ResultSkipped;
+            safecpy(fp->message, "output exists", sizeof(fp->message));
+            printResult(bp, fp);
+            return;
+        }
+
+        if (bp->policy == PolicyFail) {
+            fp->result = ResultFailed;
+            safecpy(fp->message, "output exists", sizeof(fp->message));
+            printResult(bp, fp);
+            return;
+        }
+    }
+
+    tempName = (char *)malloc(strlen(fp->output) + 5);
+    if (tempName == NULL) {
+        fp->result = ResultFailed;
+        safecpy(fp->message, "out of memory", sizeof(fp->message));
+        printResult(bp, fp);
+        return;
+    }
+    sprintf(tempName, "%s.tmp", fp->output);
+
+    if (convert(bp, fp, tempName) && verify(fp, tempName)) {
+#if defined(_WIN32)
+        // Windows rename does not replace an existing file.
+        remove(fp->output);
+#endif
+        if (rename(tempName, fp->output) == 0) {
+            fp->result = ResultConverted;
+        } else {
+            fp->result = ResultFailed;
+            snprintf(fp->message, sizeof(fp->message), "can't rename %s: %s", tempName, strerror(errno));
+        }
+    } else {
+        fp->result = ResultFailed;
+    }
+
+    if (fp->result == ResultFailed) {
+        remove(tempName);
+    }
+
+    free(tempName);
+    fp->seconds = rk05Seconds() - start;
+    printResult(bp, fp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert one SIMH image into a temporary image file.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  fp          pointer to file to convert
+**                  tempName    temporary output file name
+**
+**  Returns:        true if successful, otherwise false with the message set
+**
+**------------------------------------------------------------------------*/
+static bool convert(Batch *bp, BatchFile *fp, const char *tempName)
+{
+    Rk05Header header = bp->header;
+    const Rk05Geometry *gp = bp->geometry;
+    Rk05Mapping input;
+    Rk05Image image;
+    Rk05Status status;
+    size_t imageSize;
+    FILE *ifp;
+    const char *name = baseName(fp->input);
+    const char *dot = strrchr(name, '.');
+    int nameLength = dot != NULL && dot != name ? (int)(dot - name) : (int)strlen(name);
+
+    // The image name is the input file name without extension, cut to fit.
+    if (nameLength > (int)sizeof(header.imageName) - 1) {
+        nameLength = (int)sizeof(header.imageName) - 1;
+    }
+    memcpy(header.imageName, name, nameLength);
+    header.imageName[nameLength] = '\0';
+
+    ifp = fopen(fp->input, "rb");
+    if (ifp == NULL) {
+        snprintf(fp->message, sizeof(fp->message), "can't open: %s", strerror(errno));
+        return false;
+    }
+
+    status = rk05MapFile(ifp, false, 0, &input);
+    if (status != Rk05Ok && status != Rk05ErrEof) {
+        fclose(ifp);
+        safecpy(fp->message, "read error", sizeof(fp->message));
+        return false;
+    }
+
+    if (gp == NULL && (gp = rk05GeometryBySimhSize(input.size)) != NULL) {
+        rk05GeometryHeader(gp, &header);
+    }
+    gp = rk05FindGeometry(&header);
+
+    status = rk05Create(&image, tempName, &header);
+    if (status == Rk05Ok) {
+        status = rk05Map(&image);
+    }
+    if (status == Rk05Ok) {
+        status = rk05SimhToImage(input.data, input.size, &image);
+    }
+    if (rk05Close(&image) != Rk05Ok && status == Rk05Ok) {
+        status = Rk05ErrIo;
+    }
+
+    fp->inputBytes = input.size;
+    imageSize = (size_t)image.sectorCount * gp->simhSectorSize;
+    rk05UnmapFile(ifp, false, &input);
+    fclose(ifp);
+
+    if (status != Rk05Ok) {
+        snprintf(fp->message, sizeof(fp->message), "can't write %s: %s", tempName, rk05StatusText(status));
+        return false;
+    }
+
+    if (fp->inputBytes > imageSize) {
+        snprintf(fp->message, sizeof(fp->message), "%lu bytes past the end of the disk ignored",
+                 (unsigned long)(fp->inputBytes - imageSize));
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read back a converted image and check the header word
+**                  and the CRC of every sector.
+**
+**  Parameters:     Name        Description.
+**                  fp          pointer to converted file
+**                  tempName    temporary output file name
+**
+**  Returns:        true if the image is clean, otherwise false with the
+**                  message set
+**
+**------------------------------------------------------------------------*/
+static bool verify(BatchFile *fp, const char *tempName)
+{
+    VerifyContext context;
+    Rk05Image image;
+    Rk05Status status;
+
+    status = rk05Open(&image, tempName, false);
+    if (status != Rk05Ok) {
+        snprintf(fp->message, sizeof(fp->message), "can't read back %s: %s", tempName, rk05StatusText(status));
+        return false;
+    }
+
+    rk05Map(&image);
+    context.sectorSize = image.sectorSize;
+    context.errors = 0;
+    status = rk05ForEachSector(&image, verifySector, &context);
+    fp->outputBytes = Rk05HeaderSize + (size_t)image.sectorCount * image.sectorSize;
+    rk05Close(&image);
+
+    if (status != Rk05Ok) {
+        snprintf(fp->message, sizeof(fp->message), "read back error: %s", rk05StatusText(status));
+        return false;
+    }
+
+    if (context.errors != 0) {
+        snprintf(fp->message, sizeof(fp->message), "%d sectors fail verification", context.errors);
+        return false;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        rk05ForEachSector callback, count bad sectors.
+**
+**  Parameters:     Name        Description.
+**                  context     pointer to VerifyContext
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         sector contents
+**
+**  Returns:        true to continue
+**
+**------------------------------------------------------------------------*/
+static bool verifySector(void *context, int cylinder, int head, int sector, const u8 *buf)
+{
+    VerifyContext *cp = (VerifyContext *)context;
+
+    (void)head;
+    (void)sector;
+
+    if (rk05CheckSector(buf, cp->sectorSize, cylinder) != 0) {
+        cp->errors += 1;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print the outcome of one file.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to batch
+**                  fp          pointer to file
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printResult(Batch *bp, const BatchFile *fp)
+{
+    if (bp->quiet && fp->result != ResultFailed) {
+        return;
+    }
+
+    rk05Lock(bp->printLock);
+    switch (fp->result) {
+    case ResultConverted:
+        printf("Converted %s -> %s (%.1f ms)", fp->input, fp->output, fp->seconds * 1000.0);
+        break;
+
+    case ResultSkipped:
+        printf("Skipped   %s", fp->input);
+        break;
+
+    default:
+        printf("FAILED    %s", fp->input);
+        break;
+    }
+
+    if (fp->message[0] != '\0') {
+        printf(" - %s", fp->message);
+    }
+    printf("\n");
+    fflush(stdout);
+    rk05Unlock(bp->printLock);
+}
+
+/*---------------------------  End Of File  ------------------------------*/
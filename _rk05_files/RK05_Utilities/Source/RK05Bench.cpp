@@ -0,0 +1,913 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Bench.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Benchmark the RK05 utility kernels on emulator disk images.
+**
+**      The kernels are first checked against the reference versions, the
+**      benchmark stops if any result differs.
+**
+**      A SIMH image, a file without the emulator image header, is converted
+**      to an emulator image in memory: the whole image conversion, the
+**      verification of every sector and the conversion back are timed, and
+**      the kernels are then timed on the converted sectors.
+**
+**      Each measurement is repeated and the median is reported with the
+**      fastest and slowest runs and the standard deviation, so a change can
+**      be told apart from run to run noise.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <errno.h>
+#include <math.h>
+
+#include "RK05Image.h"
+#include "RK05Crc.h"
+#include "RK05Pack.h"
+#include "RK05Geometry.h"
+#include "RK05Simh.h"
+#include "RK05Thread.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define CheckBufferSize     1100
+#define PackCheckPairs      4096
+#define PackCheckWords      128
+#define DefaultPasses       100
+#define DefaultRepeats      5
+#define MaxRepeats          100
+#define HeaderPassScale     100
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef u16 (*Crc16Function)(u16 crc, const u8 *bp, int size);
+
+typedef struct crcKernel
+    {
+    const char *name;
+    Crc16Function function;
+    } CrcKernel;
+
+typedef struct sectorStore
+    {
+    u8 *data;
+    int sectorSize;
+    int sectorCount;
+    } SectorStore;
+
+typedef struct benchTimes
+    {
+    double seconds[MaxRepeats];
+    int count;
+    } BenchTimes;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void printUsage(void);
+static bool checkCrcKernels(void);
+static bool checkPackKernels(void);
+static bool checkPackLengths(const Rk05PackKernel *kp);
+static Rk05Status loadImage(const char *filename, SectorStore *sp);
+static bool storeImage(Rk05Image *ip, const char *filename, SectorStore *sp);
+static bool storeSector(void *context, int cylinder, int head, int sector, const u8 *buf);
+static void benchCrcKernels(const char *filename, SectorStore *sp);
+static void benchPackKernels(SectorStore *sp);
+static void benchHeader(void);
+static void benchSimh(const char *filename);
+static int compareSeconds(const void *a, const void *b);
+static void printRate(const char *name, double bytes, BenchTimes *tp, const char *note);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static CrcKernel crcKernels[] =
+    {
+    { "table",  crc16bufTable  },
+    { "slice8", crc16bufSlice8 },
+    { "clmul",  crc16bufClmul  },
+    { "default", crc16buf      },   // crc16buf, the kernel picked for this host
+    };
+
+static int passes = DefaultPasses;
+static int repeats = DefaultRepeats;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Program entry point.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        array of argument strings
+**
+**  Returns:        0 if normal termination, non-zero otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    SectorStore store;
+    Rk05Status status;
+
+    // Process command line arguments.
+    argv += 1;
+    argc -= 1;
+
+    while (argc > 0) {
+        if (**argv != '-') {
+            break;
+        }
+
+        if (strcmp(*argv, "-p") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0 || atoi(*argv) <= 0) {
+                printf("Missing or invalid 'passes' parameter\n");
+                printUsage();
+            }
+
+            passes = atoi(*argv);
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-r") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0 || atoi(*argv) <= 0 || atoi(*argv) > MaxRepeats) {
+                printf("Missing or invalid 'repeats' parameter\n");
+                printUsage();
+            }
+
+            repeats = atoi(*argv);
+
+            argv += 1;
+            argc -= 1;
+        } else {
+            printf("Unknown option %s\n", *argv);
+            printUsage();
+            }
+        }
+
+    if (argc < 1) {
+        printUsage();
+    }
+
+    printf("crc16buf kernel: %s%s\n", crc16KernelName(), crc16ClmulAvailable() ? "" : " (no carry-less multiply)");
+    printf("pack kernel: %s\n", rk05PackKernelName());
+
+    if (!checkCrcKernels() || !checkPackKernels()) {
+        exit(1);
+    }
+
+    benchHeader();
+
+    while (argc > 0) {
+        status = loadImage(*argv, &store);
+        if (status == Rk05Ok) {
+            benchCrcKernels(*argv, &store);
+            benchPackKernels(&store);
+            free(store.data);
+        } else if (status == Rk05ErrMagic) {
+            benchSimh(*argv);
+        } else {
+            printf("%s: %s\n", *argv, rk05StatusText(status));
+        }
+
+        argv += 1;
+        argc -= 1;
+    }
+
+    return 0;
+}
+
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print short description of command and its parameters.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printUsage(void)
+    {
+    printf("Usage:\n");
+    printf("    RK05Bench [options] <emulator_or_simh_image_file>...\n");
+    printf("Options:\n");
+    printf("    -p <passes>    - Passes over each image per run (default %d).\n", DefaultPasses);
+    printf("    -r <repeats>   - Timed runs of each measurement (default %d, at most %d).\n", DefaultRepeats, MaxRepeats);
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check all CRC kernels against the table kernel on
+**                  random buffers of every length up to CheckBufferSize,
+**                  at every alignment within 16 bytes.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if all results agree
+**
+**------------------------------------------------------------------------*/
+static bool checkCrcKernels(void)
+{
+    static u8 buf[CheckBufferSize + 16];
+    int size;
+    int offset;
+    int k;
+    int checked = 0;
+    u16 start;
+    u16 expected;
+    u16 result;
+
+    srand(1);
+    for (size = 0; size < (int)sizeof(buf); size++) {
+        buf[size] = rand() & 0xFF;
+    }
+
+    for (size = 0; size <= CheckBufferSize; size++) {
+        for (offset = 0; offset < 16; offset++) {
+            start = (size & 1) ? (u16)(rand() & 0xFFFF) : 0;
+            expected = crc16bufTable(start, buf + offset, size);
+            for (k = 1; k < (int)(sizeof(crcKernels) / sizeof(crcKernels[0])); k++) {
+                result = crcKernels[k].function(start, buf + offset, size);
+                if (result != expected) {
+                    printf("CRC mismatch: %s gives 0x%04x, table gives 0x%04x (size %d, offset %d, start 0x%04x)\n",
+                           crcKernels[k].name, result, expected, size, offset, start);
+                    return false;
+                }
+            }
+
+            if (crc16buf(start, buf + offset, size) != expected) {
+                printf("CRC mismatch: crc16buf (size %d, offset %d, start 0x%04x)\n", size, offset, start);
+                return false;
+            }
+
+            checked++;
+        }
+    }
+
+    printf("CRC kernels agree on %d buffers\n", checked);
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check all pack kernels against the scalar kernel for
+**                  every pair of 12 bit words and every 3 byte packed
+**                  group, and check that packing then unpacking returns
+**                  the words.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if all results agree
+**
+**------------------------------------------------------------------------*/
+static bool checkPackKernels(void)
+{
+    static u8 simh[PackCheckPairs * 4];
+    static u8 packed[PackCheckPairs * 3];
+    static u8 expected[PackCheckPairs * 4];
+    static u8 result[PackCheckPairs * 4];
+    const Rk05PackKernel *kernels;
+    int count;
+    int k;
+    int i;
+    u32 first;
+    u32 value;
+    u8 noise;
+
+    count = rk05PackKernels(&kernels);
+    noise = 0x5A;
+
+    for (first = 0; first < (1 << 24); first += PackCheckPairs) {
+        // Word pairs first..first + PackCheckPairs - 1, high nibbles of the
+        // SIMH words filled with noise which packing must ignore.
+        for (i = 0; i < PackCheckPairs; i++) {
+            value = first + i;
+            noise = (u8)(noise * 37 + 11);
+            simh[i * 4 + 0] = value & 0xFF;
+            simh[i * 4 + 1] = ((value >> 8) & 0x0F) | (noise & 0xF0);
+            simh[i * 4 + 2] = (value >> 12) & 0xFF;
+            simh[i * 4 + 3] = ((value >> 20) & 0x0F) | ((noise << 4) & 0xF0);
+        }
+
+        for (k = 0; k < count; k++) {
+            kernels[k].pack(packed, simh, PackCheckPairs * 2);
+            for (i = 0; i < PackCheckPairs; i++) {
+                value = first + i;
+                if (   packed[i * 3 + 0] != (value & 0xFF)
+                    || packed[i * 3 + 1] != ((value >> 8) & 0xFF)
+                    || packed[i * 3 + 2] != ((value >> 16) & 0xFF)) {
+                    printf("Pack mismatch: %s, words 0x%03x 0x%03x\n", kernels[k].name, (int)(value & 0xFFF), (int)(value >> 12));
+                    return false;
+                }
+            }
+
+            // The same bytes taken as packed groups cover every 3 byte value.
+            rk05UnpackScalar(expected, packed, PackCheckPairs * 2);
+            kernels[k].unpack(result, packed, PackCheckPairs * 2);
+            for (i = 0; i < PackCheckPairs * 4; i++) {
+                if (result[i] != expected[i] || result[i] != (simh[i] & ((i & 1) ? 0x0F : 0xFF))) {
+                    printf("Unpack mismatch: %s, group 0x%06x\n", kernels[k].name, (int)(first + i / 4));
+                    return false;
+                }
+            }
+        }
+    }
+
+    for (k = 0; k < count; k++) {
+        if (!checkPackLengths(&kernels[k])) {
+            return false;
+        }
+    }
+
+    printf("Pack kernels agree on all word pairs:");
+    for (k = 0; k < count; k++) {
+        printf(" %s", kernels[k].name);
+    }
+    printf("\n");
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check a pack kernel against the scalar kernel for every
+**                  even word count up to PackCheckWords at every alignment,
+**                  and check that nothing is written past the output.
+**
+**  Parameters:     Name        Description.
+**                  kp          pointer to kernel
+**
+**  Returns:        true if all results agree
+**
+**------------------------------------------------------------------------*/
+static bool checkPackLengths(const Rk05PackKernel *kp)
+{
+    static u8 src[PackCheckWords * 2 + 32];
+    static u8 expected[PackCheckWords * 2 + 64];
+    static u8 result[PackCheckWords * 2 + 64];
+    int words;
+    int offset;
+    int i;
+
+    for (i = 0; i < (int)sizeof(src); i++) {
+        src[i] = rand() & 0xFF;
+    }
+
+    for (words = 0; words <= PackCheckWords; words += 2) {
+        for (offset = 0; offset < 32; offset++) {
+            memset(expected, 0xEE, sizeof(expected));
+            memset(result, 0xEE, sizeof(result));
+            rk05PackScalar(expected + offset, src + offset, words);
+            kp->pack(result + offset, src + offset, words);
+            if (memcmp(expected, result, sizeof(result)) != 0) {
+                printf("Pack mismatch: %s, %d words at offset %d\n", kp->name, words, offset);
+                return false;
+            }
+
+            memset(expected, 0xEE, sizeof(expected));
+            memset(result, 0xEE, sizeof(result));
+            rk05UnpackScalar(expected + offset, src + offset, words);
+            kp->unpack(result + offset, src + offset, words);
+            if (memcmp(expected, result, sizeof(result)) != 0) {
+                printf("Unpack mismatch: %s, %d words at offset %d\n", kp->name, words, offset);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read all sectors of an image into memory.
+**
+**  Parameters:     Name        Description.
+**                  filename    image file name
+**                  sp          pointer to store which will be set
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrMagic if the file is not
+**                  an emulator image, Rk05ErrIo if a failure has already
+**                  been reported, other error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status loadImage(const char *filename, SectorStore *sp)
+{
+    Rk05Image image;
+    Rk05Status status;
+    bool ok;
+
+    status = rk05Open(&image, filename, false);
+    if (status != Rk05Ok) {
+        return status;
+    }
+
+    ok = storeImage(&image, filename, sp);
+    rk05Close(&image);
+
+    return ok ? Rk05Ok : Rk05ErrIo;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy all sectors of an open image into memory.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  filename    image file name for messages
+**                  sp          pointer to store which will be set
+**
+**  Returns:        true if successful and false otherwise
+**
+**------------------------------------------------------------------------*/
+static bool storeImage(Rk05Image *ip, const char *filename, SectorStore *sp)
+{
+    Rk05Status status;
+
+    sp->sectorSize = ip->sectorSize;
+    sp->sectorCount = 0;
+    sp->data = (u8 *)malloc((size_t)ip->sectorSize * ip->sectorCount);
+    if (sp->data == NULL) {
+        printf("%s: out of memory\n", filename);
+        return false;
+    }
+
+    status = rk05ForEachSector(ip, storeSector, sp);
+    if (status != Rk05Ok) {
+        printf("%s: %s after %d sectors\n", filename, rk05StatusText(status), sp->sectorCount);
+        free(sp->data);
+        return false;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Append a sector to the store.
+**
+**  Parameters:     Name        Description.
+**                  context     store
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         sector read from the image
+**
+**  Returns:        true to continue with the next sector
+**
+**------------------------------------------------------------------------*/
+static bool storeSector(void *context, int cylinder, int head, int sector, const u8 *buf)
+{
+    SectorStore *sp = (SectorStore *)context;
+
+    (void)cylinder;
+    (void)head;
+    (void)sector;
+
+    memcpy(sp->data + (size_t)sp->sectorCount * sp->sectorSize, buf, sp->sectorSize);
+    sp->sectorCount++;
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Time the CRC check of every sector with each kernel.
+**
+**  Parameters:     Name        Description.
+**                  filename    image file name
+**                  sp          pointer to the sectors of the image
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void benchCrcKernels(const char *filename, SectorStore *sp)
+{
+    int k;
+    int run;
+    int pass;
+    int i;
+    int bad = 0;
+    int expectedBad = -1;
+    double start;
+    double bytes;
+    const u8 *bp;
+    BenchTimes times;
+    char name[40];
+    char note[40];
+
+    printf("\n%s: %d sectors of %d bytes, %d passes, %d runs\n", filename, sp->sectorCount, sp->sectorSize, passes, repeats);
+    bytes = (double)passes * sp->sectorCount * (sp->sectorSize - 2);
+
+    for (k = 0; k < (int)(sizeof(crcKernels) / sizeof(crcKernels[0])); k++) {
+        times.count = 0;
+        for (run = 0; run < repeats; run++) {
+            bad = 0;
+            start = rk05Seconds();
+            for (pass = 0; pass < passes; pass++) {
+                bp = sp->data;
+                for (i = 0; i < sp->sectorCount; i++) {
+                    // As verification does: the data and the stored CRC give zero.
+                    bad += crcKernels[k].function(0, bp + 2, sp->sectorSize - 2) != 0;
+                    bp += sp->sectorSize;
+                }
+            }
+            times.seconds[times.count++] = rk05Seconds() - start;
+        }
+        bad /= passes;
+
+        if (expectedBad < 0) {
+            expectedBad = bad;
+        }
+
+        snprintf(name, sizeof(name), "crc16 %s", crcKernels[k].name);
+        snprintf(note, sizeof(note), "%d bad sectors%s", bad, bad != expectedBad ? "  MISMATCH" : "");
+        printRate(name, bytes, &times, note);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Time unpacking every sector to SIMH format and packing
+**                  it again with each kernel.
+**
+**  Parameters:     Name        Description.
+**                  sp          pointer to the sectors of the image
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void benchPackKernels(SectorStore *sp)
+{
+    const Rk05PackKernel *kernels;
+    int count;
+    int k;
+    int run;
+    int pass;
+    int i;
+    int differ;
+    double start;
+    double bytes;
+    u8 *simh;
+    u8 *packed;
+    BenchTimes unpackTimes;
+    BenchTimes packTimes;
+    char name[40];
+
+    if (sp->sectorSize != Rk05SectorSize) {
+        return;
+    }
+
+    simh = (u8 *)malloc((size_t)sp->sectorCount * SimhSectorSize);
+    packed = (u8 *)malloc((size_t)sp->sectorCount * Rk05SectorSize);
+    if (simh == NULL || packed == NULL) {
+        printf("Out of memory\n");
+        free(simh);
+        free(packed);
+        return;
+    }
+
+    count = rk05PackKernels(&kernels);
+    bytes = (double)passes * sp->sectorCount * SimhSectorSize;
+
+    for (k = 0; k < count; k++) {
+        unpackTimes.count = 0;
+        packTimes.count = 0;
+        for (run = 0; run < repeats; run++) {
+            start = rk05Seconds();
+            for (pass = 0; pass < passes; pass++) {
+                for (i = 0; i < sp->sectorCount; i++) {
+                    kernels[k].unpack(simh + i * SimhSectorSize, sp->data + i * Rk05SectorSize + 2, SimhSectorSize / 2);
+                }
+            }
+            unpackTimes.seconds[unpackTimes.count++] = rk05Seconds() - start;
+
+            start = rk05Seconds();
+            for (pass = 0; pass < passes; pass++) {
+                for (i = 0; i < sp->sectorCount; i++) {
+                    kernels[k].pack(packed + i * Rk05SectorSize + 2, simh + i * SimhSectorSize, SimhSectorSize / 2);
+                }
+            }
+            packTimes.seconds[packTimes.count++] = rk05Seconds() - start;
+        }
+
+        differ = 0;
+        for (i = 0; i < sp->sectorCount; i++) {
+            differ += memcmp(packed + i * Rk05SectorSize + 2, sp->data + i * Rk05SectorSize + 2, SimhSectorSize * 3 / 4) != 0;
+        }
+
+        snprintf(name, sizeof(name), "unpack %s", kernels[k].name);
+        printRate(name, bytes, &unpackTimes, "");
+        snprintf(name, sizeof(name), "pack %s", kernels[k].name);
+        printRate(name, bytes, &packTimes, differ != 0 ? "ROUND TRIP MISMATCH" : "");
+    }
+
+    free(simh);
+    free(packed);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Time encoding and decoding the image file header.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void benchHeader(void)
+{
+    static u8 encoded[Rk05HeaderSize];
+    static u8 check[Rk05HeaderSize];
+    const Rk05Geometry *gp;
+    Rk05Header header;
+    Rk05Header decoded;
+    Rk05Status status = Rk05Ok;
+    BenchTimes encodeTimes;
+    BenchTimes decodeTimes;
+    int headers = passes * HeaderPassScale;
+    int run;
+    int i;
+    double start;
+    double bytes;
+
+    gp = rk05GeometryByName("RK8-E");
+    rk05InitHeader(&header);
+    if (gp != NULL) {
+        rk05GeometryHeader(gp, &header);
+    }
+    safecpy(header.imageName, "BENCH", sizeof(header.imageName));
+    safecpy(header.imageDescription, "RK05Bench header serialization", sizeof(header.imageDescription));
+    safecpy(header.imageDate, "2026-10-19", sizeof(header.imageDate));
+
+    printf("\nImage file header: %d headers of %d bytes, %d runs\n", headers, Rk05HeaderSize, repeats);
+    bytes = (double)headers * Rk05HeaderSize;
+    encodeTimes.count = 0;
+    decodeTimes.count = 0;
+
+    for (run = 0; run < repeats; run++) {
+        start = rk05Seconds();
+        for (i = 0; i < headers; i++) {
+            rk05EncodeHeader(encoded, &header);
+        }
+        encodeTimes.seconds[encodeTimes.count++] = rk05Seconds() - start;
+
+        start = rk05Seconds();
+        for (i = 0; i < headers && status == Rk05Ok; i++) {
+            status = rk05DecodeHeader(encoded, Rk05HeaderSize, &decoded);
+        }
+        decodeTimes.seconds[decodeTimes.count++] = rk05Seconds() - start;
+    }
+
+    // The decoded header must encode to the same bytes.
+    rk05EncodeHeader(check, &decoded);
+    printRate("header encode", bytes, &encodeTimes, "");
+    printRate("header decode", bytes, &decodeTimes,
+              status != Rk05Ok ? rk05StatusText(status) : memcmp(check, encoded, Rk05HeaderSize) != 0 ? "ROUND TRIP MISMATCH" : "");
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Time converting a SIMH image into an emulator image in
+**                  memory, verifying every sector of it and converting it
+**                  back, then time the kernels on the converted sectors.
+**
+**  Parameters:     Name        Description.
+**                  filename    SIMH image file name
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void benchSimh(const char *filename)
+{
+    const Rk05Geometry *gp;
+    Rk05Header header;
+    Rk05Image image;
+    Rk05Mapping input;
+    Rk05Status status;
+    SectorStore store;
+    BenchTimes convertTimes;
+    BenchTimes verifyTimes;
+    BenchTimes backTimes;
+    FILE *ifp;
+    FILE *tfp;
+    u8 *simh;
+    u8 *op;
+    size_t simhSize;
+    int run;
+    int pass;
+    int cylinder;
+    int head;
+    int sector;
+    int bad = 0;
+    int differ;
+    double start;
+    char note[40];
+
+    ifp = fopen(filename, "rb");
+    if (ifp == NULL) {
+        printf("%s: %s\n", filename, strerror(errno));
+        return;
+    }
+
+    status = rk05MapFile(ifp, false, 0, &input);
+    if (status != Rk05Ok) {
+        printf("%s: not an emulator image, and as a SIMH image: %s\n", filename, rk05StatusText(status));
+        rk05UnmapFile(ifp, false, &input);
+        fclose(ifp);
+        return;
+    }
+
+    // As RK05Simh2Bin does: the controller whose SIMH image has the input's size, else RK8-E.
+    gp = rk05GeometryBySimhSize(input.size);
+    if (gp == NULL) {
+        gp = rk05GeometryByName("RK8-E");
+    }
+
+    rk05InitHeader(&header);
+    rk05GeometryHeader(gp, &header);
+    tfp = tmpfile();
+    status = tfp != NULL ? rk05CreateStream(&image, tfp, &header) : Rk05ErrOpen;
+    if (status == Rk05Ok) {
+        status = rk05Map(&image);
+    }
+
+    simhSize = (size_t)image.sectorCount * gp->simhSectorSize;
+    simh = (u8 *)malloc(simhSize);
+    if (status != Rk05Ok || simh == NULL) {
+        printf("%s: can't make an image in memory: %s\n", filename, simh == NULL ? "out of memory" : rk05StatusText(status));
+        if (tfp != NULL) {
+            rk05Close(&image);
+        }
+        free(simh);
+        rk05UnmapFile(ifp, false, &input);
+        fclose(ifp);
+        return;
+    }
+
+    printf("\n%s: SIMH %s image of %lu bytes, %d sectors, %d passes, %d runs\n", filename, gp->controller,
+           (unsigned long)input.size, image.sectorCount, passes, repeats);
+    convertTimes.count = 0;
+    verifyTimes.count = 0;
+    backTimes.count = 0;
+
+    for (run = 0; run < repeats; run++) {
+        start = rk05Seconds();
+        for (pass = 0; pass < passes && status == Rk05Ok; pass++) {
+            status = rk05SimhToImage(input.data, input.size, &image);
+        }
+        convertTimes.seconds[convertTimes.count++] = rk05Seconds() - start;
+
+        start = rk05Seconds();
+        for (pass = 0; pass < passes; pass++) {
+            bad = 0;
+            for (cylinder = 0; cylinder < header.numberOfCylinders; cylinder++) {
+                for (head = 0; head < header.numberOfHeads; head++) {
+                    for (sector = 0; sector < header.numberOfSectorsPerTrack; sector++) {
+                        bad += rk05CheckSector(rk05SectorData(&image, cylinder, head, sector), image.sectorSize, cylinder) != 0;
+                    }
+                }
+            }
+        }
+        verifyTimes.seconds[verifyTimes.count++] = rk05Seconds() - start;
+
+        start = rk05Seconds();
+        for (pass = 0; pass < passes; pass++) {
+            op = simh;
+            for (cylinder = 0; cylinder < header.numberOfCylinders; cylinder++) {
+                for (head = 0; head < header.numberOfHeads; head++) {
+                    for (sector = 0; sector < header.numberOfSectorsPerTrack; sector++) {
+                        rk05SectorToSimh(gp, rk05SectorData(&image, cylinder, head, sector), op);
+                        op += gp->simhSectorSize;
+                    }
+                }
+            }
+        }
+        backTimes.seconds[backTimes.count++] = rk05Seconds() - start;
+    }
+
+    // Only the 12 bit words of an RK8-E image come back, the spare high bits of the SIMH words are dropped.
+    differ = gp->wordBits == gp->simhWordBytes * 8
+             && memcmp(simh, input.data, input.size < simhSize ? input.size : simhSize) != 0;
+
+    printRate("simh to image", (double)passes * input.size, &convertTimes, status != Rk05Ok ? rk05StatusText(status) : "");
+    snprintf(note, sizeof(note), "%d bad sectors", bad);
+    printRate("verify image", (double)passes * image.sectorCount * image.sectorSize, &verifyTimes, note);
+    printRate("image to simh", (double)passes * simhSize, &backTimes, differ ? "ROUND TRIP MISMATCH" : "");
+
+    if (status == Rk05Ok && storeImage(&image, filename, &store)) {
+        benchCrcKernels(filename, &store);
+        benchPackKernels(&store);
+        free(store.data);
+    }
+
+    free(simh);
+    rk05Close(&image);
+    rk05UnmapFile(ifp, false, &input);
+    fclose(ifp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Order run times for qsort.
+**
+**  Parameters:     Name        Description.
+**                  a           pointer to first time
+**                  b           pointer to second time
+**
+**  Returns:        <0, 0 or >0 as a is shorter, the same or longer
+**
+**------------------------------------------------------------------------*/
+static int compareSeconds(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print the rate of a measurement from its run times: the
+**                  median run as MB/s and ns/byte, the fastest and slowest
+**                  runs and the standard deviation of the runs.
+**
+**  Parameters:     Name        Description.
+**                  name        measurement name
+**                  bytes       bytes processed in each run
+**                  tp          pointer to run times, sorted on return
+**                  note        text to append, may be empty
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printRate(const char *name, double bytes, BenchTimes *tp, const char *note)
+{
+    double median;
+    double mean = 0.0;
+    double variance = 0.0;
+    int n = tp->count;
+    int i;
+
+    qsort(tp->seconds, n, sizeof(tp->seconds[0]), compareSeconds);
+    median = (n & 1) ? tp->seconds[n / 2] : (tp->seconds[n / 2 - 1] + tp->seconds[n / 2]) / 2;
+
+    for (i = 0; i < n; i++) {
+        mean += tp->seconds[i];
+    }
+    mean /= n;
+    for (i = 0; i < n; i++) {
+        variance += (tp->seconds[i] - mean) * (tp->seconds[i] - mean);
+    }
+    variance = n > 1 ? variance / (n - 1) : 0.0;
+
+    if (bytes <= 0 || median <= 0) {
+        printf("  %-22s too fast to time, raise -p%s%s\n", name, *note ? "  " : "", note);
+        return;
+    }
+
+    printf("  %-22s %9.1f MB/s  %7.3f ns/byte  (%.3f - %.3f, sd %4.1f%%)%s%s\n", name,
+           bytes / median / 1e6, median * 1e9 / bytes,
+           tp->seconds[0] * 1e9 / bytes, tp->seconds[n - 1] * 1e9 / bytes,
+           mean > 0 ? sqrt(variance) * 100.0 / mean : 0.0,
+           *note ? "  " : "", note);
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -7,6 +7,12 @@
 **  Description:
 **      Convert RK05 Emulator disk image to SIMH RK05 disk image.
 **
+**      Either file may be "-" for stdin or stdout. The image is then
+**      converted one sector at a time, reading and writing strictly
+**      forward, so the tool can sit in a pipeline. A conversion aborted
+**      because of a bad sector leaves the sectors before it written.
+**      Otherwise the image is converted in memory and written at once.
+**
 **--------------------------------------------------------------------------
 */
 
@@ -15,7 +21,8 @@
 **  Include Files
 **  -------------
 */
-#include "RK05Util.h"
+#include "RK05Image.h"
+#include "RK05Simh.h"
 
 /*
 **  -----------------
@@ -41,28 +48,20 @@
 **  ---------------------------
 */
 static void printUsage(void);
-static void read_and_convert_disk_image_data(void);
+static int read_and_convert_disk_image_data(Rk05Image *image, const Rk05Geometry *gp, u8 *simh, FILE *ofp);
 
 /*
 **  ----------------
 **  Public Variables
 **  ----------------
 */
-FILE *ifp;
-FILE *ofp;
 
 /*
 **  -----------------
 **  Private Variables
 **  -----------------
 */
-static u8 inBuf[Rk05SectorSize];
-static u8 outBuf[SimhSectorSize];
 static bool stopOnError = true;
-static unsigned int calcCrc;
-static int sectorcount;
-static int headcount;
-static int cylindercount;
 static int sectorErrorCount = 0;
 
 /*
@@ -85,12 +84,22 @@ static int sectorErrorCount = 0;
 **------------------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
+    Rk05Image image;
+    Rk05Status status;
+    const Rk05Geometry *gp;
+    FILE *ifp;
+    FILE *ofp = NULL;
+    u8 *simh = NULL;
+    int sectors;
+    bool overwrite = false;
+    bool streaming;
+
     // Process command line arguments.
     argv += 1;
     argc -= 1;
 
     while (argc > 0) {
-        if (**argv != '-') {
+        if (**argv != '-' || is_stdio(*argv)) {
             break;
         }
 
@@ -98,6 +107,10 @@ int main(int argc, char **argv)
             argv += 1;
             argc -= 1;
             stopOnError = false;
+        } else if (strcmp(*argv, "-y") == 0) {
+            argv += 1;
+            argc -= 1;
+            overwrite = true;
         } else {
             printf("Unknown option %s\n", *argv);
             printUsage();
@@ -108,9 +121,16 @@ int main(int argc, char **argv)
         printUsage();
     }
 
-    // Check if output file exists and prompt for overwrite.
-    if (file_exists(argv[1])) {
+    streaming = is_stdio(argv[0]) || is_stdio(argv[1]);
+
+    // Check if output file exists and prompt for overwrite, stdin can't be asked
+    // if it carries the image.
+    if (!overwrite && !is_stdio(argv[1]) && file_exists(argv[1])) {
        char buf[16];
+       if (is_stdio(argv[0])) {
+           printf("Output file %s already exists - use -y to overwrite\n", argv[1]);
+           exit(1);
+       }
        printf("Output file %s already exists - do you want to overwrite? (y/n): ", argv[1]);
        fgets(buf, sizeof(buf), stdin);
        if (_stricmp(buf, "y\n") != 0){
@@ -118,39 +138,84 @@ int main(int argc, char **argv)
        }
     }
 
-    // Open the input file.
-    ifp = fopen(argv[0],"rb");
+    // Open a streamed output first, this moves the messages off stdout.
+    if (streaming) {
+        ofp = open_file(argv[1], "wb");
+        if (ofp == NULL) {
+            printf("Can't create %s", argv[1]);
+            perror(" ");
+            exit(1);
+        }
+    }
+
+    // Open the input file and read its header.
+    ifp = open_file(argv[0], "rb");
     if (ifp == NULL) {
+        status = Rk05ErrOpen;
+    } else {
+        status = rk05OpenStream(&image, ifp, false);
+    }
+    if (status == Rk05ErrOpen) {
         printf("Can't open %s", argv[0]);
         perror(" ");
         exit(1);
     }
 
-    // Open output file.
-    ofp = fopen(argv[1],"wb");
-    if (ofp == NULL) {
-        printf("Can't create %s", argv[1]);
-        perror(" ");
+    printf("\n");
+    if (status != Rk05Ok) {
+        printf("%s\n", rk05StatusText(status));
         exit(1);
     }
 
-    // Read header and display info.
-    if (verifyImageFileHeader()) {
-        displayImageFileHeader(false);
+    // The sector layout must be one of a known controller.
+    gp = rk05FindGeometry(&image.header);
+    if (gp == NULL) {
+        printf("Unsupported sector size %d bytes for controller %s\n", image.sectorSize, image.header.controller);
+        exit(1);
+    }
 
-        // Do the actual conversion
-        read_and_convert_disk_image_data();
-        if (sectorErrorCount != 0) {
-            printf("%d sectors with errors\n", sectorErrorCount);
-            if (sectorErrorCount >= MaxSectorErrors) {
-                printf("Only the first %d sectors with CRC error have been listed\n", MaxSectorErrors);
-            }
+    // Open output file.
+    if (!streaming) {
+        ofp = fopen(argv[1],"wb");
+        if (ofp == NULL) {
+            printf("Can't create %s", argv[1]);
+            perror(" ");
+            exit(1);
+        }
+    }
+
+    // Display info.
+    rk05DisplayHeader(&image.header, false);
+
+    // Unless streaming, the image is read in memory and the SIMH image built in memory.
+    if (!streaming) {
+        simh = (u8 *)malloc((size_t)image.sectorCount * gp->simhSectorSize);
+        if (simh == NULL || rk05Map(&image) != Rk05Ok) {
+            printf("Can't read %s into memory\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Do the actual conversion and write the SIMH image in one piece if built in memory.
+    sectors = read_and_convert_disk_image_data(&image, gp, simh, ofp);
+    if (simh != NULL && fwrite(simh, gp->simhSectorSize, sectors, ofp) != (size_t)sectors) {
+        printf("Write data error in %s\n", argv[1]);
+        exit(1);
+    }
+    if (sectorErrorCount != 0) {
+        printf("%d sectors with errors\n", sectorErrorCount);
+        if (sectorErrorCount >= MaxSectorErrors) {
+            printf("Only the first %d sectors with CRC error have been listed\n", MaxSectorErrors);
         }
     }
 
     // Cleanup and exit
-    fclose(ifp);
-    fclose(ofp);
+    free(simh);
+    rk05Close(&image);
+    if (fclose(ofp) != 0) {
+        printf("Write data error in %s\n", argv[1]);
+        exit(1);
+    }
     printf("Conversion completed");
     if (sectorErrorCount != 0) {
         printf(", but the original was corrupted");
@@ -181,8 +246,10 @@ static void printUsage(void)
     {
     printf("Usage:\n");
     printf("    RK05Bin2Simh [options] <emulator_image_file> <simh_image_file> \n");
+    printf("    Either file may be - for stdin or stdout.\n");
     printf("Options:\n");
     printf("    -f       Force conversion even if there are sector header or CRC errors.\n");
+    printf("    -y       Overwrite an existing output file without asking.\n");
     exit(1);
     }
 
@@ -190,47 +257,53 @@ static void printUsage(void)
 **  Purpose:        Perform the image conversion.
 **
 **  Parameters:     Name        Description.
+**                  image       RK05 emulator image to convert
+**                  gp          controller geometry of the image
+**                  simh        buffer for the SIMH image if the image is in
+**                              memory, otherwise NULL
+**                  ofp         SIMH image file written sector by sector if
+**                              simh is NULL
 **
-**  Returns:        Nothing
+**  Returns:        number of sectors converted
 **
 **------------------------------------------------------------------------*/
-static void read_and_convert_disk_image_data(void)
+static int read_and_convert_disk_image_data(Rk05Image *image, const Rk05Geometry *gp, u8 *simh, FILE *ofp)
 {
-    int rc;
-    bool zeroPad = false;
-    int i;
-    u8 *ip;
-    u8 *op;
-    u8 tmp;
-    int headerword;
+    u8 inBuf[Rk05MaxSectorSize];
+    u8 outBuf[Rk05MaxSimhSectorSize];
+    int flags;
+    int sectors = 0;
+    const u8 *ip;
+    int sectorcount;
+    int headcount;
+    int cylindercount;
 
     printf("Converting RK05 Emulator image data to SIMH image format\n");
-    for (cylindercount = 0; cylindercount <  numberOfCylinders; cylindercount++){
-        for (headcount = 0; headcount <  numberOfHeads; headcount++){
-            for (sectorcount = 0; sectorcount <  numberOfSectorsPerTrack; sectorcount++){
-                // Read the next RK05 emulator image sector
-                rc = fread(inBuf, 1, Rk05SectorSize, ifp);
-                if (rc < Rk05SectorSize) {
-                    if (ferror(ifp) != 0) {
-                        printf("Read error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                        return;
-                    }
+    for (cylindercount = 0; cylindercount <  image->header.numberOfCylinders; cylindercount++){
+        for (headcount = 0; headcount <  image->header.numberOfHeads; headcount++){
+            for (sectorcount = 0; sectorcount <  image->header.numberOfSectorsPerTrack; sectorcount++){
+                // Find the next RK05 emulator image sector in memory or read it.
+                if (simh != NULL) {
+                    ip = rk05SectorData(image, cylindercount, headcount, sectorcount);
+                } else if (rk05ReadSector(image, cylindercount, headcount, sectorcount, inBuf) == Rk05Ok) {
+                    ip = inBuf;
+                } else {
+                    ip = NULL;
+                }
+                if (ip == NULL) {
+                    printf("Read error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
+                    return sectors;
                 }
 
-                // Check the header word first.
-                headerword = cylindercount << 5;
-                if (   inBuf[0] != ((headerword >> 0) & 0xFF)
-                    || inBuf[1] != ((headerword >> 8) & 0xFF)) {
-
+                // Check the header word and the CRC.
+                flags = rk05CheckSector(ip, gp->sectorSize, cylindercount);
+                if (flags & Rk05SectorHeaderError) {
                     if (sectorErrorCount++ < MaxSectorErrors) {
                         printf("Invalid header word at C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
                     }
                 }
 
-                // Calculate CRC starting with the sector data including the stored CRC.
-                // The result must be zero otherwise the sector has been corrupted.
-                calcCrc = crc16buf(0, inBuf + 2, Rk05SectorSize - 2);
-                if (calcCrc != 0) {
+                if (flags & Rk05SectorCrcError) {
                     if (sectorErrorCount++ < MaxSectorErrors) {
                         printf("Invalid CRC at C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
                     }
@@ -241,36 +314,22 @@ static void read_and_convert_disk_image_data(void)
                     exit(1);
                 }
 
-                // now generate the output buffer skipping the header in the input buffer
-                ip = inBuf + 2;
-                op = outBuf;
-
-                // Convert the RK05 emulator binary format into the SIMH little endian 12 bit zero
-                // padded format. The conversion is illustrated in the following commented code:
-                //
-                //    op[0] = 0x21;       ip[0] = 0x21;
-                //    op[1] = 0x03;  <=   ip[1] = 0x43;
-                //    op[2] = 0x54;       ip[2] = 0x65;
-                //    op[3] = 0x06;
-
-                for (i = 0; i < SimhSectorSize; i += 4) {
-                    *op++ = *ip++;
-                    *op++ = (*ip   >> 0) & 0x0F;
-                    tmp   = (*ip++ >> 4) & 0x0F;
-                    tmp  |= (*ip   << 4) & 0xF0;
-                    *op++ = tmp;
-                    *op++ = (*ip++   >> 4) & 0x0F;
-                }
-
-                // Output to file
-                rc = fwrite(outBuf, 1, op - outBuf, ofp);
-                if (rc != SimhSectorSize) {
-                    printf("Write data error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                    exit(1);
+                // now generate the output sector skipping the header in the input sector
+                if (simh != NULL) {
+                    rk05SectorToSimh(gp, ip, simh + (size_t)sectors * gp->simhSectorSize);
+                } else {
+                    rk05SectorToSimh(gp, ip, outBuf);
+                    if (fwrite(outBuf, 1, gp->simhSectorSize, ofp) != (size_t)gp->simhSectorSize) {
+                        printf("Write data error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
+                        exit(1);
+                    }
                 }
+                sectors++;
             }
         }
     }
+
+    return sectors;
 }
 
 /*---------------------------  End Of File  ------------------------------*/
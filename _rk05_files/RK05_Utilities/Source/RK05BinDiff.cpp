@@ -0,0 +1,419 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05BinDiff.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Compare two RK05 Emulator disk images sector by sector and
+**      optionally write a patch file which RK05BinPatch applies to the
+**      first image to turn it into the second.
+**
+**      Every sector of both images is hashed, sectors with different
+**      hashes are reported as ranges of consecutive sectors.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+#include "RK05Hash.h"
+#include "RK05Patch.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define ExitSame        0
+#define ExitDifferent   1
+#define ExitTrouble     2
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void printUsage(void);
+static void openImage(Rk05Image *image, const char *filename, u64 **hashes);
+static bool sameGeometry(const Rk05Header *a, const Rk05Header *b);
+static bool compareHeaders(const Rk05Header *a, const Rk05Header *b);
+static void compareString(const char *field, const char *a, const char *b, bool *same);
+static void compareInt(const char *field, int a, int b, bool *same);
+static void printRange(const Rk05Image *image, int first, int count);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static bool quiet = false;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Program entry point.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        array of argument strings
+**
+**  Returns:        0 if the images are the same, 1 if they differ, 2 if
+**                  they could not be compared.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    Rk05Image oldImage;
+    Rk05Image newImage;
+    Rk05Patch patch;
+    Rk05Status status;
+    u64 *oldHashes;
+    u64 *newHashes;
+    const char *patchFile = NULL;
+    bool sameHeader;
+    int changed = 0;
+    int ranges = 0;
+    int first;
+    int index;
+    FILE *pfp;
+
+    // Process command line arguments.
+    argv += 1;
+    argc -= 1;
+
+    while (argc > 0) {
+        if (**argv != '-') {
+            break;
+        }
+
+        if (strcmp(*argv, "-p") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'patch file' parameter\n");
+                printUsage();
+            }
+
+            patchFile = *argv;
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-q") == 0) {
+            argv += 1;
+            argc -= 1;
+            quiet = true;
+        } else {
+            printf("Unknown option %s\n", *argv);
+            printUsage();
+            }
+        }
+
+    if (argc != 2) {
+        printUsage();
+    }
+
+    // Open and hash both images.
+    openImage(&oldImage, argv[0], &oldHashes);
+    openImage(&newImage, argv[1], &newHashes);
+
+    if (!sameGeometry(&oldImage.header, &newImage.header)) {
+        printf("The images have different geometries and can't be compared sector by sector\n");
+        exit(ExitTrouble);
+    }
+
+    // Compare the headers.
+    sameHeader = compareHeaders(&oldImage.header, &newImage.header);
+
+    // Compare the sectors and collect runs of changed sectors.
+    rk05InitPatch(&patch, newImage.sectorSize, newImage.sectorCount);
+    patch.baseHash = rk05ImageHash(oldHashes, oldImage.sectorCount);
+    patch.targetHash = rk05ImageHash(newHashes, newImage.sectorCount);
+    if (!sameHeader) {
+        patch.hasHeader = true;
+        rk05EncodeHeader(patch.header, &newImage.header);
+    }
+
+    for (index = 0; index < newImage.sectorCount; index = first + 1) {
+        first = index;
+        if (oldHashes[index] == newHashes[index]) {
+            continue;
+        }
+
+        // Extend the run over all following changed sectors.
+        while (index + 1 < newImage.sectorCount && oldHashes[index + 1] != newHashes[index + 1]) {
+            index++;
+        }
+
+        if (!quiet) {
+            printRange(&newImage, first, index - first + 1);
+        }
+
+        if (patchFile != NULL) {
+            status = rk05AddPatchRun(&patch, &newImage, first, index - first + 1);
+            if (status != Rk05Ok) {
+                printf("Read error in %s: %s\n", argv[1], rk05StatusText(status));
+                exit(ExitTrouble);
+            }
+        }
+
+        changed += index - first + 1;
+        ranges += 1;
+        first = index;
+    }
+
+    if (changed == 0) {
+        printf("No sectors differ");
+    } else {
+        printf("%d of %d sectors differ in %d ranges", changed, newImage.sectorCount, ranges);
+    }
+    printf(sameHeader ? "\n" : ", the image headers differ\n");
+
+    // Write the patch.
+    if (patchFile != NULL) {
+        pfp = fopen(patchFile, "wb");
+        if (pfp == NULL) {
+            printf("Can't create %s", patchFile);
+            perror(" ");
+            exit(ExitTrouble);
+        }
+
+        if (rk05WritePatch(pfp, &patch) != Rk05Ok || fclose(pfp) != 0) {
+            printf("Write error in %s\n", patchFile);
+            exit(ExitTrouble);
+        }
+
+        printf("Patch written to %s\n", patchFile);
+    }
+
+    // Cleanup and exit.
+    rk05FreePatch(&patch);
+    free(oldHashes);
+    free(newHashes);
+    rk05Close(&oldImage);
+    rk05Close(&newImage);
+
+    return changed == 0 && sameHeader ? ExitSame : ExitDifferent;
+}
+
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print short description of command and its parameters.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printUsage(void)
+    {
+    printf("Usage:\n");
+    printf("    RK05BinDiff [options] <old_image_file> <new_image_file>\n");
+    printf("Options:\n");
+    printf("    -p <patch_file>  Write a patch turning the old image into the new one.\n");
+    printf("    -q               Only print the summary.\n");
+    printf("Exit status is 0 if the images are the same, 1 if they differ, 2 on errors.\n");
+    exit(ExitTrouble);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open an image and hash all its sectors, exit on errors.
+**
+**  Parameters:     Name        Description.
+**                  image       pointer to image handle
+**                  filename    image file name
+**                  hashes      returns the array of sector hashes
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void openImage(Rk05Image *image, const char *filename, u64 **hashes)
+{
+    Rk05Status status;
+
+    status = rk05Open(image, filename, false);
+    if (status == Rk05ErrOpen) {
+        printf("Can't open %s", filename);
+        perror(" ");
+        exit(ExitTrouble);
+    }
+
+    if (status != Rk05Ok) {
+        printf("%s: %s\n", filename, rk05StatusText(status));
+        exit(ExitTrouble);
+    }
+
+    // Hash in memory if possible.
+    rk05Map(image);
+
+    *hashes = (u64 *)malloc((size_t)image->sectorCount * sizeof(u64));
+    if (*hashes == NULL) {
+        printf("Out of memory\n");
+        exit(ExitTrouble);
+    }
+
+    status = rk05HashSectors(image, *hashes);
+    if (status != Rk05Ok) {
+        printf("Read error in %s: %s\n", filename, rk05StatusText(status));
+        exit(ExitTrouble);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check if two images have the same layout.
+**
+**  Parameters:     Name        Description.
+**                  a           first header
+**                  b           second header
+**
+**  Returns:        true if sector size and count match
+**
+**------------------------------------------------------------------------*/
+static bool sameGeometry(const Rk05Header *a, const Rk05Header *b)
+{
+    return rk05SectorSize(a) == rk05SectorSize(b)
+        && a->numberOfCylinders == b->numberOfCylinders
+        && a->numberOfHeads == b->numberOfHeads
+        && a->numberOfSectorsPerTrack == b->numberOfSectorsPerTrack;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Compare and report the header fields of two images.
+**
+**  Parameters:     Name        Description.
+**                  a           old header
+**                  b           new header
+**
+**  Returns:        true if all fields are the same
+**
+**------------------------------------------------------------------------*/
+static bool compareHeaders(const Rk05Header *a, const Rk05Header *b)
+{
+    bool same = true;
+
+    compareString("Image Name", a->imageName, b->imageName, &same);
+    compareString("Image Description", a->imageDescription, b->imageDescription, &same);
+    compareString("Image Creation Date & Time", a->imageDate, b->imageDate, &same);
+    compareString("Controller", a->controller, b->controller, &same);
+    compareInt("Bit Rate", a->bitRate, b->bitRate, &same);
+    compareInt("Preamble 1 Length", a->preamble1Length, b->preamble1Length, &same);
+    compareInt("Preamble 2 Length", a->preamble2Length, b->preamble2Length, &same);
+    compareInt("Data Length", a->dataLength, b->dataLength, &same);
+    compareInt("Postamble Length", a->postambleLength, b->postambleLength, &same);
+    compareInt("Microseconds Per Sector", a->microsecondsPerSector, b->microsecondsPerSector, &same);
+
+    return same;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Report a differing string header field.
+**
+**  Parameters:     Name        Description.
+**                  field       field name
+**                  a           old value
+**                  b           new value
+**                  same        cleared if the values differ
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void compareString(const char *field, const char *a, const char *b, bool *same)
+{
+    if (strcmp(a, b) != 0) {
+        *same = false;
+        if (!quiet) {
+            printf("%s: \"%s\" -> \"%s\"\n", field, a, b);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Report a differing numeric header field.
+**
+**  Parameters:     Name        Description.
+**                  field       field name
+**                  a           old value
+**                  b           new value
+**                  same        cleared if the values differ
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void compareInt(const char *field, int a, int b, bool *same)
+{
+    if (a != b) {
+        *same = false;
+        if (!quiet) {
+            printf("%s: %d -> %d\n", field, a, b);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print a range of changed sectors.
+**
+**  Parameters:     Name        Description.
+**                  image       image the sectors belong to
+**                  first       first sector index
+**                  count       number of sectors
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printRange(const Rk05Image *image, int first, int count)
+{
+    const Rk05Header *hp = &image->header;
+    int last = first + count - 1;
+    int firstTrack = first / hp->numberOfSectorsPerTrack;
+    int lastTrack = last / hp->numberOfSectorsPerTrack;
+
+    if (count == 1) {
+        printf("Sector differs at C:%d, H:%d, S:%d\n", firstTrack / hp->numberOfHeads,
+               firstTrack % hp->numberOfHeads, first % hp->numberOfSectorsPerTrack);
+        return;
+    }
+
+    printf("Sectors differ from C:%d, H:%d, S:%d to C:%d, H:%d, S:%d (%d sectors)\n",
+           firstTrack / hp->numberOfHeads, firstTrack % hp->numberOfHeads, first % hp->numberOfSectorsPerTrack,
+           lastTrack / hp->numberOfHeads, lastTrack % hp->numberOfHeads, last % hp->numberOfSectorsPerTrack,
+           count);
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -7,6 +7,13 @@
 **  Description:
 **      Display RK05 Emulator image information.
 **
+**      Sector verification is split across threads by cylinder when the
+**      image can be brought into memory. The results are collected per
+**      sector and listed in order afterwards, so the output does not
+**      depend on the number of threads. They may also be written as a
+**      JSON or CSV report, and bad header words and CRCs may be
+**      recomputed in place.
+**
 **--------------------------------------------------------------------------
 */
 
@@ -15,12 +22,16 @@
 **  Include Files
 **  -------------
 */
-#include "RK05Util.h"
+#include "RK05Image.h"
+#include "RK05Thread.h"
+
 /*
 **  -----------------
 **  Private Constants
 **  -----------------
 */
+#define SectorUnreadable    0x40    // beyond the end of the file
+#define SectorRepaired      0x80    // header word and CRC rewritten
 
 /*
 **  -----------------------
@@ -33,6 +44,13 @@
 **  Private Typedef and Structure Definitions
 **  -----------------------------------------
 */
+typedef struct sectorResult
+    {
+    u8 flags;                   // Rk05SectorHeaderError, Rk05SectorCrcError and the above
+    u16 headerWord;             // as found, before any repair
+    u16 crc;                    // as found, before any repair
+    u16 expectedCrc;            // CRC of the sector data
+    } SectorResult;
 
 /*
 **  ---------------------------
@@ -40,29 +58,37 @@
 **  ---------------------------
 */
 static void printUsage(void);
-static void verifyDiskImageData(void);
+static void verifyDiskImageData(Rk05Image *image);
+static void verifyCylinder(void *context, int cylinder, int worker);
+static bool verifySector(void *context, int cylinder, int head, int sector, const u8 *buf);
+static void checkSector(Rk05Image *image, int index, int cylinder, u8 *buf, bool writable);
+static void listErrors(Rk05Image *image);
+static const char *errorName(int flags);
+static void writeReport(Rk05Image *image, const char *filename, bool json);
+static void writeJsonString(FILE *fp, const char *str);
 
 /*
 **  ----------------
 **  Public Variables
 **  ----------------
 */
-FILE *ifp;
-FILE *ofp;
 
 /*
 **  -----------------
 **  Private Variables
 **  -----------------
 */
-static u8 inBuf[Rk05SectorSize];
 static bool verifySectors = false;
 static bool longInfo = false;
-static unsigned int calcCrc;
-static int sectorcount;
-static int headcount;
-static int cylindercount;
+static bool repair = false;
+static int threads = 0;
+static const char *imageName = NULL;
+static const char *jsonFile = NULL;
+static const char *csvFile = NULL;
+static SectorResult *results = NULL;
 static int sectorErrorCount = 0;
+static int sectorsVerified = 0;
+static int sectorsRepaired = 0;
 
 /*
 **--------------------------------------------------------------------------
@@ -84,6 +110,9 @@ static int sectorErrorCount = 0;
 **------------------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
+    Rk05Image image;
+    Rk05Status status;
+
     // Process command line arguments.
     argv += 1;
     argc -= 1;
@@ -101,6 +130,43 @@ int main(int argc, char **argv)
             argv += 1;
             argc -= 1;
             longInfo = true;
+        } else if (strcmp(*argv, "-j") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'threads' parameter\n");
+                printUsage();
+            }
+
+            threads = atoi(*argv);
+            if (threads < 1 || threads > Rk05MaxThreads) {
+                printf("Threads must be 1 to %d\n", Rk05MaxThreads);
+                printUsage();
+            }
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-json") == 0 || strcmp(*argv, "-csv") == 0) {
+            if (argc < 2) {
+                printf("Missing 'report file' parameter\n");
+                printUsage();
+            }
+
+            if (strcmp(*argv, "-json") == 0) {
+                jsonFile = argv[1];
+            } else {
+                csvFile = argv[1];
+            }
+
+            argv += 2;
+            argc -= 2;
+            verifySectors = true;
+        } else if (strcmp(*argv, "--repair") == 0) {
+            argv += 1;
+            argc -= 1;
+            repair = true;
+            verifySectors = true;
         } else {
             printf("Unknown option %s\n", *argv);
             printUsage();
@@ -111,32 +177,63 @@ int main(int argc, char **argv)
         printUsage();
     }
 
-    // Open the input file.
-    ifp = fopen(argv[0], "rb");
-    if (ifp == NULL) {
+    if (threads == 0) {
+        threads = rk05CpuCount();
+    }
+
+    // Open the input file and read its header, for update if repairing.
+    imageName = argv[0];
+    status = rk05Open(&image, argv[0], repair);
+    if (status == Rk05ErrOpen) {
         printf("can't open %s\n", argv[0]);
         perror(" ");
         exit(1);
     }
 
-    // Read, verify and display requested info.
-    if (verifyImageFileHeader()) {
-        displayImageFileHeader(longInfo);
-        if (verifySectors) {
-            verifyDiskImageData();
-            if (sectorErrorCount == 0) {
-                printf("Disk image is clean - no errors found\n");
-            } else {
-                printf("%d sectors with errors\n", sectorErrorCount);
-                if (sectorErrorCount >= MaxSectorErrors) {
-                    printf("Only the first %d sectors with CRC error have been listed\n", MaxSectorErrors);
-                }
+    printf("\n");
+    if (status != Rk05Ok) {
+        printf("%s\n\n", rk05StatusText(status));
+        exit(1);
+    }
+
+    // Verify and display requested info.
+    rk05DisplayHeader(&image.header, longInfo);
+    if (verifySectors) {
+        // Verify in memory if possible, the sectors are not copied.
+        if (rk05Map(&image) != Rk05Ok && repair) {
+            printf("Can't bring %s into memory for repair\n\n", argv[0]);
+            exit(1);
+        }
+
+        verifyDiskImageData(&image);
+        if (sectorErrorCount == 0) {
+            printf("Disk image is clean - no errors found\n");
+        } else {
+            printf("%d sectors with errors\n", sectorErrorCount);
+            if (sectorErrorCount >= MaxSectorErrors) {
+                printf("Only the first %d sectors with CRC error have been listed\n", MaxSectorErrors);
             }
         }
+
+        if (repair) {
+            printf("%d sectors repaired\n", sectorsRepaired);
+        }
+
+        if (jsonFile != NULL) {
+            writeReport(&image, jsonFile, true);
+        }
+
+        if (csvFile != NULL) {
+            writeReport(&image, csvFile, false);
+        }
     }
 
-    // Cleanup and exit.
-    fclose(ifp);
+    // Cleanup and exit, repairs are written back here.
+    if (rk05Close(&image) != Rk05Ok) {
+        printf("Write error in %s\n", argv[0]);
+        exit(1);
+    }
+    free(results);
     printf("\n");
     return 0;
 }
@@ -163,63 +260,356 @@ static void printUsage(void)
     printf("\nUsage:\n");
     printf("    RK05BinInfo [options] <emulator_image_file>\n");
     printf("Options:\n");
-    printf("    -l       Detailed output.\n");
-    printf("    -v       Verify CRC of all sectors.\n");
+    printf("    -l              Detailed output.\n");
+    printf("    -v              Verify CRC of all sectors.\n");
+    printf("    -j <threads>    Verify threads (default one per processor).\n");
+    printf("    -json <file>    Write a JSON report of the sector errors, implies -v.\n");
+    printf("    -csv <file>     Write a CSV report of the sector errors, implies -v.\n");
+    printf("    --repair        Rewrite bad header words and CRCs, implies -v.\n");
     printf("\n");
     exit(1);
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Verify the header word and CRC of all sectors.
+**  Purpose:        Verify the header word and CRC of all sectors and list
+**                  the errors.
 **
 **  Parameters:     Name        Description.
+**                  image       image to verify
 **
 **  Returns:        Nothing
 **
 **------------------------------------------------------------------------*/
-static void verifyDiskImageData(void)
+static void verifyDiskImageData(Rk05Image *image)
 {
-    int rc;
-    int bytecount = dataLength / 8;
-    int sectorcount;
-    int headcount;
-    int cylindercount;
-    int headerword;
+    int cylinder;
+    int index;
 
     printf("\nVerifying sector headers and CRCs:\n");
-    for (cylindercount = 0; cylindercount <  numberOfCylinders; cylindercount++){
-        for (headcount = 0; headcount <  numberOfHeads; headcount++){
-            for (sectorcount = 0; sectorcount <  numberOfSectorsPerTrack; sectorcount++){
-                // Read the next RK05 emulator image sector.
-                rc = fread(inBuf, 1, Rk05SectorSize, ifp);
-                if (rc < Rk05SectorSize) {
-                    if (ferror(ifp) != 0) {
-                        printf("Read error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                        return;
-                    }
-                }
-
-                // Check the header word first.
-                headerword = cylindercount << 5;
-                if (   inBuf[0] != ((headerword >> 0) & 0xFF)
-                    || inBuf[1] != ((headerword >> 8) & 0xFF)) {
-
-                    if (sectorErrorCount++ < MaxSectorErrors) {
-                        printf("Invalid header word at C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                    }
-                }
-
-                // Calculate CRC starting with the sector data including the stored CRC.
-                // The result must be zero otherwise the sector has been corrupted.
-                calcCrc = crc16buf(0, inBuf + 2, Rk05SectorSize - 2);
-                if (calcCrc != 0) {
-                    if (sectorErrorCount++ < MaxSectorErrors) {
-                        printf("Invalid CRC at C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                    }
-                }
+
+    results = (SectorResult *)calloc(image->sectorCount, sizeof(SectorResult));
+    if (results == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    if (image->map.data != NULL) {
+        // Each cylinder is a job, the pool deals them out to the threads in ranges.
+        if (!rk05RunPool(image->header.numberOfCylinders, threads, verifyCylinder, image, NULL)) {
+            for (cylinder = 0; cylinder < image->header.numberOfCylinders; cylinder++) {
+                verifyCylinder(image, cylinder, 0);
             }
         }
+    } else {
+        // Read through stdio one sector after the other, stop at the first read error.
+        if (rk05ForEachSector(image, verifySector, image) != Rk05Ok) {
+            for (index = sectorsVerified; index < image->sectorCount; index++) {
+                results[index].flags = SectorUnreadable;
+            }
+        }
+    }
+
+    listErrors(image);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pool job, verify and optionally repair all sectors of
+**                  one cylinder in memory.
+**
+**  Parameters:     Name        Description.
+**                  context     image being verified
+**                  cylinder    cylinder address
+**                  worker      worker number
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void verifyCylinder(void *context, int cylinder, int worker)
+{
+    Rk05Image *image = (Rk05Image *)context;
+    int head;
+    int sector;
+    int index;
+    u8 *buf;
+
+    (void)worker;
+
+    for (head = 0; head < image->header.numberOfHeads; head++) {
+        for (sector = 0; sector < image->header.numberOfSectorsPerTrack; sector++) {
+            index = rk05SectorIndex(image, cylinder, head, sector);
+            buf = rk05SectorData(image, cylinder, head, sector);
+            if (buf == NULL) {
+                results[index].flags = SectorUnreadable;
+            } else {
+                checkSector(image, index, cylinder, buf, image->writable);
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        rk05ForEachSector callback, verify one sector read
+**                  through stdio.
+**
+**  Parameters:     Name        Description.
+**                  context     image being verified
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         sector read from the image
+**
+**  Returns:        true to continue with the next sector
+**
+**------------------------------------------------------------------------*/
+static bool verifySector(void *context, int cylinder, int head, int sector, const u8 *buf)
+{
+    Rk05Image *image = (Rk05Image *)context;
+
+    checkSector(image, rk05SectorIndex(image, cylinder, head, sector), cylinder, (u8 *)buf, false);
+    sectorsVerified++;
+    return true;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Verify the header word and CRC of one sector, record
+**                  the result and repair the sector if requested.
+**
+**  Parameters:     Name        Description.
+**                  image       image being verified
+**                  index       sector index
+**                  cylinder    cylinder address
+**                  buf         sector contents
+**                  writable    true if buf may be written
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void checkSector(Rk05Image *image, int index, int cylinder, u8 *buf, bool writable)
+{
+    SectorResult *rp = &results[index];
+    int size = image->sectorSize;
+
+    rp->flags = (u8)rk05CheckSector(buf, size, cylinder);
+    if (rp->flags == 0) {
+        return;
+    }
+
+    rp->headerWord = (u16)(buf[0] | (buf[1] << 8));
+    rp->crc = (u16)(buf[size - 2] | (buf[size - 1] << 8));
+    rp->expectedCrc = crc16buf(0, buf + 2, size - 4);
+
+    if (repair && writable) {
+        rk05FormatSector(buf, size, cylinder);
+        rp->flags |= SectorRepaired;
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        List the sector errors in sector order.
+**
+**  Parameters:     Name        Description.
+**                  image       image which has been verified
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void listErrors(Rk05Image *image)
+{
+    Rk05Header *hp = &image->header;
+    int index;
+    int track;
+    int cylinder;
+    int head;
+    int sector;
+    int flags;
+
+    for (index = 0; index < image->sectorCount; index++) {
+        flags = results[index].flags;
+        if (flags == 0) {
+            continue;
+        }
+
+        track = index / hp->numberOfSectorsPerTrack;
+        cylinder = track / hp->numberOfHeads;
+        head = track % hp->numberOfHeads;
+        sector = index % hp->numberOfSectorsPerTrack;
+
+        if (flags & SectorUnreadable) {
+            // The rest of the file is missing.
+            printf("Read error C:%d, H:%d, S:%d\n", cylinder, head, sector);
+            break;
+        }
+
+        if (flags & Rk05SectorHeaderError) {
+            if (sectorErrorCount++ < MaxSectorErrors) {
+                printf("Invalid header word at C:%d, H:%d, S:%d\n", cylinder, head, sector);
+            }
+        }
+
+        if (flags & Rk05SectorCrcError) {
+            if (sectorErrorCount++ < MaxSectorErrors) {
+                printf("Invalid CRC at C:%d, H:%d, S:%d\n", cylinder, head, sector);
+            }
+        }
+
+        if (flags & SectorRepaired) {
+            sectorsRepaired++;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Name the errors of a sector for the reports.
+**
+**  Parameters:     Name        Description.
+**                  flags       sector result flags
+**
+**  Returns:        error name
+**
+**------------------------------------------------------------------------*/
+static const char *errorName(int flags)
+{
+    if (flags & SectorUnreadable) {
+        return "unreadable";
+    }
+
+    switch (flags & (Rk05SectorHeaderError | Rk05SectorCrcError)) {
+    case Rk05SectorHeaderError:
+        return "header";
+
+    case Rk05SectorCrcError:
+        return "crc";
+
+    default:
+        return "header+crc";
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the sector errors as a JSON or CSV report. Every
+**                  sector with an error is listed, not only the first
+**                  MaxSectorErrors.
+**
+**  Parameters:     Name        Description.
+**                  image       image which has been verified
+**                  filename    report file name
+**                  json        true for JSON, false for CSV
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void writeReport(Rk05Image *image, const char *filename, bool json)
+{
+    Rk05Header *hp = &image->header;
+    SectorResult *rp;
+    FILE *fp;
+    int errors = 0;
+    int repaired = 0;
+    int unreadable = 0;
+    int index;
+    int track;
+    bool first = true;
+
+    fp = fopen(filename, "w");
+    if (fp == NULL) {
+        printf("Can't create %s", filename);
+        perror(" ");
+        exit(1);
+    }
+
+    for (index = 0; index < image->sectorCount; index++) {
+        if (results[index].flags & SectorUnreadable) {
+            unreadable++;
+        } else if (results[index].flags != 0) {
+            errors++;
+        }
+        if (results[index].flags & SectorRepaired) {
+            repaired++;
+        }
+    }
+
+    if (json) {
+        fprintf(fp, "{\n");
+        fprintf(fp, "  \"image\": ");
+        writeJsonString(fp, imageName);
+        fprintf(fp, ",\n");
+        fprintf(fp, "  \"controller\": ");
+        writeJsonString(fp, hp->controller);
+        fprintf(fp, ",\n");
+        fprintf(fp, "  \"cylinders\": %d,\n", hp->numberOfCylinders);
+        fprintf(fp, "  \"heads\": %d,\n", hp->numberOfHeads);
+        fprintf(fp, "  \"sectorsPerTrack\": %d,\n", hp->numberOfSectorsPerTrack);
+        fprintf(fp, "  \"sectors\": %d,\n", image->sectorCount);
+        fprintf(fp, "  \"sectorsWithErrors\": %d,\n", errors);
+        fprintf(fp, "  \"sectorsUnreadable\": %d,\n", unreadable);
+        fprintf(fp, "  \"sectorsRepaired\": %d,\n", repaired);
+        fprintf(fp, "  \"errors\": [");
+    } else {
+        fprintf(fp, "cylinder,head,sector,error,header_word,expected_header_word,crc,expected_crc,repaired\n");
+    }
+
+    for (index = 0; index < image->sectorCount; index++) {
+        rp = &results[index];
+        if (rp->flags == 0) {
+            continue;
+        }
+
+        track = index / hp->numberOfSectorsPerTrack;
+        if (json) {
+            fprintf(fp, "%s\n    {\"cylinder\": %d, \"head\": %d, \"sector\": %d, \"error\": \"%s\"",
+                    first ? "" : ",", track / hp->numberOfHeads, track % hp->numberOfHeads,
+                    index % hp->numberOfSectorsPerTrack, errorName(rp->flags));
+            if ((rp->flags & SectorUnreadable) == 0) {
+                fprintf(fp, ", \"headerWord\": %u, \"expectedHeaderWord\": %u, \"crc\": %u, \"expectedCrc\": %u",
+                        rp->headerWord, (track / hp->numberOfHeads) << 5, rp->crc, rp->expectedCrc);
+            }
+            fprintf(fp, ", \"repaired\": %s}", (rp->flags & SectorRepaired) ? "true" : "false");
+        } else if (rp->flags & SectorUnreadable) {
+            fprintf(fp, "%d,%d,%d,%s,,,,,0\n", track / hp->numberOfHeads, track % hp->numberOfHeads,
+                    index % hp->numberOfSectorsPerTrack, errorName(rp->flags));
+        } else {
+            fprintf(fp, "%d,%d,%d,%s,%u,%u,%u,%u,%d\n", track / hp->numberOfHeads, track % hp->numberOfHeads,
+                    index % hp->numberOfSectorsPerTrack, errorName(rp->flags), rp->headerWord,
+                    (track / hp->numberOfHeads) << 5, rp->crc, rp->expectedCrc, (rp->flags & SectorRepaired) ? 1 : 0);
+        }
+        first = false;
+    }
+
+    if (json) {
+        fprintf(fp, "%s]\n}\n", first ? "" : "\n  ");
+    }
+
+    if (fclose(fp) != 0) {
+        printf("Write error in %s\n", filename);
+        exit(1);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a string as a quoted JSON string.
+**
+**  Parameters:     Name        Description.
+**                  fp          report file
+**                  str         string to write
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void writeJsonString(FILE *fp, const char *str)
+{
+    const unsigned char *cp;
+
+    fputc('"', fp);
+    for (cp = (const unsigned char *)str; *cp != '\0'; cp++) {
+        if (*cp == '"' || *cp == '\\') {
+            fprintf(fp, "\\%c", *cp);
+        } else if (*cp < 0x20) {
+            fprintf(fp, "\\u%04x", *cp);
+        } else {
+            fputc(*cp, fp);
+        }
     }
+    fputc('"', fp);
 }
 
 /*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,302 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05BinPatch.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Apply a patch file made by RK05BinDiff to an RK05 Emulator disk
+**      image in place.
+**
+**      Before anything is written the image must hash to the base image
+**      of the patch, and the image as it will be after patching must
+**      hash to the target image of the patch.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+#include "RK05Hash.h"
+#include "RK05Patch.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void printUsage(void);
+static Rk05Status applyPatch(Rk05Image *image, const Rk05Patch *patch);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Program entry point.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        array of argument strings
+**
+**  Returns:        0 if normal termination, non-zero otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    Rk05Header newHeader;
+    u8 header[Rk05HeaderSize];
+    Rk05Image image;
+    Rk05Patch patch;
+    Rk05Status status;
+    u64 *hashes;
+    bool checkOnly = false;
+    bool force = false;
+    int sectors = 0;
+    int i;
+    int j;
+    FILE *pfp;
+
+    // Process command line arguments.
+    argv += 1;
+    argc -= 1;
+
+    while (argc > 0) {
+        if (**argv != '-') {
+            break;
+        }
+
+        if (strcmp(*argv, "-n") == 0) {
+            argv += 1;
+            argc -= 1;
+            checkOnly = true;
+        } else if (strcmp(*argv, "-f") == 0) {
+            argv += 1;
+            argc -= 1;
+            force = true;
+        } else {
+            printf("Unknown option %s\n", *argv);
+            printUsage();
+            }
+        }
+
+    if (argc != 2) {
+        printUsage();
+    }
+
+    // Read the patch.
+    pfp = fopen(argv[1], "rb");
+    if (pfp == NULL) {
+        printf("Can't open %s", argv[1]);
+        perror(" ");
+        exit(1);
+    }
+
+    status = rk05ReadPatch(pfp, &patch);
+    fclose(pfp);
+    if (status != Rk05Ok) {
+        printf("Invalid patch file %s: %s\n", argv[1], rk05StatusText(status));
+        exit(1);
+    }
+
+    if (patch.hasHeader) {
+        status = rk05DecodeHeader(patch.header, Rk05HeaderSize, &newHeader);
+        if (status != Rk05Ok || rk05SectorSize(&newHeader) != patch.sectorSize) {
+            printf("Invalid patch file %s: %s\n", argv[1], rk05StatusText(status != Rk05Ok ? status : Rk05ErrGeometry));
+            exit(1);
+        }
+    }
+
+    // Open the image for update and hash it.
+    status = rk05Open(&image, argv[0], !checkOnly);
+    if (status == Rk05ErrOpen) {
+        printf("Can't open %s", argv[0]);
+        perror(" ");
+        exit(1);
+    }
+
+    if (status != Rk05Ok) {
+        printf("%s: %s\n", argv[0], rk05StatusText(status));
+        exit(1);
+    }
+
+    if (image.sectorSize != patch.sectorSize || image.sectorCount != patch.sectorCount) {
+        printf("The patch is for a different disk geometry\n");
+        exit(1);
+    }
+
+    rk05Map(&image);
+    hashes = (u64 *)malloc((size_t)image.sectorCount * sizeof(u64));
+    if (hashes == NULL) {
+        printf("Out of memory\n");
+        exit(1);
+    }
+
+    status = rk05HashSectors(&image, hashes);
+    if (status != Rk05Ok) {
+        printf("Read error in %s: %s\n", argv[0], rk05StatusText(status));
+        exit(1);
+    }
+
+    // The image must be the one the patch was made from.
+    rk05EncodeHeader(header, &image.header);
+    if (rk05ImageHash(hashes, image.sectorCount) == patch.targetHash
+        && (!patch.hasHeader || memcmp(header, patch.header, Rk05HeaderSize) == 0)) {
+        printf("The patch has already been applied\n");
+        exit(0);
+    }
+
+    if (rk05ImageHash(hashes, image.sectorCount) != patch.baseHash) {
+        if (!force) {
+            printf("The image is not the one the patch was made from, use -f to apply anyway\n");
+            exit(1);
+        }
+        printf("The image is not the one the patch was made from, applying anyway\n");
+    }
+
+    // The patched image must be the one the patch was made for.
+    for (i = 0; i < patch.runCount; i++) {
+        for (j = 0; j < patch.runs[i].count; j++) {
+            hashes[patch.runs[i].first + j] = rk05Hash64(patch.runs[i].data + (size_t)j * patch.sectorSize,
+                                                         patch.sectorSize, 0);
+        }
+        sectors += patch.runs[i].count;
+    }
+
+    if (rk05ImageHash(hashes, image.sectorCount) != patch.targetHash && !force) {
+        printf("The patched image would not match the patch target\n");
+        exit(1);
+    }
+
+    if (checkOnly) {
+        printf("The patch applies, %d sectors in %d runs%s\n", sectors, patch.runCount,
+               patch.hasHeader ? " and the image header" : "");
+        exit(0);
+    }
+
+    // Write the sectors and the header.
+    status = applyPatch(&image, &patch);
+    if (status == Rk05Ok && patch.hasHeader) {
+        image.header = newHeader;
+        status = rk05UpdateHeader(&image);
+    }
+
+    if (rk05Close(&image) != Rk05Ok && status == Rk05Ok) {
+        status = Rk05ErrIo;
+    }
+
+    if (status != Rk05Ok) {
+        printf("Write error in %s: %s\n", argv[0], rk05StatusText(status));
+        exit(1);
+    }
+
+    printf("Patched %d sectors in %d runs%s\n", sectors, patch.runCount,
+           patch.hasHeader ? " and the image header" : "");
+
+    // Cleanup and exit.
+    rk05FreePatch(&patch);
+    free(hashes);
+    return 0;
+}
+
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print short description of command and its parameters.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printUsage(void)
+    {
+    printf("Usage:\n");
+    printf("    RK05BinPatch [options] <emulator_image_file> <patch_file>\n");
+    printf("Options:\n");
+    printf("    -n       Only check that the patch applies, change nothing.\n");
+    printf("    -f       Apply even if the image is not the one the patch was made from.\n");
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the sectors of a patch into an image.
+**
+**  Parameters:     Name        Description.
+**                  image       image open for update
+**                  patch       patch to apply
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status applyPatch(Rk05Image *image, const Rk05Patch *patch)
+{
+    const Rk05Header *hp = &image->header;
+    Rk05Status status;
+    int index;
+    int track;
+    int i;
+    int j;
+
+    for (i = 0; i < patch->runCount; i++) {
+        for (j = 0; j < patch->runs[i].count; j++) {
+            index = patch->runs[i].first + j;
+            track = index / hp->numberOfSectorsPerTrack;
+            status = rk05WriteSector(image, track / hp->numberOfHeads, track % hp->numberOfHeads,
+                                     index % hp->numberOfSectorsPerTrack,
+                                     patch->runs[i].data + (size_t)j * patch->sectorSize);
+            if (status != Rk05Ok) {
+                return status;
+            }
+        }
+    }
+
+    return Rk05Ok;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
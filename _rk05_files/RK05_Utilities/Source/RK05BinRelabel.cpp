@@ -16,7 +16,7 @@
 **  Include Files
 **  -------------
 */
-#include "RK05Util.h"
+#include "RK05Image.h"
 
 /*
 **  -----------------
@@ -42,15 +42,12 @@
 **  ---------------------------
 */
 static void printUsage(void);
-static void read_and_convert_disk_image_data(void);
 
 /*
 **  ----------------
 **  Public Variables
 **  ----------------
 */
-FILE *ifp;
-FILE *ofp;
 
 /*
 **  -----------------
@@ -84,6 +81,9 @@ static char newDate[20] = "";
 **------------------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
+    Rk05Image image;
+    Rk05Status status;
+
     // Process command line arguments.
     argv += 1;
     argc -= 1;
@@ -136,9 +136,9 @@ int main(int argc, char **argv)
         exit(1);
     }
 
-    // Open the input file in read/write mode.
-    ofp = ifp = fopen(argv[0],"rb+");
-    if (ifp == NULL) {
+    // Open the input file in read/write mode and read its header.
+    status = rk05Open(&image, argv[0], true);
+    if (status == Rk05ErrOpen) {
         printf("Can't open %s", argv[0]);
         perror(" ");
         exit(1);
@@ -153,40 +153,38 @@ int main(int argc, char **argv)
 
     strftime(newDate, sizeof(newDate), "%Y-%m-%d %H:%M:%S", tm_info);
 
-    // Read, verify and display requested info.
-    if (verifyImageFileHeader()) {
-        printf("Old settings:\n");
-        displayImageFileHeader(false);
+    printf("\n");
+    if (status != Rk05Ok) {
+        printf("%s\n", rk05StatusText(status));
+        exit(1);
+    }
 
-        // Update header variables.
-        if (setName) {
-            safecpy(imageName, newName, sizeof(imageName));
-        }
+    // Display the old settings.
+    printf("Old settings:\n");
+    rk05DisplayHeader(&image.header, false);
 
-        if (setDescription) {
-            safecpy(imageDescription, newDescription, sizeof(imageDescription));
-        }
+    // Update header variables.
+    if (setName) {
+        safecpy(image.header.imageName, newName, sizeof(image.header.imageName));
+    }
 
-        safecpy(imageDate, newDate, sizeof(imageDate));
+    if (setDescription) {
+        safecpy(image.header.imageDescription, newDescription, sizeof(image.header.imageDescription));
+    }
 
-        printf("\nNew settings:\n");
-        displayImageFileHeader(false);
+    safecpy(image.header.imageDate, newDate, sizeof(image.header.imageDate));
 
-        // Rewind image file positon and write the image file header.
-        if (fseek(ofp, 0, SEEK_SET) != 0) {
-            printf("File positioning error in %s", argv[0]);
-            perror(" ");
-            exit(1);
-        }
+    printf("\nNew settings:\n");
+    rk05DisplayHeader(&image.header, false);
 
-        if (!write_image_file_header()) {
-            printf("Failed to write image header\n");
-            exit(1);
-        }
+    // Write the image file header.
+    printf("Writing image header\n");
+    if (rk05UpdateHeader(&image) != Rk05Ok || rk05Close(&image) != Rk05Ok) {
+        printf("Failed to write image header\n");
+        exit(1);
     }
 
     // Cleanup and exit
-    fclose(ifp);
     printf("Relabelling completed\n");
     return 0;
 }
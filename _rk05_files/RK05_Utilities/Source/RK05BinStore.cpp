@@ -0,0 +1,429 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05BinStore.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Keep a library of RK05 Emulator disk images in a deduplicating
+**      store, see RK05Store.h, and rebuild any of them on demand.
+**
+**      Images which share their system areas, or which are mostly
+**      zeroed, take up little more room than the sectors in which they
+**      differ.
+**
+**      The store directory holds sectors.dat, the distinct sectors,
+**      index.dat, their hash table, one <name>.rki recipe per image and
+**      catalog.txt, the image names in the order they were first added,
+**      which list walks. add appends a name to catalog.txt the first
+**      time it is stored, adding it again only replaces its recipe.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+#include "RK05Store.h"
+#include "RK05Thread.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define OneMegabyte         (1024.0 * 1024.0)
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void printUsage(void);
+static void openStore(Rk05Store *store, const char *dir, bool create);
+static void closeStore(Rk05Store *store);
+static int addImages(Rk05Store *store, int count, char **files);
+static int getImage(Rk05Store *store, const char *name, const char *output);
+static int listImages(Rk05Store *store);
+static u64 fileSize(const char *path);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static bool quiet = false;
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Program entry point.
+**
+**  Parameters:     Name        Description.
+**                  argc        argument count
+**                  argv        array of argument strings
+**
+**  Returns:        0 if normal termination, non-zero otherwise.
+**
+**------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    Rk05Store store;
+    int rc;
+
+    // Process command line arguments.
+    argv += 1;
+    argc -= 1;
+
+    while (argc > 0) {
+        if (**argv != '-') {
+            break;
+        }
+
+        if (strcmp(*argv, "-q") == 0) {
+            argv += 1;
+            argc -= 1;
+            quiet = true;
+        } else {
+            printf("Unknown option %s\n", *argv);
+            printUsage();
+            }
+        }
+
+    if (argc < 2) {
+        printUsage();
+    }
+
+    if (strcmp(argv[1], "add") == 0 && argc >= 3) {
+        openStore(&store, argv[0], true);
+        rc = addImages(&store, argc - 2, argv + 2);
+    } else if (strcmp(argv[1], "get") == 0 && argc == 4) {
+        openStore(&store, argv[0], false);
+        rc = getImage(&store, argv[2], argv[3]);
+    } else if (strcmp(argv[1], "list") == 0 && argc == 2) {
+        openStore(&store, argv[0], false);
+        rc = listImages(&store);
+    } else {
+        printUsage();
+        return 1;
+    }
+
+    closeStore(&store);
+    return rc;
+}
+
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Print short description of command and its parameters.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void printUsage(void)
+    {
+    printf("Usage:\n");
+    printf("    RK05BinStore [options] <store_dir> add <emulator_image_file>...\n");
+    printf("    RK05BinStore [options] <store_dir> get <name> <emulator_image_file>\n");
+    printf("    RK05BinStore [options] <store_dir> list\n");
+    printf("Options:\n");
+    printf("    -q       Only print the totals.\n");
+    printf("Images are stored under their file name without directory and extension.\n");
+    printf("The store directory holds sectors.dat (the distinct sectors), index.dat\n");
+    printf("(their hash table), a <name>.rki recipe per image and catalog.txt (the\n");
+    printf("image names, one per line, in the order list shows them).\n");
+    printf("An image file of - is standard output.\n");
+    exit(1);
+    }
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open the store, exit on errors.
+**
+**  Parameters:     Name        Description.
+**                  store       pointer to store handle
+**                  dir         store directory
+**                  create      true to create the store and open it for
+**                              adding images
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void openStore(Rk05Store *store, const char *dir, bool create)
+{
+    Rk05Status status;
+
+    status = rk05StoreOpen(store, dir, create);
+    if (status == Rk05ErrOpen) {
+        printf("Can't open store %s", dir);
+        perror(" ");
+        exit(1);
+    }
+
+    if (status != Rk05Ok) {
+        printf("Store %s: %s\n", dir, rk05StatusText(status));
+        exit(1);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close the store, exit on errors.
+**
+**  Parameters:     Name        Description.
+**                  store       pointer to store handle
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void closeStore(Rk05Store *store)
+{
+    Rk05Status status;
+
+    status = rk05StoreClose(store);
+    if (status != Rk05Ok) {
+        printf("Can't write the index of store %s: %s\n", store->dir, rk05StatusText(status));
+        exit(1);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add images to the store.
+**
+**  Parameters:     Name        Description.
+**                  store       store opened for adding
+**                  count       number of image files
+**                  files       image file names
+**
+**  Returns:        0 if all images were added, 1 otherwise
+**
+**------------------------------------------------------------------------*/
+static int addImages(Rk05Store *store, int count, char **files)
+{
+    char name[Rk05StoreMaxName];
+    Rk05StoreStats stats;
+    Rk05Image image;
+    Rk05Status status;
+    double start = rk05Seconds();
+    double seconds;
+    u64 bytes = 0;
+    u64 newBytes = 0;
+    int added = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        rk05StoreName(name, files[i]);
+        if (name[0] == '\0') {
+            printf("%s: can't make a store name from the file name\n", files[i]);
+            continue;
+        }
+
+        status = rk05Open(&image, files[i], false);
+        if (status == Rk05ErrOpen) {
+            printf("Can't open %s", files[i]);
+            perror(" ");
+            continue;
+        }
+
+        if (status == Rk05Ok) {
+            rk05Map(&image);
+            status = rk05StoreAdd(store, name, &image, &stats);
+            rk05Close(&image);
+        }
+
+        if (status != Rk05Ok) {
+            printf("%s: %s\n", files[i], rk05StatusText(status));
+            continue;
+        }
+
+        if (!quiet) {
+            printf("%-20s %d sectors, %d new (%llu bytes)\n", name, stats.sectors, stats.newSectors,
+                   (unsigned long long)stats.newBytes);
+        }
+
+        bytes += Rk05HeaderSize + (u64)stats.sectors * image.sectorSize;
+        newBytes += stats.newBytes;
+        added += 1;
+    }
+
+    seconds = rk05Seconds() - start;
+    printf("Added %d of %d images, %.1f MB in, %.1f MB stored, %.1f MB/s\n", added, count,
+           bytes / OneMegabyte, newBytes / OneMegabyte,
+           seconds > 0 ? bytes / OneMegabyte / seconds : 0.0);
+
+    return added == count ? 0 : 1;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Rebuild an image from the store.
+**
+**  Parameters:     Name        Description.
+**                  store       open store
+**                  name        name of the image
+**                  output      output file name, - for standard output
+**
+**  Returns:        0 if successful, 1 otherwise
+**
+**------------------------------------------------------------------------*/
+static int getImage(Rk05Store *store, const char *name, const char *output)
+{
+    Rk05Status status;
+    FILE *fp;
+
+    fp = open_file(output, "wb");
+    if (fp == NULL) {
+        printf("Can't create %s", output);
+        perror(" ");
+        return 1;
+    }
+
+    status = rk05StoreGet(store, name, fp);
+    if (status == Rk05ErrOpen) {
+        printf("No image %s in store %s\n", name, store->dir);
+    } else if (status != Rk05Ok) {
+        printf("Can't rebuild %s: %s\n", name, rk05StatusText(status));
+    }
+
+    if (status != Rk05Ok) {
+        if (!is_stdio(output)) {
+            remove(output);
+        }
+        return 1;
+    }
+
+    if (!quiet) {
+        printf("Image %s written to %s\n", name, output);
+    }
+
+    return 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        List the images in the store and the space it saves.
+**
+**  Parameters:     Name        Description.
+**                  store       open store
+**
+**  Returns:        0 if all images could be read, 1 otherwise
+**
+**------------------------------------------------------------------------*/
+static int listImages(Rk05Store *store)
+{
+    char name[Rk05StoreMaxName + 2];
+    char path[1100];
+    Rk05Header header;
+    Rk05Status status;
+    u64 recipeSize;
+    u64 bytes = 0;
+    u64 storeBytes;
+    int images = 0;
+    int rc = 0;
+    FILE *fp;
+
+    rk05StorePath(store, path, sizeof(path), "index.dat");
+    storeBytes = store->sectorsSize + fileSize(path);
+
+    rk05StorePath(store, path, sizeof(path), "catalog.txt");
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Store %s is empty\n", store->dir);
+        return 0;
+    }
+
+    if (!quiet) {
+        printf("%-20s %-10s %-8s %s\n", "Name", "Image", "Sectors", "Controller");
+    }
+
+    while (fgets(name, sizeof(name), fp) != NULL) {
+        name[strcspn(name, "\r\n")] = '\0';
+        if (name[0] == '\0') {
+            continue;
+        }
+
+        status = rk05StoreInfo(store, name, &header, &recipeSize);
+        if (status != Rk05Ok) {
+            printf("%-20s %s\n", name, rk05StatusText(status));
+            rc = 1;
+            continue;
+        }
+
+        if (!quiet) {
+            printf("%-20s %-10s %-8d %s\n", name, header.imageName,
+                   header.numberOfCylinders * header.numberOfHeads * header.numberOfSectorsPerTrack,
+                   header.controller);
+        }
+
+        bytes += Rk05HeaderSize
+                 + (u64)header.numberOfCylinders * header.numberOfHeads * header.numberOfSectorsPerTrack
+                   * rk05SectorSize(&header);
+        storeBytes += recipeSize;
+        images += 1;
+    }
+
+    fclose(fp);
+
+    printf("%d images, %.1f MB of images in %.1f MB of store", images, bytes / OneMegabyte,
+           storeBytes / OneMegabyte);
+    if (storeBytes > 0) {
+        printf(", %.1f to 1", (double)bytes / storeBytes);
+    }
+    printf("\n");
+
+    return rc;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get the size of a file.
+**
+**  Parameters:     Name        Description.
+**                  path        file name
+**
+**  Returns:        size in bytes, 0 if the file does not exist
+**
+**------------------------------------------------------------------------*/
+static u64 fileSize(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+
+    return (u64)st.st_size;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,488 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Crc.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 sector CRC16 kernels.
+**
+**      The sector CRC is CRC-16 with polynomial x^16 + x^15 + x^2 + 1,
+**      bit reversed (0xA001), processed LSB first. Three kernels give
+**      identical results:
+**
+**      table   one byte per step through a 256 entry table.
+**      slice8  eight bytes per step through eight 256 entry tables.
+**      clmul   folds 16 byte blocks with the x86 carry-less multiply
+**              instruction (PCLMULQDQ), then finishes with slice8.
+**
+**      The kernel used by crc16buf is chosen once at program start from
+**      the CPU features. The environment variable RK05_CRC set to table,
+**      slice8 or clmul overrides the choice.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Crc.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CRC16_CLMUL 1
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define CRC16_CLMUL 0
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define Crc16Poly       0x18005     // x^16 + x^15 + x^2 + 1
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if CRC16_CLMUL && (defined(__GNUC__) || defined(__clang__))
+#define CLMUL_TARGET __attribute__((target("sse2,pclmul")))
+#else
+#define CLMUL_TARGET
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef u16 (*Crc16Function)(u16 crc, const u8 *bp, int size);
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static Crc16Function crc16Select(void);
+static bool clmulDetect(void);
+#if CRC16_CLMUL
+static u64 clmulConstant(int n);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static const u16 crc16Table[256] = {
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
+};
+// crc16Slice[k][i] is the CRC of byte i followed by k zero bytes.
+static u16 crc16Slice[8][256];
+
+#if CRC16_CLMUL
+// Folding constants, x^n mod P as a reflected 64 bit lane.
+static u64 clmulK127;
+static u64 clmulK191;
+static u64 clmulK511;
+static u64 clmulK575;
+#endif
+
+static bool clmulAvailable;
+static const char *kernelName;
+static Crc16Function crc16Function = crc16Select();
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform CRC16 calculation of buffer with the fastest
+**                  kernel available.
+**
+**  Parameters:     Name        Description.
+**                  crc         starting CRC value
+**                  bp          pointer to buffer for calculation
+**                  size        size of the buffer for calculation
+**
+**  Returns:        calculated CRC
+**
+**------------------------------------------------------------------------*/
+u16 crc16buf(u16 crc, const u8 *bp, int size)
+{
+    return crc16Function(crc, bp, size);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform table driven CRC16 calculation of buffer, one
+**                  byte at a time.
+**
+**  Parameters:     Name        Description.
+**                  crc         starting CRC value
+**                  bp          pointer to buffer for calculation
+**                  size        size of the buffer for calculation
+**
+**  Returns:        calculated CRC
+**
+**------------------------------------------------------------------------*/
+u16 crc16bufTable(u16 crc, const u8 *bp, int size)
+{
+    while (size--) {
+        crc = crc16Table[(crc ^ (*bp++)) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform table driven CRC16 calculation of buffer, eight
+**                  bytes at a time.
+**
+**  Parameters:     Name        Description.
+**                  crc         starting CRC value
+**                  bp          pointer to buffer for calculation
+**                  size        size of the buffer for calculation
+**
+**  Returns:        calculated CRC
+**
+**------------------------------------------------------------------------*/
+u16 crc16bufSlice8(u16 crc, const u8 *bp, int size)
+{
+    // The CRC register is combined with the first two bytes of each group,
+    // then each byte is looked up with the number of bytes following it.
+    while (size >= 8) {
+        crc = crc16Slice[7][bp[0] ^ (crc & 0xFF)]
+            ^ crc16Slice[6][bp[1] ^ (crc >> 8)]
+            ^ crc16Slice[5][bp[2]]
+            ^ crc16Slice[4][bp[3]]
+            ^ crc16Slice[3][bp[4]]
+            ^ crc16Slice[2][bp[5]]
+            ^ crc16Slice[1][bp[6]]
+            ^ crc16Slice[0][bp[7]];
+        bp += 8;
+        size -= 8;
+    }
+
+    return crc16bufTable(crc, bp, size);
+}
+
+#if CRC16_CLMUL
+/*--------------------------------------------------------------------------
+**  Purpose:        Fold a 128 bit remainder forward and add the next block.
+**
+**  Parameters:     Name        Description.
+**                  x           remainder to fold
+**                  k           folding constants, low lane for the low
+**                              64 bits of x, high lane for the high 64 bits
+**                  next        next 16 bytes of the buffer
+**
+**  Returns:        folded remainder
+**
+**------------------------------------------------------------------------*/
+static inline CLMUL_TARGET __m128i clmulFold(__m128i x, __m128i k, __m128i next)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), next);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform CRC16 calculation of buffer by folding with the
+**                  carry-less multiply instruction.
+**
+**  Parameters:     Name        Description.
+**                  crc         starting CRC value
+**                  bp          pointer to buffer for calculation
+**                  size        size of the buffer for calculation
+**
+**  Returns:        calculated CRC
+**
+**------------------------------------------------------------------------*/
+static CLMUL_TARGET u16 crc16bufClmulKernel(u16 crc, const u8 *bp, int size)
+{
+    __m128i x0, x1, x2, x3;
+    __m128i k1;
+    __m128i k4;
+    u8 rem[16];
+
+    // Short buffers do not amortise the setup.
+    if (size < 64) {
+        return crc16bufSlice8(crc, bp, size);
+    }
+
+    // Reflected bit order: byte 0 bit 0 is the highest power, so the low
+    // lane of a block holds the high half of its polynomial. A fold
+    // multiplies the low lane by x^(d+64) mod P and the high lane by
+    // x^d mod P, where d is the folding distance in bits, less one for
+    // the one bit shift a reflected carry-less product gives.
+    k1 = _mm_set_epi64x((long long)clmulK127, (long long)clmulK191);
+    k4 = _mm_set_epi64x((long long)clmulK511, (long long)clmulK575);
+
+    // The starting CRC is added into the first two bytes.
+    x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bp + 0)), _mm_cvtsi32_si128(crc));
+    x1 = _mm_loadu_si128((const __m128i *)(bp + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(bp + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(bp + 48));
+    bp += 64;
+    size -= 64;
+
+    // Four independent remainders, each folded 512 bits forward.
+    while (size >= 64) {
+        x0 = clmulFold(x0, k4, _mm_loadu_si128((const __m128i *)(bp + 0)));
+        x1 = clmulFold(x1, k4, _mm_loadu_si128((const __m128i *)(bp + 16)));
+        x2 = clmulFold(x2, k4, _mm_loadu_si128((const __m128i *)(bp + 32)));
+        x3 = clmulFold(x3, k4, _mm_loadu_si128((const __m128i *)(bp + 48)));
+        bp += 64;
+        size -= 64;
+    }
+
+    // Combine them into one, then fold in the remaining whole blocks.
+    x1 = clmulFold(x0, k1, x1);
+    x2 = clmulFold(x1, k1, x2);
+    x3 = clmulFold(x2, k1, x3);
+    while (size >= 16) {
+        x3 = clmulFold(x3, k1, _mm_loadu_si128((const __m128i *)bp));
+        bp += 16;
+        size -= 16;
+    }
+
+    // The remainder is congruent to the message so far, so its CRC is the
+    // CRC of the message. Continue with the bytes after the last block.
+    _mm_storeu_si128((__m128i *)rem, x3);
+    crc = crc16bufSlice8(0, rem, sizeof(rem));
+
+    return crc16bufSlice8(crc, bp, size);
+}
+#endif
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Perform CRC16 calculation of buffer with the carry-less
+**                  multiply kernel, or slice8 if the CPU does not have the
+**                  instruction.
+**
+**  Parameters:     Name        Description.
+**                  crc         starting CRC value
+**                  bp          pointer to buffer for calculation
+**                  size        size of the buffer for calculation
+**
+**  Returns:        calculated CRC
+**
+**------------------------------------------------------------------------*/
+u16 crc16bufClmul(u16 crc, const u8 *bp, int size)
+{
+#if CRC16_CLMUL
+    if (clmulAvailable) {
+        return crc16bufClmulKernel(crc, bp, size);
+    }
+#endif
+
+    return crc16bufSlice8(crc, bp, size);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Report whether the carry-less multiply kernel can be used.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if the CPU has PCLMULQDQ and SSE2
+**
+**------------------------------------------------------------------------*/
+bool crc16ClmulAvailable(void)
+{
+    return clmulAvailable;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the name of the kernel used by crc16buf.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        kernel name
+**
+**------------------------------------------------------------------------*/
+const char *crc16KernelName(void)
+{
+    return kernelName;
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build the slice8 tables and the folding constants and
+**                  choose the kernel for crc16buf. Runs once before main.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        kernel function
+**
+**------------------------------------------------------------------------*/
+static Crc16Function crc16Select(void)
+{
+    const char *override = getenv("RK05_CRC");
+    int i;
+    int k;
+
+    for (i = 0; i < 256; i++) {
+        crc16Slice[0][i] = crc16Table[i];
+    }
+
+    for (k = 1; k < 8; k++) {
+        for (i = 0; i < 256; i++) {
+            crc16Slice[k][i] = (crc16Slice[k - 1][i] >> 8) ^ crc16Table[crc16Slice[k - 1][i] & 0xFF];
+        }
+    }
+
+    clmulAvailable = clmulDetect();
+
+#if CRC16_CLMUL
+    clmulK127 = clmulConstant(127);
+    clmulK191 = clmulConstant(191);
+    clmulK511 = clmulConstant(511);
+    clmulK575 = clmulConstant(575);
+#endif
+
+    if (override != NULL && strcmp(override, "table") == 0) {
+        kernelName = "table";
+        return crc16bufTable;
+    }
+
+    if (override != NULL && strcmp(override, "slice8") == 0) {
+        kernelName = "slice8";
+        return crc16bufSlice8;
+    }
+
+#if CRC16_CLMUL
+    if (clmulAvailable) {
+        kernelName = "clmul";
+        return crc16bufClmulKernel;
+    }
+#endif
+
+    kernelName = "slice8";
+    return crc16bufSlice8;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check the CPU for the carry-less multiply instruction.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if the CPU has PCLMULQDQ and SSE2
+**
+**------------------------------------------------------------------------*/
+static bool clmulDetect(void)
+{
+#if CRC16_CLMUL
+#if defined(_MSC_VER)
+    int regs[4];
+
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 1)) != 0 && (regs[3] & (1 << 26)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+
+    return (ecx & (1 << 1)) != 0 && (edx & (1 << 26)) != 0;
+#endif
+#else
+    return false;
+#endif
+}
+
+#if CRC16_CLMUL
+/*--------------------------------------------------------------------------
+**  Purpose:        Calculate x^n mod P as a reflected 64 bit lane, the
+**                  coefficient of x^d in bit 63 - d.
+**
+**  Parameters:     Name        Description.
+**                  n           power of x
+**
+**  Returns:        folding constant
+**
+**------------------------------------------------------------------------*/
+static u64 clmulConstant(int n)
+{
+    u32 r = 1;
+    u64 lane = 0;
+    int d;
+
+    while (n--) {
+        r <<= 1;
+        if (r & 0x10000) {
+            r ^= Crc16Poly;
+        }
+    }
+
+    for (d = 0; d < 16; d++) {
+        if (r & (1 << d)) {
+            lane |= (u64)1 << (63 - d);
+        }
+    }
+
+    return lane;
+}
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
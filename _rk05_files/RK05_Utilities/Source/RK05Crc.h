@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Crc.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 sector CRC16 kernel declarations.
+**
+**      crc16buf in RK05Util.h uses the fastest kernel available on the
+**      host. The individual kernels are exported for benchmarks and for
+**      checking them against each other.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05CRC_H
+#define RK05CRC_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Util.h"
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+u16 crc16bufTable(u16 crc, const u8 *bp, int size);
+u16 crc16bufSlice8(u16 crc, const u8 *bp, int size);
+u16 crc16bufClmul(u16 crc, const u8 *bp, int size);
+bool crc16ClmulAvailable(void);
+const char *crc16KernelName(void);
+
+#endif /* RK05CRC_H */
+
+/*---------------------------  End Of File  ------------------------------*/
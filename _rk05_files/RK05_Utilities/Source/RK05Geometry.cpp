@@ -0,0 +1,205 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Geometry.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Disk controller geometry and word size descriptors.
+**
+**      The RK11-D header values are those of the rk11d_zero2.rk05 sample
+**      image. A new controller needs an entry here and, if its word size
+**      is new, a word format in RK05Simh.cpp.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Geometry.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static const Rk05Geometry geometries[] =
+    {
+    //  controller  machine   bits words simh  size  simh  cyl heads spt  bitRate pre1 pre2 post  usec
+        { "RK8-E",  "PDP-8",  12,  256,  2,    388,  512,  203, 2,    16,  1440000, 120, 82,  36,  2500 },
+        { "RK11-D", "PDP-11", 16,  256,  2,    516,  512,  203, 2,    12,  1440000, 128, 80,  16,  3333 },
+    };
+
+#define GeometryCount   ((int)(sizeof(geometries) / sizeof(geometries[0])))
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the descriptor for an image header. The controller
+**                  name is tried first, then the sector size implied by
+**                  the data length.
+**
+**  Parameters:     Name        Description.
+**                  hp          pointer to image header
+**
+**  Returns:        pointer to descriptor, NULL if the layout is unknown
+**
+**------------------------------------------------------------------------*/
+const Rk05Geometry *rk05FindGeometry(const Rk05Header *hp)
+{
+    const Rk05Geometry *gp;
+    int size = rk05SectorSize(hp);
+    int i;
+
+    gp = rk05GeometryByName(hp->controller);
+    if (gp != NULL && gp->sectorSize == size) {
+        return gp;
+    }
+
+    for (i = 0; i < GeometryCount; i++) {
+        if (geometries[i].sectorSize == size) {
+            return &geometries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the descriptor for a controller name.
+**
+**  Parameters:     Name        Description.
+**                  controller  controller name, case is ignored
+**
+**  Returns:        pointer to descriptor, NULL if unknown
+**
+**------------------------------------------------------------------------*/
+const Rk05Geometry *rk05GeometryByName(const char *controller)
+{
+    int i;
+
+    for (i = 0; i < GeometryCount; i++) {
+        if (_stricmp(geometries[i].controller, controller) == 0) {
+            return &geometries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the controller whose full SIMH image has exactly
+**                  the given size.
+**
+**  Parameters:     Name        Description.
+**                  size        SIMH image size in bytes
+**
+**  Returns:        pointer to descriptor, NULL if none or more than one
+**                  match
+**
+**------------------------------------------------------------------------*/
+const Rk05Geometry *rk05GeometryBySimhSize(size_t size)
+{
+    const Rk05Geometry *found = NULL;
+    const Rk05Geometry *gp;
+    int i;
+
+    for (i = 0; i < GeometryCount; i++) {
+        gp = &geometries[i];
+        if (size == (size_t)gp->numberOfCylinders * gp->numberOfHeads * gp->numberOfSectorsPerTrack
+                    * gp->simhSectorSize) {
+            if (found != NULL) {
+                return NULL;
+            }
+            found = gp;
+        }
+    }
+
+    return found;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get the table of all descriptors.
+**
+**  Parameters:     Name        Description.
+**                  table       returns pointer to the table
+**
+**  Returns:        number of descriptors
+**
+**------------------------------------------------------------------------*/
+int rk05Geometries(const Rk05Geometry **table)
+{
+    *table = geometries;
+    return GeometryCount;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set the controller, geometry and timing fields of a
+**                  header for a new image. Name, description and date
+**                  are left alone.
+**
+**  Parameters:     Name        Description.
+**                  gp          pointer to descriptor
+**                  hp          pointer to header
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05GeometryHeader(const Rk05Geometry *gp, Rk05Header *hp)
+{
+    safecpy(hp->controller, gp->controller, sizeof(hp->controller));
+    hp->bitRate = gp->bitRate;
+    hp->preamble1Length = gp->preamble1Length;
+    hp->preamble2Length = gp->preamble2Length;
+    hp->dataLength = gp->sectorSize * 8;
+    hp->postambleLength = gp->postambleLength;
+    hp->numberOfCylinders = gp->numberOfCylinders;
+    hp->numberOfSectorsPerTrack = gp->numberOfSectorsPerTrack;
+    hp->numberOfHeads = gp->numberOfHeads;
+    hp->microsecondsPerSector = gp->microsecondsPerSector;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
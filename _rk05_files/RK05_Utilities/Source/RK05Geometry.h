@@ -0,0 +1,77 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Geometry.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Disk controller geometry and word size descriptors.
+**
+**      Each controller the emulator supports formats an RK05 pack with
+**      its own number of sectors per track and its own word size. The
+**      descriptor of an image is found from the controller named in its
+**      header, or failing that from its data length.
+**
+**      An RK05 Emulator sector holds the header word, the data words
+**      packed into a bit stream LSB first, and the CRC word. A SIMH
+**      sector holds each data word little-endian in simhWordBytes.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05GEOMETRY_H
+#define RK05GEOMETRY_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+
+/*
+**  ----------------
+**  Public Constants
+**  ----------------
+*/
+#define Rk05MaxSectorSize       516
+#define Rk05MaxSimhSectorSize   512
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef struct rk05Geometry
+    {
+    const char *controller;     // controller name in the image header
+    const char *machine;        // machine the controller belongs to
+    int wordBits;               // bits per data word
+    int wordsPerSector;
+    int simhWordBytes;          // bytes per word in a SIMH image
+    int sectorSize;             // RK05 Emulator sector bytes
+    int simhSectorSize;         // SIMH sector bytes
+    int numberOfCylinders;
+    int numberOfHeads;
+    int numberOfSectorsPerTrack;
+    int bitRate;                // header defaults for new images
+    int preamble1Length;
+    int preamble2Length;
+    int postambleLength;
+    int microsecondsPerSector;
+    } Rk05Geometry;
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+const Rk05Geometry *rk05FindGeometry(const Rk05Header *hp);
+const Rk05Geometry *rk05GeometryByName(const char *controller);
+const Rk05Geometry *rk05GeometryBySimhSize(size_t size);
+int rk05Geometries(const Rk05Geometry **table);
+void rk05GeometryHeader(const Rk05Geometry *gp, Rk05Header *hp);
+
+#endif /* RK05GEOMETRY_H */
+
+/*---------------------------  End Of File  ------------------------------*/
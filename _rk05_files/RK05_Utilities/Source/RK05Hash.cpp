@@ -0,0 +1,304 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Hash.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Sector hashes.
+**
+**      rk05Hash64 follows the XXH64 specification, so its values can be
+**      checked with any other XXH64 implementation. Input is read as
+**      little-endian on every host.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Hash.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define Prime1  11400714785074694791ULL
+#define Prime2  14029467366897019727ULL
+#define Prime3   1609587929392839161ULL
+#define Prime4   9650029242287828579ULL
+#define Prime5   2870177450012600261ULL
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#define rotl64(x, r)    (((x) << (r)) | ((x) >> (64 - (r))))
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static u64 hashRound(u64 acc, u64 input);
+static u64 hashMerge(u64 acc, u64 value);
+static u32 getU32(const u8 *bp);
+static bool hashSector(void *context, int cylinder, int head, int sector, const u8 *buf);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Calculate the XXH64 hash of a buffer.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to data
+**                  size        number of bytes
+**                  seed        hash seed
+**
+**  Returns:        64 bit hash
+**
+**------------------------------------------------------------------------*/
+u64 rk05Hash64(const u8 *bp, size_t size, u64 seed)
+{
+    const u8 *end = bp + size;
+    u64 v1;
+    u64 v2;
+    u64 v3;
+    u64 v4;
+    u64 h;
+
+    if (size >= 32) {
+        v1 = seed + Prime1 + Prime2;
+        v2 = seed + Prime2;
+        v3 = seed;
+        v4 = seed - Prime1;
+
+        do {
+            v1 = hashRound(v1, rk05GetU64(bp));
+            v2 = hashRound(v2, rk05GetU64(bp + 8));
+            v3 = hashRound(v3, rk05GetU64(bp + 16));
+            v4 = hashRound(v4, rk05GetU64(bp + 24));
+            bp += 32;
+        } while (bp + 32 <= end);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hashMerge(h, v1);
+        h = hashMerge(h, v2);
+        h = hashMerge(h, v3);
+        h = hashMerge(h, v4);
+    } else {
+        h = seed + Prime5;
+    }
+
+    h += (u64)size;
+
+    while (bp + 8 <= end) {
+        h ^= hashRound(0, rk05GetU64(bp));
+        h = rotl64(h, 27) * Prime1 + Prime4;
+        bp += 8;
+    }
+
+    if (bp + 4 <= end) {
+        h ^= (u64)getU32(bp) * Prime1;
+        h = rotl64(h, 23) * Prime2 + Prime3;
+        bp += 4;
+    }
+
+    while (bp < end) {
+        h ^= (u64)*bp * Prime5;
+        h = rotl64(h, 11) * Prime1;
+        bp += 1;
+    }
+
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Fold a value into a running hash, for hashing a list
+**                  of sector hashes into one image hash.
+**
+**  Parameters:     Name        Description.
+**                  hash        running hash, 0 to start
+**                  value       value to add
+**
+**  Returns:        new running hash
+**
+**------------------------------------------------------------------------*/
+u64 rk05HashCombine(u64 hash, u64 value)
+{
+    u8 buf[8];
+
+    rk05PutU64(buf, value);
+    return rk05Hash64(buf, sizeof(buf), hash);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hash every sector of an image, in memory if it has
+**                  been mapped, otherwise reading it in order.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  hashes      array of ip->sectorCount hashes to set
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05HashSectors(Rk05Image *ip, u64 *hashes)
+{
+    void *context[2];
+
+    context[0] = ip;
+    context[1] = hashes;
+
+    return rk05ForEachSector(ip, hashSector, context);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store a 64 bit value in little-endian byte order.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 8 bytes
+**                  value       value to store
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05PutU64(u8 *bp, u64 value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        bp[i] = (u8)(value >> (8 * i));
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Load a 64 bit value stored in little-endian byte order.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 8 bytes
+**
+**  Returns:        value
+**
+**------------------------------------------------------------------------*/
+u64 rk05GetU64(const u8 *bp)
+{
+    return (u64)getU32(bp) | ((u64)getU32(bp + 4) << 32);
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        XXH64 accumulator round.
+**
+**  Parameters:     Name        Description.
+**                  acc         accumulator
+**                  input       next 8 bytes of input
+**
+**  Returns:        new accumulator
+**
+**------------------------------------------------------------------------*/
+static u64 hashRound(u64 acc, u64 input)
+{
+    acc += input * Prime2;
+    acc = rotl64(acc, 31);
+    return acc * Prime1;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        XXH64 accumulator merge.
+**
+**  Parameters:     Name        Description.
+**                  acc         hash so far
+**                  value       accumulator to merge in
+**
+**  Returns:        new hash
+**
+**------------------------------------------------------------------------*/
+static u64 hashMerge(u64 acc, u64 value)
+{
+    acc ^= hashRound(0, value);
+    return acc * Prime1 + Prime4;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Load a 32 bit value stored in little-endian byte order.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 4 bytes
+**
+**  Returns:        value
+**
+**------------------------------------------------------------------------*/
+static u32 getU32(const u8 *bp)
+{
+    return (u32)bp[0] | ((u32)bp[1] << 8) | ((u32)bp[2] << 16) | ((u32)bp[3] << 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        rk05ForEachSector callback, hash one sector.
+**
+**  Parameters:     Name        Description.
+**                  context     image handle and hash array
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         sector contents
+**
+**  Returns:        true to continue
+**
+**------------------------------------------------------------------------*/
+static bool hashSector(void *context, int cylinder, int head, int sector, const u8 *buf)
+{
+    Rk05Image *ip = (Rk05Image *)((void **)context)[0];
+    u64 *hashes = (u64 *)((void **)context)[1];
+
+    hashes[rk05SectorIndex(ip, cylinder, head, sector)] = rk05Hash64(buf, ip->sectorSize, 0);
+    return true;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
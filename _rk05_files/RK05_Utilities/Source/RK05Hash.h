@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Hash.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Sector hash declarations.
+**
+**      rk05Hash64 is the XXH64 hash, fast enough to hash every sector of
+**      an image in less time than it takes to read it, with a 64 bit
+**      result so unequal sectors practically never hash the same.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05HASH_H
+#define RK05HASH_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+u64 rk05Hash64(const u8 *bp, size_t size, u64 seed);
+u64 rk05HashCombine(u64 hash, u64 value);
+Rk05Status rk05HashSectors(Rk05Image *ip, u64 *hashes);
+void rk05PutU64(u8 *bp, u64 value);
+u64 rk05GetU64(const u8 *bp);
+
+#endif /* RK05HASH_H */
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,1037 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Image.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 Emulator image file library.
+**
+**      The image file is the 381 byte header followed by the sectors in
+**      cylinder, head, sector order. Each sector is dataLength / 8 bytes,
+**      the header word, the data and the CRC, both words LSB first.
+**
+**      The functions report errors through the returned status and do not
+**      print anything, except rk05DisplayHeader.
+**
+**      rk05Map uses mmap on POSIX hosts. Elsewhere, or if the mapping
+**      fails, the whole file is read into memory instead.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Image.h"
+
+#if defined(_WIN32)
+#define IMAGE_MMAP 0
+#else
+#define IMAGE_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+static const char magicNumber[10] = "\x89RK05\r\n\x1A";
+static const char versionNumber[4] = "1.0";
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void putInt(u8 *bp, int value);
+static int getInt(const u8 *bp);
+static void putString(u8 *bp, const char *cp, int size);
+static void getString(char *cp, const u8 *bp, int size);
+static Rk05Status checkGeometry(const Rk05Header *hp);
+static Rk05Status seekSector(Rk05Image *ip, int index, bool write);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set a header to the RK8-E defaults.
+**
+**  Parameters:     Name        Description.
+**                  hp          pointer to header
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05InitHeader(Rk05Header *hp)
+{
+    memset(hp, 0, sizeof(*hp));
+    memcpy(hp->magicNumber, magicNumber, sizeof(hp->magicNumber));
+    memcpy(hp->versionNumber, versionNumber, sizeof(hp->versionNumber));
+
+    strcpy(hp->controller, "RK8-E");
+    hp->bitRate = 1440000;
+    hp->preamble1Length = 120;
+    hp->preamble2Length = 82;
+    hp->dataLength = 3104;
+    hp->postambleLength = 36;
+    hp->numberOfCylinders = 203;
+    hp->numberOfSectorsPerTrack = 16;
+    hp->numberOfHeads = 2;
+    hp->microsecondsPerSector = 2500;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and verify an RK05 image file header from the
+**                  current file position.
+**
+**  Parameters:     Name        Description.
+**                  fp          file to read from
+**                  hp          pointer to header which will be set
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05ReadHeader(FILE *fp, Rk05Header *hp)
+{
+    u8 buf[Rk05HeaderSize];
+    int rc;
+
+    rc = fread(buf, 1, Rk05HeaderSize, fp);
+    if (rc != Rk05HeaderSize && ferror(fp)) {
+        return Rk05ErrIo;
+    }
+
+    return rk05DecodeHeader(buf, rc, hp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write an RK05 image file header at the current file
+**                  position.
+**
+**  Parameters:     Name        Description.
+**                  fp          file to write to
+**                  hp          pointer to header
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05WriteHeader(FILE *fp, const Rk05Header *hp)
+{
+    u8 buf[Rk05HeaderSize];
+
+    rk05EncodeHeader(buf, hp);
+    if (fwrite(buf, 1, Rk05HeaderSize, fp) != Rk05HeaderSize) {
+        return Rk05ErrIo;
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Verify and decode an RK05 image file header.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to the header bytes
+**                  size        number of bytes available at bp
+**                  hp          pointer to header which will be set
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05DecodeHeader(const u8 *bp, int size, Rk05Header *hp)
+{
+    // The magic number and version are checked before the length so a short
+    // file of the wrong type is reported as such.
+    if (size < (int)sizeof(hp->magicNumber) || memcmp(bp, magicNumber, sizeof(magicNumber)) != 0) {
+        return Rk05ErrMagic;
+    }
+    getString(hp->magicNumber, bp, sizeof(hp->magicNumber));
+    bp += sizeof(hp->magicNumber);
+
+    if (size < (int)(sizeof(hp->magicNumber) + sizeof(hp->versionNumber)) || memcmp(bp, versionNumber, sizeof(versionNumber)) != 0) {
+        return Rk05ErrVersion;
+    }
+    getString(hp->versionNumber, bp, sizeof(hp->versionNumber));
+    bp += sizeof(hp->versionNumber);
+
+    if (size < Rk05HeaderSize) {
+        return Rk05ErrEof;
+    }
+
+    getString(hp->imageName, bp, sizeof(hp->imageName));                bp += sizeof(hp->imageName);
+    getString(hp->imageDescription, bp, sizeof(hp->imageDescription));  bp += sizeof(hp->imageDescription);
+    getString(hp->imageDate, bp, sizeof(hp->imageDate));                bp += sizeof(hp->imageDate);
+    getString(hp->controller, bp, sizeof(hp->controller));              bp += sizeof(hp->controller);
+    hp->bitRate                 = getInt(bp);   bp += 4;
+    hp->preamble1Length         = getInt(bp);   bp += 4;
+    hp->preamble2Length         = getInt(bp);   bp += 4;
+    hp->dataLength              = getInt(bp);   bp += 4;
+    hp->postambleLength         = getInt(bp);   bp += 4;
+    hp->numberOfCylinders       = getInt(bp);   bp += 4;
+    hp->numberOfSectorsPerTrack = getInt(bp);   bp += 4;
+    hp->numberOfHeads           = getInt(bp);   bp += 4;
+    hp->microsecondsPerSector   = getInt(bp);
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Encode an RK05 image file header.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to Rk05HeaderSize bytes
+**                  hp          pointer to header
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05EncodeHeader(u8 *bp, const Rk05Header *hp)
+{
+    putString(bp, magicNumber, sizeof(hp->magicNumber));                bp += sizeof(hp->magicNumber);
+    putString(bp, versionNumber, sizeof(hp->versionNumber));            bp += sizeof(hp->versionNumber);
+    putString(bp, hp->imageName, sizeof(hp->imageName));                bp += sizeof(hp->imageName);
+    putString(bp, hp->imageDescription, sizeof(hp->imageDescription));  bp += sizeof(hp->imageDescription);
+    putString(bp, hp->imageDate, sizeof(hp->imageDate));                bp += sizeof(hp->imageDate);
+    putString(bp, hp->controller, sizeof(hp->controller));              bp += sizeof(hp->controller);
+    putInt(bp, hp->bitRate);                    bp += 4;
+    putInt(bp, hp->preamble1Length);            bp += 4;
+    putInt(bp, hp->preamble2Length);            bp += 4;
+    putInt(bp, hp->dataLength);                 bp += 4;
+    putInt(bp, hp->postambleLength);            bp += 4;
+    putInt(bp, hp->numberOfCylinders);          bp += 4;
+    putInt(bp, hp->numberOfSectorsPerTrack);    bp += 4;
+    putInt(bp, hp->numberOfHeads);              bp += 4;
+    putInt(bp, hp->microsecondsPerSector);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Display image file header optionally with full details.
+**
+**  Parameters:     Name        Description.
+**                  hp          pointer to header
+**                  detailed    true if full details reqested, false otherwise
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05DisplayHeader(const Rk05Header *hp, bool detailed)
+{
+    printf("Image Name = \"%s\"\n", hp->imageName);
+    printf("Image Creation Date & Time = %s\n", hp->imageDate);
+    printf("Image Description = \"%s\"\n", hp->imageDescription);
+
+    if (detailed) {
+        printf("\nEmulation Parameters:\n");
+        printf("Controller = %s\n", hp->controller);
+        printf("Bit Rate = %d\n", hp->bitRate);
+        printf("Preamble1 Length = %d\n", hp->preamble1Length);
+        printf("Preamble2 Length = %d\n", hp->preamble2Length);
+        printf("Data Length = %d\n", hp->dataLength);
+        printf("Postamble Length = %d\n", hp->postambleLength);
+        printf("Cylinders = %d\n", hp->numberOfCylinders);
+        printf("Sectors per track = %d\n", hp->numberOfSectorsPerTrack);
+        printf("Heads = %d\n", hp->numberOfHeads);
+        printf("Microseconds per sector = %d\n", hp->microsecondsPerSector);
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the size of a sector in the image file.
+**
+**  Parameters:     Name        Description.
+**                  hp          pointer to header
+**
+**  Returns:        sector size in bytes
+**
+**------------------------------------------------------------------------*/
+int rk05SectorSize(const Rk05Header *hp)
+{
+    return hp->dataLength / 8;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the message for a status.
+**
+**  Parameters:     Name        Description.
+**                  status      status returned by a library function
+**
+**  Returns:        pointer to message text
+**
+**------------------------------------------------------------------------*/
+const char *rk05StatusText(Rk05Status status)
+{
+    switch (status) {
+    case Rk05Ok:            return "no error";
+    case Rk05ErrOpen:       return "can't open image file";
+    case Rk05ErrIo:         return "image file I/O error";
+    case Rk05ErrEof:        return "unexpected end of image file";
+    case Rk05ErrMagic:      return "invalid magic number in header";
+    case Rk05ErrVersion:    return "unexpected version number in header";
+    case Rk05ErrGeometry:   return "invalid disk geometry in header";
+    case Rk05ErrRange:      return "sector address out of range";
+    case Rk05ErrReadOnly:   return "image file is open read only";
+    case Rk05ErrCorrupt:    return "file contents fail their check";
+    }
+
+    return "unknown error";
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open an existing image file and read its header.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  filename    image file name
+**                  writable    true to open for update, false for reading
+**
+**  Returns:        Rk05Ok if successful, error status otherwise. On
+**                  Rk05ErrOpen errno is left as set by fopen. The handle
+**                  is closed on any error.
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05Open(Rk05Image *ip, const char *filename, bool writable)
+{
+    FILE *fp;
+
+    memset(ip, 0, sizeof(*ip));
+    fp = fopen(filename, writable ? "rb+" : "rb");
+    if (fp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    return rk05OpenStream(ip, fp, writable);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open an image on an already open file positioned at
+**                  the image header, for example stdin. The file is only
+**                  read forward as long as the sectors are read in order,
+**                  so it may be a pipe.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  fp          open file, closed by rk05Close
+**                  writable    true if the file is open for update
+**
+**  Returns:        Rk05Ok if successful, error status otherwise. The file
+**                  is closed on any error.
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05OpenStream(Rk05Image *ip, FILE *fp, bool writable)
+{
+    Rk05Status status;
+
+    memset(ip, 0, sizeof(*ip));
+    ip->fp = fp;
+
+    status = rk05ReadHeader(ip->fp, &ip->header);
+    if (status == Rk05Ok) {
+        status = checkGeometry(&ip->header);
+    }
+
+    if (status != Rk05Ok) {
+        fclose(ip->fp);
+        ip->fp = NULL;
+        return status;
+    }
+
+    ip->writable = writable;
+    ip->sectorSize = rk05SectorSize(&ip->header);
+    ip->sectorCount = ip->header.numberOfCylinders * ip->header.numberOfHeads * ip->header.numberOfSectorsPerTrack;
+    ip->position = 0;
+    ip->lastOpWrite = false;
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create a new image file and write its header.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  filename    image file name, an existing file is replaced
+**                  hp          pointer to header for the new image
+**
+**  Returns:        Rk05Ok if successful, error status otherwise. On
+**                  Rk05ErrOpen errno is left as set by fopen.
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05Create(Rk05Image *ip, const char *filename, const Rk05Header *hp)
+{
+    Rk05Status status;
+    FILE *fp;
+
+    memset(ip, 0, sizeof(*ip));
+    status = checkGeometry(hp);
+    if (status != Rk05Ok) {
+        return status;
+    }
+
+    fp = fopen(filename, "wb+");
+    if (fp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    return rk05CreateStream(ip, fp, hp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Start a new image on an already open file, for example
+**                  stdout, and write its header. The file is only written
+**                  forward as long as the sectors are written in order,
+**                  so it may be a pipe.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  fp          file open for writing, closed by rk05Close
+**                  hp          pointer to header for the new image
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05CreateStream(Rk05Image *ip, FILE *fp, const Rk05Header *hp)
+{
+    Rk05Status status;
+
+    memset(ip, 0, sizeof(*ip));
+    status = checkGeometry(hp);
+    if (status != Rk05Ok) {
+        fclose(fp);
+        return status;
+    }
+
+    ip->fp = fp;
+    ip->header = *hp;
+    ip->writable = true;
+    ip->created = true;
+    ip->sectorSize = rk05SectorSize(hp);
+    ip->sectorCount = hp->numberOfCylinders * hp->numberOfHeads * hp->numberOfSectorsPerTrack;
+    ip->position = 0;
+    ip->lastOpWrite = true;
+
+    return rk05WriteHeader(ip->fp, &ip->header);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Rewrite the image file header from the handle, for
+**                  example after changing the name or description.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05UpdateHeader(Rk05Image *ip)
+{
+    Rk05Status status;
+
+    if (!ip->writable) {
+        return Rk05ErrReadOnly;
+    }
+
+    if (ip->map.data != NULL) {
+        rk05EncodeHeader(ip->map.data, &ip->header);
+        return Rk05Ok;
+    }
+
+    if (fseek(ip->fp, 0, SEEK_SET) != 0) {
+        return Rk05ErrIo;
+    }
+
+    status = rk05WriteHeader(ip->fp, &ip->header);
+    ip->position = -1;
+    ip->lastOpWrite = true;
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Bring the whole image into memory. Sector reads and
+**                  writes then copy to or from memory, rk05SectorData gives
+**                  pointers into it and rk05ForEachSector passes them to
+**                  the callback without copying. A created image is
+**                  extended to its full size first.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05Map(Rk05Image *ip)
+{
+    size_t size = Rk05HeaderSize + (size_t)ip->sectorCount * ip->sectorSize;
+
+    if (ip->map.data != NULL) {
+        return Rk05Ok;
+    }
+
+    return rk05MapFile(ip->fp, ip->writable, ip->created ? size : 0, &ip->map);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close an image file.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo if buffered or in
+**                  memory data could not be written
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05Close(Rk05Image *ip)
+{
+    Rk05Status status = Rk05Ok;
+
+    if (ip->map.data != NULL) {
+        status = rk05UnmapFile(ip->fp, ip->writable, &ip->map);
+    }
+
+    if (ip->fp != NULL) {
+        if (fclose(ip->fp) != 0) {
+            status = Rk05ErrIo;
+        }
+        ip->fp = NULL;
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the index of a sector in the image file.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**
+**  Returns:        sector index or -1 if the address is out of range
+**
+**------------------------------------------------------------------------*/
+int rk05SectorIndex(const Rk05Image *ip, int cylinder, int head, int sector)
+{
+    const Rk05Header *hp = &ip->header;
+
+    if (   cylinder < 0 || cylinder >= hp->numberOfCylinders
+        || head < 0 || head >= hp->numberOfHeads
+        || sector < 0 || sector >= hp->numberOfSectorsPerTrack) {
+        return -1;
+    }
+
+    return (cylinder * hp->numberOfHeads + head) * hp->numberOfSectorsPerTrack + sector;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read a sector.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         buffer of at least ip->sectorSize bytes
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05ReadSector(Rk05Image *ip, int cylinder, int head, int sector, u8 *buf)
+{
+    Rk05Status status;
+    int index = rk05SectorIndex(ip, cylinder, head, sector);
+
+    if (index < 0) {
+        return Rk05ErrRange;
+    }
+
+    if (ip->map.data != NULL) {
+        if (Rk05HeaderSize + (size_t)(index + 1) * ip->sectorSize > ip->map.size) {
+            return Rk05ErrEof;
+        }
+
+        memcpy(buf, ip->map.data + Rk05HeaderSize + (size_t)index * ip->sectorSize, ip->sectorSize);
+        return Rk05Ok;
+    }
+
+    status = seekSector(ip, index, false);
+    if (status != Rk05Ok) {
+        return status;
+    }
+
+    if (fread(buf, 1, ip->sectorSize, ip->fp) != (size_t)ip->sectorSize) {
+        ip->position = -1;
+        return ferror(ip->fp) ? Rk05ErrIo : Rk05ErrEof;
+    }
+
+    ip->position = index + 1;
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a sector.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         buffer of ip->sectorSize bytes
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05WriteSector(Rk05Image *ip, int cylinder, int head, int sector, const u8 *buf)
+{
+    Rk05Status status;
+    int index = rk05SectorIndex(ip, cylinder, head, sector);
+
+    if (index < 0) {
+        return Rk05ErrRange;
+    }
+
+    if (!ip->writable) {
+        return Rk05ErrReadOnly;
+    }
+
+    if (ip->map.data != NULL) {
+        if (Rk05HeaderSize + (size_t)(index + 1) * ip->sectorSize > ip->map.size) {
+            return Rk05ErrEof;
+        }
+
+        memcpy(ip->map.data + Rk05HeaderSize + (size_t)index * ip->sectorSize, buf, ip->sectorSize);
+        return Rk05Ok;
+    }
+
+    status = seekSector(ip, index, true);
+    if (status != Rk05Ok) {
+        return status;
+    }
+
+    if (fwrite(buf, 1, ip->sectorSize, ip->fp) != (size_t)ip->sectorSize) {
+        ip->position = -1;
+        return Rk05ErrIo;
+    }
+
+    ip->position = index + 1;
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read all sectors in cylinder, head, sector order and
+**                  pass each one to a callback.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  callback    function called for each sector
+**                  context     passed unchanged to the callback
+**
+**  Returns:        Rk05Ok if all sectors were read or the callback stopped
+**                  the iteration, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05ForEachSector(Rk05Image *ip, Rk05SectorCallback callback, void *context)
+{
+    Rk05Status status = Rk05Ok;
+    int cylinder;
+    int head;
+    int sector;
+    bool more = true;
+    u8 *buf;
+    const u8 *sp;
+
+    // In memory the callback gets the sector where it is.
+    if (ip->map.data != NULL) {
+        for (cylinder = 0; more && cylinder < ip->header.numberOfCylinders; cylinder++) {
+            for (head = 0; more && head < ip->header.numberOfHeads; head++) {
+                for (sector = 0; more && sector < ip->header.numberOfSectorsPerTrack; sector++) {
+                    sp = rk05SectorData(ip, cylinder, head, sector);
+                    if (sp == NULL) {
+                        return Rk05ErrEof;
+                    }
+                    more = callback(context, cylinder, head, sector, sp);
+                }
+            }
+        }
+
+        return Rk05Ok;
+    }
+
+    buf = (u8 *)malloc(ip->sectorSize);
+    if (buf == NULL) {
+        return Rk05ErrIo;
+    }
+
+    for (cylinder = 0; more && cylinder < ip->header.numberOfCylinders; cylinder++) {
+        for (head = 0; more && head < ip->header.numberOfHeads; head++) {
+            for (sector = 0; more && sector < ip->header.numberOfSectorsPerTrack; sector++) {
+                status = rk05ReadSector(ip, cylinder, head, sector, buf);
+                more = status == Rk05Ok && callback(context, cylinder, head, sector, buf);
+            }
+        }
+    }
+
+    free(buf);
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return a pointer to a sector of an image in memory.
+**                  The sector may only be written through the pointer if
+**                  the image is writable.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**
+**  Returns:        pointer to the sector, NULL if the image is not in
+**                  memory, the address is out of range or the file ends
+**                  before the sector
+**
+**------------------------------------------------------------------------*/
+u8 *rk05SectorData(Rk05Image *ip, int cylinder, int head, int sector)
+{
+    int index = rk05SectorIndex(ip, cylinder, head, sector);
+
+    if (ip->map.data == NULL || index < 0
+        || Rk05HeaderSize + (size_t)(index + 1) * ip->sectorSize > ip->map.size) {
+        return NULL;
+    }
+
+    return ip->map.data + Rk05HeaderSize + (size_t)index * ip->sectorSize;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check the header word and CRC of a sector.
+**
+**  Parameters:     Name        Description.
+**                  buf         pointer to sector
+**                  size        sector size in bytes
+**                  cylinder    cylinder address the sector was read from
+**
+**  Returns:        0 if the sector is good, otherwise Rk05SectorHeaderError
+**                  and/or Rk05SectorCrcError
+**
+**------------------------------------------------------------------------*/
+int rk05CheckSector(const u8 *buf, int size, int cylinder)
+{
+    int flags = 0;
+    int headerword = cylinder << 5;
+
+    if (   buf[0] != ((headerword >> 0) & 0xFF)
+        || buf[1] != ((headerword >> 8) & 0xFF)) {
+        flags |= Rk05SectorHeaderError;
+    }
+
+    // Calculate CRC starting with the sector data including the stored CRC.
+    // The result must be zero otherwise the sector has been corrupted.
+    if (crc16buf(0, buf + 2, size - 2) != 0) {
+        flags |= Rk05SectorCrcError;
+    }
+
+    return flags;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Set the header word and CRC of a sector whose data has
+**                  been filled in.
+**
+**  Parameters:     Name        Description.
+**                  buf         pointer to sector
+**                  size        sector size in bytes
+**                  cylinder    cylinder address of the sector
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05FormatSector(u8 *buf, int size, int cylinder)
+{
+    int headerword = cylinder << 5;
+    u16 crc;
+
+    // Write the header word in LSB order first.
+    buf[0] = (headerword >> 0) & 0xFF;
+    buf[1] = (headerword >> 8) & 0xFF;
+
+    // Write the CRC word of the data in LSB order first.
+    crc = crc16buf(0, buf + 2, size - 4);
+    buf[size - 2] = (crc >> 0) & 0xFF;
+    buf[size - 1] = (crc >> 8) & 0xFF;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Bring a whole file into memory, through a file mapping
+**                  if possible, otherwise by reading it into a buffer.
+**
+**  Parameters:     Name        Description.
+**                  fp          open file
+**                  writable    true if the memory will be written, the
+**                              file must be open for update
+**                  size        size to extend the file to, 0 to use the
+**                              file as it is
+**                  mp          pointer to mapping which will be set
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05MapFile(FILE *fp, bool writable, size_t size, Rk05Mapping *mp)
+{
+    long fileSize;
+    size_t rc;
+
+    memset(mp, 0, sizeof(*mp));
+
+    // Anything written through stdio must be in the file first.
+    if (fflush(fp) != 0 || fseek(fp, 0, SEEK_END) != 0 || (fileSize = ftell(fp)) < 0) {
+        return Rk05ErrIo;
+    }
+
+    if (size < (size_t)fileSize) {
+        size = (size_t)fileSize;
+    }
+
+    if (size == 0) {
+        return Rk05ErrEof;
+    }
+
+#if IMAGE_MMAP
+    if (size == (size_t)fileSize || ftruncate(fileno(fp), (off_t)size) == 0) {
+        void *p = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fileno(fp), 0);
+        if (p != MAP_FAILED) {
+            mp->data = (u8 *)p;
+            mp->size = size;
+            mp->mapped = true;
+            return Rk05Ok;
+        }
+    }
+#endif
+
+    // No mapping, read the file into a buffer of the full size.
+    mp->data = (u8 *)calloc(size, 1);
+    if (mp->data == NULL) {
+        return Rk05ErrIo;
+    }
+
+    rewind(fp);
+    rc = fread(mp->data, 1, (size_t)fileSize, fp);
+    if (rc != (size_t)fileSize) {
+        free(mp->data);
+        mp->data = NULL;
+        return Rk05ErrIo;
+    }
+
+    mp->size = size;
+    mp->mapped = false;
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release the memory of rk05MapFile. A writable buffer
+**                  copy is written back to the file in one piece.
+**
+**  Parameters:     Name        Description.
+**                  fp          file the memory belongs to
+**                  writable    true if the memory may have been written
+**                  mp          pointer to mapping
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05UnmapFile(FILE *fp, bool writable, Rk05Mapping *mp)
+{
+    Rk05Status status = Rk05Ok;
+
+    if (mp->data == NULL) {
+        return Rk05Ok;
+    }
+
+#if IMAGE_MMAP
+    if (mp->mapped) {
+        if (munmap(mp->data, mp->size) != 0) {
+            status = Rk05ErrIo;
+        }
+        memset(mp, 0, sizeof(*mp));
+        return status;
+    }
+#endif
+
+    if (writable) {
+        if (fseek(fp, 0, SEEK_SET) != 0 || fwrite(mp->data, 1, mp->size, fp) != mp->size) {
+            status = Rk05ErrIo;
+        }
+    }
+
+    free(mp->data);
+    memset(mp, 0, sizeof(*mp));
+    return status;
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store a big-endian integer.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 4 byte destination
+**                  value       integer value
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void putInt(u8 *bp, int value)
+{
+    bp[0] = (value >> 24) & 0xFF;
+    bp[1] = (value >> 16) & 0xFF;
+    bp[2] = (value >>  8) & 0xFF;
+    bp[3] = (value >>  0) & 0xFF;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Fetch a big-endian integer.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 4 byte source
+**
+**  Returns:        integer value
+**
+**------------------------------------------------------------------------*/
+static int getInt(const u8 *bp)
+{
+    return (int)(((u32)bp[0] << 24) | ((u32)bp[1] << 16) | ((u32)bp[2] << 8) | bp[3]);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store a string padded with zeroes to its field size.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to destination field
+**                  cp          pointer to string
+**                  size        size of the field in bytes
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void putString(u8 *bp, const char *cp, int size)
+{
+    size_t len = strnlen(cp, size - 1);
+
+    memcpy(bp, cp, len);
+    memset(bp + len, 0, size - 1 - len);
+    bp[size - 1] = '\0';
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Fetch a string field, enforcing the zero terminator.
+**
+**  Parameters:     Name        Description.
+**                  cp          pointer to destination string
+**                  bp          pointer to source field
+**                  size        size of the field in bytes
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void getString(char *cp, const u8 *bp, int size)
+{
+    memcpy(cp, bp, size);
+    cp[size - 1] = '\0';
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check that the header describes a usable disk.
+**
+**  Parameters:     Name        Description.
+**                  hp          pointer to header
+**
+**  Returns:        Rk05Ok if usable, Rk05ErrGeometry otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status checkGeometry(const Rk05Header *hp)
+{
+    // The sector must at least hold the header word and the CRC.
+    if (   hp->dataLength < 32 || hp->dataLength > 65536 || (hp->dataLength % 8) != 0
+        || hp->numberOfCylinders <= 0 || hp->numberOfCylinders > 4096
+        || hp->numberOfHeads <= 0 || hp->numberOfHeads > 16
+        || hp->numberOfSectorsPerTrack <= 0 || hp->numberOfSectorsPerTrack > 64) {
+        return Rk05ErrGeometry;
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Position the file at a sector. Sequential access does
+**                  not seek, so the stdio buffer is kept.
+**
+**  Parameters:     Name        Description.
+**                  ip          pointer to image handle
+**                  index       sector index
+**                  write       true if the next operation is a write
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status seekSector(Rk05Image *ip, int index, bool write)
+{
+    // A switch between reading and writing requires a positioning call.
+    if (ip->position == index && ip->lastOpWrite == write) {
+        return Rk05Ok;
+    }
+
+    if (fseek(ip->fp, Rk05HeaderSize + (long)index * ip->sectorSize, SEEK_SET) != 0) {
+        ip->position = -1;
+        return Rk05ErrIo;
+    }
+
+    ip->position = index;
+    ip->lastOpWrite = write;
+    return Rk05Ok;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
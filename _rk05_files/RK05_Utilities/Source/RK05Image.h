@@ -0,0 +1,146 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Image.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 Emulator image file library declarations.
+**
+**      All state of an open image is held in an Rk05Image handle, so any
+**      number of images may be open at once and separate handles may be
+**      used from separate threads.
+**
+**      An open image is accessed through stdio until rk05Map is called,
+**      then it is accessed in memory: through a file mapping where the
+**      host has one, otherwise through a copy of the whole file which is
+**      written back in one piece when a writable image is closed.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05IMAGE_H
+#define RK05IMAGE_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Util.h"
+
+/*
+**  ----------------
+**  Public Constants
+**  ----------------
+*/
+#define Rk05HeaderSize          381
+
+/*
+**  Flags returned by rk05CheckSector.
+*/
+#define Rk05SectorHeaderError   0x01
+#define Rk05SectorCrcError      0x02
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef enum rk05Status
+    {
+    Rk05Ok = 0,
+    Rk05ErrOpen,
+    Rk05ErrIo,
+    Rk05ErrEof,
+    Rk05ErrMagic,
+    Rk05ErrVersion,
+    Rk05ErrGeometry,
+    Rk05ErrRange,
+    Rk05ErrReadOnly,
+    Rk05ErrCorrupt,
+    } Rk05Status;
+
+typedef struct rk05Header
+    {
+    char magicNumber[10];
+    char versionNumber[4];
+
+    char imageName[11];
+    char imageDescription[200];
+    char imageDate[20];
+
+    char controller[100];
+    int bitRate;
+    int preamble1Length;
+    int preamble2Length;
+    int dataLength;
+    int postambleLength;
+    int numberOfCylinders;
+    int numberOfSectorsPerTrack;
+    int numberOfHeads;
+    int microsecondsPerSector;
+    } Rk05Header;
+
+typedef struct rk05Mapping
+    {
+    u8 *data;               // file contents, NULL if not in memory
+    size_t size;            // bytes at data
+    bool mapped;            // data is a file mapping, otherwise a malloc copy
+    } Rk05Mapping;
+
+typedef struct rk05Image
+    {
+    FILE *fp;
+    Rk05Header header;
+    bool writable;
+    bool created;           // new image, rk05Map extends it to full size
+    int sectorSize;
+    int sectorCount;
+    int position;           // sector index of the file position, -1 if unknown
+    bool lastOpWrite;       // a read following a write needs a seek and vice versa
+    Rk05Mapping map;        // whole image including the header after rk05Map
+    } Rk05Image;
+
+/*
+**  Called for each sector by rk05ForEachSector. Return false to stop the iteration.
+*/
+typedef bool (*Rk05SectorCallback)(void *context, int cylinder, int head, int sector, const u8 *buf);
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+void rk05InitHeader(Rk05Header *hp);
+Rk05Status rk05ReadHeader(FILE *fp, Rk05Header *hp);
+Rk05Status rk05WriteHeader(FILE *fp, const Rk05Header *hp);
+Rk05Status rk05DecodeHeader(const u8 *bp, int size, Rk05Header *hp);
+void rk05EncodeHeader(u8 *bp, const Rk05Header *hp);
+void rk05DisplayHeader(const Rk05Header *hp, bool detailed);
+int rk05SectorSize(const Rk05Header *hp);
+const char *rk05StatusText(Rk05Status status);
+
+Rk05Status rk05Open(Rk05Image *ip, const char *filename, bool writable);
+Rk05Status rk05Create(Rk05Image *ip, const char *filename, const Rk05Header *hp);
+Rk05Status rk05OpenStream(Rk05Image *ip, FILE *fp, bool writable);
+Rk05Status rk05CreateStream(Rk05Image *ip, FILE *fp, const Rk05Header *hp);
+Rk05Status rk05UpdateHeader(Rk05Image *ip);
+Rk05Status rk05Map(Rk05Image *ip);
+Rk05Status rk05Close(Rk05Image *ip);
+
+Rk05Status rk05MapFile(FILE *fp, bool writable, size_t size, Rk05Mapping *mp);
+Rk05Status rk05UnmapFile(FILE *fp, bool writable, Rk05Mapping *mp);
+
+int rk05SectorIndex(const Rk05Image *ip, int cylinder, int head, int sector);
+Rk05Status rk05ReadSector(Rk05Image *ip, int cylinder, int head, int sector, u8 *buf);
+Rk05Status rk05WriteSector(Rk05Image *ip, int cylinder, int head, int sector, const u8 *buf);
+Rk05Status rk05ForEachSector(Rk05Image *ip, Rk05SectorCallback callback, void *context);
+u8 *rk05SectorData(Rk05Image *ip, int cylinder, int head, int sector);
+
+int rk05CheckSector(const u8 *buf, int size, int cylinder);
+void rk05FormatSector(u8 *buf, int size, int cylinder);
+
+#endif /* RK05IMAGE_H */
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,552 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Pack.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      12 bit word pack and unpack kernels.
+**
+**      scalar  two words per step, the original conversion loops.
+**      ssse3   eight words per step with a byte shuffle (x86).
+**      avx2    sixteen words per step with a byte shuffle and a dword
+**              permute (x86).
+**      neon    thirty two words per step with interleaved loads and
+**              stores (ARM).
+**
+**      The vector kernels load and store whole registers, up to 8 bytes
+**      past the words of one step. They only run while enough words
+**      follow that the extra bytes are inside the buffers and are
+**      written again by the next step. The last words always go through
+**      the scalar kernel.
+**
+**      The kernel used is chosen once at program start from the CPU
+**      features. The environment variable RK05_PACK set to a kernel name
+**      overrides the choice.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Pack.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PACK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define PACK_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PACK_NEON 1
+#include <arm_neon.h>
+#else
+#define PACK_NEON 0
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+#define MaxKernels      4
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#if PACK_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define SSSE3_TARGET
+#define AVX2_TARGET
+#endif
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static const Rk05PackKernel *packSelect(void);
+#if PACK_X86
+static bool cpuHasSsse3(void);
+static bool cpuHasAvx2(void);
+static void packSsse3(u8 *dst, const u8 *src, int words);
+static void unpackSsse3(u8 *dst, const u8 *src, int words);
+static void packAvx2(u8 *dst, const u8 *src, int words);
+static void unpackAvx2(u8 *dst, const u8 *src, int words);
+#endif
+#if PACK_NEON
+static void packNeon(u8 *dst, const u8 *src, int words);
+static void unpackNeon(u8 *dst, const u8 *src, int words);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static Rk05PackKernel kernels[MaxKernels];
+static int kernelCount;
+static const Rk05PackKernel *kernel = packSelect();
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack SIMH words with the fastest kernel available.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 3 / 2 packed bytes
+**                  src         pointer to words * 2 SIMH bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05PackWords(u8 *dst, const u8 *src, int words)
+{
+    kernel->pack(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack words to SIMH format with the fastest kernel
+**                  available.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 2 SIMH bytes
+**                  src         pointer to words * 3 / 2 packed bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05UnpackWords(u8 *dst, const u8 *src, int words)
+{
+    kernel->unpack(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack SIMH words two at a time.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 3 / 2 packed bytes
+**                  src         pointer to words * 2 SIMH bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05PackScalar(u8 *dst, const u8 *src, int words)
+{
+    u8 tmp;
+
+    for (; words >= 2; words -= 2) {
+        *dst++ = *src++;
+        tmp  = (*src++ >> 0) & 0x0F;
+        tmp |= (*src   << 4) & 0xF0;
+        *dst++ = tmp;
+        tmp  = (*src++ >> 4) & 0x0F;
+        tmp |= (*src++ << 4) & 0xF0;
+        *dst++ = tmp;
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack words to SIMH format two at a time.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 2 SIMH bytes
+**                  src         pointer to words * 3 / 2 packed bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05UnpackScalar(u8 *dst, const u8 *src, int words)
+{
+    u8 tmp;
+
+    for (; words >= 2; words -= 2) {
+        *dst++ = *src++;
+        *dst++ = (*src   >> 0) & 0x0F;
+        tmp    = (*src++ >> 4) & 0x0F;
+        tmp   |= (*src   << 4) & 0xF0;
+        *dst++ = tmp;
+        *dst++ = (*src++ >> 4) & 0x0F;
+    }
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the name of the kernel used by rk05PackWords
+**                  and rk05UnpackWords.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        kernel name
+**
+**------------------------------------------------------------------------*/
+const char *rk05PackKernelName(void)
+{
+    return kernel->name;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the kernels which can run on this host, scalar
+**                  first.
+**
+**  Parameters:     Name        Description.
+**                  kernelsp    pointer which will be set to the kernels
+**
+**  Returns:        number of kernels
+**
+**------------------------------------------------------------------------*/
+int rk05PackKernels(const Rk05PackKernel **kernelsp)
+{
+    *kernelsp = kernels;
+    return kernelCount;
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        List the kernels which can run on this host and choose
+**                  the one used by default. Runs once before main.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        pointer to the chosen kernel
+**
+**------------------------------------------------------------------------*/
+static const Rk05PackKernel *packSelect(void)
+{
+    const char *override = getenv("RK05_PACK");
+    int i;
+
+    kernels[kernelCount].name = "scalar";
+    kernels[kernelCount].pack = rk05PackScalar;
+    kernels[kernelCount].unpack = rk05UnpackScalar;
+    kernelCount++;
+
+#if PACK_X86
+    if (cpuHasSsse3()) {
+        kernels[kernelCount].name = "ssse3";
+        kernels[kernelCount].pack = packSsse3;
+        kernels[kernelCount].unpack = unpackSsse3;
+        kernelCount++;
+    }
+
+    if (cpuHasAvx2()) {
+        kernels[kernelCount].name = "avx2";
+        kernels[kernelCount].pack = packAvx2;
+        kernels[kernelCount].unpack = unpackAvx2;
+        kernelCount++;
+    }
+#endif
+
+#if PACK_NEON
+    kernels[kernelCount].name = "neon";
+    kernels[kernelCount].pack = packNeon;
+    kernels[kernelCount].unpack = unpackNeon;
+    kernelCount++;
+#endif
+
+    if (override != NULL) {
+        for (i = 0; i < kernelCount; i++) {
+            if (strcmp(override, kernels[i].name) == 0) {
+                return &kernels[i];
+            }
+        }
+    }
+
+    // The kernels are listed slowest first.
+    return &kernels[kernelCount - 1];
+}
+
+#if PACK_X86
+/*--------------------------------------------------------------------------
+**  Purpose:        Check the CPU for SSSE3.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if SSSE3 can be used
+**
+**------------------------------------------------------------------------*/
+static bool cpuHasSsse3(void)
+{
+#if defined(_MSC_VER)
+    int regs[4];
+
+    __cpuid(regs, 1);
+    return (regs[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Check the CPU and operating system for AVX2.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        true if AVX2 can be used
+**
+**------------------------------------------------------------------------*/
+static bool cpuHasAvx2(void)
+{
+#if defined(_MSC_VER)
+    int regs[4];
+
+    // AVX needs the OS to save the YMM registers, OSXSAVE and XCR0 bits 1-2.
+    __cpuid(regs, 1);
+    if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(regs, 7, 0);
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack SIMH words eight at a time with SSSE3.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 3 / 2 packed bytes
+**                  src         pointer to words * 2 SIMH bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static SSSE3_TARGET void packSsse3(u8 *dst, const u8 *src, int words)
+{
+    const __m128i mask12 = _mm_set1_epi16(0x0FFF);
+    const __m128i maskLow = _mm_set1_epi32(0x0000FFFF);
+    const __m128i compact = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m128i x;
+
+    // Each dword becomes w0 | w1 << 12, then the top byte of each dword is
+    // squeezed out. The 16 byte store writes 4 bytes the next step rewrites.
+    while (words >= 16) {
+        x = _mm_and_si128(_mm_loadu_si128((const __m128i *)src), mask12);
+        x = _mm_or_si128(_mm_and_si128(x, maskLow), _mm_slli_epi32(_mm_srli_epi32(x, 16), 12));
+        _mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi8(x, compact));
+        src += 16;
+        dst += 12;
+        words -= 8;
+    }
+
+    rk05PackScalar(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack words to SIMH format eight at a time with SSSE3.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 2 SIMH bytes
+**                  src         pointer to words * 3 / 2 packed bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static SSSE3_TARGET void unpackSsse3(u8 *dst, const u8 *src, int words)
+{
+    const __m128i mask0 = _mm_set1_epi32(0x00000FFF);
+    const __m128i mask1 = _mm_set1_epi32(0x0FFF0000);
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i x;
+
+    // Each 3 byte group goes to a dword as w0 | w1 << 12, then w1 moves up
+    // to bit 16. The 16 byte load reads 4 bytes of the next step.
+    while (words >= 16) {
+        x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)src), spread);
+        x = _mm_or_si128(_mm_and_si128(x, mask0), _mm_and_si128(_mm_slli_epi32(x, 4), mask1));
+        _mm_storeu_si128((__m128i *)dst, x);
+        src += 12;
+        dst += 16;
+        words -= 8;
+    }
+
+    rk05UnpackScalar(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack SIMH words sixteen at a time with AVX2.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 3 / 2 packed bytes
+**                  src         pointer to words * 2 SIMH bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static AVX2_TARGET void packAvx2(u8 *dst, const u8 *src, int words)
+{
+    const __m256i mask12 = _mm256_set1_epi16(0x0FFF);
+    const __m256i maskLow = _mm256_set1_epi32(0x0000FFFF);
+    const __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                             0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    __m256i x;
+
+    // As SSSE3 in each 128 bit lane, then the two 12 byte results are
+    // joined. The 32 byte store writes 8 bytes the next step rewrites.
+    while (words >= 24) {
+        x = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)src), mask12);
+        x = _mm256_or_si256(_mm256_and_si256(x, maskLow), _mm256_slli_epi32(_mm256_srli_epi32(x, 16), 12));
+        x = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(x, compact), join);
+        _mm256_storeu_si256((__m256i *)dst, x);
+        src += 32;
+        dst += 24;
+        words -= 16;
+    }
+
+    packSsse3(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack words to SIMH format sixteen at a time with AVX2.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 2 SIMH bytes
+**                  src         pointer to words * 3 / 2 packed bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static AVX2_TARGET void unpackAvx2(u8 *dst, const u8 *src, int words)
+{
+    const __m256i mask0 = _mm256_set1_epi32(0x00000FFF);
+    const __m256i mask1 = _mm256_set1_epi32(0x0FFF0000);
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i split = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    __m256i x;
+
+    // Bytes 0-11 go to the low lane and bytes 12-23 to the high lane, then
+    // as SSSE3. The 32 byte load reads 8 bytes of the next step.
+    while (words >= 24) {
+        x = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)src), split);
+        x = _mm256_shuffle_epi8(x, spread);
+        x = _mm256_or_si256(_mm256_and_si256(x, mask0), _mm256_and_si256(_mm256_slli_epi32(x, 4), mask1));
+        _mm256_storeu_si256((__m256i *)dst, x);
+        src += 24;
+        dst += 32;
+        words -= 16;
+    }
+
+    unpackSsse3(dst, src, words);
+}
+#endif
+
+#if PACK_NEON
+/*--------------------------------------------------------------------------
+**  Purpose:        Pack SIMH words thirty two at a time with NEON.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 3 / 2 packed bytes
+**                  src         pointer to words * 2 SIMH bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void packNeon(u8 *dst, const u8 *src, int words)
+{
+    uint8x16x4_t in;
+    uint8x16x3_t out;
+    const uint8x16_t mask4 = vdupq_n_u8(0x0F);
+
+    // De-interleaving loads give the four bytes of each word pair in
+    // separate registers, so the scalar expressions apply directly.
+    while (words >= 32) {
+        in = vld4q_u8(src);
+        out.val[0] = in.val[0];
+        out.val[1] = vorrq_u8(vandq_u8(in.val[1], mask4), vshlq_n_u8(in.val[2], 4));
+        out.val[2] = vorrq_u8(vshrq_n_u8(in.val[2], 4), vshlq_n_u8(in.val[3], 4));
+        vst3q_u8(dst, out);
+        src += 64;
+        dst += 48;
+        words -= 32;
+    }
+
+    rk05PackScalar(dst, src, words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Unpack words to SIMH format thirty two at a time with
+**                  NEON.
+**
+**  Parameters:     Name        Description.
+**                  dst         pointer to words * 2 SIMH bytes
+**                  src         pointer to words * 3 / 2 packed bytes
+**                  words       number of words, even
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void unpackNeon(u8 *dst, const u8 *src, int words)
+{
+    uint8x16x3_t in;
+    uint8x16x4_t out;
+    const uint8x16_t mask4 = vdupq_n_u8(0x0F);
+
+    while (words >= 32) {
+        in = vld3q_u8(src);
+        out.val[0] = in.val[0];
+        out.val[1] = vandq_u8(in.val[1], mask4);
+        out.val[2] = vorrq_u8(vshrq_n_u8(in.val[1], 4), vshlq_n_u8(in.val[2], 4));
+        out.val[3] = vshrq_n_u8(in.val[2], 4);
+        vst4q_u8(dst, out);
+        src += 48;
+        dst += 64;
+        words -= 32;
+    }
+
+    rk05UnpackScalar(dst, src, words);
+}
+#endif
+
+/*---------------------------  End Of File  ------------------------------*/
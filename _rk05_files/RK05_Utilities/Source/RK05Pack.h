@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Pack.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      12 bit word pack and unpack kernel declarations.
+**
+**      SIMH stores each 12 bit word little-endian in 16 bits. The RK05
+**      Emulator image packs two words into three bytes:
+**
+**          SIMH            packed
+**          0x21 0x03       0x21
+**          0x54 0x06  <=>  0x43
+**                          0x65
+**
+**      rk05PackWords and rk05UnpackWords use the fastest kernel available
+**      on the host. The word count must be even. The high 4 bits of each
+**      SIMH word are ignored when packing and zero when unpacking.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05PACK_H
+#define RK05PACK_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Util.h"
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef void (*Rk05PackFunction)(u8 *dst, const u8 *src, int words);
+
+typedef struct rk05PackKernel
+    {
+    const char *name;
+    Rk05PackFunction pack;
+    Rk05PackFunction unpack;
+    } Rk05PackKernel;
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+void rk05PackWords(u8 *dst, const u8 *src, int words);
+void rk05UnpackWords(u8 *dst, const u8 *src, int words);
+void rk05PackScalar(u8 *dst, const u8 *src, int words);
+void rk05UnpackScalar(u8 *dst, const u8 *src, int words);
+const char *rk05PackKernelName(void);
+int rk05PackKernels(const Rk05PackKernel **kernels);
+
+#endif /* RK05PACK_H */
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,423 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Patch.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 Emulator image patch files.
+**
+**      The check hash at the end of a patch file is built up part by
+**      part as the file is written: each part is hashed with the hash of
+**      the parts before it as the seed. The parts are the 44 byte fixed
+**      header, the target header, and the 8 byte head and the data of
+**      each run.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Patch.h"
+#include "RK05Hash.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+static const char patchMagic[8] = { 'R', 'K', '0', '5', 'P', 'T', 'C', 'H' };
+
+#define PatchVersion        1
+#define PatchFixedSize      44
+#define PatchHasHeader      0x01
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void putU32(u8 *bp, u32 value);
+static u32 getU32(const u8 *bp);
+static bool writePart(FILE *fp, const u8 *bp, size_t size, u64 *check);
+static Rk05Status readPart(FILE *fp, u8 *bp, size_t size, u64 *check);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Initialise an empty patch.
+**
+**  Parameters:     Name        Description.
+**                  pp          pointer to patch
+**                  sectorSize  sector size of both images
+**                  sectorCount sector count of both images
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05InitPatch(Rk05Patch *pp, int sectorSize, int sectorCount)
+{
+    memset(pp, 0, sizeof(*pp));
+    pp->sectorSize = sectorSize;
+    pp->sectorCount = sectorCount;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add a run of sectors taken from the target image.
+**
+**  Parameters:     Name        Description.
+**                  pp          pointer to patch
+**                  ip          target image
+**                  first       first sector index
+**                  count       number of sectors
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05AddPatchRun(Rk05Patch *pp, Rk05Image *ip, int first, int count)
+{
+    Rk05PatchRun *rp;
+    Rk05Status status;
+    int track;
+    int i;
+
+    if (pp->runCount == pp->runsAllocated) {
+        pp->runsAllocated = pp->runsAllocated == 0 ? 64 : pp->runsAllocated * 2;
+        rp = (Rk05PatchRun *)realloc(pp->runs, pp->runsAllocated * sizeof(Rk05PatchRun));
+        if (rp == NULL) {
+            return Rk05ErrIo;
+        }
+        pp->runs = rp;
+    }
+
+    rp = &pp->runs[pp->runCount];
+    rp->first = first;
+    rp->count = count;
+    rp->data = (u8 *)malloc((size_t)count * pp->sectorSize);
+    if (rp->data == NULL) {
+        return Rk05ErrIo;
+    }
+
+    for (i = 0; i < count; i++) {
+        track = (first + i) / ip->header.numberOfSectorsPerTrack;
+        status = rk05ReadSector(ip, track / ip->header.numberOfHeads, track % ip->header.numberOfHeads,
+                                (first + i) % ip->header.numberOfSectorsPerTrack,
+                                rp->data + (size_t)i * pp->sectorSize);
+        if (status != Rk05Ok) {
+            free(rp->data);
+            return status;
+        }
+    }
+
+    pp->runCount += 1;
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write a patch file.
+**
+**  Parameters:     Name        Description.
+**                  fp          file open for writing
+**                  pp          pointer to patch
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05WritePatch(FILE *fp, const Rk05Patch *pp)
+{
+    u8 buf[PatchFixedSize];
+    u64 check = 0;
+    bool ok;
+    int i;
+
+    memcpy(buf, patchMagic, sizeof(patchMagic));
+    putU32(buf + 8, PatchVersion);
+    putU32(buf + 12, pp->sectorSize);
+    putU32(buf + 16, pp->sectorCount);
+    rk05PutU64(buf + 20, pp->baseHash);
+    rk05PutU64(buf + 28, pp->targetHash);
+    putU32(buf + 36, pp->hasHeader ? PatchHasHeader : 0);
+    putU32(buf + 40, pp->runCount);
+    ok = writePart(fp, buf, PatchFixedSize, &check);
+
+    if (ok && pp->hasHeader) {
+        ok = writePart(fp, pp->header, Rk05HeaderSize, &check);
+    }
+
+    for (i = 0; ok && i < pp->runCount; i++) {
+        putU32(buf, pp->runs[i].first);
+        putU32(buf + 4, pp->runs[i].count);
+        ok = writePart(fp, buf, 8, &check)
+             && writePart(fp, pp->runs[i].data, (size_t)pp->runs[i].count * pp->sectorSize, &check);
+    }
+
+    rk05PutU64(buf, check);
+    if (!ok || fwrite(buf, 1, 8, fp) != 8) {
+        return Rk05ErrIo;
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and check a patch file.
+**
+**  Parameters:     Name        Description.
+**                  fp          file open for reading
+**                  pp          pointer to patch which will be set, free
+**                              with rk05FreePatch even on error
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05ReadPatch(FILE *fp, Rk05Patch *pp)
+{
+    u8 buf[PatchFixedSize];
+    Rk05PatchRun *rp;
+    Rk05Status status;
+    u64 check = 0;
+    int runCount;
+    int i;
+
+    rk05InitPatch(pp, 0, 0);
+
+    status = readPart(fp, buf, PatchFixedSize, &check);
+    if (status != Rk05Ok) {
+        return status;
+    }
+
+    if (memcmp(buf, patchMagic, sizeof(patchMagic)) != 0) {
+        return Rk05ErrMagic;
+    }
+
+    if (getU32(buf + 8) != PatchVersion) {
+        return Rk05ErrVersion;
+    }
+
+    pp->sectorSize = (int)getU32(buf + 12);
+    pp->sectorCount = (int)getU32(buf + 16);
+    pp->baseHash = rk05GetU64(buf + 20);
+    pp->targetHash = rk05GetU64(buf + 28);
+    pp->hasHeader = (getU32(buf + 36) & PatchHasHeader) != 0;
+    runCount = (int)getU32(buf + 40);
+
+    if (   pp->sectorSize <= 0 || pp->sectorSize > 65536 / 8
+        || pp->sectorCount <= 0 || runCount < 0 || runCount > pp->sectorCount) {
+        return Rk05ErrGeometry;
+    }
+
+    if (pp->hasHeader) {
+        status = readPart(fp, pp->header, Rk05HeaderSize, &check);
+        if (status != Rk05Ok) {
+            return status;
+        }
+    }
+
+    pp->runs = (Rk05PatchRun *)calloc(runCount > 0 ? runCount : 1, sizeof(Rk05PatchRun));
+    if (pp->runs == NULL) {
+        return Rk05ErrIo;
+    }
+    pp->runsAllocated = runCount;
+
+    for (i = 0; i < runCount; i++) {
+        rp = &pp->runs[i];
+        status = readPart(fp, buf, 8, &check);
+        if (status != Rk05Ok) {
+            return status;
+        }
+
+        rp->first = (int)getU32(buf);
+        rp->count = (int)getU32(buf + 4);
+        if (   rp->first < 0 || rp->count <= 0
+            || rp->first > pp->sectorCount - rp->count) {
+            return Rk05ErrRange;
+        }
+
+        rp->data = (u8 *)malloc((size_t)rp->count * pp->sectorSize);
+        if (rp->data == NULL) {
+            return Rk05ErrIo;
+        }
+        pp->runCount = i + 1;
+
+        status = readPart(fp, rp->data, (size_t)rp->count * pp->sectorSize, &check);
+        if (status != Rk05Ok) {
+            return status;
+        }
+    }
+
+    if (fread(buf, 1, 8, fp) != 8) {
+        return ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+    }
+
+    if (rk05GetU64(buf) != check) {
+        return Rk05ErrCorrupt;
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Free the runs of a patch.
+**
+**  Parameters:     Name        Description.
+**                  pp          pointer to patch
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05FreePatch(Rk05Patch *pp)
+{
+    int i;
+
+    for (i = 0; i < pp->runCount; i++) {
+        free(pp->runs[i].data);
+    }
+
+    free(pp->runs);
+    pp->runs = NULL;
+    pp->runCount = 0;
+    pp->runsAllocated = 0;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Hash the sector hashes of an image into one value.
+**
+**  Parameters:     Name        Description.
+**                  hashes      sector hashes in sector index order
+**                  count       number of sectors
+**
+**  Returns:        image hash
+**
+**------------------------------------------------------------------------*/
+u64 rk05ImageHash(const u64 *hashes, int count)
+{
+    u64 hash = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        hash = rk05HashCombine(hash, hashes[i]);
+    }
+
+    return hash;
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store a 32 bit value in little-endian byte order.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 4 bytes
+**                  value       value to store
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void putU32(u8 *bp, u32 value)
+{
+    bp[0] = (u8)(value >> 0);
+    bp[1] = (u8)(value >> 8);
+    bp[2] = (u8)(value >> 16);
+    bp[3] = (u8)(value >> 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Load a 32 bit value stored in little-endian byte order.
+**
+**  Parameters:     Name        Description.
+**                  bp          pointer to 4 bytes
+**
+**  Returns:        value
+**
+**------------------------------------------------------------------------*/
+static u32 getU32(const u8 *bp)
+{
+    return (u32)bp[0] | ((u32)bp[1] << 8) | ((u32)bp[2] << 16) | ((u32)bp[3] << 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write one part of a patch file and add it to the check
+**                  hash.
+**
+**  Parameters:     Name        Description.
+**                  fp          file open for writing
+**                  bp          pointer to part
+**                  size        part size in bytes
+**                  check       running check hash
+**
+**  Returns:        true if successful
+**
+**------------------------------------------------------------------------*/
+static bool writePart(FILE *fp, const u8 *bp, size_t size, u64 *check)
+{
+    *check = rk05Hash64(bp, size, *check);
+    return fwrite(bp, 1, size, fp) == size;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read one part of a patch file and add it to the check
+**                  hash.
+**
+**  Parameters:     Name        Description.
+**                  fp          file open for reading
+**                  bp          pointer to buffer for the part
+**                  size        part size in bytes
+**                  check       running check hash
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status readPart(FILE *fp, u8 *bp, size_t size, u64 *check)
+{
+    if (fread(bp, 1, size, fp) != size) {
+        return ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+    }
+
+    *check = rk05Hash64(bp, size, *check);
+    return Rk05Ok;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,86 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Patch.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      RK05 Emulator image patch file declarations.
+**
+**      A patch holds the runs of sectors which differ between a base
+**      image and a target image, and the target image header if it
+**      differs. All values are little-endian.
+**
+**          offset  size
+**               0     8    magic "RK05PTCH"
+**               8     4    version, 1
+**              12     4    sector size
+**              16     4    sector count
+**              20     8    base image hash
+**              28     8    target image hash
+**              36     4    flags, bit 0 set if a target header follows
+**              40     4    number of runs
+**              44   381    target header, if present
+**                          then for each run:
+**                     4      first sector index
+**                     4      number of sectors
+**                     n      the target sectors
+**                     8    check hash of everything before it
+**
+**      An image hash is rk05ImageHash of the sector hashes, so a patch
+**      can be checked against an image before anything is written and
+**      the result can be checked before it is written back.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05PATCH_H
+#define RK05PATCH_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef struct rk05PatchRun
+    {
+    int first;                  // first sector index
+    int count;                  // number of sectors
+    u8 *data;                   // count target sectors
+    } Rk05PatchRun;
+
+typedef struct rk05Patch
+    {
+    int sectorSize;
+    int sectorCount;
+    u64 baseHash;
+    u64 targetHash;
+    bool hasHeader;
+    u8 header[Rk05HeaderSize];  // encoded target header if hasHeader
+    int runCount;
+    int runsAllocated;
+    Rk05PatchRun *runs;
+    } Rk05Patch;
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+void rk05InitPatch(Rk05Patch *pp, int sectorSize, int sectorCount);
+Rk05Status rk05AddPatchRun(Rk05Patch *pp, Rk05Image *ip, int first, int count);
+Rk05Status rk05WritePatch(FILE *fp, const Rk05Patch *pp);
+Rk05Status rk05ReadPatch(FILE *fp, Rk05Patch *pp);
+void rk05FreePatch(Rk05Patch *pp);
+u64 rk05ImageHash(const u64 *hashes, int count);
+
+#endif /* RK05PATCH_H */
+
+/*---------------------------  End Of File  ------------------------------*/
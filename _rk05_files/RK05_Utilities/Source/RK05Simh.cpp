@@ -0,0 +1,344 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Simh.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      SIMH RK05 disk image conversion.
+**
+**      The conversion loops are templates on the word size and the words
+**      per sector, so each controller gets its own copy with the sector
+**      sizes known at compile time. The word format of a word size packs
+**      and unpacks the data words of one sector.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Simh.h"
+#include "RK05Pack.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+template <int Bits> struct WordFormat;
+
+/*
+**  12 bit words, two packed into three bytes by the fastest pack kernel.
+*/
+template <> struct WordFormat<12>
+    {
+    enum { SimhBytes = 2 };
+
+    static void pack(u8 *dst, const u8 *src, int words)
+        {
+        rk05PackWords(dst, src, words);
+        }
+
+    static void unpack(u8 *dst, const u8 *src, int words)
+        {
+        rk05UnpackWords(dst, src, words);
+        }
+    };
+
+/*
+**  16 bit words, the packed data is the SIMH data.
+*/
+template <> struct WordFormat<16>
+    {
+    enum { SimhBytes = 2 };
+
+    static void pack(u8 *dst, const u8 *src, int words)
+        {
+        memcpy(dst, src, (size_t)words * 2);
+        }
+
+    static void unpack(u8 *dst, const u8 *src, int words)
+        {
+        memcpy(dst, src, (size_t)words * 2);
+        }
+    };
+
+/*
+**  Sizes of a sector of Words words of Bits bits.
+*/
+template <int Bits, int Words> struct SectorLayout
+    {
+    enum
+        {
+        SimhSize = Words * WordFormat<Bits>::SimhBytes,
+        SectorSize = (Words * Bits) / 8 + 2 + 2,
+        };
+    };
+
+typedef struct simhKernels
+    {
+    int wordBits;
+    int wordsPerSector;
+    void (*toSector)(const u8 *simh, u8 *buf, int cylinder);
+    void (*toSimh)(const u8 *buf, u8 *simh);
+    Rk05Status (*toImage)(const u8 *simh, size_t size, Rk05Image *ip);
+    } SimhKernels;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+template <int Bits, int Words> static void simhToSector(const u8 *simh, u8 *buf, int cylinder);
+template <int Bits, int Words> static void sectorToSimh(const u8 *buf, u8 *simh);
+template <int Bits, int Words> static Rk05Status simhToImage(const u8 *simh, size_t size, Rk05Image *ip);
+static const SimhKernels *findKernels(const Rk05Geometry *gp);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+static const SimhKernels kernels[] =
+    {
+        { 12, 256, simhToSector<12, 256>, sectorToSimh<12, 256>, simhToImage<12, 256> },
+        { 16, 256, simhToSector<16, 256>, sectorToSimh<16, 256>, simhToImage<16, 256> },
+    };
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert one SIMH sector into an RK05 Emulator sector.
+**
+**  Parameters:     Name        Description.
+**                  gp          controller geometry
+**                  simh        SIMH sector of gp->simhSectorSize bytes
+**                  buf         sector of gp->sectorSize bytes to fill in
+**                  cylinder    cylinder address of the sector
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrGeometry if the word
+**                  format is not supported
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05SimhToSector(const Rk05Geometry *gp, const u8 *simh, u8 *buf, int cylinder)
+{
+    const SimhKernels *kp = findKernels(gp);
+
+    if (kp == NULL) {
+        return Rk05ErrGeometry;
+    }
+
+    kp->toSector(simh, buf, cylinder);
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert the data of one RK05 Emulator sector into a
+**                  SIMH sector. The header word and CRC are not checked.
+**
+**  Parameters:     Name        Description.
+**                  gp          controller geometry
+**                  buf         sector of gp->sectorSize bytes
+**                  simh        SIMH sector of gp->simhSectorSize bytes to
+**                              fill in
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrGeometry if the word
+**                  format is not supported
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05SectorToSimh(const Rk05Geometry *gp, const u8 *buf, u8 *simh)
+{
+    const SimhKernels *kp = findKernels(gp);
+
+    if (kp == NULL) {
+        return Rk05ErrGeometry;
+    }
+
+    kp->toSimh(buf, simh);
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert a SIMH image in memory into all sectors of an
+**                  RK05 Emulator image. A short SIMH image is padded with
+**                  zeros.
+**
+**  Parameters:     Name        Description.
+**                  simh        SIMH image contents
+**                  size        bytes at simh
+**                  ip          pointer to image handle, mapped by rk05Map
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrGeometry if the image
+**                  layout has no SIMH conversion, Rk05ErrIo if the image
+**                  is not in memory.
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05SimhToImage(const u8 *simh, size_t size, Rk05Image *ip)
+{
+    const Rk05Geometry *gp = rk05FindGeometry(&ip->header);
+    const SimhKernels *kp;
+
+    if (gp == NULL || (kp = findKernels(gp)) == NULL) {
+        return Rk05ErrGeometry;
+    }
+
+    return kp->toImage(simh, size, ip);
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert one SIMH sector into an RK05 Emulator sector.
+**
+**  Parameters:     Name        Description.
+**                  simh        SIMH sector
+**                  buf         sector to fill in
+**                  cylinder    cylinder address of the sector
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+template <int Bits, int Words> static void simhToSector(const u8 *simh, u8 *buf, int cylinder)
+{
+    // Pack the SIMH words following the header word.
+    WordFormat<Bits>::pack(buf + 2, simh, Words);
+
+    // Add the header word and the CRC word.
+    rk05FormatSector(buf, SectorLayout<Bits, Words>::SectorSize, cylinder);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert the data of one RK05 Emulator sector into a
+**                  SIMH sector.
+**
+**  Parameters:     Name        Description.
+**                  buf         sector
+**                  simh        SIMH sector to fill in
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+template <int Bits, int Words> static void sectorToSimh(const u8 *buf, u8 *simh)
+{
+    // Unpack the data following the header word into zero padded SIMH words.
+    WordFormat<Bits>::unpack(simh, buf + 2, Words);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Convert a SIMH image in memory into all sectors of an
+**                  RK05 Emulator image.
+**
+**  Parameters:     Name        Description.
+**                  simh        SIMH image contents
+**                  size        bytes at simh
+**                  ip          pointer to image handle, mapped by rk05Map
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrGeometry if the image
+**                  sectors do not match the layout, Rk05ErrIo if the
+**                  image is not in memory.
+**
+**------------------------------------------------------------------------*/
+template <int Bits, int Words> static Rk05Status simhToImage(const u8 *simh, size_t size, Rk05Image *ip)
+{
+    const int simhSize = SectorLayout<Bits, Words>::SimhSize;
+    u8 padBuf[SectorLayout<Bits, Words>::SimhSize];
+    size_t offset = 0;
+    const u8 *sp;
+    u8 *op;
+    int sectorcount;
+    int headcount;
+    int cylindercount;
+
+    if (ip->sectorSize != SectorLayout<Bits, Words>::SectorSize) {
+        return Rk05ErrGeometry;
+    }
+
+    for (cylindercount = 0; cylindercount <  ip->header.numberOfCylinders; cylindercount++){
+        for (headcount = 0; headcount <  ip->header.numberOfHeads; headcount++){
+            for (sectorcount = 0; sectorcount <  ip->header.numberOfSectorsPerTrack; sectorcount++){
+                if (offset + simhSize <= size) {
+                    // Convert the SIMH sector where it is.
+                    sp = simh + offset;
+                } else {
+                    // Pad trailing part of partial sector and all missing sectors.
+                    memset(padBuf, 0, simhSize);
+                    if (offset < size) {
+                        memcpy(padBuf, simh + offset, size - offset);
+                    }
+                    sp = padBuf;
+                }
+                offset += simhSize;
+
+                op = rk05SectorData(ip, cylindercount, headcount, sectorcount);
+                if (op == NULL) {
+                    return Rk05ErrIo;
+                }
+
+                simhToSector<Bits, Words>(sp, op, cylindercount);
+            }
+        }
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find the conversion kernels for a controller.
+**
+**  Parameters:     Name        Description.
+**                  gp          controller geometry
+**
+**  Returns:        pointer to kernels, NULL if there are none
+**
+**------------------------------------------------------------------------*/
+static const SimhKernels *findKernels(const Rk05Geometry *gp)
+{
+    int i;
+
+    for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i++) {
+        if (kernels[i].wordBits == gp->wordBits && kernels[i].wordsPerSector == gp->wordsPerSector) {
+            return &kernels[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Simh.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      SIMH RK05 disk image conversion declarations.
+**
+**      A SIMH RK05 image holds the sectors in the same order as the RK05
+**      Emulator image, each as little-endian words with the data in the
+**      low bits, see RK05Geometry.h. Conversion fails with
+**      Rk05ErrGeometry for a controller without a word format.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05SIMH_H
+#define RK05SIMH_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+#include "RK05Geometry.h"
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+Rk05Status rk05SimhToSector(const Rk05Geometry *gp, const u8 *simh, u8 *buf, int cylinder);
+Rk05Status rk05SectorToSimh(const Rk05Geometry *gp, const u8 *buf, u8 *simh);
+Rk05Status rk05SimhToImage(const u8 *simh, size_t size, Rk05Image *ip);
+
+#endif /* RK05SIMH_H */
+
+/*---------------------------  End Of File  ------------------------------*/
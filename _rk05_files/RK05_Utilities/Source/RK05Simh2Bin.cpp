@@ -7,6 +7,11 @@
 **  Description:
 **      Convert SIMH RK05 disk image to RK05 Emulator disk image.
 **
+**      Either file may be "-" for stdin or stdout. The image is then
+**      converted one sector at a time, reading and writing strictly
+**      forward, so the tool can sit in a pipeline. Otherwise both images
+**      are converted in memory.
+**
 **--------------------------------------------------------------------------
 */
 
@@ -15,7 +20,8 @@
 **  Include Files
 **  -------------
 */
-#include "RK05Util.h"
+#include "RK05Image.h"
+#include "RK05Simh.h"
 
 /*
 **  -----------------
@@ -41,27 +47,19 @@
 **  ---------------------------
 */
 static void printUsage(void);
-static void read_and_convert_disk_image_data(void);
+static void stream_convert_disk_image_data(FILE *ifp, Rk05Image *image, const Rk05Geometry *gp);
 
 /*
 **  ----------------
 **  Public Variables
 **  ----------------
 */
-FILE *ifp;
-FILE *ofp;
 
 /*
 **  -----------------
 **  Private Variables
 **  -----------------
 */
-static u8 inBuf[SimhSectorSize];
-static u8 outBuf[Rk05SectorSize];
-static unsigned int calcCrc;
-static int sectorcount;
-static int headcount;
-static int cylindercount;
 
 /*
 **--------------------------------------------------------------------------
@@ -83,12 +81,24 @@ static int cylindercount;
 **------------------------------------------------------------------------*/
 int main(int argc, char **argv)
 {
+    Rk05Header header;
+    Rk05Image image;
+    Rk05Status status;
+    Rk05Mapping input;
+    const Rk05Geometry *gp = NULL;
+    FILE *ifp;
+    FILE *ofp = NULL;
+    bool overwrite = false;
+    bool streaming;
+
+    rk05InitHeader(&header);
+
     // Process command line arguments.
     argv += 1;
     argc -= 1;
 
     while (argc > 0) {
-        if (**argv != '-') {
+        if (**argv != '-' || is_stdio(*argv)) {
             break;
         }
 
@@ -101,7 +111,7 @@ int main(int argc, char **argv)
                 printUsage();
              }
 
-            safecpy(imageName, *argv, sizeof(imageName));
+            safecpy(header.imageName, *argv, sizeof(header.imageName));
 
             argv += 1;
             argc -= 1;
@@ -114,10 +124,31 @@ int main(int argc, char **argv)
                 printUsage();
             }
 
-            safecpy(imageDescription, *argv, sizeof(imageDescription));
+            safecpy(header.imageDescription, *argv, sizeof(header.imageDescription));
 
             argv += 1;
             argc -= 1;
+        } else if (strcmp(*argv, "-c") == 0) {
+            argv += 1;
+            argc -= 1;
+
+            if (argc == 0) {
+                printf("Missing 'controller' parameter\n");
+                printUsage();
+            }
+
+            gp = rk05GeometryByName(*argv);
+            if (gp == NULL) {
+                printf("Unknown controller %s\n", *argv);
+                printUsage();
+            }
+
+            argv += 1;
+            argc -= 1;
+        } else if (strcmp(*argv, "-y") == 0) {
+            argv += 1;
+            argc -= 1;
+            overwrite = true;
         } else {
             printf("Unknown option %s\n", *argv);
             printUsage();
@@ -128,9 +159,16 @@ int main(int argc, char **argv)
         printUsage();
     }
 
-    // Check if output file exists and prompt for overwrite.
-    if (file_exists(argv[1])) {
+    streaming = is_stdio(argv[0]) || is_stdio(argv[1]);
+
+    // Check if output file exists and prompt for overwrite, stdin can't be asked
+    // if it carries the image.
+    if (!overwrite && !is_stdio(argv[1]) && file_exists(argv[1])) {
        char buf[16];
+       if (is_stdio(argv[0])) {
+           printf("Output file %s already exists - use -y to overwrite\n", argv[1]);
+           exit(1);
+       }
        printf("Output file %s already exists - do you want to overwrite? (y/n): ", argv[1]);
        fgets(buf, sizeof(buf), stdin);
        if (_stricmp(buf, "y\n") != 0){
@@ -138,21 +176,45 @@ int main(int argc, char **argv)
        }
     }
 
+    // Open a streamed output first, this moves the messages off stdout.
+    if (streaming) {
+        ofp = open_file(argv[1], "wb");
+        if (ofp == NULL) {
+            printf("Can't create %s", argv[1]);
+            perror(" ");
+            exit(1);
+        }
+    }
+
     // Open the input file.
-    ifp = fopen(argv[0],"rb");
+    ifp = open_file(argv[0], "rb");
     if (ifp == NULL) {
         printf("Can't open %s", argv[0]);
         perror(" ");
         exit(1);
     }
 
-    // Open output file.
-    ofp = fopen(argv[1],"wb");
-    if (ofp == NULL) {
-        printf("Can't create %s", argv[1]);
-        perror(" ");
-        exit(1);
+    // Bring the whole input into memory, an empty file gives an all zero image.
+    memset(&input, 0, sizeof(input));
+    if (!streaming) {
+        status = rk05MapFile(ifp, false, 0, &input);
+        if (status != Rk05Ok && status != Rk05ErrEof) {
+            printf("Read error in %s\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    // Without -c the controller is the one whose SIMH image has the input's size, else RK8-E.
+    if (gp == NULL && !streaming) {
+        gp = rk05GeometryBySimhSize(input.size);
+        if (gp != NULL && strcmp(gp->controller, header.controller) != 0) {
+            printf("Image size matches the %s controller\n", gp->controller);
+        }
+    }
+    if (gp != NULL) {
+        rk05GeometryHeader(gp, &header);
     }
+    gp = rk05FindGeometry(&header);
 
     // Setup date & time string
     time_t timer;
@@ -161,20 +223,42 @@ int main(int argc, char **argv)
     timer = time(NULL);
     tm_info = localtime(&timer);
 
-    strftime(imageDate, sizeof(imageDate), "%Y-%m-%d %H:%M:%S", tm_info);
+    strftime(header.imageDate, sizeof(header.imageDate), "%Y-%m-%d %H:%M:%S", tm_info);
 
-    // Write the image file header.
-    if (!write_image_file_header()) {
+    // Create the output file and write the image file header.
+    printf("Writing image header\n");
+    if (streaming) {
+        status = rk05CreateStream(&image, ofp, &header);
+    } else {
+        status = rk05Create(&image, argv[1], &header);
+    }
+    if (status == Rk05ErrOpen) {
+        printf("Can't create %s", argv[1]);
+        perror(" ");
+        exit(1);
+    } else if (status != Rk05Ok) {
         printf("Failed to write image header\n");
         exit(1);
     }
 
-    // Do the actual conversion.
-    read_and_convert_disk_image_data();
+    // Do the actual conversion, directly into the output image in memory if not streaming.
+    printf("Converting SIMH image data to RK05 Emulator image format\n");
+    if (streaming) {
+        stream_convert_disk_image_data(ifp, &image, gp);
+    } else if (rk05Map(&image) != Rk05Ok || rk05SimhToImage(input.data, input.size, &image) != Rk05Ok) {
+        printf("Write data error in %s\n", argv[1]);
+        exit(1);
+    }
 
     // Cleanup and exit
+    if (!streaming) {
+        rk05UnmapFile(ifp, false, &input);
+    }
     fclose(ifp);
-    fclose(ofp);
+    if (rk05Close(&image) != Rk05Ok) {
+        printf("Write data error in %s\n", argv[1]);
+        exit(1);
+    }
     printf("Conversion completed\n");
     return 0;
 }
@@ -200,92 +284,53 @@ static void printUsage(void)
     {
     printf("Usage:\n");
     printf("    RK05Simh2Bin [options] <simh_image_file> <emulator_image_file>\n");
+    printf("    Either file may be - for stdin or stdout.\n");
     printf("Options:\n");
     printf("    -n <image_name>        - Image name (max 10 characters).\n");
     printf("    -d <image_description> - Image Description (max 199 characters).\n");
+    printf("    -c <controller>        - Controller: RK8-E (default) or RK11-D. Without -c a\n");
+    printf("                             full size RK11-D image is recognised by its size.\n");
+    printf("    -y                     - Overwrite an existing output file without asking.\n");
     exit(1);
     }
 
 /*--------------------------------------------------------------------------
-**  Purpose:        Perform the image conversion.
+**  Purpose:        Perform the image conversion one sector at a time.
 **
 **  Parameters:     Name        Description.
+**                  ifp         SIMH image file, read forward only
+**                  image       RK05 emulator image being created, written
+**                              forward only
+**                  gp          controller geometry
 **
 **  Returns:        Nothing
 **
 **------------------------------------------------------------------------*/
-static void read_and_convert_disk_image_data(void)
+static void stream_convert_disk_image_data(FILE *ifp, Rk05Image *image, const Rk05Geometry *gp)
 {
-    int rc;
-    bool zeroPad = false;
-    int i;
-    u8 *ip;
-    u8 *op;
-    u8 *dp;
-    u8 tmp;
-    int headerword;
-
-    printf("Converting SIMH image data to RK05 Emulator image format\n");
-    for (cylindercount = 0; cylindercount <  numberOfCylinders; cylindercount++){
-        for (headcount = 0; headcount <  numberOfHeads; headcount++){
-            for (sectorcount = 0; sectorcount <  numberOfSectorsPerTrack; sectorcount++){
-                if (!zeroPad) {
-                    // Read the next SIMH sector
-                    rc = fread(inBuf, 1, SimhSectorSize, ifp);
-                    if (rc < SimhSectorSize) {
-                        if (ferror(ifp) != 0) {
-                            printf("Read error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
-                            exit(1);
-                        }
-                        if (feof(ifp) != 0) {
-                            // Pad trailing part of partial sector.
-                            memset(inBuf + rc, 0, SimhSectorSize - rc);
-                            zeroPad = true;
-                        }
+    u8 inBuf[Rk05MaxSimhSectorSize];
+    u8 outBuf[Rk05MaxSectorSize];
+    size_t size = gp->simhSectorSize;
+    size_t count;
+    int sectorcount;
+    int headcount;
+    int cylindercount;
+
+    for (cylindercount = 0; cylindercount <  image->header.numberOfCylinders; cylindercount++){
+        for (headcount = 0; headcount <  image->header.numberOfHeads; headcount++){
+            for (sectorcount = 0; sectorcount <  image->header.numberOfSectorsPerTrack; sectorcount++){
+                // Pad trailing part of partial sector and all missing sectors.
+                count = fread(inBuf, 1, size, ifp);
+                if (count < size) {
+                    if (ferror(ifp)) {
+                        printf("Read error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
+                        exit(1);
                     }
-                } else {
-                    // Pad all missing sectors.
-                    memset(inBuf, 0, SimhSectorSize);
-                }
-
-                // Now generate the output buffer.
-                ip = inBuf;
-                op = outBuf;
-
-                // Write the header word in LSB order first.
-                headerword = cylindercount << 5;
-                *op++ = (headerword >> 0) & 0xFF;
-                *op++ = (headerword >> 8) & 0xFF;
-
-
-                // Convert two little-endian format 12 bit words stored in 4 bytes into 3 x 8 bit words.
-                // the conversion is illustrated in the following commented code:
-                //
-                //    ip[0] = 0x21;       op[0] = 0x21;
-                //    ip[1] = 0x03;  =>   op[1] = 0x43;
-                //    ip[2] = 0x54;       op[2] = 0x65;
-                //    ip[3] = 0x06;
-
-                dp = op;
-                for (i = 0; i < SimhSectorSize; i += 4) {
-                    *op++ = *ip++;
-                    tmp  = (*ip++ >> 0) & 0x0F;
-                    tmp |= (*ip   << 4) & 0xF0;
-                    *op++ = tmp;
-                    tmp  = (*ip++ >> 4) & 0x0F;
-                    tmp |= (*ip++ << 4) & 0xF0;
-                    *op++ = tmp;
+                    memset(inBuf + count, 0, size - count);
                 }
 
-                calcCrc = crc16buf(0, dp, op - dp);
-
-                // Write the CRC word in LSB order first
-                *op++ = (calcCrc >> 0) & 0xFF;
-                *op++ = (calcCrc >> 8) & 0xFF;
-
-                // Output to file
-                rc = fwrite(outBuf, 1, op - outBuf, ofp);
-                if (rc != Rk05SectorSize) {
+                rk05SimhToSector(gp, inBuf, outBuf, cylindercount);
+                if (rk05WriteSector(image, cylindercount, headcount, sectorcount, outBuf) != Rk05Ok) {
                     printf("Write data error C:%d, H:%d, S:%d\n", cylindercount, headcount, sectorcount);
                     exit(1);
                 }
@@ -0,0 +1,938 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Store.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Deduplicating RK05 Emulator image store.
+**
+**      index.dat is an open addressing hash table with linear probing,
+**      kept at most half full. It is read into memory when the store is
+**      opened and written back in one piece, through a temporary file,
+**      when a changed store is closed. A slot is 24 bytes: the XXH64
+**      hash of the stored bytes, their offset in sectors.dat plus one
+**      (0 marks an empty slot) and their length. Two sectors are only
+**      taken as the same when their bytes compare equal, the hash just
+**      finds the candidates.
+**
+**      A recipe is read whole, it is 8 bytes per sector. The sectors of
+**      an image are written out one at a time as they are read from
+**      sectors.dat, so rebuilding an image needs no more memory than
+**      one sector whatever the image size.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+#include "RK05Store.h"
+#include "RK05Hash.h"
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+static const char indexMagic[8] = { 'R', 'K', '0', '5', 'S', 'I', 'D', 'X' };
+static const char recipeMagic[8] = { 'R', 'K', '0', '5', 'S', 'R', 'E', 'C' };
+
+#define StoreVersion        1
+#define IndexFixedSize      32
+#define RecipeFixedSize     20
+#define SlotSize            24
+#define InitialSlots        4096
+
+/*
+**  The top bit of a recipe entry is set when the whole sector is stored,
+**  otherwise only the data words are stored and the header word and CRC
+**  are recomputed.
+*/
+#define RecipeRawSector     0x8000000000000000ULL
+
+#if defined(_WIN32)
+#define PathSeparator       '\\'
+#else
+#define PathSeparator       '/'
+#endif
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+#define SlotAt(sp, i)       ((sp)->slots + (size_t)(i) * SlotSize)
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+typedef struct recipe
+    {
+    Rk05Header header;
+    int sectorSize;
+    int sectorCount;
+    u64 *entries;
+    u64 fileSize;
+    } Recipe;
+
+typedef struct addContext
+    {
+    Rk05Store *sp;
+    Rk05Image *ip;
+    u64 *entries;
+    Rk05StoreStats *stats;
+    Rk05Status status;
+    } AddContext;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void putU32(u8 *bp, u32 value);
+static u32 getU32(const u8 *bp);
+static bool addSector(void *context, int cylinder, int head, int sector, const u8 *buf);
+static Rk05Status storeBytes(Rk05Store *sp, const u8 *bp, int size, u64 *offset, Rk05StoreStats *stats);
+static Rk05Status readBytes(Rk05Store *sp, u64 offset, u8 *bp, int size);
+static Rk05Status growIndex(Rk05Store *sp);
+static void insertSlot(u8 *slots, u32 slotCount, const u8 *slot);
+static Rk05Status readIndex(Rk05Store *sp);
+static Rk05Status writeIndex(Rk05Store *sp);
+static Rk05Status readRecipe(Rk05Store *sp, const char *name, Recipe *rp);
+static Rk05Status writeRecipe(Rk05Store *sp, const char *name, const Rk05Header *hp, int sectorSize,
+                              int sectorCount, const u64 *entries);
+static Rk05Status replaceFile(const char *tempName, const char *name);
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Open a store.
+**
+**  Parameters:     Name        Description.
+**                  sp          pointer to store handle
+**                  dir         store directory
+**                  create      true to create the store if it does not
+**                              exist and open it for adding images
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05StoreOpen(Rk05Store *sp, const char *dir, bool create)
+{
+    char path[1100];
+    Rk05Status status;
+
+    memset(sp, 0, sizeof(*sp));
+    safecpy(sp->dir, dir, sizeof(sp->dir));
+
+    if (create) {
+#if defined(_WIN32)
+        _mkdir(dir);
+#else
+        mkdir(dir, 0777);
+#endif
+    }
+
+    rk05StorePath(sp, path, sizeof(path), "sectors.dat");
+    sp->sectorsFp = fopen(path, create ? "rb+" : "rb");
+    if (sp->sectorsFp == NULL && create) {
+        sp->sectorsFp = fopen(path, "wb+");
+    }
+
+    if (sp->sectorsFp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    if (!file_size(sp->sectorsFp, &sp->sectorsSize)) {
+        return Rk05ErrIo;
+    }
+
+    status = readIndex(sp);
+    if (status == Rk05ErrOpen && create) {
+        // A new store, or the index was lost: start an empty one.
+        sp->slotCount = InitialSlots;
+        sp->slots = (u8 *)calloc(sp->slotCount, SlotSize);
+        sp->indexChanged = true;
+        status = sp->slots != NULL ? Rk05Ok : Rk05ErrIo;
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Close a store, writing its index if it has changed.
+**
+**  Parameters:     Name        Description.
+**                  sp          pointer to store handle
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05StoreClose(Rk05Store *sp)
+{
+    Rk05Status status = Rk05Ok;
+
+    if (sp->sectorsFp != NULL) {
+        // The sectors go to disk before the index which points at them.
+        if (fflush(sp->sectorsFp) != 0) {
+            status = Rk05ErrIo;
+        }
+
+        if (status == Rk05Ok && sp->indexChanged) {
+            status = writeIndex(sp);
+        }
+
+        if (fclose(sp->sectorsFp) != 0 && status == Rk05Ok) {
+            status = Rk05ErrIo;
+        }
+        sp->sectorsFp = NULL;
+    }
+
+    free(sp->slots);
+    sp->slots = NULL;
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Add an image to a store, replacing any image stored
+**                  under the same name.
+**
+**  Parameters:     Name        Description.
+**                  sp          store opened for adding
+**                  name        name to store the image under, see
+**                              rk05StoreName
+**                  ip          open image, preferably mapped
+**                  stats       returns what was added
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05StoreAdd(Rk05Store *sp, const char *name, Rk05Image *ip, Rk05StoreStats *stats)
+{
+    char path[1100];
+    AddContext context;
+    Rk05Status status;
+    bool known;
+    FILE *fp;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->sectors = ip->sectorCount;
+
+    context.sp = sp;
+    context.ip = ip;
+    context.stats = stats;
+    context.status = Rk05Ok;
+    context.entries = (u64 *)malloc((size_t)ip->sectorCount * sizeof(u64));
+    if (context.entries == NULL) {
+        return Rk05ErrIo;
+    }
+
+    status = rk05ForEachSector(ip, addSector, &context);
+    if (status == Rk05Ok) {
+        status = context.status;
+    }
+
+    // The recipe must only point at sectors which are in the file.
+    if (status == Rk05Ok && fflush(sp->sectorsFp) != 0) {
+        status = Rk05ErrIo;
+    }
+
+    if (status == Rk05Ok) {
+        snprintf(path, sizeof(path), "%s.rki", name);
+        rk05StorePath(sp, path, sizeof(path), path);
+        known = file_exists(path);
+
+        status = writeRecipe(sp, name, &ip->header, ip->sectorSize, ip->sectorCount, context.entries);
+
+        if (status == Rk05Ok && !known) {
+            rk05StorePath(sp, path, sizeof(path), "catalog.txt");
+            fp = fopen(path, "a");
+            if (fp == NULL || fprintf(fp, "%s\n", name) < 0) {
+                status = Rk05ErrIo;
+            }
+            if (fp != NULL && fclose(fp) != 0) {
+                status = Rk05ErrIo;
+            }
+        }
+    }
+
+    free(context.entries);
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Rebuild an image from a store and write it out.
+**
+**  Parameters:     Name        Description.
+**                  sp          open store
+**                  name        name of the image
+**                  fp          file open for writing, closed on return
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05StoreGet(Rk05Store *sp, const char *name, FILE *fp)
+{
+    const Rk05Header *hp;
+    u8 buf[65536 / 8];
+    Rk05Image image;
+    Rk05Status status;
+    Recipe recipe;
+    bool raw;
+    int cylinder;
+    int index;
+    int track;
+
+    status = readRecipe(sp, name, &recipe);
+    if (status != Rk05Ok) {
+        fclose(fp);
+        return status;
+    }
+
+    status = rk05CreateStream(&image, fp, &recipe.header);
+    if (status == Rk05Ok && image.sectorSize != recipe.sectorSize) {
+        status = Rk05ErrGeometry;
+    }
+
+    hp = &image.header;
+    for (index = 0; status == Rk05Ok && index < recipe.sectorCount; index++) {
+        track = index / hp->numberOfSectorsPerTrack;
+        cylinder = track / hp->numberOfHeads;
+        raw = (recipe.entries[index] & RecipeRawSector) != 0;
+
+        if (raw) {
+            status = readBytes(sp, recipe.entries[index] & ~RecipeRawSector, buf, recipe.sectorSize);
+        } else {
+            status = readBytes(sp, recipe.entries[index], buf + 2, recipe.sectorSize - 4);
+            rk05FormatSector(buf, recipe.sectorSize, cylinder);
+        }
+
+        if (status == Rk05Ok) {
+            status = rk05WriteSector(&image, cylinder, track % hp->numberOfHeads,
+                                     index % hp->numberOfSectorsPerTrack, buf);
+        }
+    }
+
+    if (rk05Close(&image) != Rk05Ok && status == Rk05Ok) {
+        status = Rk05ErrIo;
+    }
+
+    free(recipe.entries);
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Get the header of a stored image.
+**
+**  Parameters:     Name        Description.
+**                  sp          open store
+**                  name        name of the image
+**                  hp          returns the image header
+**                  recipeSize  returns the size of the recipe file
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+Rk05Status rk05StoreInfo(Rk05Store *sp, const char *name, Rk05Header *hp, u64 *recipeSize)
+{
+    Rk05Status status;
+    Recipe recipe;
+
+    status = readRecipe(sp, name, &recipe);
+    if (status == Rk05Ok) {
+        *hp = recipe.header;
+        *recipeSize = recipe.fileSize;
+        free(recipe.entries);
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Make a store name from an image file name: the file
+**                  name without directory and extension, with anything
+**                  but letters, digits, '-', '_' and '.' replaced by '_'.
+**
+**  Parameters:     Name        Description.
+**                  name        returns the name, Rk05StoreMaxName bytes
+**                  filename    image file name
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05StoreName(char *name, const char *filename)
+{
+    const char *base = filename;
+    const char *dot;
+    const char *cp;
+    int n = 0;
+
+    for (cp = filename; *cp != '\0'; cp++) {
+        if (*cp == '/' || *cp == '\\' || *cp == ':') {
+            base = cp + 1;
+        }
+    }
+
+    dot = strrchr(base, '.');
+    if (dot == NULL || dot == base) {
+        dot = base + strlen(base);
+    }
+
+    for (cp = base; cp < dot && n < Rk05StoreMaxName - 1; cp++) {
+        if (   (*cp >= 'a' && *cp <= 'z') || (*cp >= 'A' && *cp <= 'Z') || (*cp >= '0' && *cp <= '9')
+            || *cp == '-' || *cp == '_' || *cp == '.') {
+            name[n++] = *cp;
+        } else {
+            name[n++] = '_';
+        }
+    }
+
+    name[n] = '\0';
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Build the path of a file in the store directory.
+**
+**  Parameters:     Name        Description.
+**                  sp          store handle
+**                  path        returns the path
+**                  size        size of path
+**                  file        file name, may be the same buffer as path
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05StorePath(const Rk05Store *sp, char *path, int size, const char *file)
+{
+    char name[Rk05StoreMaxName + 8];
+
+    safecpy(name, file, sizeof(name));
+    snprintf(path, size, "%s%c%s", sp->dir, PathSeparator, name);
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Store a 32 bit value LSB first.
+**
+**  Parameters:     Name        Description.
+**                  bp          destination
+**                  value       value to store
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void putU32(u8 *bp, u32 value)
+{
+    bp[0] = (u8)(value >> 0);
+    bp[1] = (u8)(value >> 8);
+    bp[2] = (u8)(value >> 16);
+    bp[3] = (u8)(value >> 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Fetch a 32 bit value stored LSB first.
+**
+**  Parameters:     Name        Description.
+**                  bp          source
+**
+**  Returns:        value
+**
+**------------------------------------------------------------------------*/
+static u32 getU32(const u8 *bp)
+{
+    return (u32)bp[0] | ((u32)bp[1] << 8) | ((u32)bp[2] << 16) | ((u32)bp[3] << 24);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        rk05ForEachSector callback of rk05StoreAdd.
+**
+**  Parameters:     Name        Description.
+**                  context     pointer to AddContext
+**                  cylinder    cylinder address
+**                  head        head address
+**                  sector      sector address
+**                  buf         sector contents
+**
+**  Returns:        false to stop on errors
+**
+**------------------------------------------------------------------------*/
+static bool addSector(void *context, int cylinder, int head, int sector, const u8 *buf)
+{
+    AddContext *cp = (AddContext *)context;
+    int size = cp->ip->sectorSize;
+    int index = rk05SectorIndex(cp->ip, cylinder, head, sector);
+    u64 offset;
+
+    if (rk05CheckSector(buf, size, cylinder) != 0) {
+        cp->status = storeBytes(cp->sp, buf, size, &offset, cp->stats);
+        offset |= RecipeRawSector;
+    } else {
+        cp->status = storeBytes(cp->sp, buf + 2, size - 4, &offset, cp->stats);
+    }
+
+    cp->entries[index] = offset;
+    return cp->status == Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Find bytes in the store, adding them if they are new.
+**
+**  Parameters:     Name        Description.
+**                  sp          store opened for adding
+**                  bp          bytes to store
+**                  size        number of bytes
+**                  offset      returns their offset in sectors.dat
+**                  stats       counts new sectors
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status storeBytes(Rk05Store *sp, const u8 *bp, int size, u64 *offset, Rk05StoreStats *stats)
+{
+    u8 stored[65536 / 8];
+    Rk05Status status;
+    u64 hash = rk05Hash64(bp, size, 0);
+    u32 mask = sp->slotCount - 1;
+    u32 i = (u32)hash & mask;
+    u8 *slot;
+
+    // Probe until the bytes or an empty slot are found.
+    for (;;) {
+        slot = SlotAt(sp, i);
+        *offset = rk05GetU64(slot + 8);
+        if (*offset == 0) {
+            break;
+        }
+
+        *offset -= 1;
+        if (rk05GetU64(slot) == hash && (int)getU32(slot + 16) == size) {
+            status = readBytes(sp, *offset, stored, size);
+            if (status != Rk05Ok) {
+                return status;
+            }
+
+            if (memcmp(stored, bp, size) == 0) {
+                return Rk05Ok;
+            }
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    // New bytes, append them.
+    *offset = sp->sectorsSize;
+    if (   seek_file(sp->sectorsFp, *offset, SEEK_SET) != 0
+        || fwrite(bp, 1, size, sp->sectorsFp) != (size_t)size) {
+        return Rk05ErrIo;
+    }
+
+    sp->sectorsSize += size;
+    stats->newSectors += 1;
+    stats->newBytes += size;
+
+    rk05PutU64(slot, hash);
+    rk05PutU64(slot + 8, *offset + 1);
+    putU32(slot + 16, size);
+    putU32(slot + 20, 0);
+    sp->usedCount += 1;
+    sp->indexChanged = true;
+
+    if (sp->usedCount * 2 > sp->slotCount) {
+        return growIndex(sp);
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read bytes from sectors.dat.
+**
+**  Parameters:     Name        Description.
+**                  sp          open store
+**                  offset      offset in sectors.dat
+**                  bp          destination
+**                  size        number of bytes
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status readBytes(Rk05Store *sp, u64 offset, u8 *bp, int size)
+{
+    if (offset > sp->sectorsSize || sp->sectorsSize - offset < (u64)size) {
+        return Rk05ErrRange;
+    }
+
+    if (seek_file(sp->sectorsFp, offset, SEEK_SET) != 0) {
+        return Rk05ErrIo;
+    }
+
+    if (fread(bp, 1, size, sp->sectorsFp) != (size_t)size) {
+        return ferror(sp->sectorsFp) ? Rk05ErrIo : Rk05ErrEof;
+    }
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Double the number of hash table slots.
+**
+**  Parameters:     Name        Description.
+**                  sp          store opened for adding
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo if out of memory
+**
+**------------------------------------------------------------------------*/
+static Rk05Status growIndex(Rk05Store *sp)
+{
+    u32 slotCount = sp->slotCount * 2;
+    u8 *slots;
+    u32 i;
+
+    slots = (u8 *)calloc(slotCount, SlotSize);
+    if (slots == NULL) {
+        return Rk05ErrIo;
+    }
+
+    for (i = 0; i < sp->slotCount; i++) {
+        if (rk05GetU64(SlotAt(sp, i) + 8) != 0) {
+            insertSlot(slots, slotCount, SlotAt(sp, i));
+        }
+    }
+
+    free(sp->slots);
+    sp->slots = slots;
+    sp->slotCount = slotCount;
+
+    return Rk05Ok;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Copy a used slot into the first free slot of its
+**                  probe sequence in a hash table.
+**
+**  Parameters:     Name        Description.
+**                  slots       hash table
+**                  slotCount   number of slots, a power of 2
+**                  slot        slot to insert
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void insertSlot(u8 *slots, u32 slotCount, const u8 *slot)
+{
+    u32 i = (u32)rk05GetU64(slot) & (slotCount - 1);
+
+    while (rk05GetU64(slots + (size_t)i * SlotSize + 8) != 0) {
+        i = (i + 1) & (slotCount - 1);
+    }
+
+    memcpy(slots + (size_t)i * SlotSize, slot, SlotSize);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and check index.dat.
+**
+**  Parameters:     Name        Description.
+**                  sp          store handle
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrOpen if there is no
+**                  index, other error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status readIndex(Rk05Store *sp)
+{
+    u8 buf[IndexFixedSize];
+    char path[1100];
+    Rk05Status status = Rk05Ok;
+    u32 slotCount;
+    FILE *fp;
+
+    rk05StorePath(sp, path, sizeof(path), "index.dat");
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    if (fread(buf, 1, IndexFixedSize, fp) != IndexFixedSize) {
+        status = ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+    } else if (memcmp(buf, indexMagic, sizeof(indexMagic)) != 0) {
+        status = Rk05ErrMagic;
+    } else if (getU32(buf + 8) != StoreVersion) {
+        status = Rk05ErrVersion;
+    }
+
+    if (status == Rk05Ok) {
+        slotCount = getU32(buf + 12);
+        sp->usedCount = getU32(buf + 16);
+        if (slotCount < InitialSlots || (slotCount & (slotCount - 1)) != 0 || sp->usedCount * 2 > slotCount) {
+            status = Rk05ErrCorrupt;
+        }
+    }
+
+    if (status == Rk05Ok) {
+        sp->slotCount = slotCount;
+        sp->slots = (u8 *)malloc((size_t)slotCount * SlotSize);
+        if (sp->slots == NULL) {
+            status = Rk05ErrIo;
+        } else if (fread(sp->slots, SlotSize, slotCount, fp) != slotCount) {
+            status = ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+        } else if (rk05Hash64(sp->slots, (size_t)slotCount * SlotSize, 0) != rk05GetU64(buf + 24)) {
+            status = Rk05ErrCorrupt;
+        }
+    }
+
+    fclose(fp);
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write index.dat through a temporary file.
+**
+**  Parameters:     Name        Description.
+**                  sp          store handle
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status writeIndex(Rk05Store *sp)
+{
+    u8 buf[IndexFixedSize];
+    char tempName[1100];
+    char path[1100];
+    bool ok;
+    FILE *fp;
+
+    rk05StorePath(sp, tempName, sizeof(tempName), "index.tmp");
+    rk05StorePath(sp, path, sizeof(path), "index.dat");
+
+    fp = fopen(tempName, "wb");
+    if (fp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, indexMagic, sizeof(indexMagic));
+    putU32(buf + 8, StoreVersion);
+    putU32(buf + 12, sp->slotCount);
+    putU32(buf + 16, sp->usedCount);
+    rk05PutU64(buf + 24, rk05Hash64(sp->slots, (size_t)sp->slotCount * SlotSize, 0));
+
+    ok = fwrite(buf, 1, IndexFixedSize, fp) == IndexFixedSize
+         && fwrite(sp->slots, SlotSize, sp->slotCount, fp) == sp->slotCount;
+    if (fclose(fp) != 0 || !ok) {
+        remove(tempName);
+        return Rk05ErrIo;
+    }
+
+    sp->indexChanged = false;
+    return replaceFile(tempName, path);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Read and check the recipe of a stored image.
+**
+**  Parameters:     Name        Description.
+**                  sp          open store
+**                  name        name of the image
+**                  rp          returns the recipe, free rp->entries
+**                              after use
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status readRecipe(Rk05Store *sp, const char *name, Recipe *rp)
+{
+    u8 buf[RecipeFixedSize + Rk05HeaderSize];
+    char path[1100];
+    Rk05Status status = Rk05Ok;
+    u8 *bp;
+    int i;
+    FILE *fp;
+
+    memset(rp, 0, sizeof(*rp));
+
+    snprintf(path, sizeof(path), "%s.rki", name);
+    rk05StorePath(sp, path, sizeof(path), path);
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return Rk05ErrOpen;
+    }
+
+    if (fread(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
+        status = ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+    } else if (memcmp(buf, recipeMagic, sizeof(recipeMagic)) != 0) {
+        status = Rk05ErrMagic;
+    } else if (getU32(buf + 8) != StoreVersion) {
+        status = Rk05ErrVersion;
+    } else {
+        status = rk05DecodeHeader(buf + RecipeFixedSize, Rk05HeaderSize, &rp->header);
+    }
+
+    if (status == Rk05Ok) {
+        rp->sectorSize = (int)getU32(buf + 12);
+        rp->sectorCount = (int)getU32(buf + 16);
+        if (   rp->sectorSize != rk05SectorSize(&rp->header)
+            || rp->sectorCount != rp->header.numberOfCylinders * rp->header.numberOfHeads
+                                  * rp->header.numberOfSectorsPerTrack) {
+            status = Rk05ErrGeometry;
+        }
+    }
+
+    // The entries and the check hash follow.
+    if (status == Rk05Ok) {
+        bp = (u8 *)malloc((size_t)rp->sectorCount * 8 + 8);
+        rp->entries = (u64 *)malloc((size_t)rp->sectorCount * sizeof(u64));
+        if (bp == NULL || rp->entries == NULL) {
+            status = Rk05ErrIo;
+        } else if (fread(bp, 8, rp->sectorCount + 1, fp) != (size_t)rp->sectorCount + 1) {
+            status = ferror(fp) ? Rk05ErrIo : Rk05ErrEof;
+        } else if (rk05Hash64(bp, (size_t)rp->sectorCount * 8, rk05Hash64(buf, sizeof(buf), 0))
+                   != rk05GetU64(bp + (size_t)rp->sectorCount * 8)) {
+            status = Rk05ErrCorrupt;
+        } else {
+            for (i = 0; i < rp->sectorCount; i++) {
+                rp->entries[i] = rk05GetU64(bp + (size_t)i * 8);
+            }
+            rp->fileSize = sizeof(buf) + (u64)rp->sectorCount * 8 + 8;
+        }
+        free(bp);
+    }
+
+    fclose(fp);
+    if (status != Rk05Ok) {
+        free(rp->entries);
+        rp->entries = NULL;
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Write the recipe of an image through a temporary file.
+**
+**  Parameters:     Name        Description.
+**                  sp          open store
+**                  name        name of the image
+**                  hp          image header
+**                  sectorSize  sector size in bytes
+**                  sectorCount number of sectors
+**                  entries     sectors.dat offset of each sector
+**
+**  Returns:        Rk05Ok if successful, error status otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status writeRecipe(Rk05Store *sp, const char *name, const Rk05Header *hp, int sectorSize,
+                              int sectorCount, const u64 *entries)
+{
+    u8 buf[RecipeFixedSize + Rk05HeaderSize];
+    char tempName[1100];
+    char path[1100];
+    bool ok;
+    u8 *bp;
+    int i;
+    FILE *fp;
+
+    bp = (u8 *)malloc((size_t)sectorCount * 8 + 8);
+    if (bp == NULL) {
+        return Rk05ErrIo;
+    }
+
+    memcpy(buf, recipeMagic, sizeof(recipeMagic));
+    putU32(buf + 8, StoreVersion);
+    putU32(buf + 12, sectorSize);
+    putU32(buf + 16, sectorCount);
+    rk05EncodeHeader(buf + RecipeFixedSize, hp);
+
+    for (i = 0; i < sectorCount; i++) {
+        rk05PutU64(bp + (size_t)i * 8, entries[i]);
+    }
+    rk05PutU64(bp + (size_t)sectorCount * 8,
+               rk05Hash64(bp, (size_t)sectorCount * 8, rk05Hash64(buf, sizeof(buf), 0)));
+
+    snprintf(path, sizeof(path), "%s.tmp", name);
+    rk05StorePath(sp, tempName, sizeof(tempName), path);
+    snprintf(path, sizeof(path), "%s.rki", name);
+    rk05StorePath(sp, path, sizeof(path), path);
+
+    fp = fopen(tempName, "wb");
+    if (fp == NULL) {
+        free(bp);
+        return Rk05ErrOpen;
+    }
+
+    ok = fwrite(buf, 1, sizeof(buf), fp) == sizeof(buf)
+         && fwrite(bp, 8, sectorCount + 1, fp) == (size_t)sectorCount + 1;
+    free(bp);
+    if (fclose(fp) != 0 || !ok) {
+        remove(tempName);
+        return Rk05ErrIo;
+    }
+
+    return replaceFile(tempName, path);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Rename a temporary file over the file it replaces.
+**
+**  Parameters:     Name        Description.
+**                  tempName    temporary file
+**                  name        final name
+**
+**  Returns:        Rk05Ok if successful, Rk05ErrIo otherwise
+**
+**------------------------------------------------------------------------*/
+static Rk05Status replaceFile(const char *tempName, const char *name)
+{
+#if defined(_WIN32)
+    // Windows rename does not replace an existing file.
+    remove(name);
+#endif
+    if (rename(tempName, name) != 0) {
+        remove(tempName);
+        return Rk05ErrIo;
+    }
+
+    return Rk05Ok;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
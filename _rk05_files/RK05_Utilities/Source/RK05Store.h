@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Store.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Deduplicating RK05 Emulator image store declarations.
+**
+**      A store is a directory holding every distinct sector of the
+**      images added to it once:
+**
+**          sectors.dat     the distinct sectors, appended as found
+**          index.dat       hash table of the sectors in sectors.dat
+**          catalog.txt     names of the stored images, one per line
+**          <name>.rki      image recipe: the image header and the
+**                          sectors.dat offset of each sector
+**
+**      A sector whose header word and CRC are correct is stored without
+**      them, they are recomputed when the image is rebuilt. So a zeroed
+**      sector is stored once no matter which cylinder it is on. Sectors
+**      with errors are stored as they are and come back unchanged.
+**
+**      Sectors are never removed from a store. There is no locking, one
+**      program at a time may update a store.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05STORE_H
+#define RK05STORE_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Image.h"
+
+/*
+**  ----------------
+**  Public Constants
+**  ----------------
+*/
+#define Rk05StoreMaxName        64
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef struct rk05Store
+    {
+    char dir[1024];
+    FILE *sectorsFp;            // sectors.dat
+    u64 sectorsSize;            // bytes in sectors.dat
+    u8 *slots;                  // hash table, Rk05StoreSlotSize bytes per slot
+    u32 slotCount;              // power of 2
+    u32 usedCount;
+    bool indexChanged;          // index.dat must be written by rk05StoreClose
+    } Rk05Store;
+
+typedef struct rk05StoreStats
+    {
+    int sectors;                // sectors of the image
+    int newSectors;             // sectors not in the store before
+    u64 newBytes;               // bytes added to sectors.dat
+    } Rk05StoreStats;
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+Rk05Status rk05StoreOpen(Rk05Store *sp, const char *dir, bool create);
+Rk05Status rk05StoreClose(Rk05Store *sp);
+Rk05Status rk05StoreAdd(Rk05Store *sp, const char *name, Rk05Image *ip, Rk05StoreStats *stats);
+Rk05Status rk05StoreGet(Rk05Store *sp, const char *name, FILE *fp);
+Rk05Status rk05StoreInfo(Rk05Store *sp, const char *name, Rk05Header *hp, u64 *recipeSize);
+void rk05StoreName(char *name, const char *filename);
+void rk05StorePath(const Rk05Store *sp, char *path, int size, const char *file);
+
+#endif /* RK05STORE_H */
+
+/*---------------------------  End Of File  ------------------------------*/
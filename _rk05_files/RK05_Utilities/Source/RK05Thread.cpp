@@ -0,0 +1,550 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Thread.cpp
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Thread pool, lock and timer for the batch tools.
+**
+**      Uses Win32 threads on Windows and POSIX threads elsewhere.
+**
+**      Every worker owns a queue which is a range of job numbers. A
+**      worker takes jobs from the front of its own range. When the range
+**      is empty it locks the other queues one at a time, takes the back
+**      half of the longest range it finds and carries on with that. When
+**      no queue has jobs left the worker ends. Jobs are never added after
+**      the start, so an empty scan means the work is done.
+**
+**--------------------------------------------------------------------------
+*/
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "RK05Thread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#endif
+
+/*
+**  -----------------
+**  Private Constants
+**  -----------------
+*/
+
+/*
+**  -----------------------
+**  Private Macro Functions
+**  -----------------------
+*/
+
+/*
+**  -----------------------------------------
+**  Private Typedef and Structure Definitions
+**  -----------------------------------------
+*/
+struct rk05Lock
+    {
+#if defined(_WIN32)
+    CRITICAL_SECTION section;
+#else
+    pthread_mutex_t mutex;
+#endif
+    };
+
+typedef struct poolQueue
+    {
+    Rk05Lock *lock;
+    int next;                   // first job not yet taken
+    int end;                    // one past the last job
+    } PoolQueue;
+
+typedef struct pool
+    {
+    PoolQueue queues[Rk05MaxThreads];
+    int threads;
+    Rk05PoolJob job;
+    void *context;
+    Rk05Lock *statsLock;
+    Rk05PoolStats *stats;
+    } Pool;
+
+typedef struct poolWorker
+    {
+    Pool *pool;
+    int worker;
+    } PoolWorker;
+
+/*
+**  ---------------------------
+**  Private Function Prototypes
+**  ---------------------------
+*/
+static void runWorker(Pool *pp, int worker);
+static bool takeJob(PoolQueue *qp, int *job);
+static bool stealJobs(Pool *pp, int worker);
+#if defined(_WIN32)
+static DWORD WINAPI workerThread(LPVOID param);
+#else
+static void *workerThread(void *param);
+#endif
+
+/*
+**  ----------------
+**  Public Variables
+**  ----------------
+*/
+
+/*
+**  -----------------
+**  Private Variables
+**  -----------------
+*/
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Public Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Create a lock.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        pointer to lock, NULL if out of memory
+**
+**------------------------------------------------------------------------*/
+Rk05Lock *rk05LockCreate(void)
+{
+    Rk05Lock *lp = (Rk05Lock *)malloc(sizeof(Rk05Lock));
+
+    if (lp == NULL) {
+        return NULL;
+    }
+
+#if defined(_WIN32)
+    InitializeCriticalSection(&lp->section);
+#else
+    pthread_mutex_init(&lp->mutex, NULL);
+#endif
+
+    return lp;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Free a lock which is not held.
+**
+**  Parameters:     Name        Description.
+**                  lp          pointer to lock
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05LockFree(Rk05Lock *lp)
+{
+    if (lp == NULL) {
+        return;
+    }
+
+#if defined(_WIN32)
+    DeleteCriticalSection(&lp->section);
+#else
+    pthread_mutex_destroy(&lp->mutex);
+#endif
+    free(lp);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Acquire a lock, waiting while another thread holds it.
+**
+**  Parameters:     Name        Description.
+**                  lp          pointer to lock
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05Lock(Rk05Lock *lp)
+{
+#if defined(_WIN32)
+    EnterCriticalSection(&lp->section);
+#else
+    pthread_mutex_lock(&lp->mutex);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Release a lock.
+**
+**  Parameters:     Name        Description.
+**                  lp          pointer to lock
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+void rk05Unlock(Rk05Lock *lp)
+{
+#if defined(_WIN32)
+    LeaveCriticalSection(&lp->section);
+#else
+    pthread_mutex_unlock(&lp->mutex);
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return the number of processors available.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        processor count, at least 1 and at most Rk05MaxThreads
+**
+**------------------------------------------------------------------------*/
+int rk05CpuCount(void)
+{
+    long count;
+
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    count = (long)info.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    if (count < 1) {
+        return 1;
+    }
+
+    if (count > Rk05MaxThreads) {
+        return Rk05MaxThreads;
+    }
+
+    return (int)count;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Return wall clock time for measuring intervals. Unlike
+**                  clock() this does not add up the time of all threads.
+**
+**  Parameters:     Name        Description.
+**
+**  Returns:        seconds since an arbitrary start
+**
+**------------------------------------------------------------------------*/
+double rk05Seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#endif
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run jobs 0 to jobs - 1 on a pool of worker threads and
+**                  wait for all of them to finish.
+**
+**  Parameters:     Name        Description.
+**                  jobs        number of jobs
+**                  threads     number of workers, limited to the number
+**                              of jobs and to Rk05MaxThreads
+**                  job         function called for each job
+**                  context     passed to the job function
+**                  stats       returns pool statistics, may be NULL
+**
+**  Returns:        true if successful, false if threads or locks could
+**                  not be created. No jobs have run in that case.
+**
+**------------------------------------------------------------------------*/
+bool rk05RunPool(int jobs, int threads, Rk05PoolJob job, void *context, Rk05PoolStats *stats)
+{
+    Rk05PoolStats localStats;
+    PoolWorker workers[Rk05MaxThreads];
+#if defined(_WIN32)
+    HANDLE handles[Rk05MaxThreads];
+#else
+    pthread_t handles[Rk05MaxThreads];
+#endif
+    bool ok = true;
+    Pool *pp;
+    int started;
+    int i;
+
+    if (stats == NULL) {
+        stats = &localStats;
+    }
+
+    if (threads > jobs) {
+        threads = jobs;
+    }
+    if (threads > Rk05MaxThreads) {
+        threads = Rk05MaxThreads;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->threads = threads;
+    stats->seconds = rk05Seconds();
+
+    pp = (Pool *)calloc(1, sizeof(Pool));
+    if (pp == NULL) {
+        return false;
+    }
+
+    pp->threads = threads;
+    pp->job = job;
+    pp->context = context;
+    pp->stats = stats;
+
+    // Deal the jobs out in equal ranges.
+    pp->statsLock = rk05LockCreate();
+    ok = pp->statsLock != NULL;
+    for (i = 0; i < threads; i++) {
+        pp->queues[i].lock = rk05LockCreate();
+        pp->queues[i].next = (int)(((long long)jobs * i) / threads);
+        pp->queues[i].end = (int)(((long long)jobs * (i + 1)) / threads);
+        ok = ok && pp->queues[i].lock != NULL;
+    }
+
+    if (!ok) {
+        for (i = 0; i < threads; i++) {
+            rk05LockFree(pp->queues[i].lock);
+        }
+        rk05LockFree(pp->statsLock);
+        free(pp);
+        return false;
+    }
+
+    if (threads == 1) {
+        // No point in a thread, run on the caller.
+        runWorker(pp, 0);
+    } else {
+        // Start the workers, if any fail to start the others steal their jobs.
+        started = 0;
+        for (i = 0; i < threads; i++) {
+            workers[i].pool = pp;
+            workers[i].worker = i;
+#if defined(_WIN32)
+            handles[started] = CreateThread(NULL, 0, workerThread, &workers[i], 0, NULL);
+            if (handles[started] != NULL) {
+                started++;
+            }
+#else
+            if (pthread_create(&handles[started], NULL, workerThread, &workers[i]) == 0) {
+                started++;
+            }
+#endif
+        }
+
+        if (started == 0) {
+            runWorker(pp, 0);
+        }
+
+        for (i = 0; i < started; i++) {
+#if defined(_WIN32)
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+#else
+            pthread_join(handles[i], NULL);
+#endif
+        }
+    }
+
+    for (i = 0; i < threads; i++) {
+        rk05LockFree(pp->queues[i].lock);
+    }
+    rk05LockFree(pp->statsLock);
+    free(pp);
+
+    stats->seconds = rk05Seconds() - stats->seconds;
+
+    return true;
+}
+
+/*
+**--------------------------------------------------------------------------
+**
+**  Private Functions
+**
+**--------------------------------------------------------------------------
+*/
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Thread entry point of a pool worker.
+**
+**  Parameters:     Name        Description.
+**                  param       pointer to PoolWorker
+**
+**  Returns:        Nothing useful
+**
+**------------------------------------------------------------------------*/
+#if defined(_WIN32)
+static DWORD WINAPI workerThread(LPVOID param)
+{
+    PoolWorker *wp = (PoolWorker *)param;
+
+    runWorker(wp->pool, wp->worker);
+    return 0;
+}
+#else
+static void *workerThread(void *param)
+{
+    PoolWorker *wp = (PoolWorker *)param;
+
+    runWorker(wp->pool, wp->worker);
+    return NULL;
+}
+#endif
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Run jobs from the own queue and steal more until no
+**                  queue has any left.
+**
+**  Parameters:     Name        Description.
+**                  pp          pointer to pool
+**                  worker      worker number
+**
+**  Returns:        Nothing
+**
+**------------------------------------------------------------------------*/
+static void runWorker(Pool *pp, int worker)
+{
+    int jobsRun = 0;
+    int steals = 0;
+    int job;
+
+    for (;;) {
+        if (takeJob(&pp->queues[worker], &job)) {
+            pp->job(pp->context, job, worker);
+            jobsRun++;
+        } else if (stealJobs(pp, worker)) {
+            steals++;
+        } else {
+            break;
+        }
+    }
+
+    rk05Lock(pp->statsLock);
+    pp->stats->jobsRun[worker] += jobsRun;
+    pp->stats->steals += steals;
+    rk05Unlock(pp->statsLock);
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Take the next job from the front of a queue.
+**
+**  Parameters:     Name        Description.
+**                  qp          pointer to queue
+**                  job         returns the job number
+**
+**  Returns:        true if a job was taken, false if the queue is empty
+**
+**------------------------------------------------------------------------*/
+static bool takeJob(PoolQueue *qp, int *job)
+{
+    bool taken = false;
+
+    rk05Lock(qp->lock);
+    if (qp->next < qp->end) {
+        *job = qp->next++;
+        taken = true;
+    }
+    rk05Unlock(qp->lock);
+
+    return taken;
+}
+
+/*--------------------------------------------------------------------------
+**  Purpose:        Move the back half of the longest other queue into the
+**                  empty queue of a worker.
+**
+**  Parameters:     Name        Description.
+**                  pp          pointer to pool
+**                  worker      worker number of the thief
+**
+**  Returns:        true if jobs were stolen, false if all queues are empty
+**
+**------------------------------------------------------------------------*/
+static bool stealJobs(Pool *pp, int worker)
+{
+    PoolQueue *qp;
+    int victim = -1;
+    int longest = 0;
+    int length;
+    int start;
+    int end;
+    int i;
+
+    // Find the longest queue. It may be emptied before it is locked again
+    // below, then simply look again.
+    for (;;) {
+        victim = -1;
+        longest = 0;
+        for (i = 0; i < pp->threads; i++) {
+            if (i == worker) {
+                continue;
+            }
+
+            qp = &pp->queues[i];
+            rk05Lock(qp->lock);
+            length = qp->end - qp->next;
+            rk05Unlock(qp->lock);
+
+            if (length > longest) {
+                longest = length;
+                victim = i;
+            }
+        }
+
+        if (victim < 0) {
+            return false;
+        }
+
+        qp = &pp->queues[victim];
+        rk05Lock(qp->lock);
+        length = qp->end - qp->next;
+        if (length > 0) {
+            end = qp->end;
+            start = end - (length + 1) / 2;
+            qp->end = start;
+            rk05Unlock(qp->lock);
+            break;
+        }
+        rk05Unlock(qp->lock);
+    }
+
+    qp = &pp->queues[worker];
+    rk05Lock(qp->lock);
+    qp->next = start;
+    qp->end = end;
+    rk05Unlock(qp->lock);
+
+    return true;
+}
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -0,0 +1,72 @@
+/*--------------------------------------------------------------------------
+**
+**  Name: RK05Thread.h
+**
+**  Author: Tom Hunter
+**
+**  Description:
+**      Thread pool, lock and timer declarations for the batch tools.
+**
+**      rk05RunPool calls a job function once for every job number on a
+**      number of worker threads. Each worker starts with an equal share
+**      of the job numbers and, when it runs out, steals half of the jobs
+**      left to the busiest other worker. Jobs of very different cost,
+**      such as files of different size, keep all workers busy to the end.
+**
+**--------------------------------------------------------------------------
+*/
+
+#ifndef RK05THREAD_H
+#define RK05THREAD_H
+
+/*
+**  -------------
+**  Include Files
+**  -------------
+*/
+#include "RK05Util.h"
+
+/*
+**  ----------------
+**  Public Constants
+**  ----------------
+*/
+#define Rk05MaxThreads          64
+
+/*
+**  ----------------------------------------
+**  Public Typedef and Structure Definitions
+**  ----------------------------------------
+*/
+typedef struct rk05Lock Rk05Lock;
+
+/*
+**  Called by rk05RunPool for each job number.
+*/
+typedef void (*Rk05PoolJob)(void *context, int job, int worker);
+
+typedef struct rk05PoolStats
+    {
+    int threads;                // workers used
+    int steals;                 // times a worker took jobs from another
+    int jobsRun[Rk05MaxThreads];// jobs run by each worker
+    double seconds;             // wall clock time of the whole run
+    } Rk05PoolStats;
+
+/*
+**  --------------------------
+**  Public Function Prototypes
+**  --------------------------
+*/
+Rk05Lock *rk05LockCreate(void);
+void rk05LockFree(Rk05Lock *lp);
+void rk05Lock(Rk05Lock *lp);
+void rk05Unlock(Rk05Lock *lp);
+
+int rk05CpuCount(void);
+double rk05Seconds(void);
+bool rk05RunPool(int jobs, int threads, Rk05PoolJob job, void *context, Rk05PoolStats *stats);
+
+#endif /* RK05THREAD_H */
+
+/*---------------------------  End Of File  ------------------------------*/
@@ -10,6 +10,9 @@
 **--------------------------------------------------------------------------
 */
 
+#ifndef RK05UTIL_H
+#define RK05UTIL_H
+
 /*
 **  -------------
 **  Include Files
@@ -28,6 +31,8 @@
 **  -----------------
 */
 #define MaxSectorErrors     10
+
+// RK8-E sector sizes, see RK05Geometry.h for other controllers.
 #define SimhSectorSize   ((256 * 16) / 8)
 #define Rk05SectorSize   (((256 * 12) / 8) + 2 + 2)
 
@@ -40,6 +45,10 @@
 #define _stricmp strcasecmp
 #endif
 
+#if defined (_MSC_VER) && _MSC_VER < 1900
+#define snprintf _snprintf
+#endif
+
 /*
 **  -----------------------------------------
 **  Private Typedef and Structure Definitions
@@ -51,6 +60,7 @@ typedef signed long  i32;
 typedef unsigned char  u8;
 typedef unsigned short u16;
 typedef unsigned long  u32;
+typedef unsigned long long u64;
 
 /*
 **  --------------------------
@@ -58,41 +68,13 @@ typedef unsigned long  u32;
 **  --------------------------
 */
 bool file_exists(const char *filename);
-void safecpy(char *dst, char *src, int n);
-bool serialize_int(int value);
-bool serialize_string(char *cp, int size);
-bool deserialize_int(int *vp);
-bool deserialize_string(char *cp, int size);
-bool write_image_file_header(void);
-bool verifyImageFileHeader(void);
-void displayImageFileHeader(bool detailed);
+bool is_stdio(const char *filename);
+FILE *open_file(const char *filename, const char *mode);
+int seek_file(FILE *fp, u64 offset, int origin);
+bool file_size(FILE *fp, u64 *size);
+void safecpy(char *dst, const char *src, int n);
 u16 crc16buf(u16 crc, const u8 *bp, int size);
 
-/*
-**  ----------------
-**  Public Variables
-**  ----------------
-*/
-
-extern FILE *ifp;
-extern FILE *ofp;
-
-extern char magicNumber[10];
-extern char versionNumber[4];
-
-extern char imageName[11];
-extern char imageDescription[200];
-extern char imageDate[20];
-
-extern char controller[100];
-extern int bitRate;
-extern int preamble1Length;
-extern int preamble2Length;
-extern int dataLength;
-extern int postambleLength;
-extern int numberOfCylinders;
-extern int numberOfSectorsPerTrack;
-extern int numberOfHeads;
-extern int microsecondsPerSector;
+#endif /* RK05UTIL_H */
 
 /*---------------------------  End Of File  ------------------------------*/